@@ -15,6 +15,9 @@ To run discovery, you need the following:
 # Executable/library locations
 _base_install_path = Path(__file__).resolve().parent
 gramtools_exec_fpath = str(_base_install_path / "bin" / "gram")
+# Builds with 8 bit (narrow) and 32 bit (wide) coverage counters; `gram` has 16
+gramtools_narrow_exec_fpath = str(_base_install_path / "bin" / "gram_narrow")
+gramtools_wide_exec_fpath = str(_base_install_path / "bin" / "gram_wide")
 gramtools_lib_fpath = str(_base_install_path / "lib")
 
 # For graph construction
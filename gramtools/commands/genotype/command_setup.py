@@ -23,11 +23,32 @@ def setup_parser(common_parser, subparsers):
         help="One or more read files.\n"
         "Valid formats: fastq, sam/bam/cram, fasta, txt; compressed or uncompressed; fuzzy extensions (eg fq, fsq for fastq).\n"
         "Read files can be given after one or several '--reads' argument:"
-        " eg '--reads rf_1.fq rf_2.fq.gz --reads rf_3.bam '",
+        " eg '--reads rf_1.fq rf_2.fq.gz --reads rf_3.bam '\n"
+        "Required unless --from_coverage is used.",
         nargs="+",
         action="append",
         type=str,
-        required=True,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--from_coverage",
+        help="Coverage snapshot written by a previous genotype run"
+        " (coverage/coverage_snapshot.bin in its genotype directory)."
+        " Genotypes its coverage instead of mapping reads, eg to re-run genotyping"
+        " with other parameters.",
+        type=str,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--top_up_coverage",
+        help="Coverage snapshot written by a previous genotype run of the sample."
+        " Only the reads given, new reads of the sample, are mapped, and their coverage"
+        " is added to the snapshot's before genotyping. With --site_memo_dir, sites"
+        " whose coverage and nested site calls did not change keep their previous results.",
+        type=str,
+        required=False,
     )
 
     parser.add_argument(
@@ -44,6 +65,16 @@ def setup_parser(common_parser, subparsers):
         default="haploid",
     )
 
+    parser.add_argument(
+        "--expected_depth",
+        help="The expected sequencing depth of the sample. If given, picks the build"
+        " of gramtools whose coverage counters use least memory without saturating:"
+        " 8 bits up to depth 50, 32 bits from depth 10000, 16 bits otherwise."
+        " Default: None (16 bits).",
+        type=float,
+        required=False,
+    )
+
     parser.add_argument(
         "--max_threads",
         help="Max number of threads to use. Default: 1.",
@@ -59,3 +90,61 @@ def setup_parser(common_parser, subparsers):
         type=int,
         required=False,
     )
+
+    parser.add_argument(
+        "--read_cache_size",
+        help="Number of distinct reads whose mapping gets cached, so that repeated"
+        " reads (e.g. in amplicon or high-depth samples) are only searched once."
+        " Default: 0 (no cache).",
+        type=int,
+        default=0,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--max_search_states",
+        help="Maximum number of search states a read can have during mapping;"
+        " guards against slow mapping in repetitive or nested regions."
+        " Default: 0 (no limit).",
+        type=int,
+        default=0,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--max_sa_interval_width",
+        help="Maximum number of graph positions, summed over all search states,"
+        " a read can map to during mapping. Default: 0 (no limit).",
+        type=int,
+        default=0,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--search_limit_policy",
+        help="What to do with reads exceeding the search limits, which stop being"
+        " extended: drop them, or record the allele coverage of the search states"
+        " reached, without per base coverage. Default: drop.",
+        choices=["drop", "skip_per_base"],
+        default="drop",
+        required=False,
+    )
+
+    parser.add_argument(
+        "--gcp_cache_dir",
+        help="Directory caching the genotype confidences simulated for confidence"
+        " percentiles, so that samples with the same depth model reuse them."
+        " Default: None (no caching).",
+        type=str,
+        required=False,
+    )
+
+    parser.add_argument(
+        "--site_memo_dir",
+        help="Directory holding a memo of site genotyping results, so that samples"
+        " and runs seeing the same site inputs skip the genotyping model. Covered"
+        " sites are kept for the 32 most recently saved depth models."
+        " Default: None (no memo).",
+        type=str,
+        required=False,
+    )
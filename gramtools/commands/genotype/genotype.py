@@ -5,10 +5,15 @@
 import json
 import logging
 import collections
+from pathlib import Path
 
 from pysam import VariantFile
 
-from gramtools import gramtools_exec_fpath
+from gramtools import (
+    gramtools_exec_fpath,
+    gramtools_narrow_exec_fpath,
+    gramtools_wide_exec_fpath,
+)
 from gramtools.commands import common, report
 from gramtools.commands.paths import GenotypePaths
 from gramtools.commands.genotype.seq_region_map import (
@@ -20,8 +25,20 @@ from gramtools.commands.genotype.seq_region_map import (
 
 log = logging.getLogger("gramtools")
 
+## Expected depths up to which the narrow (8 bit, max 255) coverage counter build
+# is used, and from which the wide (32 bit) one is. Both leave headroom for
+# coverage piling up in repeats and for depth variation along the genome.
+NARROW_COUNTER_MAX_DEPTH = 50
+WIDE_COUNTER_MIN_DEPTH = 10000
+
 
 def run(args):
+    if args.reads is None and args.from_coverage is None:
+        log.error("One of --reads and --from_coverage is required")
+        exit(1)
+    if args.top_up_coverage is not None and args.reads is None:
+        log.error("--top_up_coverage requires the new reads, given with --reads")
+        exit(1)
     geno_paths = GenotypePaths(args.geno_dir, args.force)
     geno_paths.setup(args)
 
@@ -65,16 +82,31 @@ def _load_build_report(geno_paths):
     return build_report
 
 
+def _choose_gram_exec(expected_depth) -> str:
+    """
+    Picks the `gram` build whose coverage counter width suits the sample's
+    expected depth, if given and if that build is installed.
+    """
+    chosen = gramtools_exec_fpath
+    if expected_depth is not None:
+        if expected_depth <= NARROW_COUNTER_MAX_DEPTH:
+            chosen = gramtools_narrow_exec_fpath
+        elif expected_depth >= WIDE_COUNTER_MIN_DEPTH:
+            chosen = gramtools_wide_exec_fpath
+    if not Path(chosen).exists():
+        log.warning(f"{chosen} not found, using {gramtools_exec_fpath}")
+        chosen = gramtools_exec_fpath
+    return chosen
+
+
 @report.with_report
 def _execute_command_cpp_genotype(geno_report, action, geno_paths, args):
 
     command = [
-        gramtools_exec_fpath,
+        _choose_gram_exec(args.expected_depth),
         "genotype",
         "--gram_dir",
         str(geno_paths.gram_dir),
-        "--reads",
-        *list(map(str, geno_paths.reads_files)),
         "--sample_id",
         args.sample_id,
         "--ploidy",
@@ -87,8 +119,28 @@ def _execute_command_cpp_genotype(geno_report, action, geno_paths, args):
         str(args.max_threads),
     ]
 
+    if len(geno_paths.reads_files) > 0:
+        command += ["--reads", *list(map(str, geno_paths.reads_files))]
+    if args.from_coverage is not None:
+        command += ["--from_coverage", str(Path(args.from_coverage).resolve())]
+    if args.top_up_coverage is not None:
+        command += [
+            "--top_up_coverage",
+            str(Path(args.top_up_coverage).resolve()),
+        ]
     if args.seed is not None:
         command += ["--seed", str(args.seed)]
+    if args.read_cache_size > 0:
+        command += ["--read_cache_size", str(args.read_cache_size)]
+    if args.max_search_states > 0:
+        command += ["--max_search_states", str(args.max_search_states)]
+    if args.max_sa_interval_width > 0:
+        command += ["--max_sa_interval_width", str(args.max_sa_interval_width)]
+    command += ["--search_limit_policy", args.search_limit_policy]
+    if args.gcp_cache_dir is not None:
+        command += ["--gcp_cache_dir", str(Path(args.gcp_cache_dir).resolve())]
+    if args.site_memo_dir is not None:
+        command += ["--site_memo_dir", str(Path(args.site_memo_dir).resolve())]
     if args.debug:
         command += ["--debug"]
 
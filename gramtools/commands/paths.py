@@ -155,7 +155,7 @@ class GenotypePaths(ProjectPaths):
         super().initial_setup()
         self.reads_dir.mkdir()
         self._link_to_build(args.gram_dir)
-        self._link_to_reads(args.reads)
+        self._link_to_reads(args.reads or [])
 
     def _link_to_build(self, existing_gram_dir):
         """
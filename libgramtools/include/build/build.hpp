@@ -16,6 +16,7 @@
 
 #include "kmer_index/build.hpp"
 #include "kmer_index/dump.hpp"
+#include "kmer_index/kmer_filter.hpp"
 #include "parameters.hpp"
 
 namespace gram::commands::build {
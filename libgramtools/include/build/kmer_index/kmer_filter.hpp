@@ -0,0 +1,113 @@
+/** @file
+ * A compact prefilter over the indexed kmers, used to reject reads that cannot
+ * map before they are looked up in the `gram::KmerIndex`.
+ */
+#ifndef GRAMTOOLS_KMER_FILTER_HPP
+#define GRAMTOOLS_KMER_FILTER_HPP
+
+#include "common/parameters.hpp"
+#include "kmer_index_types.hpp"
+#include "sdsl/int_vector.hpp"
+
+namespace gram {
+
+/** Longest kmer that fits in a 64-bit word, at two bits per base */
+constexpr uint32_t max_packed_kmer_size{32};
+
+/**
+ * Hashes a kmer to 64 bits. Bases are packed two bits each, 32 bases at a time,
+ * and mixed.
+ */
+uint64_t hash_kmer(Sequence::const_iterator const kmer_begin,
+                   Sequence::const_iterator const kmer_end);
+
+/**
+ * Same hash as `hash_kmer`, for a kmer of at most `max_packed_kmer_size` bases
+ * already packed into a word: first base in the highest bits, and each base
+ * `b` (encoded 1-4) stored as `b - 1`.
+ */
+uint64_t hash_packed_kmer(uint64_t const packed_kmer, uint32_t const kmer_size);
+
+/**
+ * Blocked Bloom filter over kmers.
+ *
+ * Each kmer is hashed to a single 512-bit block (one cache line), in which
+ * `num_probes` bits are set. Querying a kmer thus costs at most one cache miss.
+ * There are no false negatives: a kmer that was added is always reported as
+ * possibly present. Absent kmers are reported as present with a small
+ * probability (~0.5% at the default sizing).
+ */
+class KmerFilter {
+ public:
+  static constexpr uint32_t words_per_block{8};  // 8 * 64 bits = 512 bits
+  static constexpr uint32_t num_probes{7};
+  static constexpr uint32_t bits_per_kmer{12};
+
+  KmerFilter() = default;
+
+  /**
+   * Sizes the filter for holding `num_kmers` kmers.
+   */
+  explicit KmerFilter(uint64_t const num_kmers);
+
+  void insert(Sequence const &kmer);
+
+  bool may_contain(Sequence::const_iterator const kmer_begin,
+                   Sequence::const_iterator const kmer_end) const;
+
+  bool may_contain(Sequence const &kmer) const {
+    return may_contain(kmer.begin(), kmer.end());
+  }
+
+  /**
+   * Query with a kmer packed by `hash_packed_kmer`; lets callers roll kmer
+   * words along a read instead of re-reading each kmer.
+   */
+  bool may_contain_packed(uint64_t const packed_kmer,
+                          uint32_t const kmer_size) const {
+    return may_contain_hash(hash_packed_kmer(packed_kmer, kmer_size));
+  }
+
+  /**
+   * @return false if at least one kmer of `read` is certainly not indexed.
+   */
+  bool all_read_kmers_may_occur(uint32_t const &kmer_size,
+                                Sequence const &read) const;
+
+  bool empty() const { return blocks.size() == 0; }
+
+  sdsl::int_vector<64> const &get_blocks() const { return blocks; }
+
+  void set_blocks(sdsl::int_vector<64> const &new_blocks) {
+    blocks = new_blocks;
+  }
+
+ private:
+  std::size_t num_blocks() const { return blocks.size() / words_per_block; }
+
+  bool may_contain_hash(uint64_t const kmer_hash) const;
+
+  /** Index of the first word of the block that `kmer_hash` maps to */
+  uint64_t block_start(uint64_t const kmer_hash) const;
+
+  sdsl::int_vector<64> blocks;
+};
+
+namespace kmer_filter {
+/**
+ * Adds every kmer of `kmer_index` to a filter sized for it.
+ */
+KmerFilter build(KmerIndex const &kmer_index);
+
+void dump(KmerFilter const &kmer_filter, CommonParameters const &parameters);
+
+/**
+ * @return an empty filter if there is no filter file in the gramtools
+ * directory (eg if it was made by an earlier version of `build`).
+ */
+KmerFilter load(CommonParameters const &parameters);
+}  // namespace kmer_filter
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_KMER_FILTER_HPP
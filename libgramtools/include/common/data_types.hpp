@@ -2,7 +2,9 @@
 #define GRAMTOOLS_DATA_TYPES_HPP
 
 #include <cstdint>
+#include <limits>
 #include <set>
+#include <type_traits>
 #include <vector>
 
 #include <sdsl/suffix_arrays.hpp>
@@ -49,7 +51,64 @@ struct DNA_BWT_Masks {
 };
 
 // coverage-related
-using CovCount = uint16_t;
+/**
+ * Width of coverage counters, set at build configuration. gramtools builds a
+ * 16 bit `gram` executable, and optionally narrow (8 bit) and wide (32 bit)
+ * variants of it. Coverage counters stay at their maximum value once it is
+ * reached.
+ */
+#ifndef GRAM_COV_COUNT_BITS
+#define GRAM_COV_COUNT_BITS 16
+#endif
+static_assert(GRAM_COV_COUNT_BITS == 8 || GRAM_COV_COUNT_BITS == 16 ||
+                  GRAM_COV_COUNT_BITS == 32,
+              "Coverage counters must have 8, 16 or 32 bits");
+using CovCount = std::conditional_t<
+    GRAM_COV_COUNT_BITS == 8, uint8_t,
+    std::conditional_t<GRAM_COV_COUNT_BITS == 16, uint16_t, uint32_t>>;
+constexpr CovCount max_cov_count{std::numeric_limits<CovCount>::max()};
+using CovTotal = uint64_t; /**< Sums of coverage counters, which can exceed
+                              `max_cov_count` */
+
+/**
+ * Converts `count` to a coverage counter, saturating at `max_cov_count` (and
+ * at 0 for negative counts).
+ */
+template <typename Count>
+CovCount saturate_cov_count(Count const count) {
+  if (count <= Count{0}) return 0;
+  if constexpr (std::is_floating_point_v<Count>) {
+    if (count >= static_cast<Count>(max_cov_count)) return max_cov_count;
+  } else if (static_cast<CovTotal>(count) >= max_cov_count)
+    return max_cov_count;
+  return static_cast<CovCount>(count);
+}
+
+/**
+ * Coverage counters are stored in files with 32 bits, whatever their width, so
+ * that builds with narrow and wide coverage counters share the files. Stored
+ * counts are read back through `saturate_cov_count`.
+ */
+using StoredCovCount = uint32_t;
+template <typename Counts>
+std::vector<StoredCovCount> stored_cov_counts(Counts const& counts) {
+  return std::vector<StoredCovCount>(counts.begin(), counts.end());
+}
+
+/**
+ * Adds one to `count` unless it is at `max_cov_count`. The check and the
+ * increment are a single atomic compare-exchange, so that threads recording
+ * coverage concurrently can never take `count` past its maximum and wrap it.
+ */
+inline void saturating_increment(CovCount& count) {
+  CovCount current = __atomic_load_n(&count, __ATOMIC_RELAXED);
+  while (current < max_cov_count &&
+         !__atomic_compare_exchange_n(&count, &current,
+                                      static_cast<CovCount>(current + 1), true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
 using PerBaseCoverage = std::vector<CovCount>;   /**< Number of reads mapped to
                                                     each base of an allele */
 using PerAlleleCoverage = std::vector<CovCount>; /**< Number of reads mapped to
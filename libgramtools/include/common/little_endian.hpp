@@ -0,0 +1,129 @@
+/** @file
+ * Reading and writing of binary files whose integers are stored little-endian
+ * at fixed widths, whatever the machine. Floating point numbers are stored as
+ * the bits of their IEEE 754 representation.
+ */
+#ifndef GRAMTOOLS_LITTLE_ENDIAN_HPP
+#define GRAMTOOLS_LITTLE_ENDIAN_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace gram {
+
+/**
+ * Writes integers little-endian, each at the width of its type.
+ */
+class LittleEndianWriter {
+ public:
+  explicit LittleEndianWriter(std::ostream& out) : out(out) {}
+
+  template <typename Int>
+  void write(Int const value) {
+    char bytes[sizeof(Int)];
+    encode(value, bytes);
+    out.write(bytes, sizeof(Int));
+  }
+
+  /** Writes the number of values, then the values. */
+  template <typename Int>
+  void write_all(std::vector<Int> const& values) {
+    write<uint64_t>(values.size());
+    std::string buffer(values.size() * sizeof(Int), '\0');
+    for (std::size_t i = 0; i < values.size(); ++i)
+      encode(values[i], &buffer[i * sizeof(Int)]);
+    out.write(buffer.data(), buffer.size());
+  }
+
+  void write_double(double const value) {
+    static_assert(sizeof(double) == sizeof(uint64_t));
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write<uint64_t>(bits);
+  }
+
+  void write_string(std::string const& value) {
+    write<uint64_t>(value.size());
+    out.write(value.data(), value.size());
+  }
+
+ private:
+  template <typename Int>
+  static void encode(Int const value, char* bytes) {
+    auto const bits = static_cast<std::make_unsigned_t<Int>>(value);
+    for (std::size_t i = 0; i < sizeof(Int); ++i)
+      bytes[i] = static_cast<char>((bits >> (8 * i)) & 0xff);
+  }
+
+  std::ostream& out;
+};
+
+/**
+ * Reads integers written by `LittleEndianWriter`.
+ * Throws if the stream ends early, naming the file as `file_description`.
+ */
+class LittleEndianReader {
+ public:
+  LittleEndianReader(std::istream& in, std::string file_description)
+      : in(in), file_description(std::move(file_description)) {}
+
+  template <typename Int>
+  Int read() {
+    char bytes[sizeof(Int)];
+    read_bytes(bytes, sizeof(Int));
+    return decode<Int>(bytes);
+  }
+
+  template <typename Int>
+  std::vector<Int> read_all() {
+    auto const num_values = read<uint64_t>();
+    std::string buffer(num_values * sizeof(Int), '\0');
+    read_bytes(&buffer[0], buffer.size());
+    std::vector<Int> values(num_values);
+    for (std::size_t i = 0; i < num_values; ++i)
+      values[i] = decode<Int>(&buffer[i * sizeof(Int)]);
+    return values;
+  }
+
+  double read_double() {
+    auto const bits = read<uint64_t>();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::string read_string() {
+    std::string value(read<uint64_t>(), '\0');
+    read_bytes(&value[0], value.size());
+    return value;
+  }
+
+ private:
+  void read_bytes(char* bytes, std::size_t const num_bytes) {
+    in.read(bytes, num_bytes);
+    if (static_cast<std::size_t>(in.gcount()) != num_bytes)
+      throw std::runtime_error("Truncated " + file_description);
+  }
+
+  template <typename Int>
+  static Int decode(char const* bytes) {
+    std::make_unsigned_t<Int> bits = 0;
+    for (std::size_t i = 0; i < sizeof(Int); ++i)
+      bits |= static_cast<std::make_unsigned_t<Int>>(
+                  static_cast<unsigned char>(bytes[i]))
+              << (8 * i);
+    return static_cast<Int>(bits);
+  }
+
+  std::istream& in;
+  std::string file_description;
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_LITTLE_ENDIAN_HPP
@@ -50,6 +50,7 @@ class CommonParameters {
   std::string kmers_stats_fpath;
   std::string sa_intervals_fpath;
   std::string paths_fpath;
+  std::string kmer_filter_fpath;
 
   uint32_t kmers_size;
   uint32_t maximum_threads;
@@ -0,0 +1,41 @@
+/** @file
+ * Hashing of values that are stored in, or name, files.
+ */
+#ifndef GRAMTOOLS_STABLE_HASH_HPP
+#define GRAMTOOLS_STABLE_HASH_HPP
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace gram {
+
+/**
+ * 64-bit FNV-1a hash, which unlike `std::hash` and `boost::hash` gives the
+ * same value on all platforms and library versions, so it can be stored.
+ * Integers are added little-endian, at the width of their type.
+ */
+class StableHash {
+ public:
+  void add(std::string const &bytes) {
+    for (auto const byte : bytes) add_byte(static_cast<uint8_t>(byte));
+  }
+  template <typename Int>
+  void add(Int const value) {
+    auto const bits = static_cast<std::make_unsigned_t<Int>>(value);
+    for (std::size_t i = 0; i < sizeof(Int); ++i)
+      add_byte(static_cast<uint8_t>(bits >> (8 * i)));
+  }
+  uint64_t get() const { return hash; }
+
+ private:
+  void add_byte(uint8_t const byte) {
+    hash ^= byte;
+    hash *= 0x100000001b3;
+  }
+  uint64_t hash{0xcbf29ce484222325};
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_STABLE_HASH_HPP
@@ -1,6 +1,7 @@
 #ifndef ALLELE_EXTRACTER_HPP
 #define ALLELE_EXTRACTER_HPP
 
+#include "allele_paths.hpp"
 #include "prg/types.hpp"
 #include "types.hpp"
 
@@ -18,10 +19,16 @@ Allele extract_ref_allele(covG_ptr start_node, covG_ptr end_node);
  * Class in charge of producing the set of `Allele`s that get genotyped.
  * The procedure scans through each haplogroup of a site, pasting sequence &
  * coverage from previously genotyped (=nested) sites when encountered.
+ * Alleles are produced as `AllelePaths`, through the nodes and nested site
+ * alleles they are made of.
  */
 class AlleleExtracter {
+ public:
+  using Path = AllelePaths::Path;
+  using path_vector = std::vector<Path>;
+
  private:
-  allele_vector alleles;
+  AllelePaths paths;
   gt_sites const* genotyped_sites;
 
  public:
@@ -31,17 +38,27 @@ class AlleleExtracter {
 
   AlleleExtracter(gt_sites& sites) : genotyped_sites(&sites) {}
 
-  allele_vector const get_alleles() const { return alleles; }
+  AllelePaths const& get_paths() const { return paths; }
+  /** Makes all the extracted alleles */
+  allele_vector const get_alleles() const { return paths.materialise_all(); }
+
+  /** A path through the single piece `allele`, with its haplogroup */
+  Path make_path(Allele const& allele);
 
-  void place_ref_as_first_allele(allele_vector& alleles, Allele ref_allele);
+  /**
+   * Places the REF allele first among the paths, which must only be those of
+   * the first haplogroup.
+   */
+  void place_ref_as_first_allele(Allele const& ref_allele);
 
   /**
    * Linear traversal of an allelic haplogroup, extracting all relevant
    * combinations of alleles. In the absence of incident nested sites, always
    * produces a single allele.
+   * @return void because the alleles are added to the extracter's paths
    */
-  allele_vector extract_alleles(AlleleId const haplogroup,
-                                covG_ptr haplogroup_start, covG_ptr site_end);
+  void extract_alleles(AlleleId const haplogroup, covG_ptr haplogroup_start,
+                       covG_ptr site_end);
 
   /**
    * From the set of genotypes of a site, combines them with existing alleles.
@@ -49,8 +66,8 @@ class AlleleExtracter {
    * @param site_index the previously genotyped site
    * @return Cartesian product of `existing` and distinct genotyped alleles
    */
-  allele_vector allele_combine(allele_vector const& existing,
-                               std::size_t site_index);
+  path_vector allele_combine(path_vector const& existing,
+                             std::size_t site_index);
 
   /**
    * From a set of existing alleles, paste sequence and pb coverage to the end
@@ -59,7 +76,7 @@ class AlleleExtracter {
    * @param sequence_node  the haplogroup common node
    * @return void because `existing` is modified in place
    */
-  void allele_paste(allele_vector& existing, covG_ptr sequence_node);
+  void allele_paste(path_vector& existing, covG_ptr sequence_node);
 };
 }  // namespace gram::genotype::infer
 
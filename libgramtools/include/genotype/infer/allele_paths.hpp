@@ -0,0 +1,94 @@
+/**
+ * @file
+ * Candidate alleles of a site, held as paths through pieces of sequence: the
+ * nodes of a haplogroup, and the alleles of the genotyped sites nested in it.
+ *
+ * A site can have thousands of candidate alleles, combining the alleles of its
+ * nested sites, and most of them are only used to compute likelihoods. So each
+ * piece is stored once, and alleles only hold the indices of their pieces.
+ * Their length, coverage and sequence are computed from the pieces when asked
+ * for, and full `Allele`s are only made for the alleles that get output.
+ */
+#ifndef GT_INFER_ALLELE_PATHS
+#define GT_INFER_ALLELE_PATHS
+
+#include "common/stable_hash.hpp"
+#include "types.hpp"
+
+namespace gram::genotype::infer {
+
+class AllelePaths {
+ public:
+  using PieceIndex = uint32_t;
+  using Pieces = std::vector<PieceIndex>;
+
+  struct Path {
+    Pieces pieces;
+    AlleleId haplogroup; /**< Which ID in its site this allele is associated
+                            with */
+    bool callable = true;
+  };
+
+  AllelePaths() = default;
+  /** Each allele makes a path of a single piece */
+  AllelePaths(allele_vector const& alleles);
+
+  /**
+   * Stores a piece for use in paths. The piece's haplogroup is ignored, and so
+   * is its `callable` status, which is set on the paths using it.
+   */
+  PieceIndex add_piece(Allele const& piece);
+  void add_path(Path path);
+  void prepend_path(Path path);
+  void swap_paths(std::size_t first, std::size_t second);
+
+  std::size_t size() const { return paths.size(); }
+  bool empty() const { return paths.empty(); }
+  Path const& at(std::size_t index) const { return paths.at(index); }
+  Path const& operator[](std::size_t index) const { return paths[index]; }
+  std::vector<Path>::const_iterator begin() const { return paths.begin(); }
+  std::vector<Path>::const_iterator end() const { return paths.end(); }
+
+  /*_______Computed from the pieces______*/
+  std::size_t length(Path const& path) const;
+  CovTotal total_coverage(Path const& path) const;
+  /** Average per base coverage, NaN for paths with no sequence */
+  double average_cov(Path const& path) const;
+  std::size_t count_positions_below(Path const& path,
+                                    CovCount threshold) const;
+  /** Equal sequences have equal hashes */
+  uint64_t sequence_hash(Path const& path) const;
+  std::string sequence(Path const& path) const;
+  Allele materialise(Path const& path) const;
+  allele_vector materialise_all() const;
+
+  /**
+   * @return the index of the first path with the same sequence, per base
+   * coverage and haplogroup as `allele`, or `size()` if there is none
+   */
+  std::size_t find(Allele const& allele) const;
+
+  bool has_duplicate_sequences() const;
+
+  /**
+   * Adds the pieces and the paths through them to `hash`: equal for equal
+   * extractions
+   */
+  void add_content(StableHash &hash) const;
+
+ private:
+  struct Piece {
+    std::string sequence;
+    PerBaseCoverage pbCov;
+    CovTotal coverage;
+    uint64_t hash;
+    uint64_t hash_shift; /**< Multiplies a prefix's hash when appending */
+  };
+
+  std::vector<Piece> pieces;
+  std::vector<Path> paths;
+};
+
+}  // namespace gram::genotype::infer
+
+#endif  // GT_INFER_ALLELE_PATHS
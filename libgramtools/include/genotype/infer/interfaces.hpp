@@ -10,6 +10,7 @@
 
 #include "genotype/infer/types.hpp"
 #include "genotype/quasimap/coverage/types.hpp"
+#include "prg/site_hierarchy.hpp"
 #include "prg/types.hpp"
 
 namespace gram::genotype::output_spec {
@@ -105,7 +106,7 @@ class GenotypedSite {
   virtual site_entries get_model_specific_entries() = 0;
   virtual void null_model_specific_entries() = 0;
 
-  std::size_t const& get_num_haplogroups() { return num_haplogroups; }
+  std::size_t const& get_num_haplogroups() const { return num_haplogroups; }
   bool const has_alleles() const { return gtype_info.alleles.size() > 0; }
   bool const has_filter(std::string const& name) const;
 
@@ -137,11 +138,13 @@ class Genotyper {
   coverage_Graph const* cov_graph;
   SitesGroupedAlleleCounts const* gped_covs;
   child_map child_m;
+  SiteHierarchy site_hierarchy;  // Same nesting as `child_m`, for lookups
 
   Genotyper() : cov_graph(nullptr), gped_covs(nullptr) {}
   Genotyper(gt_sites const& sites, child_map const& ch)
       : genotyped_records(sites),
         child_m(ch),
+        site_hierarchy(ch),
         cov_graph(nullptr),
         gped_covs(nullptr) {}
 
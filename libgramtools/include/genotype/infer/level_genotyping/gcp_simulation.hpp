@@ -0,0 +1,69 @@
+/**
+ * @file
+ * Simulation of genotype confidences, used for genotype confidence
+ * percentiles (GCP) when a sample has too few genotyped sites.
+ *
+ * Simulations run in chunks of `gcp_chunk_size` confidences, each drawn with
+ * its own generator seeded from the run's seed and the chunk's number. So the
+ * chunks are simulated in parallel, and the confidences do not depend on the
+ * number of threads. As they only depend on the depth model and the ploidy,
+ * they can be cached on disk and reused by samples sharing these.
+ */
+#ifndef LVLGT_GCP_SIMULATION
+#define LVLGT_GCP_SIMULATION
+
+#include "genotype/parameters.hpp"
+#include "probabilities.hpp"
+
+namespace gram::genotype::infer {
+using namespace probabilities;
+
+constexpr std::size_t gcp_chunk_size{256};
+
+struct GcpSimulationParams {
+  SeedSize seed{42};
+  std::string cache_dirpath; /**< No caching if empty */
+};
+
+/**
+ * @return `num_confidences` simulated genotype confidences, in chunk order
+ * (unsorted). Read from, and added to, the cache if one is used.
+ */
+std::vector<double> simulate_gt_confs(likelihood_related_stats const& l_stats,
+                                      Ploidy const ploidy,
+                                      std::size_t const num_confidences,
+                                      GcpSimulationParams const& params);
+
+/**
+ * Simulates chunks [first_chunk, first_chunk + num_chunks), in parallel.
+ */
+std::vector<double> simulate_gt_conf_chunks(
+    likelihood_related_stats const& l_stats, Ploidy const ploidy,
+    SeedSize const seed, std::size_t const first_chunk,
+    std::size_t const num_chunks);
+
+/**
+ * On-disk store of simulated confidences, one file per depth model, ploidy,
+ * seed and coverage counter width. The file starts with the full key, so that colliding file names
+ * are detected and treated as cache misses.
+ */
+class GcpCache {
+ public:
+  GcpCache(std::string const& dirpath, likelihood_related_stats const& l_stats,
+           Ploidy const ploidy, SeedSize const seed);
+
+  /** @return the cached confidences, empty if there are none */
+  std::vector<double> load() const;
+  void save(std::vector<double> const& confidences) const;
+
+  std::string const& get_key() const { return key; }
+  std::string const& get_fpath() const { return fpath; }
+
+ private:
+  std::string key;
+  std::string fpath;
+};
+
+}  // namespace gram::genotype::infer
+
+#endif  // LVLGT_GCP_SIMULATION
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * Evaluation of the genotype likelihoods of many sites together.
+ *
+ * Sites add the sufficient statistics of their candidate genotypes (coverages
+ * and per allele likelihood terms), in the order a `LevelGenotyperModel`
+ * computes their likelihoods. These are held in one array per statistic, over
+ * which likelihoods are computed in vectorised loops, with the same operations
+ * as the model's. Only the two best genotypes of each site are then kept,
+ * ranked as in a `likelihood_map`, so that the calls are those of the model.
+ *
+ * A batch is specialised per ploidy, like the model, so that haploid batches
+ * store and evaluate nothing for second alleles.
+ */
+#ifndef LVLGT_LIKELIHOOD_BATCH
+#define LVLGT_LIKELIHOOD_BATCH
+
+#include <limits>
+
+#include "model.hpp"
+
+namespace gram::genotype::infer {
+
+/** Number of sites genotyped per batch */
+constexpr std::size_t likelihood_batch_size{4096};
+
+template <Ploidy P>
+class LikelihoodBatch {
+  static_assert(P == Ploidy::Haploid || P == Ploidy::Diploid);
+
+ public:
+  explicit LikelihoodBatch(double log_mean_pb_error);
+
+  /** @return the index of the site whose genotypes get added next */
+  std::size_t add_site();
+
+  /** Haploid batches only */
+  void add_haploid(GtypedIndex allele, CovTotal total_cov,
+                   CovTotal haploid_cov, double allele_log_likelihood);
+
+  /**
+   * Diploid batches only.
+   * The coverages are those of the genotype's haplogroups, in increasing
+   * haplogroup order; the allele terms are in genotype order.
+   * @param halved_covs whether each haplogroup's coverage is split between
+   * several of the site's alleles
+   */
+  void add_diploid(Genotype<Ploidy::Diploid> const& genotype,
+                   CovTotal total_cov, bool same_haplogroup,
+                   std::pair<CovTotal, CovTotal> haploid_covs,
+                   CovTotal shared_cov, std::pair<bool, bool> halved_covs,
+                   std::pair<double, double> allele_log_likelihoods);
+
+  void evaluate();
+
+  std::size_t num_sites() const { return site_starts.size(); }
+  std::size_t num_genotypes() const { return first_alleles.size(); }
+  double log_likelihood(std::size_t genotype) const {
+    return log_likelihoods.at(genotype);
+  }
+  Genotype<P> genotype(std::size_t genotype) const;
+
+  /** Marks the absence of a genotype in `best_two` */
+  static constexpr std::size_t no_genotype{
+      std::numeric_limits<std::size_t>::max()};
+  /**
+   * Needs `evaluate()` first.
+   * @return the site's best and second best genotypes, or `no_genotype`
+   */
+  std::array<std::size_t, 2> best_two(std::size_t site) const;
+
+ private:
+  double log_mean_pb_error;
+
+  std::vector<std::size_t> site_starts;  // First genotype of each site
+
+  // Per genotype
+  std::vector<GtypedIndex> first_alleles, second_alleles;
+  std::vector<double> total_covs, first_covs, second_covs, shared_covs;
+  std::vector<uint8_t> same_haplogroups, first_halved, second_halved;
+  std::vector<double> first_terms, second_terms;
+  std::vector<double> log_likelihoods;
+};
+
+}  // namespace gram::genotype::infer
+
+#endif  // LVLGT_LIKELIHOOD_BATCH
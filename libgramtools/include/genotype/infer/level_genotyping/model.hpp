@@ -1,6 +1,11 @@
 #ifndef LVLGT_MODEL
 #define LVLGT_MODEL
 
+#include <array>
+#include <cassert>
+#include <unordered_map>
+
+#include "genotype/infer/allele_paths.hpp"
 #include "genotype/parameters.hpp"
 #include "probabilities.hpp"
 #include "site.hpp"
@@ -18,13 +23,68 @@ class IncorrectGenotyping : public std::runtime_error {
 
 using multiplicities = std::vector<bool>;
 using likelihood_map = std::multimap<double, GtypedIndices, std::greater<>>;
-using memoised_coverages = std::map<AlleleIds, allele_coverages>;
+/** Coverage summed per allele, which can exceed a coverage counter */
+using AlleleCovTotals = std::vector<CovTotal>;
 using CovPair = std::pair<double, double>;
 
+/** Number of alleles in a genotype of ploidy `P` */
+template <Ploidy P>
+constexpr std::size_t genotype_length = P == Ploidy::Haploid ? 1 : 2;
+/**
+ * A candidate genotype, as indices into its site's alleles. Being sized at
+ * compile time, it needs no allocation.
+ */
+template <Ploidy P>
+using Genotype = std::array<GtypedIndex, genotype_length<P>>;
+
 using namespace probabilities;
 
+template <Ploidy P>
+class LikelihoodBatch;
+
+/**
+ * Coverage shared by each pair of haplogroups of a site, ie the counts of the
+ * allele groups holding both. Filled in one pass over the grouped allele
+ * counts. Sites with few haplogroups store all pairs as an upper triangle;
+ * sites with more store only the pairs that share coverage, in a hash map, as
+ * most pairs of a many-allele site never occur together in an allele group.
+ */
+class SharedCoverages {
+ public:
+  /** The most haplogroups for which all pairs are stored */
+  static constexpr AlleleId max_dense_haplogroups{64};
+
+  SharedCoverages() = default;
+  SharedCoverages(GroupedAlleleCounts const &gp_counts,
+                  AlleleId num_haplogroups);
+
+  /** For two different haplogroups, in any order */
+  CovTotal operator()(AlleleId first, AlleleId second) const {
+    if (first > second) std::swap(first, second);
+    assert(first < second && second < num_haplogroups);
+    if (!is_sparse()) return dense_coverages[dense_index(first, second)];
+    auto const found = sparse_coverages.find(sparse_key(first, second));
+    return found == sparse_coverages.end() ? 0 : found->second;
+  }
+
+  bool is_sparse() const { return num_haplogroups > max_dense_haplogroups; }
+
+ private:
+  std::size_t dense_index(AlleleId const first, AlleleId const second) const {
+    return first * (2 * std::size_t{num_haplogroups} - first - 1) / 2 +
+           (second - first - 1);
+  }
+  static uint64_t sparse_key(AlleleId const first, AlleleId const second) {
+    return static_cast<uint64_t>(first) << 32 | static_cast<uint32_t>(second);
+  }
+
+  AlleleId num_haplogroups{0};
+  std::vector<CovTotal> dense_coverages;
+  std::unordered_map<uint64_t, CovTotal> sparse_coverages;
+};
+
 struct ModelData {
-  allele_vector const input_alleles;
+  AllelePaths const input_alleles;
   GroupedAlleleCounts const gp_counts;
   Ploidy ploidy;
   likelihood_related_stats const *l_stats;
@@ -32,7 +92,7 @@ struct ModelData {
 
   ModelData() : gp_counts() {}
 
-  ModelData(allele_vector const &input_alleles,
+  ModelData(AllelePaths const &input_alleles,
             GroupedAlleleCounts const &gp_counts, Ploidy ploidy,
             likelihood_related_stats const *l_stats, bool debug = false)
       : input_alleles(input_alleles),
@@ -54,20 +114,45 @@ class LevelGenotyperModel : GenotypingModel {
   ModelData data;
 
   // Computed at construction time
-  PerAlleleCoverage haploid_allele_coverages;   /**< Coverage counts compatible
-                                                   with single alleles */
-  PerAlleleCoverage singleton_allele_coverages; /**< Coverage counts unique to
-                                                   single alleles */
-  memoised_coverages computed_coverages;
+  AlleleCovTotals haploid_allele_coverages;   /**< Coverage counts compatible
+                                                 with single alleles */
+  AlleleCovTotals singleton_allele_coverages; /**< Coverage counts unique to
+                                                 single alleles */
+  SharedCoverages shared_coverages;
+  multiplicities haplogroup_multiplicities;
   std::size_t total_coverage;
+  /** Per allele, the likelihood terms that only depend on that allele */
+  std::vector<double> allele_log_likelihoods;
 
   // Computed at run time
-  likelihood_map likelihoods;  // Stores highest likelihoods first
-  site_ptr genotyped_site;     // What the class will build
+  // The likelihood of each genotype, in the order they were computed in, and
+  // the genotypes' alleles, `alleles_per_genotype` at a time
+  std::vector<double> log_likelihoods;
+  GtypedIndices genotyped_alleles;
+  std::size_t alleles_per_genotype{0};
+  site_ptr genotyped_site;  // What the class will build
+  bool awaiting_batch = false;
 
  public:
   LevelGenotyperModel() = default;
-  explicit LevelGenotyperModel(ModelData &input_data);
+  /**
+   * @param batched if true, the likelihoods of sites whose alleles are all
+   * callable are left to a `LikelihoodBatch`: see `add_genotypes` and
+   * `call_genotype`
+   */
+  explicit LevelGenotyperModel(ModelData &input_data, bool batched = false);
+
+  /** Whether the genotype is to be called from a `LikelihoodBatch` */
+  bool awaits_batch() const { return awaiting_batch; }
+  /**
+   * Adds the site's candidate genotypes to `batch`, in the order their
+   * likelihoods are otherwise computed in. `P` must be the site's ploidy.
+   */
+  template <Ploidy P>
+  void add_genotypes(LikelihoodBatch<P> &batch) const;
+  /** Calls the genotype from the site's best genotypes in evaluated `batch` */
+  template <Ploidy P>
+  void call_genotype(LikelihoodBatch<P> const &batch, std::size_t site);
 
   bool ignore_ref_allele() const { return !data.input_alleles.at(0).callable; }
 
@@ -80,18 +165,19 @@ class LevelGenotyperModel : GenotypingModel {
   std::size_t count_total_coverage(GroupedAlleleCounts const &gp_counts);
 
   std::vector<bool> get_haplogroup_multiplicities(
-      allele_vector const &input_alleles);
+      AllelePaths const &input_alleles);
 
   void set_haploid_coverages(GroupedAlleleCounts const &input_gp_counts,
                              AlleleId num_haplogroups);
-  /**
-   * Alleles with no sequence correspond to direct deletions.
-   * In this case they get assigned coverage by this function,
-   * using the grouped allele coverages, as if they had a single base.
-   */
-  void assign_coverage_to_empty_alleles(allele_vector &input_alleles);
+  /** Only diploid genotyping uses the coverage shared by two haplogroups */
+  void set_shared_coverages(GroupedAlleleCounts const &input_gp_counts,
+                            AlleleId num_haplogroups);
 
   /*_______Likelihoods______*/
+  /** Computes the genotype likelihoods and calls the genotype */
+  template <Ploidy P>
+  void genotype();
+
   /**
    * Counts the number of positions in an allele with coverage below threshold
    * `credible_cov_t`. This threshold is the coverage at which true coverage is
@@ -99,33 +185,55 @@ class LevelGenotyperModel : GenotypingModel {
    */
   double fraction_noncredible_positions(Allele const &allele);
 
+  /**
+   * Log-probability of an allele's average coverage, penalised by its fraction
+   * of non-credible positions. It does not depend on the genotype the allele
+   * is in, so it is computed once per allele.
+   */
+  double allele_log_likelihood(Allele const &allele);
+  /**
+   * Alleles with no sequence correspond to direct deletions.
+   * In this case they get assigned coverage using the grouped allele
+   * coverages, as if they had a single base.
+   */
+  void set_allele_log_likelihoods(AllelePaths const &input_alleles);
+
   /**
    * Computes log-likelihood of allelic coverage and stores it.
-   * Handles haploid and diploid flexibly.
+   * @return the log-likelihood
    */
-  void add_likelihood(allele_vector const &alleles,
-                      double const &incompatible_coverage,
-                      GtypedIndices const &allele_indices);
+  template <Ploidy P>
+  double add_likelihood(double incompatible_coverage,
+                        Genotype<P> const &genotype);
+
+  template <Ploidy P>
+  static bool is_callable(AllelePaths const &alleles,
+                          Genotype<P> const &genotype);
 
   /**
    * Haploid genotype likelihood
    */
-  void compute_haploid_log_likelihoods(allele_vector const &input_alleles);
+  void compute_haploid_log_likelihoods(AllelePaths const &input_alleles);
 
   /**
    * Diploid homozygous
    */
   void compute_homozygous_log_likelihoods(
-      allele_vector const &input_alleles,
+      AllelePaths const &input_alleles,
       multiplicities const &haplogroup_multiplicities);
 
   /**
    * Diploid. Because of the large possible number of diploid combinations,
    * (eg for 10 alleles, 45), we only consider for combination those alleles
    * that have at least one unit of coverage unique to them.
+   *
+   * Combinations are also skipped when an upper bound on their likelihood is
+   * below the second best callable likelihood found so far: they can then be
+   * neither the call nor the next best genotype. The bound takes all of both
+   * alleles' haploid coverage as compatible.
    */
   void compute_heterozygous_log_likelihoods(
-      allele_vector const &input_alleles,
+      AllelePaths const &input_alleles,
       multiplicities const &haplogroup_multiplicities);
 
   /** For producing the diploid combinations. */
@@ -139,18 +247,38 @@ class LevelGenotyperModel : GenotypingModel {
    * each.
    */
   std::pair<double, double> compute_diploid_coverage(
-      GroupedAlleleCounts const &gp_counts, AlleleIds haplogroups,
+      AlleleIds const &haplogroups,
+      multiplicities const &haplogroup_multiplicities);
+  std::pair<double, double> compute_diploid_coverage(
+      AlleleId first, AlleleId second,
       multiplicities const &haplogroup_multiplicities);
 
-  std::pair<double, double> diploid_cov_same_haplogroup(
-      AlleleIds const &haplogroups);
+  std::pair<double, double> diploid_cov_same_haplogroup(AlleleId haplogroup);
   std::pair<double, double> diploid_cov_different_haplogroup(
-      GroupedAlleleCounts const &gp_counts, AlleleIds const &ids,
-      multiplicities const &hap_mults);
+      AlleleId first, AlleleId second, multiplicities const &hap_mults);
 
   /*_______Make result______*/
-  void CallGenotype(allele_vector const &input_alleles,
-                    multiplicities hap_mults, Ploidy const ploidy);
+  void CallGenotype(AllelePaths const &input_alleles,
+                    multiplicities const &hap_mults, Ploidy const ploidy);
+  template <Ploidy P>
+  void CallGenotype(AllelePaths const &input_alleles,
+                    multiplicities const &hap_mults);
+
+  /** The genotype whose likelihood is `log_likelihoods[genotype]` */
+  template <Ploidy P>
+  Genotype<P> genotype_at(std::size_t genotype) const;
+
+  /**
+   * Picks best likelihood conditional on the genotype not being
+   * nesting inconsistent, to ensure model cannot choose a parent site allele
+   * inconsistent with child site calls.
+   * Likelihoods are ranked highest first, then in order of computation, as in
+   * a `likelihood_map`.
+   * @return the indices of the chosen and of the next best genotype
+   */
+  template <Ploidy P>
+  std::pair<std::size_t, std::size_t> choose_max_likelihood(
+      AllelePaths const &alleles) const;
 
   /**
    * If coverage differences between chosen allele(s) and next best allele(s)
@@ -158,9 +286,10 @@ class LevelGenotyperModel : GenotypingModel {
    * if any.
    * This propagates uncertainty upwards, reducing overconfidence.
    */
-  void add_next_best_alleles(allele_vector const &input_alleles,
-                             GtypedIndices const &chosen_gt,
-                             GtypedIndices const &next_best_gt);
+  template <Ploidy P>
+  void add_next_best_alleles(AllelePaths const &input_alleles,
+                             Genotype<P> const &chosen_gt,
+                             Genotype<P> const &next_best_gt);
 
   /**
    * If there is no coverage difference between chosen allele(s) and next best
@@ -168,20 +297,15 @@ class LevelGenotyperModel : GenotypingModel {
    * if any.
    * This propagates uncertainty upwards, reducing overconfidence.
    */
-  void add_all_best_alleles(allele_vector const &input_alleles,
-                            GtypedIndices const &chosen_gt,
-                            GtypedIndices const &next_best_gt);
+  template <Ploidy P>
+  void add_all_best_alleles(AllelePaths const &input_alleles,
+                            Genotype<P> const &chosen_gt,
+                            Genotype<P> const &next_best_gt);
 
-  /**
-   * Picks best likelihood conditional on the genotype not being
-   * nesting inconsistent, to ensure model cannot choose a parent site allele
-   * inconsistent with child site calls.
-   */
-  static likelihood_map::const_iterator ChooseMaxLikelihood(
-      likelihood_map const &likelihoods, allele_vector const &alleles);
-
-  AlleleIds get_haplogroups(allele_vector const &alleles,
-                            GtypedIndices const &gtype) const;
+  /** In increasing order */
+  template <Ploidy P>
+  std::array<AlleleId, genotype_length<P>> get_haplogroups(
+      AllelePaths const &alleles, Genotype<P> const &gtype) const;
 
   /**
    * Express genotypes as relative to chosen alleles.
@@ -191,13 +315,17 @@ class LevelGenotyperModel : GenotypingModel {
   GtypedIndices rescale_genotypes(GtypedIndices const &genotypes);
 
   // Getters
-  PerAlleleCoverage const &get_haploid_covs() const {
+  AlleleCovTotals const &get_haploid_covs() const {
     return haploid_allele_coverages;
   }
-  PerAlleleCoverage const &get_singleton_covs() const {
+  AlleleCovTotals const &get_singleton_covs() const {
     return singleton_allele_coverages;
   }
-  likelihood_map const &get_likelihoods() const { return likelihoods; }
+  /** All the genotype likelihoods computed, ranked */
+  likelihood_map get_likelihoods() const;
+  std::vector<double> const &get_allele_log_likelihoods() const {
+    return allele_log_likelihoods;
+  }
 
   gt_site_ptr get_site() override {
     return std::static_pointer_cast<gt_site>(genotyped_site);
@@ -3,6 +3,8 @@
 
 #include <map>
 #include <memory>
+#include <shared_mutex>
+#include <string>
 #include <vector>
 
 #include "genotype/quasimap/coverage/types.hpp"
@@ -14,18 +16,50 @@ using memoised_params = std::map<params, double>;
 class AbstractPmf {
  protected:
   AbstractPmf() = default;
+  // Copies the probabilities, not the mutex guarding them
+  AbstractPmf(AbstractPmf const& other)
+      : probs(other.probs), table(other.table) {}
+  AbstractPmf& operator=(AbstractPmf const& other) {
+    probs = other.probs;
+    table = other.table;
+    return *this;
+  }
   memoised_params probs;  // Memoised probabilities
-  virtual double compute_prob(params const& query) const = 0;
+  std::shared_mutex probs_mutex;
+  std::vector<double> table;  // Probabilities of integer coverages from 0
+  /** Log probability of a single coverage value */
+  virtual double compute_prob(double const coverage) const = 0;
 
  public:
   virtual ~AbstractPmf() = default;
+  /** Safe to call from several threads */
   double operator()(params const& query);
   memoised_params const& get_probs() const { return probs; }
+
+  /**
+   * Computes the probabilities of all integer coverages below `table_size`
+   * upfront. Not safe to call while the pmf is in use.
+   */
+  void tabulate(std::size_t const table_size);
+  std::size_t table_size() const { return table.size(); }
+  /**
+   * Probability of a single coverage value: read from the table if it is a
+   * tabulated integer, else computed. Other values, such as average allele
+   * coverages, rarely repeat, so are not memoised: this takes no lock and
+   * allocates nothing. Safe to call from several threads.
+   */
+  double log_prob(double const coverage) const {
+    if (coverage >= 0 && coverage < table.size()) {
+      auto const index = static_cast<std::size_t>(coverage);
+      if (index == coverage) return table[index];
+    }
+    return compute_prob(coverage);
+  }
 };
 
 class PoissonLogPmf : public AbstractPmf {
   double lambda;
-  double compute_prob(params const& query) const override;
+  double compute_prob(double const coverage) const override;
 
  public:
   PoissonLogPmf() : lambda(0) {}
@@ -35,13 +69,20 @@ class PoissonLogPmf : public AbstractPmf {
 class NegBinomLogPmf : public AbstractPmf {
   // k: number of successes; p: probability of success
   double k, p;
-  double compute_prob(params const& query) const override;
+  double compute_prob(double const coverage) const override;
 
  public:
   explicit NegBinomLogPmf(params const& parameterisation);
 };
 
 using pmf_ptr = std::shared_ptr<AbstractPmf>;
+
+/**
+ * Number of integer coverages to tabulate for a depth distribution: well past
+ * its bulk, and no more than a coverage counter can hold.
+ */
+std::size_t pmf_table_size(double const mean_cov, double const var_cov);
+
 struct DataParams {
   double mean_cov{-1};
   double mean_pb_error{-1};
@@ -55,6 +96,11 @@ struct DataParams {
            num_successes == other.num_successes &&
            success_prob == other.success_prob;
   }
+  /**
+   * The exact parameters as text, in hexadecimal floats, for keying the stored
+   * results of genotyping with them
+   */
+  std::string key() const;
 };
 
 struct likelihood_related_stats {
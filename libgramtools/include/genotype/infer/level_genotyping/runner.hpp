@@ -13,6 +13,7 @@
 
 #define CONF_DISTRIB_SIZE 10000
 
+#include "gcp_simulation.hpp"
 #include "genotype/parameters.hpp"
 #include "probabilities.hpp"
 #include "site.hpp"
@@ -27,10 +28,43 @@ class ReadStats;
 namespace gram::genotype::infer {
 
 using lvlgt_site_ptr = std::shared_ptr<LevelGenotypedSite>;
+using bubble_ptr = covG_ptr_map::value_type const*;
+
+class SiteMemo;
 
 class LevelGenotyper : public Genotyper {
   likelihood_related_stats l_stats;
   Ploidy ploidy;
+  SiteMemo* site_memo = nullptr;
+  uint64_t memo_params_hash{0};
+
+  /**
+   * Genotypes the site of a bubble, then invalidates and filters the sites
+   * nested in it. Reads and modifies no site outside the bubble.
+   * The site's result is looked up in, and added to, the site memo if there is
+   * one.
+   * @return the site's debug information, if `debug`
+   */
+  std::string genotype_bubble(covG_ptr const& site_start,
+                              covG_ptr const& site_end, bool debug);
+
+  /**
+   * Genotypes the sites of bubbles with no nested sites, evaluating their
+   * likelihoods together in a `LikelihoodBatch`. `P` is the run's ploidy.
+   * @param debug_infos where the sites' debug information is set, if `debug`
+   */
+  template <Ploidy P>
+  void genotype_batch(std::vector<bubble_ptr> const& bubbles, bool debug,
+                      std::vector<std::string>& debug_infos);
+
+  /**
+   * Records a genotyped site, then invalidates and filters the sites nested in
+   * it.
+   * @return the site's debug information, if `debug`
+   */
+  std::string record_site(gt_site_ptr const& genotyped_site,
+                          covG_ptr const& site_start, covG_ptr const& site_end,
+                          bool debug);
 
  public:
   LevelGenotyper() = default;
@@ -40,7 +74,9 @@ class LevelGenotyper : public Genotyper {
   LevelGenotyper(coverage_Graph const& cov_graph,
                  SitesGroupedAlleleCounts const& gped_covs,
                  ReadStats const& read_stats, Ploidy ploidy,
-                 bool get_gcp = false, std::string debug_fpath = "");
+                 bool get_gcp = false, std::string debug_fpath = "",
+                 GcpSimulationParams const& gcp_params = {},
+                 SiteMemo* site_memo = nullptr);
 
   header_vec get_model_specific_headers() override;
 
@@ -65,7 +101,7 @@ class LevelGenotyper : public Genotyper {
   static CovCount find_minimum_non_error_cov(double mean_pb_error, pmf_ptr pmf);
   std::vector<double> static get_gtconf_distrib(
       gt_sites const& input_sites, likelihood_related_stats const& input_lstats,
-      Ploidy const& input_ploidy);
+      Ploidy const& input_ploidy, GcpSimulationParams const& gcp_params = {});
 };
 }  // namespace gram::genotype::infer
 
@@ -0,0 +1,144 @@
+/**
+ * @file
+ * Memo of site genotyping results, shared by the samples genotyped against a
+ * PRG, or by runs of a sample.
+ *
+ * The result of genotyping a site only depends on the alleles extracted from
+ * it, which reflect the calls of its nested sites, on its grouped allele
+ * counts, and on the model parameters: ploidy, depth model and debug mode.
+ * These are hashed into the site's key, with a `StableHash` so that saved keys
+ * hold on all platforms, and a site seeing the same inputs again skips the
+ * genotyping model. Sites with no coverage, most of a sample's, are null
+ * genotyped whatever the model parameters, which are then left out of their
+ * key: their results are shared by all samples.
+ *
+ * The memo is saved to a directory in a versioned, little-endian binary format:
+ * sites with no coverage in one file, and the other sites in one file per
+ * model parameters, loaded when those parameters are used or reused. Only the
+ * files of the most recently saved parameters are kept.
+ *
+ * When a sample is topped up with new reads, its depth model changes, so its
+ * covered sites get keys of new parameters. Sites whose inputs did not change,
+ * because neither their coverage nor the calls of their nested sites did, can
+ * then reuse their results under the parameters of the previous run: see
+ * `reuse_params`.
+ */
+#ifndef LVLGT_SITE_MEMO
+#define LVLGT_SITE_MEMO
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "model.hpp"
+
+namespace gram::genotype::infer {
+
+class SiteMemo {
+ public:
+  struct Key {
+    uint64_t site_index;
+    uint64_t params_hash; /**< 0 for sites with no coverage */
+    uint64_t inputs_hash;
+    uint64_t inputs_check; /**< Hash of the inputs from another seed, making
+                              colliding keys unlikely */
+
+    bool operator==(Key const &other) const {
+      return site_index == other.site_index &&
+             params_hash == other.params_hash &&
+             inputs_hash == other.inputs_hash &&
+             inputs_check == other.inputs_check;
+    }
+  };
+
+  SiteMemo() = default;
+
+  /** @param params_hash see `make_params_hash` */
+  static Key make_key(std::size_t site_index, ModelData const &data,
+                      uint64_t params_hash);
+  static uint64_t make_params_hash(likelihood_related_stats const &l_stats,
+                                   Ploidy ploidy, bool debug);
+
+  /**
+   * Records that sites get genotyped with the parameters of `params_hash`, and
+   * adds their entries saved in the directory given to `load`, if any.
+   */
+  void use_params(uint64_t params_hash);
+  /**
+   * Sites not found under the parameters in use are then looked up under those
+   * of `params_hash`, whose saved entries are added as by `use_params`. A site
+   * found that way is stored again under its key.
+   */
+  void reuse_params(uint64_t params_hash);
+
+  /**
+   * @return a copy of the site genotyped from the inputs of `key`, or nullptr.
+   * Thread-safe.
+   */
+  std::shared_ptr<LevelGenotypedSite> find(Key const &key);
+  /**
+   * Stores a copy of a site, as produced by the genotyping model: before it is
+   * positioned in the graph or filtered by other sites. Thread-safe.
+   */
+  void insert(Key const &key, LevelGenotypedSite const &site);
+
+  std::size_t size() const;
+  std::size_t get_num_lookups() const { return num_lookups; }
+  std::size_t get_num_hits() const { return num_hits; }
+  /** The number of hits found under the parameters of `reuse_params` */
+  std::size_t get_num_reused() const { return num_reused; }
+
+  /**
+   * Adds the entries of sites with no coverage saved in `dirpath`, if any, and
+   * those of the parameters used from then on. Entries are only kept if this
+   * version of the model made them.
+   */
+  void load(std::string const &dirpath);
+  /**
+   * Saves the entries of sites with no coverage and of the parameters in use,
+   * each merged with those already saved. The entries of other parameters, eg
+   * of other samples, are kept, up to those of the `max_saved_params` most
+   * recently saved parameters: older ones are evicted, so that the saved memo
+   * does not grow with the number of samples.
+   */
+  void save(std::string const &dirpath,
+            std::size_t max_saved_params = default_max_saved_params) const;
+
+  static constexpr std::size_t default_max_saved_params{32};
+  /** The file of the entries of sites with no coverage */
+  static std::string memo_fpath(std::string const &dirpath);
+  /** The file of the entries of sites genotyped with `params_hash` */
+  static std::string params_memo_fpath(std::string const &dirpath,
+                                       uint64_t params_hash);
+
+ private:
+  struct KeyHash {
+    std::size_t operator()(Key const &key) const {
+      return key.inputs_hash ^ (key.site_index * 0x9e3779b97f4a7c15);
+    }
+  };
+  using Entries = std::unordered_map<Key, std::shared_ptr<LevelGenotypedSite>,
+                                     KeyHash>;
+
+  static Entries read_entries(std::string const &fpath);
+  /** As `read_entries`, warning of and ignoring unreadable files */
+  static Entries read_saved(std::string const &fpath);
+  static void write_entries(std::string const &fpath, Entries const &saved);
+  /** Adds the saved entries of `params_hash`, once. Requires the lock. */
+  void load_params(uint64_t params_hash);
+
+  mutable std::shared_mutex mutex;
+  Entries entries;
+  std::optional<std::string> loaded_dirpath;
+  std::set<uint64_t> loaded_params;
+  std::set<uint64_t> params_in_use;
+  std::optional<uint64_t> reused_params;
+  std::atomic<std::size_t> num_lookups{0}, num_hits{0}, num_reused{0};
+};
+
+}  // namespace gram::genotype::infer
+
+#endif  // LVLGT_SITE_MEMO
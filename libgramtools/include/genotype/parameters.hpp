@@ -6,6 +6,8 @@
 #ifndef GRAMTOOLS_QUASIMAP_PARAMETERS_HPP
 #define GRAMTOOLS_QUASIMAP_PARAMETERS_HPP
 
+#include <optional>
+
 #include "common/parameters.hpp"
 
 namespace gram {
@@ -14,6 +16,29 @@ using SeedSize = uint32_t;
 using Seed = std::optional<SeedSize>;
 using Seeds = std::vector<SeedSize>;
 
+/**
+ * What to do with a read whose search exceeds the `SearchLimits`. Under both
+ * policies, the read stops being extended as soon as the limits are exceeded.
+ *  - drop: record no coverage.
+ *  - skip_per_base: record allele sum and grouped allele counts coverage from
+ * the search states reached, but not per base coverage.
+ */
+enum class SearchLimitPolicy { drop, skip_per_base };
+
+/**
+ * Per-read bounds on the vBWT search, guarding against search state explosion
+ * in repetitive or nested regions. A bound of 0 means no bound.
+ */
+struct SearchLimits {
+  uint64_t max_search_states = 0;
+  uint64_t max_sa_interval_width = 0; /**< Summed over all search states */
+  SearchLimitPolicy policy = SearchLimitPolicy::drop;
+
+  bool bounded() const {
+    return max_search_states > 0 or max_sa_interval_width > 0;
+  }
+};
+
 class GenotypeParams : public CommonParameters {
  public:
   std::vector<std::string> reads_fpaths;
@@ -21,6 +46,7 @@ class GenotypeParams : public CommonParameters {
   std::string allele_sum_coverage_fpath;
   std::string allele_base_coverage_fpath;
   std::string grouped_allele_counts_fpath;
+  std::string coverage_snapshot_fpath;
   std::string read_stats_fpath;
 
   Ploidy ploidy;
@@ -32,6 +58,23 @@ class GenotypeParams : public CommonParameters {
   std::string debug_fpath;
 
   Seed seed = std::nullopt;
+
+  /** Maximum number of distinct reads whose mapping is cached (0: no cache) */
+  uint64_t read_cache_size = 0;
+
+  SearchLimits search_limits = {};
+
+  /** Directory caching simulated genotype confidences (none if empty) */
+  std::string gcp_cache_dirpath;
+
+  /** Directory holding the memo of site genotyping results (none if empty) */
+  std::string site_memo_dirpath;
+
+  /** Coverage snapshot genotyped instead of mapping reads (none if empty) */
+  std::string from_coverage_fpath;
+
+  /** Coverage snapshot the coverage of the reads is added to (none if empty) */
+  std::string top_up_coverage_fpath;
 };
 
 namespace commands::genotype {
@@ -20,6 +20,8 @@ namespace generate {
  * Produces base-level coverage recording structure and populates it with
  * coverage from the `coverage_Graph` The structure is 'flat' so cannot be
  * populated, and returns empty, for a nested PRG.
+ * This copies all per base coverage; `dump::allele_base` does not need it, as
+ * it reads the `coverage_Graph` in place.
  * @see types.hpp
  */
 SitesAlleleBaseCoverage allele_base_non_nested(const PRG_Info& prg_info);
@@ -30,21 +32,37 @@ namespace record {
  * Record base-level coverage for selected `SearchStates`.
  * `SearchStates`, can have different mapping instances going through the same
  * `VariantLocus`.
+ * Uses `prg_info.pb_cov_layout` if it is built, and a `PbCovRecorder`
+ * otherwise. The coverage goes to `coverage.pb_cov_accumulator` if it is set
+ * up, and to the `coverage_Graph` otherwise.
  */
-void allele_base(PRG_Info const& prg_info, SearchStates const& search_states,
+void allele_base(Coverage& coverage, PRG_Info const& prg_info,
+                 SearchStates const& search_states,
                  uint64_t const& read_length);
+
+/**
+ * Adds the per base coverage accumulated in `coverage.pb_cov_accumulator` to
+ * the `coverage_Graph`.
+ */
+void accumulated_allele_base(Coverage& coverage, PRG_Info const& prg_info);
 }  // namespace record
 
 namespace dump {
 /**
- * String serialise the coverage information in JSON format and write it to
- * disk.
+ * String serialise the per base coverage of the `coverage_Graph` in JSON
+ * format and write it to disk. As for `generate::allele_base_non_nested`, the
+ * sites are empty for a nested PRG.
  */
-void allele_base(const Coverage& coverage, const GenotypeParams& parameters);
+void allele_base(const PRG_Info& prg_info, const GenotypeParams& parameters);
 }  // namespace dump
 }  // namespace coverage
 
 std::string dump_allele_base_coverage(const SitesAlleleBaseCoverage& sites);
+/**
+ * Writes the same JSON as the above for the per base coverage of
+ * `prg_info.coverage_graph`, without copying it.
+ */
+void dump_allele_base_coverage(std::ostream& stream, PRG_Info const& prg_info);
 
 /**
  * Compute the (start,end) positions in the prg of a variant site marker.
@@ -0,0 +1,146 @@
+/** @file
+ * Defines the storage of grouped allele counts: `AlleleGroup`, the set of
+ * alleles of a site compatible with a read, and `GroupedAlleleCounts`, the
+ * number of reads seen for each group at a site.
+ *
+ * Groups are bitsets, held in a single machine word for sites with fewer than
+ * `AlleleGroup::word_bits` alleles, and growing into a vector of words beyond.
+ * A site's counts are a vector of (group, count) pairs, sorted by group: most
+ * sites see a handful of distinct groups, for which this is smaller and faster
+ * than a hash map.
+ */
+
+#ifndef GRAMTOOLS_ALLELE_GROUP_HPP
+#define GRAMTOOLS_ALLELE_GROUP_HPP
+
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+#include "common/data_types.hpp"
+
+namespace gram {
+
+class AlleleGroup {
+ public:
+  using Word = uint64_t;
+  static constexpr AlleleId word_bits{64};
+
+  /** Iterates through the group's alleles in increasing order */
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = AlleleId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = AlleleId const*;
+    using reference = AlleleId const&;
+
+    const_iterator(AlleleGroup const* group, AlleleId allele)
+        : group(group), allele(allele) {}
+    reference operator*() const { return allele; }
+    const_iterator& operator++() {
+      allele = group->next_allele(allele + 1);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto previous = *this;
+      ++*this;
+      return previous;
+    }
+    bool operator==(const_iterator const& other) const {
+      return allele == other.allele;
+    }
+    bool operator!=(const_iterator const& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    AlleleGroup const* group;
+    AlleleId allele;
+  };
+  using iterator = const_iterator;
+  using value_type = AlleleId;
+
+  AlleleGroup() = default;
+  AlleleGroup(std::initializer_list<AlleleId> allele_ids);
+  AlleleGroup(AlleleIds const& allele_ids);
+
+  void insert(AlleleId const allele_id);
+  bool contains(AlleleId const allele_id) const;
+  std::size_t size() const;
+  bool empty() const { return first_word == 0 && more_words.empty(); }
+  /** The smallest allele of the (non-empty) group */
+  AlleleId front() const { return *begin(); }
+  AlleleIds to_ids() const { return AlleleIds(begin(), end()); }
+
+  const_iterator begin() const { return {this, next_allele(0)}; }
+  const_iterator end() const { return {this, end_allele()}; }
+
+  bool operator==(AlleleGroup const& other) const {
+    return first_word == other.first_word && more_words == other.more_words;
+  }
+  bool operator!=(AlleleGroup const& other) const { return !(*this == other); }
+  /** An arbitrary total order, used to keep groups sorted */
+  bool operator<(AlleleGroup const& other) const;
+
+  std::size_t hash() const;
+
+ private:
+  std::size_t num_words() const { return 1 + more_words.size(); }
+  Word word(std::size_t const index) const {
+    return index == 0 ? first_word : more_words[index - 1];
+  }
+  AlleleId end_allele() const { return num_words() * word_bits; }
+  /** The first allele of the group from `from` on, or `end_allele()` */
+  AlleleId next_allele(AlleleId const from) const;
+
+  Word first_word{0};
+  // Only allocated for groups with alleles from `word_bits` on. Never ends in
+  // a zero word, so that equal groups have equal words.
+  std::vector<Word> more_words;
+};
+
+struct allele_group_hash {
+  std::size_t operator()(AlleleGroup const& group) const {
+    return group.hash();
+  }
+};
+
+/**
+ * Associates each group of alleles with the number of reads compatible with
+ * exactly that group, at one variant site.
+ */
+class GroupedAlleleCounts {
+ public:
+  using value_type = std::pair<AlleleGroup, CovCount>;
+  using const_iterator = std::vector<value_type>::const_iterator;
+  using iterator = const_iterator;
+
+  GroupedAlleleCounts() = default;
+  GroupedAlleleCounts(std::initializer_list<value_type> group_counts);
+
+  std::size_t size() const { return counts.size(); }
+  bool empty() const { return counts.empty(); }
+  const_iterator begin() const { return counts.begin(); }
+  const_iterator end() const { return counts.end(); }
+
+  const_iterator find(AlleleGroup const& group) const;
+  /** @throws std::out_of_range if `group` has no count */
+  CovCount at(AlleleGroup const& group) const;
+  /** The count of `group`, inserted with value 0 if it has none */
+  CovCount& operator[](AlleleGroup const& group);
+
+  bool operator==(GroupedAlleleCounts const& other) const {
+    return counts == other.counts;
+  }
+  bool operator!=(GroupedAlleleCounts const& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  std::vector<value_type> counts;  // Sorted by group
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_ALLELE_GROUP_HPP
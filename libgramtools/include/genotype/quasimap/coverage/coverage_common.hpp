@@ -22,11 +22,14 @@ namespace gram {
 namespace coverage::record {
 /**
  * Selects read mappings and records all coverage information.
+ * Per base coverage is skipped if `record_per_base` is false.
  * @see selection()
  */
+template <Nesting nesting = Nesting::nested>
 void search_states(Coverage &coverage, const SearchStates &search_states,
                    const uint64_t &read_length, const PRG_Info &prg_info,
-                   SeedSize const &selection_seed = 0);
+                   SeedSize const &selection_seed = 0,
+                   bool const record_per_base = true);
 }  // namespace coverage::record
 
 namespace coverage::generate {
@@ -39,9 +42,11 @@ Coverage empty_structure(const PRG_Info &prg_info);
 
 namespace coverage::dump {
 /**
- * Write coverage information to disk.
+ * Write coverage information to disk. Per base coverage is read from
+ * `prg_info`'s `coverage_Graph`.
  */
-void all(const Coverage &coverage, const GenotypeParams &parameters);
+void all(const Coverage &coverage, const PRG_Info &prg_info,
+         const GenotypeParams &parameters);
 }  // namespace coverage::dump
 
 using SitePath = std::set<Marker>;
@@ -72,7 +77,13 @@ class LocusFinder {
  public:
   LocusFinder() : search_state(), prg_info(nullptr){};
 
-  LocusFinder(SearchState search_state, info_ptr prg_info);
+  LocusFinder(SearchState search_state, info_ptr prg_info)
+      : LocusFinder(search_state, prg_info, NestingTag<Nesting::nested>{}) {}
+
+  /** As above, for a prg with the given `nesting` */
+  template <Nesting nesting>
+  LocusFinder(SearchState search_state, info_ptr prg_info,
+              NestingTag<nesting>);
 
   /** Sanity check: are all variant site markers in the `SearchState` different?
    */
@@ -86,10 +97,18 @@ class LocusFinder {
    */
   void assign_nested_locus(VariantLocus const &var_loc, info_ptr info_ptr);
 
+  /**
+   * Registers a `VariantLocus`. In a flat prg, every site is a level 0 site,
+   * so this skips the lookups of `assign_nested_locus`.
+   */
+  template <Nesting nesting = Nesting::nested>
+  void assign_locus(VariantLocus const &var_loc, info_ptr info_ptr);
+
   /**
    * This function works on the premise that all `VariantLocus` in the
    * `traversing_path` are in the same nested bubble.
    */
+  template <Nesting nesting = Nesting::nested>
   void assign_traversing_loci(SearchState const &search_state,
                               info_ptr prg_info);
 
@@ -97,6 +116,7 @@ class LocusFinder {
     assign_traversing_loci(this->search_state, this->prg_info);
   }
 
+  template <Nesting nesting = Nesting::nested>
   void assign_traversed_loci(SearchState const &search_state,
                              info_ptr prg_info);
 
@@ -146,7 +166,14 @@ class MappingInstanceSelector {
 
   // Constructor
   MappingInstanceSelector(SearchStates const search_states, info_ptr prg_info,
-                          rand_ptr rand_generator);
+                          rand_ptr rand_generator)
+      : MappingInstanceSelector(search_states, prg_info, rand_generator,
+                                NestingTag<Nesting::nested>{}) {}
+
+  /** As above, for a prg with the given `nesting` */
+  template <Nesting nesting>
+  MappingInstanceSelector(SearchStates const search_states, info_ptr prg_info,
+                          rand_ptr rand_generator, NestingTag<nesting>);
 
   // Constructors for testing
   MappingInstanceSelector() : prg_info(nullptr), rand_generator(nullptr) {}
@@ -157,6 +184,7 @@ class MappingInstanceSelector {
   MappingInstanceSelector(info_ptr prg_info, rand_ptr rand_g)
       : prg_info(prg_info), rand_generator(rand_g) {}
 
+  template <Nesting nesting = Nesting::nested>
   void process_searchstates(SearchStates const &all_ss);
 
   void set_searchstates(SearchStates const &ss) { input_search_states = ss; }
@@ -164,6 +192,7 @@ class MappingInstanceSelector {
   /**
    * Dispatches a `SearchState` into `usps` using `LocusFinder`.
    */
+  template <Nesting nesting = Nesting::nested>
   void add_searchstate(SearchState const &ss);
 
   uint32_t count_nonvar_search_states(SearchStates const &search_states);
@@ -17,8 +17,8 @@ namespace gram {
 namespace coverage {
 namespace generate {
 /** Sets up the structure for recording grouped allele counts.
- * The structure is a vector holding, for each variant site of the prg, an
- * unordered_map that can associate together alleles mapped by the same read.
+ * The structure is a vector holding, for each variant site of the prg, a map
+ * that can associate together alleles mapped by the same read.
  * @see SitesGroupedAlleleCounts
  */
 SitesGroupedAlleleCounts grouped_allele_counts(const PRG_Info &prg_info);
@@ -44,21 +44,15 @@ void grouped_allele_counts(const Coverage &coverage,
 }  // namespace coverage
 
 /**
- * Assigns a unique group ID to each distinct `gram::AlleleIds` group.
+ * Assigns a unique group ID to each distinct `gram::AlleleGroup`, from 0, in
+ * order of first appearance in `sites`.
  */
 AlleleGroupHash hash_allele_groups(const SitesGroupedAlleleCounts &sites);
 
-struct numericStringComparator {
-  bool operator()(const std::string &lhs, const std::string &rhs) const {
-    return std::stoi(lhs) < std::stoi(rhs);
-  }
-};
-
-using GroupIDToCounts =
-    std::map<std::string, CovCount, numericStringComparator>;
+/** (group ID, count) pairs, ordered by group ID */
+using GroupIDToCounts = std::vector<std::pair<uint64_t, CovCount>>;
 using SitesGroupIDToCounts = std::vector<GroupIDToCounts>;
-using GroupIDToAlleles =
-    std::map<std::string, AlleleIds, numericStringComparator>;
+using GroupIDToAlleles = std::map<uint64_t, AlleleIds>;
 
 SitesGroupIDToCounts get_group_id_counts(
     SitesGroupedAlleleCounts const &sites,
@@ -67,6 +61,13 @@ SitesGroupIDToCounts get_group_id_counts(
 GroupIDToAlleles get_group_id_alleles(
     AlleleGroupHash const &allele_ids_group_hash);
 
+/**
+ * Writes grouped allele counts as JSON, with the group IDs (JSON object keys)
+ * written straight from their integer values, in increasing order.
+ */
+void write_json(std::ostream &stream, const SitesGroupedAlleleCounts &sites,
+                AlleleGroupHash const &allele_ids_groups_hash);
+
 JSON get_json(const SitesGroupedAlleleCounts &sites,
               AlleleGroupHash const &allele_ids_groups_hash);
 }  // namespace gram
@@ -0,0 +1,55 @@
+/** @file
+ * Defines the coverage snapshot: all the coverage recorded by `quasimap`
+ * (allele sum coverage, grouped allele counts, per base coverage) and the
+ * `ReadStats`, in a versioned, little-endian binary file.
+ *
+ * A snapshot can be loaded back instead of mapping reads, so that genotyping
+ * can be re-run, for example with other parameters, without repeating the
+ * mapping. Per base coverage is stored for the nodes with coverage only, in the
+ * node numbering of the prg's `PbCovLayout`; the snapshot records the layout's
+ * dimensions and a hash of its sequence and structure, and can only be loaded
+ * against the prg it was made from.
+ */
+#ifndef GRAMTOOLS_COVERAGE_SNAPSHOT_HPP
+#define GRAMTOOLS_COVERAGE_SNAPSHOT_HPP
+
+#include "genotype/quasimap/coverage/types.hpp"
+#include "genotype/read_stats.hpp"
+#include "prg/prg_info.hpp"
+
+namespace gram {
+class GenotypeParams;
+
+namespace coverage::dump {
+/**
+ * Writes a snapshot of `coverage`, of the per base coverage of `prg_info`'s
+ * `coverage_Graph` and of `read_stats`.
+ */
+void snapshot(std::ostream &out, Coverage const &coverage,
+              PRG_Info const &prg_info, ReadStats const &read_stats);
+
+/** As above, to `parameters.coverage_snapshot_fpath` */
+void snapshot(Coverage const &coverage, PRG_Info const &prg_info,
+              ReadStats const &read_stats, GenotypeParams const &parameters);
+}  // namespace coverage::dump
+
+namespace coverage::load {
+/**
+ * Adds the coverage of a snapshot to `coverage` and to the per base coverage
+ * of `prg_info`'s `coverage_Graph`. Counts saturate at `max_cov_count`.
+ * `coverage` must have the structure of `coverage::generate::empty_structure`.
+ * @return the snapshot's read stats
+ * @throws std::runtime_error if the snapshot is truncated, of another format
+ * version, or of another prg, including if it refers to alleles the prg's
+ * sites do not have
+ */
+ReadStats snapshot(std::istream &in, Coverage &coverage,
+                   PRG_Info const &prg_info);
+
+/** As above, from the file `fpath` */
+ReadStats snapshot(std::string const &fpath, Coverage &coverage,
+                   PRG_Info const &prg_info);
+}  // namespace coverage::load
+}  // namespace gram
+
+#endif  // GRAMTOOLS_COVERAGE_SNAPSHOT_HPP
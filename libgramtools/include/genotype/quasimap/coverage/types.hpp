@@ -7,6 +7,8 @@
 
 #include "common/data_types.hpp"
 #include "common/utils.hpp"
+#include "genotype/quasimap/coverage/allele_group.hpp"
+#include "prg/per_base_layout.hpp"
 
 namespace gram {
 
@@ -17,14 +19,14 @@ using AlleleSumCoverage =
 /** Vector of `gram::AlleleId`. Used to store different alleles of the same
  * variant site both by a read.*/
 using AlleleIds = std::vector<AlleleId>;
-/* An unordered_map associating a group of alleles (`gram::AlleleIds`) with a
- * count of how many reads mapped to this group.*/
-using GroupedAlleleCounts = SequenceHashMap<AlleleIds, CovCount>;
-/** A vector containing unordered_maps of allele group counts.
- * There is one such map per variant site in the prg.*/
+/** A vector containing maps of allele group counts
+ * (`gram::GroupedAlleleCounts`). There is one such map per variant site in the
+ * prg.*/
 using SitesGroupedAlleleCounts = std::vector<GroupedAlleleCounts>;
 
-using AlleleGroupHash = SequenceHashMap<AlleleIds, uint64_t>;
+/** Associates each `gram::AlleleGroup` with a group ID, for serialisation */
+using AlleleGroupHash =
+    std::unordered_map<AlleleGroup, uint64_t, allele_group_hash>;
 
 using SitePbCoverage =
     std::vector<PerBaseCoverage>; /**< `gram::PerBaseCoverage` for each allele
@@ -39,7 +41,9 @@ using SitesAlleleBaseCoverage =
 struct Coverage {
   AlleleSumCoverage allele_sum_coverage;
   SitesGroupedAlleleCounts grouped_allele_counts;
-  SitesAlleleBaseCoverage allele_base_coverage;
+  /** If not empty, per base coverage is accumulated here during mapping, and
+   * added to the `coverage_Graph` afterwards. */
+  PbCovAccumulator pb_cov_accumulator;
 };
 }  // namespace gram
 
@@ -5,9 +5,11 @@
 #ifndef GRAMTOOLS_QUASIMAP_HPP
 #define GRAMTOOLS_QUASIMAP_HPP
 
+#include "build/kmer_index/kmer_filter.hpp"
 #include "build/kmer_index/kmer_index_types.hpp"
 #include "genotype/parameters.hpp"
 #include "genotype/quasimap/coverage/coverage_common.hpp"
+#include "genotype/quasimap/read_cache.hpp"
 #include "genotype/read_stats.hpp"
 #include "search/encapsulated_search.hpp"
 #include "sequence_read/seqread.hpp"
@@ -18,39 +20,98 @@ struct QuasimapReadsStats {
   uint64_t all_reads_count = 0;
   uint64_t skipped_reads_count = 0;
   uint64_t missing_kmer_reads_count = 0;
+  /** Subset of `missing_kmer_reads_count` caught by the kmer filter */
+  uint64_t kmer_filter_rejected_reads_count = 0;
   uint64_t no_extension_reads_count = 0;
   uint64_t exact_mapped_reads_count = 0;
+  /** Reads not recorded because their search exceeded the search limits */
+  uint64_t search_limit_dropped_reads_count = 0;
+  /** Subset of `exact_mapped_reads_count` recorded without per base coverage */
+  uint64_t search_limit_no_per_base_reads_count = 0;
+  uint64_t read_cache_lookups_count = 0;
+  uint64_t read_cache_hits_count = 0;
   Coverage coverage = {};
 };
 
 /**
  * For each read file, quasimap reads.
+ * Reads are mapped with the routines for the prg's `Nesting`.
+ * @param kmer_filter if provided, used to reject reads with unindexed kmers
+ * before querying the `KmerIndex`.
  */
-QuasimapReadsStats quasimap_reads(const GenotypeParams &parameters,
-                                  const KmerIndex &kmer_index,
-                                  const PRG_Info &prg_info,
-                                  ReadStats &readstats);
+QuasimapReadsStats quasimap_reads(
+    const GenotypeParams &parameters, const KmerIndex &kmer_index,
+    const PRG_Info &prg_info, ReadStats &readstats,
+    KmerFilter const *const kmer_filter = nullptr);
+
+/**
+ * Chooses how many reads to load and map per reads buffer.
+ *
+ * Per-read mapping cost varies by orders of magnitude: off-target reads are
+ * rejected after a hash lookup, while reads in nested sites need heavy vBWT
+ * work. So rather than using a fixed size, each buffer is sized from the cost
+ * per read measured on the previous buffers, to hold about `target_seconds` of
+ * work for the thread pool. This keeps the wait at the end of each buffer, for
+ * the slowest thread, small compared to the buffer's mapping time.
+ */
+class ReadBatchSizer {
+ public:
+  static constexpr uint64_t initial_batch_size{5000};
+  static constexpr uint64_t min_batch_size{1000};
+  static constexpr uint64_t max_batch_size{200000};
+  static constexpr double target_seconds{0.5};
+
+  explicit ReadBatchSizer(uint32_t const num_threads);
+
+  uint64_t batch_size() const { return size; }
+
+  /**
+   * Updates the batch size from the time taken to map a buffer of `num_reads`.
+   */
+  void record(uint64_t const num_reads, double const elapsed_seconds);
+
+  /**
+   * Number of reads threads take at a time from a buffer of `num_reads`:
+   * small enough that each thread takes many chunks, so that threads drawing
+   * cheap reads pick up more work, but large enough to amortise scheduling.
+   */
+  static uint64_t chunk_size(uint64_t const num_reads,
+                             uint32_t const num_threads);
+
+ private:
+  uint32_t num_threads;
+  uint64_t size = initial_batch_size;
+  double thread_seconds_per_read = 0; /**< Running average */
+};
 
 /**
  * Load and process (ie map) reads from a given read file using a buffer to
- * reduce disk I/O calls
+ * reduce disk I/O calls. The buffer size is set by a `ReadBatchSizer`.
  */
+template <Nesting nesting = Nesting::nested>
 void handle_read_file(QuasimapReadsStats &quasimap_stats,
                       const std::string &reads_fpath,
                       const GenotypeParams &parameters,
                       const KmerIndex &kmer_index, const PRG_Info &prg_info,
-                      RandomGenerator *const seed_generator);
+                      RandomGenerator *const seed_generator,
+                      ReadCache *const read_cache = nullptr,
+                      KmerFilter const *const kmer_filter = nullptr);
 
 /**
  * Calls quasimapping routine on a given read (forward mapping), and its reverse
- * complement (reverse mapping)
+ * complement (reverse mapping).
+ * The kmers of both strands are checked in a single pass over the read, so
+ * that only strands which can map go on to backward search.
  */
+template <Nesting nesting = Nesting::nested>
 void quasimap_forward_reverse(QuasimapReadsStats &quasimap_stats,
                               const Sequence &read,
                               const GenotypeParams &parameters,
                               const KmerIndex &kmer_index,
                               const PRG_Info &prg_info,
-                              SeedSize const &selection_seed);
+                              SeedSize const &selection_seed,
+                              ReadCache *const read_cache = nullptr,
+                              KmerFilter const *const kmer_filter = nullptr);
 
 /**
  * Map a read to the prg, starting from the precomputed set of search states
@@ -60,12 +121,68 @@ void quasimap_forward_reverse(QuasimapReadsStats &quasimap_stats,
  * first kmer in the read will be seeded this way.
  * @param prg_info object holding all data structures necessary for vBWT,
  * including `gram::FM_Index`.
+ * @param read_cache if provided, the search is skipped for reads already in
+ * the cache; selection and coverage recording still run for every read.
  * @return
  */
+template <Nesting nesting = Nesting::nested>
 void quasimap_read(const Sequence &read, Coverage &coverage,
                    const KmerIndex &kmer_index, const PRG_Info &prg_info,
                    const GenotypeParams &parameters, QuasimapReadsStats &stats,
-                   SeedSize const &selection_seed = 42);
+                   SeedSize const &selection_seed = 42,
+                   ReadCache *const read_cache = nullptr,
+                   KmerFilter const *const kmer_filter = nullptr);
+
+/**
+ * Runs the kmer checks and the vBWT search of `quasimap_read`, without
+ * recording any coverage.
+ */
+template <Nesting nesting = Nesting::nested>
+ReadMapping search_read(const Sequence &read, const KmerIndex &kmer_index,
+                        const PRG_Info &prg_info,
+                        const GenotypeParams &parameters,
+                        KmerFilter const *const kmer_filter = nullptr);
+
+/**
+ * Backward search of a read whose kmers are all known to be indexed.
+ * The search is bounded by `parameters.search_limits`.
+ */
+template <Nesting nesting = Nesting::nested>
+ReadMapping search_checked_read(const Sequence &read,
+                                const KmerIndex &kmer_index,
+                                const PRG_Info &prg_info,
+                                const GenotypeParams &parameters);
+
+/**
+ * @return true if `search_states` hold more states, or span a wider total SA
+ * interval, than `limits` allow.
+ */
+bool exceeds_search_limits(SearchStates const &search_states,
+                           SearchLimits const &limits);
+
+/**
+ * Result of checking the kmers of a read and of its reverse complement.
+ * An empty rejection means the strand was not checked, or all of its kmers are
+ * indexed.
+ */
+struct StrandsKmerCheck {
+  std::optional<MappingOutcome> forward_rejection;
+  std::optional<MappingOutcome> reverse_rejection;
+};
+
+/**
+ * Checks that all kmers of `read` (forward strand) and of its reverse
+ * complement occur in the index, without materialising the reverse complement.
+ * Both strands are checked together, first against the kmer filter with rolling
+ * kmer words, then against the `KmerIndex` for the strands the filter let
+ * through. Scanning stops as soon as both strands are rejected.
+ */
+StrandsKmerCheck check_strands_kmers(uint32_t const &kmer_size,
+                                     Sequence const &read,
+                                     KmerIndex const &kmer_index,
+                                     KmerFilter const *const kmer_filter,
+                                     bool const check_forward = true,
+                                     bool const check_reverse = true);
 
 /**
  * Fetches a kmer of size `kmer_size`, starting from `offset` (0-based)
@@ -82,18 +199,27 @@ bool all_read_kmers_occur_in_index(uint32_t const &kmer_size,
  * Generates a list of `SearchState`s from a read and a kmer, which is 3'-most
  * kmer in the read. The kmer_index is queried to generate an initial set of
  * `SearchState`s (precomputed at `build` stage) to start from.
+ * The search stops extending the read as soon as the search states exceed
+ * `limits`, which is then recorded in `exceeded_limits`, if given. With the
+ * `drop` policy the states reached so far are returned as is; with the
+ * `skip_per_base` policy they are resolved to allele paths, as complete
+ * searches are.
  * @return SearchStates: a list of `SearchState`s, which at core are an SA
  * interval and a path through the prg (marker-allele ID pairs)
  */
+template <Nesting nesting = Nesting::nested>
 SearchStates search_read_backwards(const Sequence &read, const Sequence &kmer,
                                    const KmerIndex &kmer_index,
-                                   const PRG_Info &prg_info);
+                                   const PRG_Info &prg_info,
+                                   SearchLimits const &limits = SearchLimits{},
+                                   bool *exceeded_limits = nullptr);
 
 /**
  * **The key read mapping procedure**.
  * First updates SA_intervals to search next based on variant marker presence.
  * Then executes regular backward search.
  */
+template <Nesting nesting = Nesting::nested>
 SearchStates process_read_char_search_states(const int_Base &pattern_char,
                                              SearchStates &search_states,
                                              const PRG_Info &prg_info);
@@ -0,0 +1,82 @@
+/** @file
+ * Caches the outcome of vBWT search for recently seen reads, so that
+ * byte-identical reads (common in amplicon and high-depth samples) skip the
+ * search and only go through mapping instance selection and coverage recording.
+ */
+
+#ifndef GRAMTOOLS_READ_CACHE_HPP
+#define GRAMTOOLS_READ_CACHE_HPP
+
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#include "common/utils.hpp"
+#include "genotype/quasimap/search/types.hpp"
+
+namespace gram {
+
+/**
+ * How far a read got through `quasimap_read`.
+ * Stored so that cache hits update the same mapping statistics as a search.
+ */
+enum class MappingOutcome {
+  rejected_by_filter,
+  missing_kmer,
+  no_extension,
+  exceeded_search_limits,
+  mapped_without_per_base,
+  mapped
+};
+
+struct ReadMapping {
+  MappingOutcome outcome = MappingOutcome::missing_kmer;
+  SearchStates search_states = {}; /**< Only non-empty if mapped */
+};
+
+/**
+ * Thread-safe cache from read sequence to `ReadMapping`.
+ *
+ * The cache is split into shards chosen by the read's hash, each with its own
+ * lock, so that threads mapping different reads rarely contend.
+ * Memory is bounded by `max_entries` reads: once a shard is full, its oldest
+ * entry is evicted (first-in first-out).
+ *
+ * Cached `SearchStates` are exactly those a fresh search would produce, so
+ * using the cache does not change mapping output for a given selection seed.
+ */
+class ReadCache {
+ public:
+  ReadCache() = delete;
+  explicit ReadCache(std::size_t const max_entries,
+                     std::size_t const num_shards = 64);
+
+  /**
+   * @return the cached mapping of `read`, if there is one.
+   */
+  std::optional<ReadMapping> find(Sequence const &read);
+
+  void insert(Sequence const &read, ReadMapping const &mapping);
+
+  /** Number of reads currently cached */
+  std::size_t size();
+
+  std::size_t get_max_entries() const { return max_entries; }
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    SequenceHashMap<Sequence, ReadMapping> entries;
+    std::deque<Sequence> insertion_order; /**< Oldest entry first */
+  };
+
+  Shard &get_shard(Sequence const &read);
+
+  std::size_t max_entries;
+  std::size_t max_shard_entries;
+  std::vector<Shard> shards;
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_READ_CACHE_HPP
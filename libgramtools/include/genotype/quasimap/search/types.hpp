@@ -5,6 +5,7 @@
 #define GRAMTOOLS_SEARCH_TYPES_HPP
 
 #include <list>
+#include <type_traits>
 
 #include "common/data_types.hpp"
 
@@ -55,6 +56,17 @@ struct SearchState {
 };
 
 using SearchStates = std::list<SearchState>;
+
+/**
+ * Whether the prg has nested sites (`coverage_Graph::is_nested`).
+ * The search and coverage recording routines which deal with nesting are
+ * compiled for both cases, and the one matching the prg is chosen once it is
+ * loaded: the `flat` version leaves out all handling of nested sites.
+ * The `nested` version is correct for all prgs, and is the default.
+ */
+enum class Nesting { flat, nested };
+template <Nesting nesting>
+using NestingTag = std::integral_constant<Nesting, nesting>;
 }  // namespace gram
 
 #endif  // GRAMTOOLS_SEARCH_TYPES_HPP
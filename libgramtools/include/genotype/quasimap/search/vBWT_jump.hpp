@@ -39,6 +39,7 @@ SA_Interval get_allele_marker_sa_interval(const Marker &allele_marker_char,
  * this is a requirement for mapping to work.
  * @see SearchState()
  */
+template <Nesting nesting = Nesting::nested>
 void process_markers_search_states(SearchStates &current_search_states,
                                    const PRG_Info &prg_info);
 
@@ -66,6 +67,7 @@ MarkersSearchResults left_markers_search(const SearchState &search_state,
  *      1) Does it need to be processed further, due to adjacent variant
  * markers? 2) Does it need to be backward searched?
  */
+template <Nesting nesting = Nesting::nested>
 SearchStates search_state_vBWT_jumps(const SearchState &current_search_state,
                                      const PRG_Info &prg_info);
 
@@ -79,7 +81,10 @@ SearchStates search_state_vBWT_jumps(const SearchState &current_search_state,
  * marker in case of multiple exits.
  *          - an allele marker: when the exit point is followed by an entry
  * point (allele marker)
+ * Only a nested prg has multiple exits, so the `flat` version does not
+ * handle them.
  */
+template <Nesting nesting = Nesting::nested>
 Locus_and_SearchState extend_targets_site_exit(VariantLocus const &target_locus,
                                                SearchState const &search_state,
                                                PRG_Info const &prg_info);
@@ -15,6 +15,9 @@
 
 namespace gram {
 
+class LittleEndianWriter;
+class LittleEndianReader;
+
 class AbstractReadStats {
  public:
   AbstractReadStats()
@@ -22,7 +25,7 @@ class AbstractReadStats {
         variance_cov_depth(-1),
         num_sites_noCov(0),
         num_sites_total(-1) {}
-  using allele_and_cov = std::pair<Allele, CovCount>;
+  using allele_and_cov = std::pair<Allele, CovTotal>;
   virtual ~AbstractReadStats(){};
 
   /**
@@ -81,7 +84,13 @@ class ReadStats : public AbstractReadStats {
    */
   void process_read_perbase_error_rates(AbstractGenomicReadIterator& reads_it);
 
-  using haplogroup_cov = std::pair<AlleleId, CovCount>;
+  /**
+   * Adds the reads processed for `other`'s base error rate to this one's, as if
+   * both sets of reads had been processed together.
+   */
+  void add_base_error_rate(ReadStats const& other);
+
+  using haplogroup_cov = std::pair<AlleleId, CovTotal>;
 
   static haplogroup_cov get_max_cov_haplogroup(
       GroupedAlleleCounts const& gped_cov);
@@ -92,6 +101,10 @@ class ReadStats : public AbstractReadStats {
 
   void serialise(const std::string& json_output_fpath);
 
+  /** Binary (de)serialisation of all statistics, for coverage snapshots */
+  void write(LittleEndianWriter& writer) const;
+  void read(LittleEndianReader& reader);
+
   double const& get_mean_pb_error() const { return mean_pb_error; }
   int64_t const& get_num_bases_processed() const { return num_bases_processed; }
   std::size_t const& get_max_read_len() const { return max_read_length; }
@@ -4,17 +4,19 @@
  *  - Sequence nodes (`coverage_Node`). Each node has:
  *      - Nucleotide sequence
  *      - Outgoing edges (pointers) to other nodes
- *      - Coverage array to store per base coverage for each node
+ *      - Per base coverage, allocated as reads cover the node
+ * (`gram::SparsePbCoverage`)
  *      - Site and allele ID
  *      - A position which refers to that in the original Multiple Sequence
  * Alignment
  *  - A bubble map (`coverage_Graph::bubble_map`), used to order the variant
  * sites for both coverage recording and genotyping
- *  - A parental map (`coverage_Graph::par_map`), used for recording grouped
- * allele counts coverage
+ *  - A parental map (`coverage_Graph::par_map`), and the site hierarchy built
+ * from it (`coverage_Graph::site_hierarchy`), used for recording grouped
+ * allele counts coverage and for genotyping nested sites
  *  - A target map (`coverage_Graph::target_map), used to place new
  * `gram::SearchState`s at variant sites during quasimap.
- *  - A random access array (`coverage_Graph::random_access`) used to place a
+ *  - A random access table (`coverage_Graph::random_access`) used to place a
  * mapped instance in the graph for per base coverage recording.
  */
 #ifndef COV_GRAPH_HPP
@@ -27,8 +29,11 @@
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/vector.hpp>
+#include <limits>
 
 #include "linearised_prg.hpp"
+#include "prg/site_hierarchy.hpp"
+#include "prg/sparse_pb_coverage.hpp"
 #include "prg/types.hpp"
 
 using namespace gram;
@@ -69,6 +74,7 @@ class coverage_Node {
   bool is_bubble_end() const {
     return next.size() == 1 && sequence.size() == 0;
   }
+  bool is_boundary() const { return is_site_boundary; }
 
   /*
    * Getters
@@ -77,8 +83,11 @@ class coverage_Node {
   std::string get_sequence() const { return sequence; }
   std::size_t get_sequence_size() const { return sequence.size(); }
   int get_coverage_space() const { return coverage.size(); }
-  PerBaseCoverage const& get_coverage() const { return coverage; }
-  PerBaseCoverage& get_ref_to_coverage() { return coverage; }
+  /** A copy of the node's coverage, with an entry for each base */
+  PerBaseCoverage get_coverage() const { return coverage.to_dense(); }
+  /** The node's coverage, read in place */
+  SparsePbCoverage const& get_sparse_coverage() const { return coverage; }
+  SparsePbCoverage& get_ref_to_coverage() { return coverage; }
   Marker get_site_ID() const { return site_ID; }
   AlleleId get_allele_ID() const { return allele_ID; }
   std::vector<covG_ptr> const& get_edges() const { return next; }
@@ -92,7 +101,7 @@ class coverage_Node {
   void set_coverage(PerBaseCoverage const& new_cov) {
     assert(new_cov.size() == coverage.size() &&
            new_cov.size() == sequence.size());
-    coverage = new_cov;
+    coverage = SparsePbCoverage(new_cov);
   }
 
   void add_sequence(std::string const& new_seq);
@@ -104,7 +113,7 @@ class coverage_Node {
   Marker site_ID;
   AlleleId allele_ID;
   std::size_t pos;
-  PerBaseCoverage coverage;
+  SparsePbCoverage coverage;
   bool is_site_boundary;
   std::vector<covG_ptr> next;
 
@@ -141,6 +150,109 @@ struct node_access {
   }
 };
 
+/**
+ * Compact table giving the `node_access` of each position of the PRG string.
+ *
+ * Storing one `node_access` per position costs over 32 bytes per base.
+ * Instead:
+ *  - Each node is stored once, and each position stores the number of its node.
+ *  - Offsets are computed from the position at which each node's sequence
+ * starts.
+ *  - Targets are only stored for the positions which have one (those preceded
+ * by a variant marker), and are found by ranking these positions in a bit
+ * vector.
+ */
+class node_access_table {
+ public:
+  node_access_table() = default;
+
+  /** All `num_positions` positions initially refer to no node */
+  explicit node_access_table(std::size_t const num_positions);
+
+  std::size_t size() const { return node_IDs.size(); }
+
+  covG_ptr const& node(std::size_t const pos) const {
+    return nodes[node_IDs[pos]];
+  }
+  std::size_t offset(std::size_t const pos) const {
+    auto const node_start = node_starts[node_IDs[pos]];
+    return node_start == no_sequence ? 0 : pos - node_start;
+  }
+  VariantLocus target(std::size_t const pos) const;
+
+  /**
+   * Nodes are numbered from 1, in the order they were first set; number 0 is
+   * no node, and counts towards `num_numbered_nodes`.
+   */
+  uint32_t node_number(std::size_t const pos) const { return node_IDs[pos]; }
+  std::size_t num_numbered_nodes() const { return nodes.size(); }
+  covG_ptr const& numbered_node(uint32_t const number) const {
+    return nodes[number];
+  }
+
+  node_access operator[](std::size_t const pos) const;
+
+  void set_node(std::size_t const pos, covG_ptr const& node,
+                std::size_t const offset);
+  /** Frees what `set_node` uses to number nodes; no node can be set after. */
+  void done_setting_nodes();
+
+  /** Targets must be set in increasing position order. */
+  void set_target(std::size_t const pos, VariantLocus const& target);
+
+  /** Iterates over the positions' `node_access`es */
+  class const_iterator {
+   public:
+    const_iterator(node_access_table const* table, std::size_t pos)
+        : table(table), pos(pos) {}
+    node_access const& operator*() {
+      access = (*table)[pos];
+      return access;
+    }
+    const_iterator& operator++() {
+      ++pos;
+      return *this;
+    }
+    bool operator!=(const_iterator const& other) const {
+      return pos != other.pos;
+    }
+
+   private:
+    node_access_table const* table;
+    std::size_t pos;
+    node_access access;
+  };
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+ private:
+  static constexpr uint64_t no_sequence{std::numeric_limits<uint64_t>::max()};
+
+  std::vector<covG_ptr> nodes{covG_ptr{}};  // Node number 0 is no node
+  std::vector<uint32_t> node_IDs;
+  std::vector<uint64_t> node_starts{no_sequence};
+  /** Numbers of the nodes already stored; only held while setting nodes. */
+  std::unordered_map<coverage_Node const*, uint32_t> node_numbers;
+
+  std::vector<uint64_t> target_bits;   // One bit per position
+  std::vector<uint64_t> target_ranks;  // Number of targets before each word
+  std::size_t num_ranked_words{0};
+  std::vector<VariantLocus> targets;
+
+  // Boost serialisation
+  friend class boost::serialization::access;
+  template <typename Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& nodes;
+    ar& node_IDs;
+    ar& node_starts;
+    ar& target_bits;
+    ar& target_ranks;
+    ar& num_ranked_words;
+    ar& targets;
+  }
+};
+
 struct targeted_marker {
   Marker ID{0};
   AlleleId direct_deletion_allele{
@@ -194,7 +306,14 @@ class coverage_Graph {
   parental_map par_map;
 
   /**
-   * A vector of the same size as the PRG string, giving access to the
+   * The nesting of sites in `par_map`, in tables indexed by site index.
+   * Not serialised: built from `par_map`.
+   * Use : equivalence class coverage recording, genotyping
+   */
+  SiteHierarchy site_hierarchy;
+
+  /**
+   * A table of the same size as the PRG string, giving access to the
    * corresponding node in the graph. Use : per base coverage recording
    */
   access_vec random_access;
@@ -231,6 +350,8 @@ class coverage_Graph {
     ar& random_access;
     ar& target_map;
     ar& is_nested;
+    if (Archive::is_loading::value)
+      site_hierarchy = SiteHierarchy(par_map, bubble_map.size());
   }
 };
 
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * Defines the `FlatCoverageGraph`, an array-based representation of a
+ * `coverage_Graph`:
+ *  - Nodes are numbered in topological order, the root being node 0, and their
+ * attributes are stored in one array each.
+ *  - Outgoing edges are stored in compressed sparse row (CSR) form.
+ *  - The sequences of all nodes are stored in a single buffer, and so is their
+ * per base coverage, each with per-node offsets.
+ *  - Bubbles, `coverage_Graph::random_access` and the other maps refer to nodes
+ * by their number.
+ *
+ * This is only the graph's storage form: it can be copied, compared or written
+ * out without recursion, and is converted back with `to_coverage_Graph` when
+ * loaded. Everything that reads the graph, from building to coverage recording
+ * and genotyping, runs on the node-based `coverage_Graph`.
+ *
+ * The graph is stored on disk in a versioned binary format: a magic string and
+ * a format version, then each array as its length followed by its elements.
+ * All integers are stored little-endian at fixed widths, whatever the machine.
+ * Per base coverage is stored with 16 bits whatever the width of `CovCount`,
+ * so that the builds with narrow and wide coverage counters share files.
+ */
+#ifndef GRAMTOOLS_FLAT_COVERAGE_GRAPH_HPP
+#define GRAMTOOLS_FLAT_COVERAGE_GRAPH_HPP
+
+#include <iostream>
+#include <string_view>
+
+#include "prg/coverage_graph.hpp"
+
+namespace gram {
+
+using NodeId = uint32_t;
+
+/** A `node_access` referring to its node by number */
+struct flat_node_access {
+  NodeId node;
+  std::size_t offset;
+  VariantLocus target;
+
+  bool operator==(flat_node_access const& other) const {
+    return node == other.node && offset == other.offset &&
+           target == other.target;
+  }
+};
+
+class FlatCoverageGraph {
+ public:
+  FlatCoverageGraph() = default;
+
+  /**
+   * Flattens `cov_graph`. Nodes are numbered in topological order, breaking
+   * ties by visiting outgoing edges in order, so that the number of a node
+   * only depends on the graph's structure.
+   */
+  explicit FlatCoverageGraph(coverage_Graph const& cov_graph);
+
+  /**
+   * Rebuilds the node-based graph, including per base coverage.
+   */
+  coverage_Graph to_coverage_Graph() const;
+
+  std::size_t num_nodes() const { return positions.size(); }
+  NodeId root() const { return 0; }
+
+  /*
+   * Node attributes
+   */
+  std::size_t get_pos(NodeId const node) const { return positions[node]; }
+  Marker get_site_ID(NodeId const node) const { return site_IDs[node]; }
+  AlleleId get_allele_ID(NodeId const node) const { return allele_IDs[node]; }
+  bool is_site_boundary(NodeId const node) const {
+    return site_boundaries[node];
+  }
+
+  std::string_view get_sequence(NodeId const node) const {
+    return std::string_view(sequences).substr(
+        sequence_offsets[node], get_sequence_size(node));
+  }
+  std::size_t get_sequence_size(NodeId const node) const {
+    return sequence_offsets[node + 1] - sequence_offsets[node];
+  }
+  bool has_sequence(NodeId const node) const {
+    return get_sequence_size(node) != 0;
+  }
+
+  /** Coverage of node `node` starts here, and has `get_coverage_space` bases */
+  CovCount const* get_coverage(NodeId const node) const {
+    return coverage.data() + coverage_offsets[node];
+  }
+  CovCount* get_ref_to_coverage(NodeId const node) {
+    return coverage.data() + coverage_offsets[node];
+  }
+  std::size_t get_coverage_space(NodeId const node) const {
+    return coverage_offsets[node + 1] - coverage_offsets[node];
+  }
+  /** Per base coverage of the whole graph, node after node */
+  PerBaseCoverage const& get_all_coverage() const { return coverage; }
+
+  NodeId const* edges_begin(NodeId const node) const {
+    return edge_targets.data() + edge_offsets[node];
+  }
+  NodeId const* edges_end(NodeId const node) const {
+    return edge_targets.data() + edge_offsets[node + 1];
+  }
+  std::size_t get_num_edges(NodeId const node) const {
+    return edge_offsets[node + 1] - edge_offsets[node];
+  }
+  NodeId get_edge(NodeId const node, std::size_t const edge_index) const {
+    return edge_targets[edge_offsets[node] + edge_index];
+  }
+
+  bool is_bubble_start(NodeId const node) const {
+    return get_num_edges(node) > 1 && !has_sequence(node);
+  }
+  bool is_bubble_end(NodeId const node) const {
+    return get_num_edges(node) == 1 && !has_sequence(node);
+  }
+
+  /*
+   * Graph-level structures, mirroring those of `coverage_Graph`
+   */
+  /** (start, end) node of each bubble, in `coverage_Graph::bubble_map` order */
+  std::vector<std::pair<NodeId, NodeId>> const& get_bubbles() const {
+    return bubbles;
+  }
+  std::vector<flat_node_access> const& get_random_access() const {
+    return random_access;
+  }
+  parental_map const& get_par_map() const { return par_map; }
+  target_m const& get_target_map() const { return target_map; }
+  bool is_nested() const { return nested; }
+
+  bool operator==(FlatCoverageGraph const& other) const;
+
+  static constexpr char format_magic[9] = "GRAMCOVG";
+  static constexpr uint32_t format_version{1};
+
+  /**
+   * Writes the graph in the binary coverage graph format.
+   */
+  void serialise(std::ostream& out) const;
+
+  /**
+   * Reads a graph written by `serialise`. Array lengths, offsets and node
+   * numbers are checked, so that the graph can be safely traversed and
+   * converted with `to_coverage_Graph`.
+   * @throws std::runtime_error if `in` does not hold a graph in the current
+   * format version, is truncated, or is inconsistent.
+   */
+  static FlatCoverageGraph deserialise(std::istream& in);
+
+  /**
+   * @return true if `in` starts with the binary coverage graph format's magic
+   * string. The stream is left at its original position.
+   */
+  static bool has_format_magic(std::istream& in);
+
+ private:
+  std::vector<std::size_t> positions;
+  std::vector<Marker> site_IDs;
+  std::vector<AlleleId> allele_IDs;
+  std::vector<bool> site_boundaries;
+
+  std::string sequences;
+  std::vector<uint64_t> sequence_offsets; /**< One more entry than nodes */
+  PerBaseCoverage coverage;
+  std::vector<uint64_t> coverage_offsets; /**< One more entry than nodes */
+  std::vector<NodeId> edge_targets;
+  std::vector<uint64_t> edge_offsets; /**< One more entry than nodes */
+
+  std::vector<std::pair<NodeId, NodeId>> bubbles;
+  std::vector<flat_node_access> random_access;
+  parental_map par_map;
+  target_m target_map;
+  bool nested{false};
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_FLAT_COVERAGE_GRAPH_HPP
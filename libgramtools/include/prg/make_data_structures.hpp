@@ -25,9 +25,21 @@ FM_Index load_fm_index(CommonParameters const &parameters);
  * Cov graph***
  **************/
 
+/**
+ * Builds the coverage graph and writes it to disk, in the binary format of
+ * `FlatCoverageGraph`.
+ */
 coverage_Graph generate_cov_graph(CommonParameters const &parameters,
                                   PRG_String const &prg_string);
 
+/**
+ * Reads the `FlatCoverageGraph` written by `generate_cov_graph` and rebuilds
+ * the node-based graph from it.
+ * @throws std::runtime_error if the file is not in the current coverage graph
+ * format, eg if it was written by an earlier version of `build`.
+ */
+coverage_Graph load_cov_graph(CommonParameters const &parameters);
+
 /**
  * Build child_map from parental_map
  */
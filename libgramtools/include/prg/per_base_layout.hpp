@@ -0,0 +1,183 @@
+/**
+ * @file
+ * Defines the `PbCovLayout`, which places the per base coverage of all
+ * `coverage_Node`s of a `coverage_Graph` in a single coverage space, and turns
+ * a mapped read into the ranges of that space it covers.
+ *
+ * Per base coverage recording used to walk the graph node by node for each
+ * mapping instance, collecting the bases to increment in a map keyed by node.
+ * Here the walk uses arrays precomputed once per graph:
+ *  - the start, in the coverage space, of each node's coverage;
+ *  - for each site entry, the first node of each of its alleles;
+ *  - for each node with a single outgoing edge, the node at which the next
+ * recording or allele choice happens, and the number of invariant bases in
+ * between (the invariant gap).
+ * So a mapping instance costs one step per site and per recorded node, and
+ * produces a short list of (offset, length) ranges to add coverage to.
+ *
+ * Ranges can be added to the graph's coverage directly, or accumulated in a
+ * `PbCovAccumulator` over many reads and added at once.
+ */
+#ifndef GRAMTOOLS_PER_BASE_LAYOUT_HPP
+#define GRAMTOOLS_PER_BASE_LAYOUT_HPP
+
+#include <limits>
+#include <map>
+#include <optional>
+
+#include "genotype/quasimap/search/types.hpp"
+#include "prg/coverage_graph.hpp"
+
+namespace gram {
+
+/**
+ * `length` entries of a `PbCovLayout`'s coverage space from `offset`, all in
+ * the coverage of node number `node`.
+ */
+struct CovRange {
+  uint32_t node;
+  uint64_t offset;
+  uint32_t length;
+
+  bool operator==(CovRange const& other) const {
+    return node == other.node && offset == other.offset &&
+           length == other.length;
+  }
+};
+using CovRanges = std::vector<CovRange>;
+
+/**
+ * Accumulates per base coverage over a coverage space, from several threads
+ * and without atomics.
+ *
+ * Each thread records a range as two updates in its own differences: +1 at the
+ * range's start, -1 just past its end. The coverage of a base is then the
+ * prefix sum of the differences up to it, summed over threads. A thread's
+ * differences are held in blocks of the coverage space, each only allocated
+ * once a range starts or ends in it, so that memory grows with the bases
+ * reads touch rather than with the size of the prg.
+ */
+class PbCovAccumulator {
+ public:
+  using Difference = int32_t;
+  /** Summed differences of the blocks some thread touched, by block number */
+  using BlockDifferences = std::map<std::size_t, std::vector<int64_t>>;
+  static constexpr std::size_t default_block_size{4096};
+
+  PbCovAccumulator() = default;
+  PbCovAccumulator(std::size_t const coverage_space,
+                   uint32_t const num_threads,
+                   std::size_t const block_size = default_block_size);
+
+  bool empty() const { return differences.empty(); }
+  std::size_t coverage_space() const { return space; }
+  std::size_t get_block_size() const { return block_size; }
+
+  /**
+   * Records one unit of coverage over each of `ranges`, which must not overlap
+   * (@see PbCovLayout::merge). Only one thread can use a given `thread` number
+   * at a time.
+   */
+  void add(CovRanges const& ranges, uint32_t const thread);
+
+  /**
+   * @return the differences summed over threads, of the blocks in which some
+   * thread recorded a difference. The differences cover one more entry than
+   * the coverage space. The accumulator is then empty.
+   */
+  BlockDifferences take_differences();
+
+ private:
+  using Block = std::vector<Difference>;  // Empty until touched
+  std::vector<std::vector<Block>> differences;  // Blocks of each thread
+  std::size_t space{0};
+  std::size_t block_size{default_block_size};
+};
+
+class PbCovLayout {
+ public:
+  PbCovLayout() = default;
+
+  /**
+   * Nodes are numbered as in `cov_graph.random_access`, and the nodes it does
+   * not refer to (site entries and exits) are numbered after those.
+   */
+  explicit PbCovLayout(coverage_Graph const& cov_graph);
+
+  bool empty() const { return sizes.empty(); }
+  std::size_t num_nodes() const { return sizes.size(); }
+  /** Total number of per base coverage entries in the graph */
+  std::size_t coverage_space() const { return space; }
+
+  /** Start of the coverage of node `node`, if it records any */
+  std::optional<uint64_t> coverage_offset(uint32_t const node) const;
+  covG_ptr const& get_node(uint32_t const node) const { return nodes[node]; }
+
+  /**
+   * Appends the ranges covered by a read of `read_size` bases whose mapping
+   * starts `offset` bases into node number `node`, then goes through
+   * `traversed_loci`. As in a `SearchState`, the last locus traversed comes
+   * first in `traversed_loci`.
+   */
+  void add_traversal(uint32_t const node, std::size_t const offset,
+                     VariantSitePath const& traversed_loci,
+                     std::size_t const read_size, CovRanges& ranges) const;
+
+  /**
+   * As `add_traversal`, but stops after the first node of the traversal in a
+   * bubble. Used for all mapping instances of a `SearchState` but the first.
+   */
+  void add_traversal_start(uint32_t const node, std::size_t const offset,
+                           VariantSitePath const& traversed_loci,
+                           std::size_t const read_size,
+                           CovRanges& ranges) const;
+
+  /**
+   * Orders `ranges` by offset, and replaces the ranges falling in the same
+   * node by the smallest range containing them all.
+   */
+  static void merge(CovRanges& ranges);
+
+  /**
+   * Increments the coverage of each base in `ranges`, in the graph's nodes.
+   * Coverage stays at its maximum value once it is reached.
+   */
+  void increment(CovRanges const& ranges) const;
+
+  /**
+   * Adds the coverage held in `accumulator`, which is then emptied, to the
+   * graph's nodes, in a single prefix sum over the touched blocks and the
+   * bases covered between them.
+   * Coverage stays at its maximum value once it is reached.
+   */
+  void add_accumulated(PbCovAccumulator& accumulator) const;
+
+ private:
+  void add_ranges(uint32_t node, std::size_t const offset,
+                  VariantSitePath const& traversed_loci,
+                  std::size_t const read_size, CovRanges& ranges,
+                  bool const first_node_only) const;
+
+  static constexpr uint64_t no_coverage{std::numeric_limits<uint64_t>::max()};
+
+  std::vector<covG_ptr> nodes;
+  std::vector<uint32_t> sizes;
+  std::vector<bool> in_bubble;
+  std::vector<uint64_t> coverage_offsets;  // no_coverage if none recorded
+
+  // Outgoing edges, in CSR form. At a site entry, these are the first node of
+  // each allele, in allele order.
+  std::vector<uint32_t> edge_targets;
+  std::vector<uint64_t> edge_offsets;  // One more entry than nodes
+
+  // Nodes with a single outgoing edge: the next node at which to record or
+  // choose an allele, and the number of invariant bases to skip to reach it
+  std::vector<uint32_t> gap_targets;
+  std::vector<uint64_t> gap_lengths;
+
+  std::size_t space{0};
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_PER_BASE_LAYOUT_HPP
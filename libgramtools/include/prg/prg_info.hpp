@@ -12,6 +12,7 @@
 
 #include "common/parameters.hpp"
 #include "prg/coverage_graph.hpp"
+#include "prg/per_base_layout.hpp"
 
 namespace gram {
 
@@ -29,6 +30,8 @@ struct PRG_Info {
   mutable coverage_Graph
       coverage_graph;  // Can pass PRG_Info as const but still mutate this
                        // (record pb coverage)
+  PbCovLayout pb_cov_layout; /**< Supports recording per base coverage in
+                                `coverage_graph`; built after it. */
 
   sdsl::bit_vector bwt_markers_mask; /**< Bit vector flagging variant site
                                         marker presence in bwt.*/
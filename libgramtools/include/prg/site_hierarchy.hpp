@@ -0,0 +1,103 @@
+/**
+ * @file
+ * Defines the `SiteHierarchy`: the nesting relationships of the variant sites
+ * of a PRG, held in dense tables indexed by site index.
+ *
+ * The `parental_map` and `child_map` hold the same relationships in hash maps
+ * keyed by site marker. They are queried per read during coverage recording
+ * and per site during genotyping, where the hashing adds up on deeply nested
+ * PRGs with many sites. Here, for each site:
+ *  - its parent site and the allele of the parent it sits in (no parent for
+ * level 1 sites);
+ *  - its depth, 0 for level 1 sites;
+ *  - its children, as a contiguous range of a single child list (compressed
+ * sparse rows), ordered by the parent allele they sit in;
+ *  - the interval of a preorder walk of the hierarchy spanned by the site and
+ * its descendants, so that testing if a site is an ancestor of another is two
+ * comparisons.
+ */
+#ifndef GRAMTOOLS_SITE_HIERARCHY_HPP
+#define GRAMTOOLS_SITE_HIERARCHY_HPP
+
+#include "prg/types.hpp"
+
+namespace gram {
+
+/** A contiguous range of site markers in a `SiteHierarchy`'s child list */
+class SiteRange {
+ public:
+  using const_iterator = marker_vec::const_iterator;
+
+  SiteRange(const_iterator first, const_iterator last)
+      : first(first), last(last) {}
+  const_iterator begin() const { return first; }
+  const_iterator end() const { return last; }
+  std::size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+
+ private:
+  const_iterator first;
+  const_iterator last;
+};
+
+class SiteHierarchy {
+ public:
+  SiteHierarchy() = default;
+  /**
+   * @param num_sites the number of sites in the PRG; sites without an entry in
+   * `par_map` are level 1 sites.
+   */
+  SiteHierarchy(parental_map const& par_map, std::size_t const num_sites);
+  explicit SiteHierarchy(parental_map const& par_map);
+  explicit SiteHierarchy(child_map const& child_m);
+
+  std::size_t num_sites() const { return parent_sites.size(); }
+
+  /** False for level 1 sites, and for markers not in the hierarchy */
+  bool has_parent(Marker const site_ID) const {
+    auto const index = siteID_to_index(site_ID);
+    return index < num_sites() && parent_sites[index] != 0;
+  }
+  /** @return the parent site and allele of a site which `has_parent` */
+  VariantLocus parent_locus(Marker const site_ID) const {
+    auto const index = siteID_to_index(site_ID);
+    return VariantLocus{parent_sites[index], parent_alleles[index]};
+  }
+  uint32_t depth(Marker const site_ID) const {
+    return depths[siteID_to_index(site_ID)];
+  }
+
+  bool has_children(Marker const site_ID) const {
+    auto const index = siteID_to_index(site_ID);
+    return index < num_sites() &&
+           child_offsets[index] != child_offsets[index + 1];
+  }
+  /** All sites directly nested in the site, across its alleles */
+  SiteRange children(Marker const site_ID) const;
+  /** The sites directly nested in allele `allele_ID` of the site */
+  SiteRange children(Marker const site_ID, AlleleId const allele_ID) const;
+
+  /** True if `site_ID` is `descendant_ID` or one of its ancestors */
+  bool is_ancestor(Marker const site_ID, Marker const descendant_ID) const {
+    auto const index = siteID_to_index(site_ID);
+    auto const descendant_index = siteID_to_index(descendant_ID);
+    return preorder_starts[index] <= preorder_starts[descendant_index] &&
+           preorder_ends[descendant_index] <= preorder_ends[index];
+  }
+
+  bool operator==(SiteHierarchy const& other) const;
+
+ private:
+  std::vector<Marker> parent_sites;  // 0 for level 1 sites
+  std::vector<AlleleId> parent_alleles;
+  std::vector<uint32_t> depths;
+  std::vector<uint64_t> child_offsets;  // num_sites() + 1 entries
+  marker_vec child_sites;
+  // The site's descendants are visited in [start, end) of the preorder walk
+  std::vector<uint32_t> preorder_starts;
+  std::vector<uint32_t> preorder_ends;
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_SITE_HIERARCHY_HPP
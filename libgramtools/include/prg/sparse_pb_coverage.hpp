@@ -0,0 +1,110 @@
+/**
+ * @file
+ * Defines `SparsePbCoverage`, the per base coverage store of a `coverage_Node`.
+ *
+ * In a single sample, most alleles of a large PRG receive no reads. A
+ * `PerBaseCoverage` vector for each in-bubble node pays for every base of
+ * every allele regardless. Here coverage is held in blocks of up to
+ * `block_size` bases, which are only allocated once a base in them gets
+ * coverage. An allele without coverage is just its size and a null block
+ * pointer. Short alleles (the vast majority) fit in a single block, which is
+ * held inline; longer alleles get a table of block pointers.
+ */
+#ifndef GRAMTOOLS_SPARSE_PB_COVERAGE_HPP
+#define GRAMTOOLS_SPARSE_PB_COVERAGE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+#include <memory>
+
+#include "common/data_types.hpp"
+
+namespace gram {
+
+class SparsePbCoverage {
+ public:
+  /** Maximum number of bases allocated together */
+  static constexpr std::size_t block_size{64};
+
+  SparsePbCoverage() = default;
+  /** All `num_bases` bases have zero coverage; nothing is allocated */
+  explicit SparsePbCoverage(std::size_t const num_bases);
+  /** Only the blocks holding non-zero coverage are allocated */
+  explicit SparsePbCoverage(PerBaseCoverage const& dense);
+
+  SparsePbCoverage(SparsePbCoverage const& other);
+  SparsePbCoverage(SparsePbCoverage&& other) noexcept;
+  SparsePbCoverage& operator=(SparsePbCoverage const& other);
+  SparsePbCoverage& operator=(SparsePbCoverage&& other) noexcept;
+  ~SparsePbCoverage();
+
+  std::size_t size() const { return num_bases; }
+  bool empty() const { return num_bases == 0; }
+  /** True if no base has ever been given coverage */
+  bool is_zero() const { return num_allocated_blocks() == 0; }
+  std::size_t num_allocated_blocks() const;
+
+  CovCount operator[](std::size_t const base) const;
+  void set(std::size_t const base, CovCount const value);
+  /**
+   * Adds one to the coverage of `base`, unless it is at its maximum value.
+   * Safe to call from several threads.
+   */
+  void increment(std::size_t const base);
+
+  /** Grows or shrinks to `new_size` bases; added bases have zero coverage */
+  void resize(std::size_t const new_size);
+
+  PerBaseCoverage to_dense() const;
+  /** Appends the coverage of all bases to `dense`, without a temporary copy */
+  void append_to(PerBaseCoverage& dense) const;
+
+  bool operator==(SparsePbCoverage const& other) const;
+  bool operator!=(SparsePbCoverage const& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  using Block = std::atomic<CovCount*>;
+
+  std::size_t num_blocks() const {
+    return (num_bases + block_size - 1) / block_size;
+  }
+  std::size_t block_length(std::size_t const block) const {
+    return std::min(block_size, num_bases - block * block_size);
+  }
+  Block& get_block(std::size_t const block) {
+    return block == 0 ? first_block : other_blocks[block - 1];
+  }
+  Block const& get_block(std::size_t const block) const {
+    return block == 0 ? first_block : other_blocks[block - 1];
+  }
+  /** Allocates the block if no thread has yet; returns its bases */
+  CovCount* touch_block(std::size_t const block);
+  void release();
+
+  std::size_t num_bases{0};
+  Block first_block{nullptr};
+  std::unique_ptr<Block[]> other_blocks;  // Only if more than one block
+
+  // Boost serialisation: written as a `PerBaseCoverage`
+  friend class boost::serialization::access;
+  template <typename Archive>
+  void save(Archive& ar, const unsigned int version) const {
+    auto const dense = to_dense();
+    ar& dense;
+  }
+  template <typename Archive>
+  void load(Archive& ar, const unsigned int version) {
+    PerBaseCoverage dense;
+    ar& dense;
+    *this = SparsePbCoverage(dense);
+  }
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+}  // namespace gram
+
+#endif  // GRAMTOOLS_SPARSE_PB_COVERAGE_HPP
@@ -11,6 +11,7 @@ class coverage_Graph;
 
 class coverage_Node;
 struct node_access;
+class node_access_table;
 struct targeted_marker;
 
 namespace gram {
@@ -21,7 +22,7 @@ struct Allele;
 namespace gram {
 using covG_ptr = boost::shared_ptr<coverage_Node>;
 using marker_to_node = std::unordered_map<Marker, covG_ptr>;
-using access_vec = std::vector<node_access>;
+using access_vec = node_access_table;
 using target_m = std::unordered_map<Marker, std::vector<targeted_marker>>;
 using covG_ptr_map = std::map<covG_ptr, covG_ptr, std::greater<covG_ptr>>;
 
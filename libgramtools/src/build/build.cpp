@@ -68,5 +68,11 @@ void commands::build::run(BuildParams const &parameters) {
   kmer_index::dump(kmer_index, parameters);
   timer.stop();
 
+  std::cout << "Building kmer filter" << std::endl;
+  timer.start("Building kmer filter");
+  auto const kmer_filter = kmer_filter::build(kmer_index);
+  kmer_filter::dump(kmer_filter, parameters);
+  timer.stop();
+
   timer.report();
 }
\ No newline at end of file
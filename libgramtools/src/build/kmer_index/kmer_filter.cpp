@@ -0,0 +1,118 @@
+#include "build/kmer_index/kmer_filter.hpp"
+
+using namespace gram;
+
+namespace {
+/**
+ * Finaliser of the splitmix64 generator: scrambles all input bits into all
+ * output bits.
+ */
+inline uint64_t mix_bits(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+}  // namespace
+
+uint64_t gram::hash_kmer(Sequence::const_iterator const kmer_begin,
+                         Sequence::const_iterator const kmer_end) {
+  uint64_t hash = 0;
+  uint64_t packed = 0;
+  uint32_t num_packed = 0;
+  for (auto it = kmer_begin; it != kmer_end; ++it) {
+    if (num_packed == max_packed_kmer_size) {
+      hash = mix_bits(hash ^ packed);
+      packed = 0;
+      num_packed = 0;
+    }
+    // Bases are encoded 1-4; anything else cannot be an indexed kmer, so its
+    // packing only needs to be deterministic.
+    packed = (packed << 2) | ((*it - 1) & 3);
+    ++num_packed;
+  }
+  return mix_bits(hash ^ packed ^ (uint64_t(num_packed) << 58));
+}
+
+uint64_t gram::hash_packed_kmer(uint64_t const packed_kmer,
+                                uint32_t const kmer_size) {
+  return mix_bits(packed_kmer ^ (uint64_t(kmer_size) << 58));
+}
+
+KmerFilter::KmerFilter(uint64_t const num_kmers) {
+  uint64_t const bits_per_block = 64 * words_per_block;
+  uint64_t num_blocks =
+      (num_kmers * bits_per_kmer + bits_per_block - 1) / bits_per_block;
+  if (num_blocks == 0) num_blocks = 1;
+  blocks = sdsl::int_vector<64>(num_blocks * words_per_block, 0);
+}
+
+/*
+ * The upper 32 bits of the hash select the block; the probe positions inside
+ * the block are 9-bit slices of a second, re-mixed hash.
+ */
+uint64_t KmerFilter::block_start(uint64_t const kmer_hash) const {
+  return ((kmer_hash >> 32) * num_blocks() >> 32) * words_per_block;
+}
+
+void KmerFilter::insert(Sequence const &kmer) {
+  auto const hash = hash_kmer(kmer.begin(), kmer.end());
+  auto const first_word = block_start(hash);
+  auto probes = mix_bits(hash);
+  for (uint32_t i = 0; i < num_probes; ++i) {
+    auto const bit = probes & 511;
+    blocks[first_word + (bit >> 6)] |= uint64_t(1) << (bit & 63);
+    probes >>= 9;
+  }
+}
+
+bool KmerFilter::may_contain(Sequence::const_iterator const kmer_begin,
+                             Sequence::const_iterator const kmer_end) const {
+  return may_contain_hash(hash_kmer(kmer_begin, kmer_end));
+}
+
+bool KmerFilter::may_contain_hash(uint64_t const hash) const {
+  if (empty()) return true;
+  auto const first_word = block_start(hash);
+  auto probes = mix_bits(hash);
+  for (uint32_t i = 0; i < num_probes; ++i) {
+    auto const bit = probes & 511;
+    if (((blocks[first_word + (bit >> 6)] >> (bit & 63)) & 1) == 0)
+      return false;
+    probes >>= 9;
+  }
+  return true;
+}
+
+bool KmerFilter::all_read_kmers_may_occur(uint32_t const &kmer_size,
+                                          Sequence const &read) const {
+  if (read.size() < kmer_size) return true;
+  // The last kmer seeds the search, so it is the most likely to be absent in
+  // off-target reads; test kmers right to left.
+  for (std::size_t end = read.size(); end >= kmer_size; --end) {
+    auto const kmer_end = read.begin() + end;
+    if (not may_contain(kmer_end - kmer_size, kmer_end)) return false;
+  }
+  return true;
+}
+
+KmerFilter kmer_filter::build(KmerIndex const &kmer_index) {
+  KmerFilter kmer_filter(kmer_index.size());
+  for (auto const &entry : kmer_index) kmer_filter.insert(entry.first);
+  return kmer_filter;
+}
+
+void kmer_filter::dump(KmerFilter const &kmer_filter,
+                       CommonParameters const &parameters) {
+  sdsl::store_to_file(kmer_filter.get_blocks(), parameters.kmer_filter_fpath);
+}
+
+KmerFilter kmer_filter::load(CommonParameters const &parameters) {
+  KmerFilter kmer_filter;
+  sdsl::int_vector<64> blocks;
+  if (sdsl::load_from_file(blocks, parameters.kmer_filter_fpath))
+    kmer_filter.set_blocks(blocks);
+  return kmer_filter;
+}
@@ -37,4 +37,5 @@ void gram::fill_common_parameters(CommonParameters& parameters,
   parameters.kmers_stats_fpath = full_path(gram_dirpath, "kmers_stats");
   parameters.sa_intervals_fpath = full_path(gram_dirpath, "sa_intervals");
   parameters.paths_fpath = full_path(gram_dirpath, "paths");
+  parameters.kmer_filter_fpath = full_path(gram_dirpath, "kmer_filter");
 }
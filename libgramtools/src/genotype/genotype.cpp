@@ -1,12 +1,15 @@
 #include "genotype/genotype.hpp"
 
+#include "build/kmer_index/kmer_filter.hpp"
 #include "build/kmer_index/load.hpp"
 #include "common/timer_report.hpp"
 #include "genotype/infer/level_genotyping/runner.hpp"
+#include "genotype/infer/level_genotyping/site_memo.hpp"
 #include "genotype/infer/output_specs/make_json.hpp"
 #include "genotype/infer/output_specs/make_vcf.hpp"
 #include "genotype/infer/output_specs/segment_tracker.hpp"
 #include "genotype/infer/personalised_reference.hpp"
+#include "genotype/quasimap/coverage/snapshot.hpp"
 #include "genotype/quasimap/quasimap.hpp"
 
 using namespace gram;
@@ -19,36 +22,27 @@ void write_deduped_p_refs(Fastas const& p_refs, std::string const& fpath) {
   for (auto& p_ref : deduped_p_refs) pers_ref_fhandle << p_ref << std::endl;
   pers_ref_fhandle.close();
 }
-}  // namespace gram::genotype
-
-void gram::commands::genotype::run(GenotypeParams const& parameters,
-                                   bool const& debug) {
-  auto timer = TimerReport();
-  /**
-   * Quasimap
-   */
-  std::cout << "Executing genotype command" << std::endl;
 
-  ReadStats readstats;
+Coverage map_reads(GenotypeParams const& parameters, PRG_Info const& prg_info,
+                   ReadStats& readstats, TimerReport& timer) {
   std::string first_reads_fpath = parameters.reads_fpaths[0];
   readstats.compute_base_error_rate(first_reads_fpath);
 
-  timer.start("Load data");
-  std::cout << "Loading PRG data" << std::endl;
-  const auto prg_info = load_prg_info(parameters);
+  timer.start("Load kmer index");
   std::cout << "Loading kmer index data" << std::endl;
   const auto kmer_index = kmer_index::load(parameters);
+  const auto kmer_filter = kmer_filter::load(parameters);
+  if (kmer_filter.empty())
+    std::cout << "No kmer filter found; reads are checked against the kmer "
+                 "index only"
+              << std::endl;
   timer.stop();
 
   std::cout << "Running quasimap" << std::endl;
   timer.start("Quasimap");
   auto quasimap_stats =
-      quasimap_reads(parameters, kmer_index, prg_info, readstats);
-
-  // Commit the read stats into quasimap output dir.
-  std::cout << "Writing read stats to " << parameters.read_stats_fpath
-            << std::endl;
-  readstats.serialise(parameters.read_stats_fpath);
+      quasimap_reads(parameters, kmer_index, prg_info, readstats,
+                     kmer_filter.empty() ? nullptr : &kmer_filter);
 
   std::cout << std::endl;
   std::cout
@@ -60,12 +54,82 @@ void gram::commands::genotype::run(GenotypeParams const& parameters,
             << quasimap_stats.skipped_reads_count << std::endl;
   std::cout << "Count reads with >0 kmers not in kmer index: "
             << quasimap_stats.missing_kmer_reads_count << std::endl;
+  std::cout << "  of which rejected by kmer filter: "
+            << quasimap_stats.kmer_filter_rejected_reads_count << std::endl;
   std::cout << "Count reads with no exact mapping: "
             << quasimap_stats.no_extension_reads_count << std::endl;
   std::cout << "Count exact mapped reads: "
             << quasimap_stats.exact_mapped_reads_count << std::endl;
+  if (parameters.search_limits.bounded()) {
+    std::cout << "Count reads dropped for exceeding search limits: "
+              << quasimap_stats.search_limit_dropped_reads_count << std::endl;
+    std::cout << "  of exact mapped reads, recorded without per base coverage: "
+              << quasimap_stats.search_limit_no_per_base_reads_count
+              << std::endl;
+  }
+  if (quasimap_stats.read_cache_lookups_count > 0) {
+    auto const hit_rate = (double)quasimap_stats.read_cache_hits_count /
+                          quasimap_stats.read_cache_lookups_count;
+    std::cout << "Count reads found in read cache: "
+              << quasimap_stats.read_cache_hits_count << " (hit rate: "
+              << hit_rate << ")" << std::endl;
+  }
+  timer.stop();
+  return std::move(quasimap_stats.coverage);
+}
+}  // namespace gram::genotype
+
+void gram::commands::genotype::run(GenotypeParams const& parameters,
+                                   bool const& debug) {
+  auto timer = TimerReport();
+  /**
+   * Quasimap
+   */
+  std::cout << "Executing genotype command" << std::endl;
+  std::cout << "Coverage counter width: " << GRAM_COV_COUNT_BITS
+            << " bits (maximum " << static_cast<CovTotal>(max_cov_count)
+            << ")" << std::endl;
+
+  timer.start("Load data");
+  std::cout << "Loading PRG data" << std::endl;
+  const auto prg_info = load_prg_info(parameters);
   timer.stop();
 
+  Coverage coverage;
+  ReadStats readstats;
+  std::optional<ReadStats> previous_readstats;
+  if (parameters.from_coverage_fpath.empty()) {
+    coverage = map_reads(parameters, prg_info, readstats, timer);
+    if (not parameters.top_up_coverage_fpath.empty()) {
+      timer.start("Top up coverage");
+      std::cout << "Adding coverage snapshot "
+                << parameters.top_up_coverage_fpath << std::endl;
+      previous_readstats = coverage::load::snapshot(
+          parameters.top_up_coverage_fpath, coverage, prg_info);
+      readstats.add_base_error_rate(previous_readstats.value());
+      readstats.compute_coverage_depth(coverage, prg_info.coverage_graph);
+      coverage::dump::all(coverage, prg_info, parameters);
+      timer.stop();
+    }
+  } else {
+    timer.start("Load coverage");
+    std::cout << "Loading coverage snapshot "
+              << parameters.from_coverage_fpath << std::endl;
+    coverage = coverage::generate::empty_structure(prg_info);
+    readstats = coverage::load::snapshot(parameters.from_coverage_fpath,
+                                         coverage, prg_info);
+    coverage::dump::all(coverage, prg_info, parameters);
+    timer.stop();
+  }
+
+  // Commit the read stats and coverage into quasimap output dir.
+  std::cout << "Writing read stats to " << parameters.read_stats_fpath
+            << std::endl;
+  readstats.serialise(parameters.read_stats_fpath);
+  std::cout << "Writing coverage snapshot to "
+            << parameters.coverage_snapshot_fpath << std::endl;
+  coverage::dump::snapshot(coverage, prg_info, readstats, parameters);
+
   /**
    * Infer
    */
@@ -81,13 +145,44 @@ void gram::commands::genotype::run(GenotypeParams const& parameters,
               << std::endl;
   }
 
+  GcpSimulationParams gcp_params;
+  if (parameters.seed.has_value()) gcp_params.seed = parameters.seed.value();
+  gcp_params.cache_dirpath = parameters.gcp_cache_dirpath;
+
+  SiteMemo site_memo;
+  bool const use_site_memo = not parameters.site_memo_dirpath.empty();
+  if (use_site_memo) {
+    std::cout << "Loading site memo from " << parameters.site_memo_dirpath
+              << std::endl;
+    site_memo.load(parameters.site_memo_dirpath);
+    // Sites whose inputs did not change keep the results of the previous run
+    if (previous_readstats.has_value()) {
+      auto const previous_l_stats = LevelGenotyper::make_l_stats(
+          previous_readstats->get_mean_cov(), previous_readstats->get_var_cov(),
+          previous_readstats->get_mean_pb_error());
+      site_memo.reuse_params(SiteMemo::make_params_hash(
+          previous_l_stats, parameters.ploidy, not debug_file.empty()));
+    }
+  }
+
   std::cout << "Running genotyping model" << std::endl;
   LevelGenotyper genotyper{prg_info.coverage_graph,
-                           quasimap_stats.coverage.grouped_allele_counts,
+                           coverage.grouped_allele_counts,
                            readstats,
                            parameters.ploidy,
                            true,
-                           debug_file};
+                           debug_file,
+                           gcp_params,
+                           use_site_memo ? &site_memo : nullptr};
+
+  if (use_site_memo) {
+    std::cout << "Count sites found in site memo: " << site_memo.get_num_hits()
+              << " of " << site_memo.get_num_lookups() << std::endl;
+    if (previous_readstats.has_value())
+      std::cout << "  of which reused from the previous run: "
+                << site_memo.get_num_reused() << std::endl;
+    site_memo.save(parameters.site_memo_dirpath);
+  }
 
   std::ifstream coords_file(parameters.prg_coords_fpath);
   SegmentTracker tracker(coords_file);
@@ -14,16 +14,17 @@ AlleleExtracter::AlleleExtracter(covG_ptr site_start, covG_ptr site_end,
   AlleleId haplogroup_ID{FIRST_ALLELE};
 
   for (auto& haplogroup_start_node : site_start->get_edges()) {
-    allele_vector extracted_alleles =
-        extract_alleles(haplogroup_ID, haplogroup_start_node, site_end);
-    alleles.insert(alleles.end(), extracted_alleles.begin(),
-                   extracted_alleles.end());
+    extract_alleles(haplogroup_ID, haplogroup_start_node, site_end);
     haplogroup_ID++;
   }
 }
 
-allele_vector AlleleExtracter::allele_combine(allele_vector const& existing,
-                                              std::size_t site_index) {
+AlleleExtracter::Path AlleleExtracter::make_path(Allele const& allele) {
+  return Path{{paths.add_piece(allele)}, allele.haplogroup, allele.callable};
+}
+
+AlleleExtracter::path_vector AlleleExtracter::allele_combine(
+    path_vector const& existing, std::size_t site_index) {
   // Sanity check: site_index refers to actual site
   assert(0 <= site_index && site_index < genotyped_sites->size());
   gt_site_ptr referent_site = genotyped_sites->at(site_index);
@@ -44,33 +45,43 @@ allele_vector AlleleExtracter::allele_combine(allele_vector const& existing,
   while (existing.size() * relevant_alleles.size() > MAX_COMBINATIONS)
     relevant_alleles.resize(relevant_alleles.size() - 1);
 
-  allele_vector combinations(existing.size() * relevant_alleles.size());
-
-  std::size_t insertion_index{0};
-  for (auto const& allele : existing) {
-    for (auto const& added_allele : relevant_alleles) {
-      combinations.at(insertion_index) = allele + added_allele;
-      ++insertion_index;
+  // Each added allele is stored once, and referred to by its combinations
+  std::vector<AllelePaths::PieceIndex> added_pieces;
+  added_pieces.reserve(relevant_alleles.size());
+  for (auto const& added_allele : relevant_alleles)
+    added_pieces.push_back(paths.add_piece(added_allele));
+
+  path_vector combinations;
+  combinations.reserve(existing.size() * relevant_alleles.size());
+  for (auto const& path : existing) {
+    for (std::size_t i = 0; i < relevant_alleles.size(); ++i) {
+      // The existing path's haplogroup is kept; any uncallable portion makes
+      // the whole allele uncallable
+      Path combination{path.pieces, path.haplogroup,
+                       path.callable && relevant_alleles[i].callable};
+      combination.pieces.push_back(added_pieces[i]);
+      combinations.push_back(std::move(combination));
     }
   }
   return combinations;
 }
 
-void AlleleExtracter::allele_paste(allele_vector& existing,
+void AlleleExtracter::allele_paste(path_vector& existing,
                                    covG_ptr sequence_node) {
-  Allele to_paste_allele{sequence_node->get_sequence(),
-                         sequence_node->get_coverage()};
-  for (auto& allele : existing) allele = allele + to_paste_allele;
+  Allele piece{sequence_node->get_sequence(), {}};
+  sequence_node->get_sparse_coverage().append_to(piece.pbCov);
+  auto const to_paste_piece = paths.add_piece(piece);
+  for (auto& path : existing) path.pieces.push_back(to_paste_piece);
 }
 
-void AlleleExtracter::place_ref_as_first_allele(allele_vector& alleles,
-                                                Allele ref_allele) {
-  auto found_ref = std::find(alleles.begin(), alleles.end(), ref_allele);
-  if (found_ref == alleles.end()) {
-    ref_allele.callable = false;
-    alleles = prepend(alleles, ref_allele);
-  } else if (found_ref != alleles.begin())
-    std::swap(*found_ref, alleles.at(0));
+void AlleleExtracter::place_ref_as_first_allele(Allele const& ref_allele) {
+  auto const found_ref = paths.find(ref_allele);
+  if (found_ref == paths.size()) {
+    auto ref_path = make_path(ref_allele);
+    ref_path.callable = false;
+    paths.prepend_path(std::move(ref_path));
+  } else if (found_ref != 0)
+    paths.swap_paths(found_ref, 0);
 }
 
 Allele gram::genotype::infer::extract_ref_allele(covG_ptr start_node,
@@ -80,19 +91,19 @@ Allele gram::genotype::infer::extract_ref_allele(covG_ptr start_node,
 
   while (cur_Node != end_node) {
     if (cur_Node->has_sequence()) {
-      result =
-          result + Allele{cur_Node->get_sequence(), cur_Node->get_coverage()};
+      result.sequence += cur_Node->get_sequence();
+      cur_Node->get_sparse_coverage().append_to(result.pbCov);
     }
     cur_Node = *(cur_Node->get_edges().begin());
   }
   return result;
 }
 
-allele_vector AlleleExtracter::extract_alleles(AlleleId const haplogroup,
-                                               covG_ptr haplogroup_start,
-                                               covG_ptr site_end) {
-  allele_vector haplogroup_alleles{
-      {"", {}, haplogroup}};  // Make one empty allele as starting point, allows
+void AlleleExtracter::extract_alleles(AlleleId const haplogroup,
+                                      covG_ptr haplogroup_start,
+                                      covG_ptr site_end) {
+  path_vector haplogroup_alleles{
+      Path{{}, haplogroup}};  // Make one empty allele as starting point, allows
                               // for direct deletion
   covG_ptr cur_Node{haplogroup_start};
 
@@ -115,10 +126,9 @@ allele_vector AlleleExtracter::extract_alleles(AlleleId const haplogroup,
     cur_Node = *(cur_Node->get_edges().begin());  // Advance to the next node
   }
 
+  for (auto& path : haplogroup_alleles) paths.add_path(std::move(path));
   if (haplogroup == 0) {
     auto ref_allele = extract_ref_allele(haplogroup_start, site_end);
-    place_ref_as_first_allele(haplogroup_alleles, ref_allele);
+    place_ref_as_first_allele(ref_allele);
   }
-
-  return haplogroup_alleles;
 }
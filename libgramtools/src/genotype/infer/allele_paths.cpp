@@ -0,0 +1,154 @@
+#include "genotype/infer/allele_paths.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace gram;
+using namespace gram::genotype::infer;
+
+namespace {
+// Polynomial hash, so that the hash of a path can be made from its pieces'
+constexpr uint64_t hash_base{0x100000001b3};
+}  // namespace
+
+AllelePaths::AllelePaths(allele_vector const& alleles) {
+  for (auto const& allele : alleles)
+    add_path(Path{{add_piece(allele)}, allele.haplogroup, allele.callable});
+}
+
+AllelePaths::PieceIndex AllelePaths::add_piece(Allele const& piece) {
+  CovTotal coverage =
+      std::accumulate(piece.pbCov.begin(), piece.pbCov.end(), CovTotal{0});
+  uint64_t hash{0}, hash_shift{1};
+  for (auto const& base : piece.sequence) {
+    hash = hash * hash_base + static_cast<unsigned char>(base);
+    hash_shift *= hash_base;
+  }
+  pieces.push_back(
+      Piece{piece.sequence, piece.pbCov, coverage, hash, hash_shift});
+  return pieces.size() - 1;
+}
+
+void AllelePaths::add_path(Path path) { paths.push_back(std::move(path)); }
+
+void AllelePaths::prepend_path(Path path) {
+  paths.insert(paths.begin(), std::move(path));
+}
+
+void AllelePaths::swap_paths(std::size_t const first,
+                             std::size_t const second) {
+  std::swap(paths.at(first), paths.at(second));
+}
+
+std::size_t AllelePaths::length(Path const& path) const {
+  std::size_t result{0};
+  for (auto const& piece : path.pieces) result += pieces[piece].sequence.size();
+  return result;
+}
+
+CovTotal AllelePaths::total_coverage(Path const& path) const {
+  CovTotal result{0};
+  for (auto const& piece : path.pieces) result += pieces[piece].coverage;
+  return result;
+}
+
+double AllelePaths::average_cov(Path const& path) const {
+  return static_cast<double>(total_coverage(path)) / length(path);
+}
+
+std::size_t AllelePaths::count_positions_below(Path const& path,
+                                               CovCount const threshold) const {
+  std::size_t result{0};
+  for (auto const& piece : path.pieces) {
+    auto const& pbCov = pieces[piece].pbCov;
+    result += std::count_if(
+        pbCov.begin(), pbCov.end(),
+        [threshold](CovCount const cov) { return cov < threshold; });
+  }
+  return result;
+}
+
+uint64_t AllelePaths::sequence_hash(Path const& path) const {
+  uint64_t result{0};
+  for (auto const& piece : path.pieces)
+    result = result * pieces[piece].hash_shift + pieces[piece].hash;
+  return result;
+}
+
+std::string AllelePaths::sequence(Path const& path) const {
+  std::string result;
+  result.reserve(length(path));
+  for (auto const& piece : path.pieces) result += pieces[piece].sequence;
+  return result;
+}
+
+Allele AllelePaths::materialise(Path const& path) const {
+  PerBaseCoverage pbCov;
+  pbCov.reserve(length(path));
+  for (auto const& piece : path.pieces)
+    pbCov.insert(pbCov.end(), pieces[piece].pbCov.begin(),
+                 pieces[piece].pbCov.end());
+  return Allele{sequence(path), pbCov, path.haplogroup, path.callable};
+}
+
+allele_vector AllelePaths::materialise_all() const {
+  allele_vector result;
+  result.reserve(paths.size());
+  for (auto const& path : paths) result.push_back(materialise(path));
+  return result;
+}
+
+std::size_t AllelePaths::find(Allele const& allele) const {
+  AllelePaths single_allele(allele_vector{allele});
+  auto const& allele_path = single_allele[0];
+  auto const allele_hash = single_allele.sequence_hash(allele_path);
+  for (std::size_t index = 0; index < paths.size(); ++index) {
+    auto const& path = paths[index];
+    if (path.haplogroup != allele.haplogroup ||
+        length(path) != allele.sequence.size() ||
+        sequence_hash(path) != allele_hash)
+      continue;
+    if (materialise(path) == allele) return index;
+  }
+  return paths.size();
+}
+
+bool AllelePaths::has_duplicate_sequences() const {
+  std::vector<std::pair<uint64_t, std::size_t>> hashes;  // Hash, path index
+  hashes.reserve(paths.size());
+  for (std::size_t index = 0; index < paths.size(); ++index)
+    hashes.emplace_back(sequence_hash(paths[index]), index);
+  std::sort(hashes.begin(), hashes.end());
+
+  for (std::size_t first = 0; first < hashes.size();) {
+    auto last = first + 1;
+    while (last < hashes.size() && hashes[last].first == hashes[first].first)
+      ++last;
+    // Hashes can collide: sequences with equal hashes are compared
+    for (auto i = first; i < last; ++i) {
+      auto const sequence_i = sequence(paths[hashes[i].second]);
+      for (auto j = i + 1; j < last; ++j) {
+        if (sequence(paths[hashes[j].second]) == sequence_i) return true;
+      }
+    }
+    first = last;
+  }
+  return false;
+}
+
+void AllelePaths::add_content(StableHash& hash) const {
+  hash.add<uint64_t>(pieces.size());
+  for (auto const& piece : pieces) {
+    hash.add<uint64_t>(piece.sequence.size());
+    hash.add(piece.sequence);
+    hash.add<uint64_t>(piece.pbCov.size());
+    for (auto const& count : piece.pbCov) hash.add<StoredCovCount>(count);
+  }
+  hash.add<uint64_t>(paths.size());
+  for (auto const& path : paths) {
+    hash.add<uint64_t>(path.pieces.size());
+    for (auto const& piece : path.pieces) hash.add<uint64_t>(piece);
+    hash.add(path.haplogroup);
+    hash.add<uint8_t>(path.callable);
+  }
+}
@@ -0,0 +1,160 @@
+#include "genotype/infer/level_genotyping/gcp_simulation.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <random>
+#include <sstream>
+
+#include "GCP/GCP.h"
+#include "common/stable_hash.hpp"
+#include "genotype/infer/level_genotyping/model.hpp"
+
+namespace fs = std::filesystem;
+
+namespace gram::genotype::infer {
+
+/** Bumped whenever the model changes the confidences it produces */
+constexpr uint32_t gcp_cache_version{3};
+
+class ModelDataProducer : public GCP::Model<ModelData> {
+ private:
+  likelihood_related_stats const* l_stats;
+  Ploidy ploidy;
+
+ public:
+  ModelDataProducer(likelihood_related_stats const* l_stats, Ploidy ploidy,
+                    SeedSize seed)
+      : GCP::Model<ModelData>(seed), l_stats(l_stats), ploidy(ploidy){};
+
+  ModelData produce_data() override {
+    // Drawn as `int`s: the distributions do not take 8 bit integer types
+    CovCount correct_cov;
+    if (std::dynamic_pointer_cast<PoissonLogPmf>(l_stats->pmf_full_depth)) {
+      std::poisson_distribution<int> dpois(l_stats->data_params.mean_cov);
+      correct_cov = saturate_cov_count(dpois(random_number_generator));
+    } else {
+      std::negative_binomial_distribution<int> dnbinom(
+          l_stats->data_params.num_successes,
+          l_stats->data_params.success_prob);
+      correct_cov = saturate_cov_count(dnbinom(random_number_generator));
+    }
+
+    std::binomial_distribution<int> b(l_stats->data_params.mean_cov,
+                                      l_stats->data_params.mean_pb_error);
+    CovCount const incorrect_cov =
+        saturate_cov_count(b(random_number_generator));
+
+    allele_vector alleles{
+        Allele{"C", {correct_cov}, 0},
+        Allele{"A", {incorrect_cov}, 1},
+    };
+    GroupedAlleleCounts gped_counts{
+        {{0}, correct_cov},
+        {{1}, incorrect_cov},
+    };
+    return ModelData(alleles, gped_counts, ploidy, l_stats);
+  }
+};
+
+std::vector<double> simulate_gt_conf_chunks(
+    likelihood_related_stats const& l_stats, Ploidy const ploidy,
+    SeedSize const seed, std::size_t const first_chunk,
+    std::size_t const num_chunks) {
+  std::vector<double> confidences(num_chunks * gcp_chunk_size);
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t i = 0; i < num_chunks; ++i) {
+    std::seed_seq chunk_seed_seq{seed, static_cast<SeedSize>(first_chunk + i)};
+    SeedSize chunk_seed;
+    chunk_seed_seq.generate(&chunk_seed, &chunk_seed + 1);
+
+    ModelDataProducer data_producer(&l_stats, ploidy, chunk_seed);
+    for (std::size_t j = 0; j < gcp_chunk_size; ++j) {
+      auto data = data_producer.produce_data();
+      LevelGenotyperModel genotyped(data);
+      confidences[i * gcp_chunk_size + j] = genotyped.get_genotype_confidence();
+    }
+  }
+  return confidences;
+}
+
+std::vector<double> simulate_gt_confs(likelihood_related_stats const& l_stats,
+                                      Ploidy const ploidy,
+                                      std::size_t const num_confidences,
+                                      GcpSimulationParams const& params) {
+  std::vector<double> confidences;
+  std::optional<GcpCache> cache;
+  if (not params.cache_dirpath.empty()) {
+    cache.emplace(params.cache_dirpath, l_stats, ploidy, params.seed);
+    confidences = cache->load();
+  }
+
+  if (confidences.size() < num_confidences) {
+    // Only whole chunks are cached, so the cached ones are kept
+    auto const num_cached_chunks = confidences.size() / gcp_chunk_size;
+    confidences.resize(num_cached_chunks * gcp_chunk_size);
+    auto const num_chunks =
+        (num_confidences + gcp_chunk_size - 1) / gcp_chunk_size;
+    auto const simulated =
+        simulate_gt_conf_chunks(l_stats, ploidy, params.seed, num_cached_chunks,
+                                num_chunks - num_cached_chunks);
+    confidences.insert(confidences.end(), simulated.begin(), simulated.end());
+    if (cache.has_value()) cache->save(confidences);
+  }
+  confidences.resize(num_confidences);
+  return confidences;
+}
+
+GcpCache::GcpCache(std::string const& dirpath,
+                   likelihood_related_stats const& l_stats, Ploidy const ploidy,
+                   SeedSize const seed) {
+  std::stringstream key_stream;
+  // Simulated coverages saturate at the coverage counter's maximum, so builds
+  // of other widths do not share confidences.
+  key_stream << "version=" << gcp_cache_version
+             << " cov_count_bits=" << GRAM_COV_COUNT_BITS
+             << " ploidy=" << (ploidy == Ploidy::Haploid ? 1 : 2)
+             << " seed=" << seed << " " << l_stats.data_params.key();
+  key = key_stream.str();
+
+  StableHash key_hash;
+  key_hash.add(key);
+  std::stringstream fname;
+  fname << "gcp_" << std::hex << key_hash.get() << ".txt";
+  fpath = (fs::path(dirpath) / fname.str()).string();
+}
+
+std::vector<double> GcpCache::load() const {
+  std::vector<double> confidences;
+  std::ifstream cache_file(fpath);
+  if (not cache_file.is_open()) return confidences;
+  std::string file_key;
+  std::getline(cache_file, file_key);
+  if (file_key != key) return confidences;
+
+  std::string line;
+  while (std::getline(cache_file, line))
+    confidences.push_back(std::strtod(line.c_str(), nullptr));
+  // Only whole chunks are used
+  confidences.resize(confidences.size() / gcp_chunk_size * gcp_chunk_size);
+  return confidences;
+}
+
+void GcpCache::save(std::vector<double> const& confidences) const {
+  fs::create_directories(fs::path(fpath).parent_path());
+  // Written to a temporary file first, so that concurrent runs never read a
+  // partly written cache
+  auto const tmp_fpath = fpath + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream cache_file(tmp_fpath);
+    cache_file << key << "\n" << std::hexfloat;
+    for (auto const& confidence : confidences) cache_file << confidence << "\n";
+  }
+  fs::rename(tmp_fpath, fpath);
+}
+
+}  // namespace gram::genotype::infer
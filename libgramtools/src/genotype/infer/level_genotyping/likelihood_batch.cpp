@@ -0,0 +1,124 @@
+#include "genotype/infer/level_genotyping/likelihood_batch.hpp"
+
+using namespace gram::genotype::infer;
+
+template <Ploidy P>
+LikelihoodBatch<P>::LikelihoodBatch(double const log_mean_pb_error)
+    : log_mean_pb_error(log_mean_pb_error) {}
+
+template <Ploidy P>
+std::size_t LikelihoodBatch<P>::add_site() {
+  site_starts.push_back(first_alleles.size());
+  return site_starts.size() - 1;
+}
+
+template <Ploidy P>
+void LikelihoodBatch<P>::add_haploid(GtypedIndex const allele,
+                                     CovTotal const total_cov,
+                                     CovTotal const haploid_cov,
+                                     double const allele_log_likelihood) {
+  assert(P == Ploidy::Haploid);
+  first_alleles.push_back(allele);
+  total_covs.push_back(total_cov);
+  first_covs.push_back(haploid_cov);
+  first_terms.push_back(allele_log_likelihood);
+}
+
+template <Ploidy P>
+void LikelihoodBatch<P>::add_diploid(
+    Genotype<Ploidy::Diploid> const& genotype, CovTotal const total_cov,
+    bool const same_haplogroup,
+    std::pair<CovTotal, CovTotal> const haploid_covs,
+    CovTotal const shared_cov, std::pair<bool, bool> const halved_covs,
+    std::pair<double, double> const allele_log_likelihoods) {
+  assert(P == Ploidy::Diploid);
+  first_alleles.push_back(genotype[0]);
+  second_alleles.push_back(genotype[1]);
+  total_covs.push_back(total_cov);
+  first_covs.push_back(haploid_covs.first);
+  second_covs.push_back(haploid_covs.second);
+  shared_covs.push_back(shared_cov);
+  same_haplogroups.push_back(same_haplogroup);
+  first_halved.push_back(halved_covs.first);
+  second_halved.push_back(halved_covs.second);
+  first_terms.push_back(allele_log_likelihoods.first);
+  second_terms.push_back(allele_log_likelihoods.second);
+}
+
+template <Ploidy P>
+void LikelihoodBatch<P>::evaluate() {
+  auto const num_genotypes = first_alleles.size();
+  log_likelihoods.resize(num_genotypes);
+  double* const results = log_likelihoods.data();
+  double const* const totals = total_covs.data();
+  double const* const firsts = first_covs.data();
+  double const* const first_ll = first_terms.data();
+  double const log_error = log_mean_pb_error;
+
+  if constexpr (P == Ploidy::Haploid) {
+#pragma omp simd
+    for (std::size_t i = 0; i < num_genotypes; ++i) {
+      double result = (totals[i] - firsts[i]) * log_error;
+      result += first_ll[i];
+      results[i] = result;
+    }
+  } else {
+    // Same operations as LevelGenotyperModel::compute_diploid_coverage
+    double const* const seconds = second_covs.data();
+    double const* const shareds = shared_covs.data();
+    uint8_t const* const same = same_haplogroups.data();
+    uint8_t const* const first_half = first_halved.data();
+    uint8_t const* const second_half = second_halved.data();
+    double const* const second_ll = second_terms.data();
+#pragma omp simd
+    for (std::size_t i = 0; i < num_genotypes; ++i) {
+      double const first_specific = firsts[i] - shareds[i],
+                   second_specific = seconds[i] - shareds[i];
+      double const first_belonging =
+          (first_specific == 0 && second_specific == 0)
+              ? 0.5
+              : first_specific / (first_specific + second_specific);
+      double first_cov = firsts[i] - (1 - first_belonging) * shareds[i];
+      double second_cov = seconds[i] - first_belonging * shareds[i];
+      first_cov = first_half[i] ? first_cov / 2 : first_cov;
+      second_cov = second_half[i] ? second_cov / 2 : second_cov;
+      first_cov = same[i] ? firsts[i] / 2 : first_cov;
+      second_cov = same[i] ? firsts[i] / 2 : second_cov;
+
+      double result = (totals[i] - first_cov - second_cov) * log_error;
+      result += first_ll[i];
+      result += second_ll[i];
+      results[i] = result;
+    }
+  }
+}
+
+template <Ploidy P>
+Genotype<P> LikelihoodBatch<P>::genotype(std::size_t const genotype) const {
+  if constexpr (P == Ploidy::Haploid)
+    return {first_alleles[genotype]};
+  else
+    return {first_alleles[genotype], second_alleles[genotype]};
+}
+
+template <Ploidy P>
+std::array<std::size_t, 2> LikelihoodBatch<P>::best_two(
+    std::size_t const site) const {
+  auto const start = site_starts.at(site);
+  auto const end = site + 1 < site_starts.size() ? site_starts[site + 1]
+                                                 : log_likelihoods.size();
+  // Ties are ranked in order of addition, as in a `likelihood_map`
+  std::size_t best = no_genotype, second_best = no_genotype;
+  for (auto i = start; i < end; ++i) {
+    if (best == no_genotype || log_likelihoods[i] > log_likelihoods[best]) {
+      second_best = best;
+      best = i;
+    } else if (second_best == no_genotype ||
+               log_likelihoods[i] > log_likelihoods[second_best])
+      second_best = i;
+  }
+  return {best, second_best};
+}
+
+template class gram::genotype::infer::LikelihoodBatch<Ploidy::Haploid>;
+template class gram::genotype::infer::LikelihoodBatch<Ploidy::Diploid>;
@@ -1,34 +1,28 @@
 #include "genotype/infer/level_genotyping/model.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "genotype/infer/allele_extracter.hpp"
+#include "genotype/infer/level_genotyping/likelihood_batch.hpp"
 
 using namespace gram::genotype::infer;
 using namespace gram::genotype::infer::probabilities;
 
-std::optional<Allele> check_for_duplicates(allele_vector const& input_alleles) {
-  std::set<Allele> nodups;
-  for (auto const& allele : input_alleles) {
-    if (nodups.find(allele) == nodups.end())
-      nodups.insert(allele);
-    else
-      return allele;
-  }
-  return std::nullopt;
-}
-
-LevelGenotyperModel::LevelGenotyperModel(ModelData& input_data)
+LevelGenotyperModel::LevelGenotyperModel(ModelData& input_data,
+                                         bool const batched)
     : data(input_data) {
   assert(data.input_alleles.size() > 1);
-  auto const& ref_allele = data.input_alleles.at(0);
+  auto const ref_allele = data.input_alleles.materialise(data.input_alleles[0]);
   genotyped_site = std::make_shared<LevelGenotypedSite>();
 
-  auto haplogroup_multiplicities =
-      get_haplogroup_multiplicities(data.input_alleles);
+  haplogroup_multiplicities = get_haplogroup_multiplicities(data.input_alleles);
   // Used in invalidation process, required set early
   genotyped_site->set_num_haplogroups(haplogroup_multiplicities.size());
 
-  auto const duplicate_allele = check_for_duplicates(data.input_alleles);
-  if (duplicate_allele) genotyped_site->set_filter("AMBIG");
+  if (data.input_alleles.has_duplicate_sequences())
+    genotyped_site->set_filter("AMBIG");
 
   total_coverage = count_total_coverage(data.gp_counts);
   if (total_coverage == 0 || data.l_stats->data_params.mean_cov == 0) {
@@ -40,73 +34,173 @@ LevelGenotyperModel::LevelGenotyperModel(ModelData& input_data)
   }
 
   set_haploid_coverages(data.gp_counts, haplogroup_multiplicities.size());
+  if (data.ploidy == Ploidy::Diploid)
+    set_shared_coverages(data.gp_counts, haplogroup_multiplicities.size());
 
-  allele_vector used_alleles(data.input_alleles);
-  assign_coverage_to_empty_alleles(used_alleles);
+  auto const& input_alleles = data.input_alleles;
+  set_allele_log_likelihoods(input_alleles);
 
-  if (data.ploidy == Ploidy::Haploid)
-    compute_haploid_log_likelihoods(used_alleles);
-  else if (data.ploidy == Ploidy::Diploid) {
-    compute_homozygous_log_likelihoods(used_alleles, haplogroup_multiplicities);
-    compute_heterozygous_log_likelihoods(used_alleles,
+  auto const is_callable = [](auto const& allele) { return allele.callable; };
+  if (batched &&
+      std::all_of(input_alleles.begin(), input_alleles.end(), is_callable)) {
+    awaiting_batch = true;
+    return;
+  }
+
+  switch (data.ploidy) {
+    case Ploidy::Haploid:
+      genotype<Ploidy::Haploid>();
+      break;
+    case Ploidy::Diploid:
+      genotype<Ploidy::Diploid>();
+      break;
+    default:
+      throw UnsupportedPloidy("");
+  }
+}
+
+template <Ploidy P>
+void LevelGenotyperModel::genotype() {
+  auto const& input_alleles = data.input_alleles;
+  alleles_per_genotype = genotype_length<P>;
+  if constexpr (P == Ploidy::Haploid) {
+    log_likelihoods.reserve(input_alleles.size());
+    genotyped_alleles.reserve(input_alleles.size());
+    compute_haploid_log_likelihoods(input_alleles);
+  } else {
+    compute_homozygous_log_likelihoods(input_alleles,
+                                       haplogroup_multiplicities);
+    compute_heterozygous_log_likelihoods(input_alleles,
                                          haplogroup_multiplicities);
   }
+  CallGenotype<P>(input_alleles, haplogroup_multiplicities);
+}
 
-  CallGenotype(data.input_alleles, haplogroup_multiplicities, data.ploidy);
+template <Ploidy P>
+void LevelGenotyperModel::add_genotypes(LikelihoodBatch<P>& batch) const {
+  assert(data.ploidy == P);
+  auto const& input_alleles = data.input_alleles;
+  GtypedIndices candidates;
+  for (GtypedIndex i = 0; i < input_alleles.size(); ++i) {
+    if (i == 0 && ignore_ref_allele()) continue;
+    candidates.push_back(i);
+  }
+
+  if constexpr (P == Ploidy::Haploid) {
+    for (auto const& i : candidates) {
+      auto const haplogroup = input_alleles[i].haplogroup;
+      batch.add_haploid(i, total_coverage,
+                        haploid_allele_coverages.at(haplogroup),
+                        allele_log_likelihoods.at(i));
+    }
+  } else {
+    auto const add_diploid = [&](GtypedIndex const first,
+                                 GtypedIndex const second) {
+      auto haplogroups = std::minmax(input_alleles[first].haplogroup,
+                                     input_alleles[second].haplogroup);
+      bool const same_haplogroup = haplogroups.first == haplogroups.second;
+      batch.add_diploid(
+          {first, second}, total_coverage, same_haplogroup,
+          {haploid_allele_coverages.at(haplogroups.first),
+           haploid_allele_coverages.at(haplogroups.second)},
+          same_haplogroup
+              ? 0
+              : shared_coverages(haplogroups.first, haplogroups.second),
+          {haplogroup_multiplicities.at(haplogroups.first),
+           haplogroup_multiplicities.at(haplogroups.second)},
+          {allele_log_likelihoods.at(first),
+           allele_log_likelihoods.at(second)});
+    };
+    // Homozygous, then heterozygous genotypes of alleles with coverage unique
+    // to them
+    for (auto const& i : candidates) add_diploid(i, i);
+    GtypedIndices selected;
+    for (auto const& i : candidates) {
+      if (singleton_allele_coverages.at(input_alleles[i].haplogroup) != 0)
+        selected.push_back(i);
+    }
+    for (std::size_t i = 0; i < selected.size(); ++i) {
+      for (std::size_t j = i + 1; j < selected.size(); ++j)
+        add_diploid(selected[i], selected[j]);
+    }
+  }
+}
+
+template <Ploidy P>
+void LevelGenotyperModel::call_genotype(LikelihoodBatch<P> const& batch,
+                                        std::size_t const site) {
+  log_likelihoods.clear();
+  genotyped_alleles.clear();
+  alleles_per_genotype = genotype_length<P>;
+  for (auto const genotype : batch.best_two(site)) {
+    if (genotype == LikelihoodBatch<P>::no_genotype) continue;
+    log_likelihoods.push_back(batch.log_likelihood(genotype));
+    auto const alleles = batch.genotype(genotype);
+    genotyped_alleles.insert(genotyped_alleles.end(), alleles.begin(),
+                             alleles.end());
+  }
+  awaiting_batch = false;
+  CallGenotype<P>(data.input_alleles, haplogroup_multiplicities);
 }
 
 void LevelGenotyperModel::set_haploid_coverages(
     GroupedAlleleCounts const& input_gp_counts, AlleleId num_haplogroups) {
-  haploid_allele_coverages = PerAlleleCoverage(num_haplogroups, 0);
-  singleton_allele_coverages = PerAlleleCoverage(num_haplogroups, 0);
+  haploid_allele_coverages = AlleleCovTotals(num_haplogroups, 0);
+  singleton_allele_coverages = AlleleCovTotals(num_haplogroups, 0);
 
   for (auto const& entry : input_gp_counts) {
     for (auto const& allele_id : entry.first) {
       haploid_allele_coverages.at(allele_id) += entry.second;
     }
     if (entry.first.size() == 1) {
-      AlleleId id{entry.first.at(0)};
+      AlleleId id{entry.first.front()};
       singleton_allele_coverages.at(id) = entry.second;
     }
   }
 }
 
-void LevelGenotyperModel::assign_coverage_to_empty_alleles(
-    allele_vector& input_alleles) {
-  for (auto& allele : input_alleles) {
-    if (allele.sequence.empty()) {
-      auto assigned_cov = haploid_allele_coverages.at(allele.haplogroup);
-      allele.pbCov = PerBaseCoverage{assigned_cov};
+void LevelGenotyperModel::set_shared_coverages(
+    GroupedAlleleCounts const& input_gp_counts, AlleleId num_haplogroups) {
+  shared_coverages = SharedCoverages(input_gp_counts, num_haplogroups);
+}
+
+SharedCoverages::SharedCoverages(GroupedAlleleCounts const& gp_counts,
+                                 AlleleId const num_haplogroups)
+    : num_haplogroups(num_haplogroups) {
+  if (!is_sparse() && num_haplogroups > 1)
+    dense_coverages.assign(
+        std::size_t{num_haplogroups} * (num_haplogroups - 1) / 2, 0);
+  AlleleIds group_ids;
+  for (auto const& entry : gp_counts) {
+    if (entry.first.size() < 2) continue;
+    group_ids = entry.first.to_ids();
+    // Sorted, so each pair is indexed as (smaller, larger)
+    for (std::size_t i = 0; i < group_ids.size(); ++i) {
+      for (std::size_t j = i + 1; j < group_ids.size(); ++j) {
+        if (is_sparse())
+          sparse_coverages[sparse_key(group_ids[i], group_ids[j])] +=
+              entry.second;
+        else
+          dense_coverages[dense_index(group_ids[i], group_ids[j])] +=
+              entry.second;
+      }
     }
   }
 }
 
 CovPair LevelGenotyperModel::diploid_cov_same_haplogroup(
-    AlleleIds const& haplogroups) {
-  auto hapg = haplogroups.at(0);
-  auto allele_cov = (double)(haploid_allele_coverages.at(hapg));
+    AlleleId const haplogroup) {
+  auto allele_cov = (double)(haploid_allele_coverages.at(haplogroup));
   allele_cov /= 2;
-  computed_coverages.insert(
-      {haplogroups, allele_coverages{allele_cov, allele_cov}});
   return std::make_pair(allele_cov, allele_cov);
 }
 
 std::pair<double, double> LevelGenotyperModel::diploid_cov_different_haplogroup(
-    GroupedAlleleCounts const& gp_counts, AlleleIds const& ids,
+    AlleleId const allele_1_id, AlleleId const allele_2_id,
     multiplicities const& hap_mults) {
-  AlleleId allele_1_id = ids.at(0), allele_2_id = ids.at(1);
   auto allele_1_cov = (double)(haploid_allele_coverages.at(allele_1_id));
   auto allele_2_cov = (double)(haploid_allele_coverages.at(allele_2_id));
-  bool has_first_allele, has_second_allele;
-  CovCount shared_coverage{0};
-
-  for (auto const& entry : gp_counts) {
-    has_first_allele = std::find(entry.first.begin(), entry.first.end(),
-                                 allele_1_id) != entry.first.end();
-    has_second_allele = std::find(entry.first.begin(), entry.first.end(),
-                                  allele_2_id) != entry.first.end();
-    if (has_first_allele && has_second_allele) shared_coverage += entry.second;
-  }
+  auto const shared_coverage = shared_coverages(allele_1_id, allele_2_id);
 
   auto first_allele_specific_cov = allele_1_cov - shared_coverage,
        second_allele_specific_cov = allele_2_cov - shared_coverage;
@@ -127,28 +221,28 @@ std::pair<double, double> LevelGenotyperModel::diploid_cov_different_haplogroup(
   if (hap_mults.at(allele_1_id)) allele_1_cov /= 2;
   if (hap_mults.at(allele_2_id)) allele_2_cov /= 2;
 
-  computed_coverages.insert(
-      {ids, allele_coverages{allele_1_cov, allele_2_cov}});
   return std::make_pair(allele_1_cov, allele_2_cov);
 }
 
 std::pair<double, double> LevelGenotyperModel::compute_diploid_coverage(
-    GroupedAlleleCounts const& gp_counts, AlleleIds haplogroups,
+    AlleleIds const& haplogroups,
     multiplicities const& haplogroup_multiplicities) {
   assert(haplogroups.size() == 2);
-  // Below line so that `computed_coverages` map lookup/insertion is
-  // insensitive to order.
-  std::sort(haplogroups.begin(), haplogroups.end());
+  return compute_diploid_coverage(haplogroups.at(0), haplogroups.at(1),
+                                  haplogroup_multiplicities);
+}
 
-  if (computed_coverages.find(haplogroups) != computed_coverages.end()) {
-    auto known_covs = computed_coverages.at(haplogroups);
-    return std::make_pair(known_covs.at(0), known_covs.at(1));
-  }
+std::pair<double, double> LevelGenotyperModel::compute_diploid_coverage(
+    AlleleId first, AlleleId second,
+    multiplicities const& haplogroup_multiplicities) {
+  // So that the coverages come in the same order for either order of the
+  // haplogroups
+  if (first > second) std::swap(first, second);
 
-  if (haplogroups.at(0) == haplogroups.at(1))
-    return diploid_cov_same_haplogroup(haplogroups);
+  if (first == second)
+    return diploid_cov_same_haplogroup(first);
   else
-    return diploid_cov_different_haplogroup(gp_counts, haplogroups,
+    return diploid_cov_different_haplogroup(first, second,
                                             haplogroup_multiplicities);
 }
 
@@ -170,18 +264,18 @@ std::size_t LevelGenotyperModel::count_total_coverage(
   return total_cov;
 }
 
-AlleleIds LevelGenotyperModel::get_haplogroups(
-    allele_vector const& alleles, GtypedIndices const& gtype) const {
-  AlleleIds result;
-  for (auto const& index : gtype) {
-    result.push_back(alleles.at(index).haplogroup);
-  }
+template <Ploidy P>
+std::array<AlleleId, genotype_length<P>> LevelGenotyperModel::get_haplogroups(
+    AllelePaths const& alleles, Genotype<P> const& gtype) const {
+  std::array<AlleleId, genotype_length<P>> result;
+  for (std::size_t i = 0; i < gtype.size(); ++i)
+    result[i] = alleles.at(gtype[i]).haplogroup;
   std::sort(result.begin(), result.end());
   return result;
 }
 
 multiplicities LevelGenotyperModel::get_haplogroup_multiplicities(
-    allele_vector const& input_alleles) {
+    AllelePaths const& input_alleles) {
   std::map<AlleleId, std::size_t> haplo_counts;
   for (auto const& allele : input_alleles) {
     if (haplo_counts.find(allele.haplogroup) == haplo_counts.end())
@@ -237,40 +331,69 @@ std::vector<GtypedIndices> LevelGenotyperModel::get_permutations(
   return result;
 }
 
-void LevelGenotyperModel::add_likelihood(allele_vector const& alleles,
-                                         double const& incompatible_coverage,
-                                         GtypedIndices const& allele_indices) {
+double LevelGenotyperModel::allele_log_likelihood(Allele const& allele) {
+  return data.l_stats->pmf_full_depth->log_prob(allele.get_average_cov()) +
+         fraction_noncredible_positions(allele) * data.l_stats->log_zero;
+}
+
+void LevelGenotyperModel::set_allele_log_likelihoods(
+    AllelePaths const& input_alleles) {
+  allele_log_likelihoods.clear();
+  allele_log_likelihoods.reserve(input_alleles.size());
+  for (auto const& allele : input_alleles) {
+    auto const length = input_alleles.length(allele);
+    if (length == 0) {
+      auto assigned_cov = haploid_allele_coverages.at(allele.haplogroup);
+      allele_log_likelihoods.push_back(allele_log_likelihood(
+          Allele{"", {saturate_cov_count(assigned_cov)}, allele.haplogroup}));
+      continue;
+    }
+    double const noncredible_fraction =
+        static_cast<double>(input_alleles.count_positions_below(
+            allele, data.l_stats->credible_cov_t)) /
+        length;
+    allele_log_likelihoods.push_back(
+        data.l_stats->pmf_full_depth->log_prob(
+            input_alleles.average_cov(allele)) +
+        noncredible_fraction * data.l_stats->log_zero);
+  }
+}
+
+template <Ploidy P>
+double LevelGenotyperModel::add_likelihood(double const incompatible_coverage,
+                                           Genotype<P> const& genotype) {
   double log_likelihood =
       incompatible_coverage * data.l_stats->log_mean_pb_error;
-  uint8_t stop_index;
-  switch (data.ploidy) {
-    case Ploidy::Haploid:
-      stop_index = 1;
-      break;
-    case Ploidy::Diploid:
-      stop_index = 2;
-      break;
-    default:
-      throw UnsupportedPloidy("");
-  }
+  for (auto const& allele_index : genotype)
+    log_likelihood += allele_log_likelihoods.at(allele_index);
 
-  assert(alleles.size() == stop_index);
-  assert(allele_indices.size() == stop_index);
-  double compatible_coverage, gap_penalty;
-  for (uint8_t i = 0; i < stop_index; i++) {
-    auto const& allele = alleles.at(i);
-    compatible_coverage = allele.get_average_cov();
-    gap_penalty = fraction_noncredible_positions(allele);
-    log_likelihood +=
-        data.l_stats->pmf_full_depth->operator()(params{compatible_coverage});
-    log_likelihood += gap_penalty * data.l_stats->log_zero;
+  log_likelihoods.push_back(log_likelihood);
+  genotyped_alleles.insert(genotyped_alleles.end(), genotype.begin(),
+                           genotype.end());
+  return log_likelihood;
+}
+
+likelihood_map LevelGenotyperModel::get_likelihoods() const {
+  likelihood_map result;
+  for (std::size_t i = 0; i < log_likelihoods.size(); ++i) {
+    auto const first = genotyped_alleles.begin() + i * alleles_per_genotype;
+    result.insert({log_likelihoods[i],
+                   GtypedIndices(first, first + alleles_per_genotype)});
   }
+  return result;
+}
 
-  likelihoods.insert({log_likelihood, allele_indices});
+template <Ploidy P>
+bool LevelGenotyperModel::is_callable(AllelePaths const& alleles,
+                                      Genotype<P> const& genotype) {
+  for (auto const& allele_index : genotype) {
+    if (!alleles.at(allele_index).callable) return false;
+  }
+  return true;
 }
 
 void LevelGenotyperModel::compute_haploid_log_likelihoods(
-    allele_vector const& input_alleles) {
+    AllelePaths const& input_alleles) {
   GtypedIndex allele_index{-1};
 
   for (auto const& allele : input_alleles) {
@@ -278,13 +401,12 @@ void LevelGenotyperModel::compute_haploid_log_likelihoods(
     if (allele_index == 0 && ignore_ref_allele()) continue;
     auto haploid_cov = haploid_allele_coverages.at(allele.haplogroup);
     auto incompatible_coverage = total_coverage - haploid_cov;
-    add_likelihood(allele_vector{allele}, incompatible_coverage,
-                   GtypedIndices{allele_index});
+    add_likelihood<Ploidy::Haploid>(incompatible_coverage, {allele_index});
   }
 }
 
 void LevelGenotyperModel::compute_homozygous_log_likelihoods(
-    allele_vector const& input_alleles,
+    AllelePaths const& input_alleles,
     multiplicities const& haplogroup_multiplicities) {
   GtypedIndex allele_index{-1};
 
@@ -292,18 +414,17 @@ void LevelGenotyperModel::compute_homozygous_log_likelihoods(
     ++allele_index;
     if (allele_index == 0 && ignore_ref_allele()) continue;
     auto coverages = compute_diploid_coverage(
-        data.gp_counts, AlleleIds{allele.haplogroup, allele.haplogroup},
-        haplogroup_multiplicities);
+        allele.haplogroup, allele.haplogroup, haplogroup_multiplicities);
     auto incompatible_coverage =
         total_coverage - coverages.first - coverages.second;
 
-    add_likelihood(allele_vector{allele, allele}, incompatible_coverage,
-                   GtypedIndices{allele_index, allele_index});
+    add_likelihood<Ploidy::Diploid>(incompatible_coverage,
+                                    {allele_index, allele_index});
   }
 }
 
 void LevelGenotyperModel::compute_heterozygous_log_likelihoods(
-    allele_vector const& input_alleles,
+    AllelePaths const& input_alleles,
     multiplicities const& haplogroup_multiplicities) {
   GtypedIndices selected_indices;
   GtypedIndex allele_index{-1};
@@ -316,27 +437,69 @@ void LevelGenotyperModel::compute_heterozygous_log_likelihoods(
 
   if (selected_indices.size() < 2) return;
 
-  auto all_diploid_combos = get_permutations(selected_indices, 2);
-
-  for (auto const& combo : all_diploid_combos) {
-    Allele allele_1 = input_alleles.at(combo.at(0));
-    Allele allele_2 = input_alleles.at(combo.at(1));
-    AlleleIds haplogroups{allele_1.haplogroup, allele_2.haplogroup};
-    auto coverages = compute_diploid_coverage(data.gp_counts, haplogroups,
-                                              haplogroup_multiplicities);
-    auto incompatible_coverage =
-        total_coverage - coverages.first - coverages.second;
+  // The two best likelihoods of callable genotypes so far
+  double best = -std::numeric_limits<double>::infinity(), second_best = best;
+  auto const add_callable = [&best, &second_best](double const likelihood) {
+    if (likelihood > best) {
+      second_best = best;
+      best = likelihood;
+    } else if (likelihood > second_best)
+      second_best = likelihood;
+  };
+  for (std::size_t i = 0; i < log_likelihoods.size(); ++i) {
+    Genotype<Ploidy::Diploid> const homozygous{genotyped_alleles[2 * i],
+                                               genotyped_alleles[2 * i + 1]};
+    if (is_callable<Ploidy::Diploid>(input_alleles, homozygous))
+      add_callable(log_likelihoods[i]);
+  }
 
-    add_likelihood(allele_vector{allele_1, allele_2}, incompatible_coverage,
-                   combo);
+  // Upper bounds on the likelihood of each allele's share of a genotype:
+  // its own terms, with all its haploid coverage compatible
+  auto const& log_error = data.l_stats->log_mean_pb_error;
+  auto const num_selected = selected_indices.size();
+  std::vector<double> bounds(num_selected), max_bounds_after(num_selected);
+  for (std::size_t i = 0; i < num_selected; ++i) {
+    auto const index = selected_indices[i];
+    auto const haploid_cov =
+        haploid_allele_coverages.at(input_alleles.at(index).haplogroup);
+    bounds[i] = allele_log_likelihoods.at(index) - haploid_cov * log_error;
+  }
+  max_bounds_after.back() = -std::numeric_limits<double>::infinity();
+  for (std::size_t i = num_selected - 1; i > 0; --i)
+    max_bounds_after[i - 1] = std::max(max_bounds_after[i], bounds[i]);
+  // The bounds are summed in a different order to the likelihoods
+  auto const below_second_best = [&second_best](double const bound) {
+    return bound < second_best - 1e-9 * (1 + std::abs(second_best));
+  };
+
+  double const total_log_error = total_coverage * log_error;
+  for (std::size_t i = 0; i < num_selected; ++i) {
+    if (below_second_best(total_log_error + bounds[i] + max_bounds_after[i]))
+      continue;
+    for (std::size_t j = i + 1; j < num_selected; ++j) {
+      if (below_second_best(total_log_error + bounds[i] + bounds[j])) continue;
+      Genotype<Ploidy::Diploid> const combo{selected_indices[i],
+                                            selected_indices[j]};
+      auto coverages = compute_diploid_coverage(
+          input_alleles.at(combo[0]).haplogroup,
+          input_alleles.at(combo[1]).haplogroup, haplogroup_multiplicities);
+      auto incompatible_coverage =
+          total_coverage - coverages.first - coverages.second;
+
+      auto const likelihood =
+          add_likelihood<Ploidy::Diploid>(incompatible_coverage, combo);
+      if (is_callable<Ploidy::Diploid>(input_alleles, combo))
+        add_callable(likelihood);
+    }
   }
 }
 
+template <Ploidy P>
 void LevelGenotyperModel::add_next_best_alleles(
-    allele_vector const& input_alleles, GtypedIndices const& chosen_gt,
-    GtypedIndices const& next_best_gt) {
-  auto& chosen_allele_for_cov = input_alleles.at(chosen_gt.at(0));
-  auto& next_best_allele_for_cov = input_alleles.at(next_best_gt.at(0));
+    AllelePaths const& input_alleles, Genotype<P> const& chosen_gt,
+    Genotype<P> const& next_best_gt) {
+  auto& chosen_allele_for_cov = input_alleles.at(chosen_gt[0]);
+  auto& next_best_allele_for_cov = input_alleles.at(next_best_gt[0]);
 
   bool low_total_cov = total_coverage < data.l_stats->data_params.mean_cov / 4;
   bool low_relative_cov =
@@ -351,7 +514,7 @@ void LevelGenotyperModel::add_next_best_alleles(
     }
     allele_vector result;
     for (auto const& gt : next_best) {
-      auto added_allele = input_alleles.at(gt);
+      auto added_allele = input_alleles.materialise(input_alleles.at(gt));
       added_allele.callable = false;
       result.push_back(added_allele);
     }
@@ -359,80 +522,115 @@ void LevelGenotyperModel::add_next_best_alleles(
   }
 }
 
+template <Ploidy P>
 void LevelGenotyperModel::add_all_best_alleles(
-    allele_vector const& input_alleles, GtypedIndices const& chosen_gt,
-    GtypedIndices const& next_best_gt) {
+    AllelePaths const& input_alleles, Genotype<P> const& chosen_gt,
+    Genotype<P> const& next_best_gt) {
   std::set<GtypedIndex> all_best{next_best_gt.begin(), next_best_gt.end()};
   all_best.insert(chosen_gt.begin(), chosen_gt.end());
   allele_vector result;
-  for (auto const& gt : all_best) result.push_back(input_alleles.at(gt));
+  for (auto const& gt : all_best)
+    result.push_back(input_alleles.materialise(input_alleles.at(gt)));
   genotyped_site->set_extra_alleles(result);
 }
 
-likelihood_map::const_iterator LevelGenotyperModel::ChooseMaxLikelihood(
-    likelihood_map const& likelihoods, allele_vector const& alleles) {
-  if (likelihoods.size() < 2)
+void LevelGenotyperModel::CallGenotype(AllelePaths const& input_alleles,
+                                       multiplicities const& hap_mults,
+                                       Ploidy const ploidy) {
+  switch (ploidy) {
+    case Ploidy::Haploid:
+      return CallGenotype<Ploidy::Haploid>(input_alleles, hap_mults);
+    case Ploidy::Diploid:
+      return CallGenotype<Ploidy::Diploid>(input_alleles, hap_mults);
+    default:
+      throw UnsupportedPloidy("");
+  }
+}
+
+template <Ploidy P>
+Genotype<P> LevelGenotyperModel::genotype_at(std::size_t const genotype) const {
+  assert(alleles_per_genotype == genotype_length<P>);
+  Genotype<P> result;
+  std::copy_n(genotyped_alleles.begin() + genotype * genotype_length<P>,
+              genotype_length<P>, result.begin());
+  return result;
+}
+
+template <Ploidy P>
+std::pair<std::size_t, std::size_t> LevelGenotyperModel::choose_max_likelihood(
+    AllelePaths const& alleles) const {
+  auto const num_genotypes = log_likelihoods.size();
+  if (num_genotypes < 2)
     throw IncorrectGenotyping(
         "Less than 2 alleles have a likelihood.\n"
         "Allele extraction bug?");
-  auto it = likelihoods.begin();
-  while (it != likelihoods.end()) {
-    bool callable = true;
-    auto chosen_gt = it->second;
-    for (auto const& gt : chosen_gt) {
-      if (!alleles.at(gt).callable) {
-        callable = false;
-        break;
-      }
-    }
-    if (callable) break;
-    ++it;
+  // Highest likelihood first, ties in order of computation, as in a
+  // `likelihood_map`
+  auto const ranks_before = [this](std::size_t const i, std::size_t const j) {
+    return log_likelihoods[i] > log_likelihoods[j] ||
+           (log_likelihoods[i] == log_likelihoods[j] && i < j);
+  };
+
+  std::size_t const none = num_genotypes;
+  std::size_t chosen = none, next_best = none;
+  for (std::size_t i = 0; i < num_genotypes; ++i) {
+    if ((chosen == none || ranks_before(i, chosen)) &&
+        is_callable<P>(alleles, genotype_at<P>(i)))
+      chosen = i;
   }
-  if (std::distance(it, likelihoods.end()) < 2)
+  for (std::size_t i = 0; chosen != none && i < num_genotypes; ++i) {
+    if (i != chosen && !ranks_before(i, chosen) &&
+        (next_best == none || ranks_before(i, next_best)))
+      next_best = i;
+  }
+  if (next_best == none)
     throw IncorrectGenotyping(
         "Fewer than 2 alleles are callable."
         "\nAllele extraction bug?");
-
-  return it;
+  return {chosen, next_best};
 }
 
-void LevelGenotyperModel::CallGenotype(allele_vector const& input_alleles,
-                                       multiplicities hap_mults,
-                                       Ploidy const ploidy) {
-  auto const& ref_allele = input_alleles.at(0);
-  auto it = ChooseMaxLikelihood(likelihoods, input_alleles);
-  auto best_likelihood = it->first;
-  auto chosen_gt = it->second;
-  ++it;
-  auto gt_confidence = best_likelihood - it->first;
-  auto next_best_gt = it->second;
+template <Ploidy P>
+void LevelGenotyperModel::CallGenotype(AllelePaths const& input_alleles,
+                                       multiplicities const& hap_mults) {
+  auto const ref_allele = input_alleles.materialise(input_alleles.at(0));
+  auto const [chosen, next_best] = choose_max_likelihood<P>(input_alleles);
+  auto gt_confidence = log_likelihoods[chosen] - log_likelihoods[next_best];
+  auto const chosen_gt = genotype_at<P>(chosen);
+  auto const next_best_gt = genotype_at<P>(next_best);
 
   if (gt_confidence == 0.) {
     genotyped_site->set_alleles(allele_vector{ref_allele});
     genotyped_site->make_null();
-    add_all_best_alleles(input_alleles, chosen_gt, next_best_gt);
+    add_all_best_alleles<P>(input_alleles, chosen_gt, next_best_gt);
     return;
   } else
-    add_next_best_alleles(input_alleles, chosen_gt, next_best_gt);
+    add_next_best_alleles<P>(input_alleles, chosen_gt, next_best_gt);
 
-  auto chosen_alleles =
-      genotyped_site->get_unique_genotyped_alleles(input_alleles, chosen_gt);
+  // Only the called alleles are made in full, in sorted genotype order
+  std::set<GtypedIndex> const distinct_gts(chosen_gt.begin(), chosen_gt.end());
+  allele_vector chosen_alleles;
+  for (auto const& gt : distinct_gts)
+    chosen_alleles.push_back(input_alleles.materialise(input_alleles.at(gt)));
   // Get haplotypes and coverages
-  auto chosen_haplotypes = get_haplogroups(input_alleles, chosen_gt);
+  auto chosen_haplotypes = get_haplogroups<P>(input_alleles, chosen_gt);
   allele_coverages allele_covs;
-  if (ploidy == Ploidy::Haploid)
+  if constexpr (P == Ploidy::Haploid)
     allele_covs = allele_coverages{
-        (double)haploid_allele_coverages.at(chosen_haplotypes.at(0))};
-  else if (ploidy == Ploidy::Diploid) {
-    allele_covs = computed_coverages.at(chosen_haplotypes);
+        (double)haploid_allele_coverages.at(chosen_haplotypes[0])};
+  else {
+    auto const coverages = compute_diploid_coverage(
+        chosen_haplotypes[0], chosen_haplotypes[1], hap_mults);
+    allele_covs = allele_coverages{coverages.first, coverages.second};
     // If homozygous call, give the single allele all the coverage
-    if (chosen_gt.at(0) == chosen_gt.at(1))
+    if (chosen_gt[0] == chosen_gt[1])
       allele_covs = allele_coverages{allele_covs.at(0) + allele_covs.at(1)};
   }
 
   // Because we only output the called alleles (+ REF), re-express genotype
   // indices to those.
-  auto rescaled_gt = rescale_genotypes(chosen_gt);
+  auto rescaled_gt =
+      rescale_genotypes(GtypedIndices(chosen_gt.begin(), chosen_gt.end()));
 
   // Add the REF allele (and its coverage) to the set of chosen alleles if it
   // was not called
@@ -452,11 +650,12 @@ void LevelGenotyperModel::CallGenotype(allele_vector const& input_alleles,
   if (data.debug) {
     std::string debug_info{"\tnext_best_seq: "};
     for (auto const& gt : next_best_gt) {
-      debug_info.append(input_alleles.at(gt).sequence);
+      debug_info.append(input_alleles.sequence(input_alleles.at(gt)));
       debug_info.append(",");
     }
     debug_info.append("\tnext_best_cov: ");
-    auto next_best_haplotypes = get_haplogroups(input_alleles, next_best_gt);
+    auto next_best_haplotypes =
+        get_haplogroups<P>(input_alleles, next_best_gt);
     for (auto const& hapg : next_best_haplotypes) {
       debug_info.append(std::to_string(haploid_allele_coverages.at(hapg)));
       debug_info.append(",");
@@ -468,13 +667,38 @@ void LevelGenotyperModel::CallGenotype(allele_vector const& input_alleles,
 LevelGenotyperModel::LevelGenotyperModel(
     likelihood_related_stats const& input_l_stats,
     PerAlleleCoverage const& input_covs,
-    likelihood_map const& input_likelihoods)
-    : likelihoods(input_likelihoods) {
+    likelihood_map const& input_likelihoods) {
+  // Likelihoods are stored as if computed in ranked order
+  alleles_per_genotype = input_likelihoods.empty()
+                             ? 0
+                             : input_likelihoods.begin()->second.size();
+  for (auto const& entry : input_likelihoods) {
+    assert(entry.second.size() == alleles_per_genotype);
+    log_likelihoods.push_back(entry.first);
+    genotyped_alleles.insert(genotyped_alleles.end(), entry.second.begin(),
+                             entry.second.end());
+  }
   data.l_stats = &input_l_stats;
   genotyped_site = std::make_shared<LevelGenotypedSite>();
 
-  haploid_allele_coverages = input_covs;
-  singleton_allele_coverages = input_covs;
+  haploid_allele_coverages =
+      AlleleCovTotals(input_covs.begin(), input_covs.end());
+  singleton_allele_coverages = haploid_allele_coverages;
   total_coverage = 0;
   for (auto const& entry : input_covs) total_coverage += entry;
 }
+
+template void LevelGenotyperModel::add_genotypes<Ploidy::Haploid>(
+    LikelihoodBatch<Ploidy::Haploid>& batch) const;
+template void LevelGenotyperModel::add_genotypes<Ploidy::Diploid>(
+    LikelihoodBatch<Ploidy::Diploid>& batch) const;
+template void LevelGenotyperModel::call_genotype<Ploidy::Haploid>(
+    LikelihoodBatch<Ploidy::Haploid> const& batch, std::size_t site);
+template void LevelGenotyperModel::call_genotype<Ploidy::Diploid>(
+    LikelihoodBatch<Ploidy::Diploid> const& batch, std::size_t site);
+template std::pair<std::size_t, std::size_t>
+LevelGenotyperModel::choose_max_likelihood<Ploidy::Haploid>(
+    AllelePaths const& alleles) const;
+template std::pair<std::size_t, std::size_t>
+LevelGenotyperModel::choose_max_likelihood<Ploidy::Diploid>(
+    AllelePaths const& alleles) const;
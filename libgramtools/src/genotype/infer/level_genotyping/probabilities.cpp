@@ -2,22 +2,49 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cmath>
+#include <mutex>
+#include <sstream>
 
 namespace gram::genotype::infer::probabilities {
 double AbstractPmf::operator()(params const& query) {
-  if (probs.find(query) != probs.end())
-    return probs.at(query);
-  else {
-    auto prob = compute_prob(query);
-    probs.insert(std::pair<params, double>(query, prob));
-    return prob;
+  assert(query.size() == 1);
+  {
+    std::shared_lock<std::shared_mutex> lock(probs_mutex);
+    auto found = probs.find(query);
+    if (found != probs.end()) return found->second;
   }
+  auto prob = compute_prob(query.front());
+  std::unique_lock<std::shared_mutex> lock(probs_mutex);
+  probs.insert(std::pair<params, double>(query, prob));
+  return prob;
 }
 
-double PoissonLogPmf::compute_prob(params const& query) const {
-  assert(query.size() == 1);
-  auto cov{query.at(0)};
+void AbstractPmf::tabulate(std::size_t const table_size) {
+  table.resize(table_size);
+  for (std::size_t coverage = 0; coverage < table_size; ++coverage)
+    table[coverage] = compute_prob(static_cast<double>(coverage));
+}
+
+std::size_t pmf_table_size(double const mean_cov, double const var_cov) {
+  double const spread = std::sqrt(std::max(mean_cov, var_cov));
+  double const size = std::min(mean_cov + 10 * spread + 1,
+                               static_cast<double>(max_cov_count) + 1);
+  if (not std::isfinite(size) || size < 1) return 1;
+  return static_cast<std::size_t>(size);
+}
+
+std::string DataParams::key() const {
+  std::stringstream result;
+  result << std::hexfloat << "mean_cov=" << mean_cov
+         << " mean_pb_error=" << mean_pb_error
+         << " num_successes=" << num_successes
+         << " success_prob=" << success_prob;
+  return result.str();
+}
+
+double PoissonLogPmf::compute_prob(double const cov) const {
   return (-1 * lambda + cov * log(lambda) - lgamma(cov + 1));
 }
 
@@ -31,9 +58,7 @@ NegBinomLogPmf::NegBinomLogPmf(params const& parameterisation)
   operator()(params{0});
 }
 
-double NegBinomLogPmf::compute_prob(params const& query) const {
-  assert(query.size() == 1);
-  auto cov{query.at(0)};
+double NegBinomLogPmf::compute_prob(double const cov) const {
   return (lgamma(k + cov) - lgamma(cov + 1) - lgamma(k) + k * log(p) +
           cov * log(1 - p));
 }
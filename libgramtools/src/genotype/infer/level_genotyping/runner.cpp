@@ -1,11 +1,15 @@
 #include "genotype/infer/level_genotyping/runner.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <optional>
 #include <random>
 
 #include "GCP/GCP.h"
 #include "genotype/infer/allele_extracter.hpp"
+#include "genotype/infer/level_genotyping/likelihood_batch.hpp"
 #include "genotype/infer/level_genotyping/model.hpp"
+#include "genotype/infer/level_genotyping/site_memo.hpp"
 #include "genotype/infer/output_specs/fields.hpp"
 #include "genotype/read_stats.hpp"
 #include "prg/coverage_graph.hpp"
@@ -27,12 +31,14 @@ void add_percentiles(gt_sites const& input_sites,
 LevelGenotyper::LevelGenotyper(coverage_Graph const& cov_graph,
                                SitesGroupedAlleleCounts const& gped_covs,
                                ReadStats const& read_stats, Ploidy const ploidy,
-                               bool get_gcp, std::string debug_fpath)
-    : ploidy(ploidy) {
+                               bool get_gcp, std::string debug_fpath,
+                               GcpSimulationParams const& gcp_params,
+                               SiteMemo* site_memo)
+    : ploidy(ploidy), site_memo(site_memo) {
   this->cov_graph = &cov_graph;
   this->gped_covs = &gped_covs;
-  child_m =
-      build_child_map(cov_graph.par_map);  // Required for site invalidation
+  child_m = build_child_map(cov_graph.par_map);  // Required for json output
+  site_hierarchy = cov_graph.site_hierarchy;  // Required for site invalidation
   genotyped_records.resize(
       cov_graph.bubble_map
           .size());  // Pre-allocate one slot for each bubble in the PRG
@@ -49,53 +55,199 @@ LevelGenotyper::LevelGenotyper(coverage_Graph const& cov_graph,
     debug = true;
     debug_file << l_stats;
   }
+  if (site_memo != nullptr) {
+    memo_params_hash = SiteMemo::make_params_hash(l_stats, ploidy, debug);
+    site_memo->use_params(memo_params_hash);
+  }
 
-  // Genotype each bubble in the PRG, in most nested to less nested order.
+  // A site is genotyped once all sites nested in it are, and genotyping it
+  // only reads and modifies its own nested sites. So sites are genotyped by
+  // nesting level, from the most nested, and the sites of a level in parallel.
+  // The results do not depend on the number of threads.
+  // Sites without nested sites, such as all those of non-nested PRGs, have
+  // their likelihoods evaluated in batches.
+  std::vector<std::vector<bubble_ptr>> levels;
   for (auto const& bubble_pair : cov_graph.bubble_map) {
-    auto site_ID = bubble_pair.first->get_site_ID();
-    auto site_index = siteID_to_index(site_ID);
-
-    auto extracter = AlleleExtracter(bubble_pair.first, bubble_pair.second,
-                                     genotyped_records);
-    auto extracted_alleles = extracter.get_alleles();
-    auto& gped_covs_for_site = gped_covs.at(site_index);
+    auto const depth = site_hierarchy.depth(bubble_pair.first->get_site_ID());
+    if (depth >= levels.size()) levels.resize(depth + 1);
+    levels[depth].push_back(&bubble_pair);
+  }
 
-    ModelData data(extracted_alleles, gped_covs_for_site, ploidy, &l_stats,
-                   debug);
-    auto genotyped = LevelGenotyperModel(data);
-    auto genotyped_site = genotyped.get_site();
-    genotyped_site->set_pos(bubble_pair.first->get_pos());
+  // The batched genotyping code is specialised per ploidy, chosen here once
+  void (LevelGenotyper::*genotype_leaf_batch)(std::vector<bubble_ptr> const&,
+                                              bool, std::vector<std::string>&);
+  switch (ploidy) {
+    case Ploidy::Haploid:
+      genotype_leaf_batch = &LevelGenotyper::genotype_batch<Ploidy::Haploid>;
+      break;
+    case Ploidy::Diploid:
+      genotype_leaf_batch = &LevelGenotyper::genotype_batch<Ploidy::Diploid>;
+      break;
+    default:
+      throw UnsupportedPloidy("");
+  }
 
-    if (debug_file.is_open()) {
-      debug_file << "site index: \t" << site_index;
-      if (genotyped_site->is_null())
-        debug_file << "\tnull gt \n";
-      else {
-        debug_file << genotyped_site->get_debug_info();
-        debug_file << "\n";
-      }
+  std::vector<std::string> debug_infos(debug ? genotyped_records.size() : 0);
+  for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+    std::vector<bubble_ptr> nesting_bubbles, leaf_bubbles;
+    for (auto const& bubble : *level) {
+      if (site_hierarchy.has_children(bubble->first->get_site_ID()))
+        nesting_bubbles.push_back(bubble);
+      else
+        leaf_bubbles.push_back(bubble);
     }
 
-    // Line below is so that when allele extraction occurs and jumps through a
-    // previously genotyped site, it knows where in the graph to resume from.
-    genotyped_site->set_site_end_node(bubble_pair.second);
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t i = 0; i < nesting_bubbles.size(); ++i) {
+      auto const& bubble_pair = *nesting_bubbles[i];
+      auto debug_info =
+          genotype_bubble(bubble_pair.first, bubble_pair.second, debug);
+      if (debug)
+        debug_infos.at(siteID_to_index(bubble_pair.first->get_site_ID())) =
+            std::move(debug_info);
+    }
 
-    genotyped_records.at(site_index) = genotyped_site;
+    for (std::size_t first = 0; first < leaf_bubbles.size();
+         first += likelihood_batch_size) {
+      auto const last =
+          std::min(first + likelihood_batch_size, leaf_bubbles.size());
+      (this->*genotype_leaf_batch)(
+          std::vector<bubble_ptr>(leaf_bubbles.begin() + first,
+                                  leaf_bubbles.begin() + last),
+          debug, debug_infos);
+    }
+  }
 
-    auto downcasted =
-        std::dynamic_pointer_cast<LevelGenotypedSite>(genotyped_site);
-    run_invalidation_process(downcasted, site_ID);
-    if (genotyped_site->has_filter("AMBIG"))
-      downpropagate_filter("AMBIG", site_ID);
-    else
-      uppropagate_filter("AMBIG", site_ID);
+  // Written in the original, most nested to less nested, order
+  if (debug_file.is_open()) {
+    for (auto const& bubble_pair : cov_graph.bubble_map) {
+      auto const site_index = siteID_to_index(bubble_pair.first->get_site_ID());
+      debug_file << "site index: \t" << site_index;
+      debug_file << debug_infos.at(site_index);
+    }
   }
+
   if (get_gcp) {
-    auto confidences = get_gtconf_distrib(genotyped_records, l_stats, ploidy);
+    auto confidences =
+        get_gtconf_distrib(genotyped_records, l_stats, ploidy, gcp_params);
     add_percentiles(genotyped_records, confidences);
   }
 }
 
+std::string LevelGenotyper::genotype_bubble(covG_ptr const& site_start,
+                                            covG_ptr const& site_end,
+                                            bool const debug) {
+  auto site_ID = site_start->get_site_ID();
+  auto site_index = siteID_to_index(site_ID);
+
+  auto extracter = AlleleExtracter(site_start, site_end, genotyped_records);
+  auto& gped_covs_for_site = gped_covs->at(site_index);
+
+  ModelData data(extracter.get_paths(), gped_covs_for_site, ploidy, &l_stats,
+                 debug);
+  SiteMemo::Key memo_key{};
+  if (site_memo != nullptr) {
+    memo_key = SiteMemo::make_key(site_index, data, memo_params_hash);
+    if (auto memoised = site_memo->find(memo_key))
+      return record_site(memoised, site_start, site_end, debug);
+  }
+
+  auto genotyped = LevelGenotyperModel(data);
+  auto genotyped_site = genotyped.get_site();
+  if (site_memo != nullptr)
+    site_memo->insert(memo_key,
+                      *std::static_pointer_cast<LevelGenotypedSite>(
+                          genotyped_site));
+  return record_site(genotyped_site, site_start, site_end, debug);
+}
+
+template <Ploidy P>
+void LevelGenotyper::genotype_batch(std::vector<bubble_ptr> const& bubbles,
+                                    bool const debug,
+                                    std::vector<std::string>& debug_infos) {
+  // Sites found in the site memo get no model
+  std::vector<std::optional<LevelGenotyperModel>> models(bubbles.size());
+  std::vector<gt_site_ptr> memoised(bubbles.size());
+  std::vector<SiteMemo::Key> memo_keys(bubbles.size());
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t i = 0; i < bubbles.size(); ++i) {
+    auto const& site_start = bubbles[i]->first;
+    auto const site_index = siteID_to_index(site_start->get_site_ID());
+    auto extracter =
+        AlleleExtracter(site_start, bubbles[i]->second, genotyped_records);
+    auto& gped_covs_for_site = gped_covs->at(site_index);
+    ModelData data(extracter.get_paths(), gped_covs_for_site, ploidy, &l_stats,
+                   debug);
+    if (site_memo != nullptr) {
+      memo_keys[i] = SiteMemo::make_key(site_index, data, memo_params_hash);
+      memoised[i] = site_memo->find(memo_keys[i]);
+      if (memoised[i] != nullptr) continue;
+    }
+    models[i].emplace(data, true);
+  }
+
+  LikelihoodBatch<P> batch(l_stats.log_mean_pb_error);
+  std::vector<std::size_t> batch_sites(bubbles.size());
+  for (std::size_t i = 0; i < bubbles.size(); ++i) {
+    if (!models[i].has_value() || !models[i]->awaits_batch()) continue;
+    batch_sites[i] = batch.add_site();
+    models[i]->add_genotypes<P>(batch);
+  }
+  batch.evaluate();
+
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t i = 0; i < bubbles.size(); ++i) {
+    auto genotyped_site = memoised[i];
+    if (genotyped_site == nullptr) {
+      if (models[i]->awaits_batch())
+        models[i]->call_genotype<P>(batch, batch_sites[i]);
+      genotyped_site = models[i]->get_site();
+      if (site_memo != nullptr)
+        site_memo->insert(memo_keys[i],
+                          *std::static_pointer_cast<LevelGenotypedSite>(
+                              genotyped_site));
+    }
+    auto const& [site_start, site_end] = *bubbles[i];
+    auto debug_info =
+        record_site(genotyped_site, site_start, site_end, debug);
+    if (debug)
+      debug_infos.at(siteID_to_index(site_start->get_site_ID())) =
+          std::move(debug_info);
+  }
+}
+
+std::string LevelGenotyper::record_site(gt_site_ptr const& genotyped_site,
+                                        covG_ptr const& site_start,
+                                        covG_ptr const& site_end,
+                                        bool const debug) {
+  auto const site_ID = site_start->get_site_ID();
+  auto const site_index = siteID_to_index(site_ID);
+  genotyped_site->set_pos(site_start->get_pos());
+
+  std::string debug_info;
+  if (debug) {
+    if (genotyped_site->is_null())
+      debug_info = "\tnull gt \n";
+    else
+      debug_info = genotyped_site->get_debug_info() + "\n";
+  }
+
+  // Line below is so that when allele extraction occurs and jumps through a
+  // previously genotyped site, it knows where in the graph to resume from.
+  genotyped_site->set_site_end_node(site_end);
+
+  genotyped_records.at(site_index) = genotyped_site;
+
+  auto downcasted =
+      std::dynamic_pointer_cast<LevelGenotypedSite>(genotyped_site);
+  run_invalidation_process(downcasted, site_ID);
+  if (genotyped_site->has_filter("AMBIG"))
+    downpropagate_filter("AMBIG", site_ID);
+  else
+    uppropagate_filter("AMBIG", site_ID);
+  return debug_info;
+}
+
 header_vec LevelGenotyper::get_model_specific_headers() {
   auto site_model_entries = LevelGenotypedSite::site_model_specific_entries();
   header_vec result{
@@ -108,15 +260,12 @@ header_vec LevelGenotyper::get_model_specific_headers() {
 
 void LevelGenotyper::uppropagate_filter(std::string const& name,
                                         Marker const& parent_site_ID) {
-  if (child_m.find(parent_site_ID) == child_m.end()) return;
   auto const focal_site_index = siteID_to_index(parent_site_ID);
-  for (auto const& pair : child_m.at(parent_site_ID)) {
-    for (auto const& child_marker : pair.second) {
-      auto referent_site = genotyped_records.at(siteID_to_index(child_marker));
-      if (referent_site->has_filter(name)) {
-        genotyped_records.at(focal_site_index)->set_filter(name);
-        return;
-      }
+  for (auto const& child_marker : site_hierarchy.children(parent_site_ID)) {
+    auto referent_site = genotyped_records.at(siteID_to_index(child_marker));
+    if (referent_site->has_filter(name)) {
+      genotyped_records.at(focal_site_index)->set_filter(name);
+      return;
     }
   }
 }
@@ -128,15 +277,11 @@ void LevelGenotyper::downpropagate_filter(std::string const& name,
   while (!to_process.empty()) {
     cur_ID = to_process.back();
     to_process.pop_back();
-    if (child_m.find(cur_ID) == child_m.end()) continue;
-    for (auto const& pair : child_m.at(cur_ID)) {
-      for (auto const& child_marker : pair.second) {
-        auto referent_site =
-            genotyped_records.at(siteID_to_index(child_marker));
-        if (!referent_site->has_filter(name)) {
-          referent_site->set_filter(name);
-          to_process.emplace_back(child_marker);
-        }
+    for (auto const& child_marker : site_hierarchy.children(cur_ID)) {
+      auto referent_site = genotyped_records.at(siteID_to_index(child_marker));
+      if (!referent_site->has_filter(name)) {
+        referent_site->set_filter(name);
+        to_process.emplace_back(child_marker);
       }
     }
   }
@@ -145,7 +290,7 @@ void LevelGenotyper::downpropagate_filter(std::string const& name,
 void LevelGenotyper::run_invalidation_process(
     lvlgt_site_ptr const& genotyped_site, Marker const& site_ID) {
   // Invalidation process attempted only if this site contains 1+ site
-  if (child_m.find(site_ID) != child_m.end()) {
+  if (site_hierarchy.has_children(site_ID)) {
     auto candidate_haplogroups = genotyped_site->get_nonGenotyped_haplogroups();
     auto haplogroups_with_sites =
         get_haplogroups_with_sites(site_ID, candidate_haplogroups);
@@ -156,10 +301,9 @@ void LevelGenotyper::run_invalidation_process(
 AlleleIds LevelGenotyper::get_haplogroups_with_sites(
     Marker const& site_ID, AlleleIds candidate_haplogroups) const {
   AlleleIds result{};
-  if (child_m.find(site_ID) == child_m.end()) return result;
-  auto child_entry = child_m.at(site_ID);
+  if (not site_hierarchy.has_children(site_ID)) return result;
   for (auto const& candidate : candidate_haplogroups) {
-    if (child_entry.find(candidate) != child_entry.end())
+    if (not site_hierarchy.children(site_ID, candidate).empty())
       result.push_back(candidate);
   }
   return result;
@@ -178,8 +322,9 @@ void LevelGenotyper::invalidate_if_needed(Marker const& parent_site_ID,
     cur_locus = to_process.back();
     to_process.pop_back();
 
-    // We know the site/haplogroup combination bears 1+ site so use .at() .
-    auto sites_on_haplogroup = child_m.at(cur_locus.first).at(cur_locus.second);
+    // We know the site/haplogroup combination bears 1+ site
+    auto sites_on_haplogroup =
+        site_hierarchy.children(cur_locus.first, cur_locus.second);
     for (auto const& child_marker : sites_on_haplogroup) {
       auto referent_site = genotyped_records.at(siteID_to_index(child_marker));
       if (referent_site->is_null()) continue;
@@ -231,6 +376,9 @@ likelihood_related_stats LevelGenotyper::make_l_stats(
     pmf_half_depth = std::make_shared<PoissonLogPmf>(params{mean_cov / 2});
     prob_no_zero_half_depth = log(1 - exp(mean_cov * -0.5));
   }
+  // Genotyping then reads most probabilities from the table. The half depth
+  // pmf is only queried at coverage 0, below.
+  pmf->tabulate(pmf_table_size(mean_cov, var_cov));
 
   // store natural log of pb error also because of its use in likelihood
   // formulae
@@ -252,65 +400,28 @@ CovCount LevelGenotyper::find_minimum_non_error_cov(double mean_pb_error,
   /** Below avoids infinite loop if the prob of min_count coverage is 0
    * (and its log is thus -inf),
    */
-  if (isinf((*pmf)(params{min_count}))) return min_count;
-  while ((*pmf)(params{min_count}) <= min_count * log(mean_pb_error)) {
+  if (isinf(pmf->log_prob(min_count))) return min_count;
+  while (pmf->log_prob(min_count) <= min_count * log(mean_pb_error)) {
     ++min_count;
   }
-  return min_count;
+  return saturate_cov_count(min_count);
 }
 
-class ModelDataProducer : public GCP::Model<ModelData> {
- private:
-  likelihood_related_stats const* l_stats;
-  Ploidy ploidy;
-
- public:
-  ModelDataProducer(likelihood_related_stats const* l_stats, Ploidy ploidy)
-      : l_stats(l_stats), ploidy(ploidy){};
-
-  ModelData produce_data() override {
-    CovCount correct_cov;
-    if (std::dynamic_pointer_cast<PoissonLogPmf>(l_stats->pmf_full_depth)) {
-      std::poisson_distribution<CovCount> dpois(l_stats->data_params.mean_cov);
-      correct_cov = dpois(random_number_generator);
-    } else {
-      std::negative_binomial_distribution<CovCount> dnbinom(
-          l_stats->data_params.num_successes,
-          l_stats->data_params.success_prob);
-      correct_cov = dnbinom(random_number_generator);
-    }
-
-    std::binomial_distribution<CovCount> b(l_stats->data_params.mean_cov,
-                                           l_stats->data_params.mean_pb_error);
-    CovCount const incorrect_cov = b(random_number_generator);
-
-    allele_vector alleles{
-        Allele{"C", {correct_cov}, 0},
-        Allele{"A", {incorrect_cov}, 1},
-    };
-    GroupedAlleleCounts gped_counts{
-        {{0}, correct_cov},
-        {{1}, incorrect_cov},
-    };
-    return ModelData(alleles, gped_counts, ploidy, l_stats);
-  }
-};
-
 /**
  * Draws empirical confidences from the genotyped sites
  * and complements them with simulations if there are not enough.
+ * Both are drawn from `gcp_params.seed`, so that runs are reproducible.
  */
 std::vector<double> LevelGenotyper::get_gtconf_distrib(
     gt_sites const& input_sites, likelihood_related_stats const& input_lstats,
-    Ploidy const& input_ploidy) {
+    Ploidy const& input_ploidy, GcpSimulationParams const& gcp_params) {
   constexpr uint16_t distrib_size{CONF_DISTRIB_SIZE};
   std::vector<double> confidences(distrib_size);
   auto insertion_point = confidences.begin();
 
   // Case: draw all needed confidences at random from sites
   if (input_sites.size() > distrib_size) {
-    std::random_device rd;
-    std::mt19937 generator(rd());
+    std::mt19937 generator(gcp_params.seed);
     std::uniform_int_distribution<> distrib(0, input_sites.size() - 1);
     while (insertion_point != confidences.end()) {
       auto selected_entry = distrib(generator);
@@ -325,11 +436,8 @@ std::vector<double> LevelGenotyper::get_gtconf_distrib(
       *insertion_point++ =
           std::dynamic_pointer_cast<LevelGenotypedSite>(site)->get_gt_conf();
     auto num_simulations = std::distance(insertion_point, confidences.end());
-    // Perform simulations
-    GCP::Model<ModelData>* data_producer =
-        new ModelDataProducer(&input_lstats, input_ploidy);
-    GCP::Simulator<ModelData, LevelGenotyperModel> simulator(data_producer);
-    auto simu = simulator.simulate(num_simulations);
+    auto simu = simulate_gt_confs(input_lstats, input_ploidy, num_simulations,
+                                  gcp_params);
     std::copy(simu.begin(), simu.end(), insertion_point);
   }
   std::sort(confidences.begin(), confidences.end());
@@ -0,0 +1,293 @@
+#include "genotype/infer/level_genotyping/site_memo.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "common/little_endian.hpp"
+#include "common/stable_hash.hpp"
+
+namespace fs = std::filesystem;
+using namespace gram::genotype::infer;
+
+namespace {
+/** Bumped whenever the model changes the sites it produces */
+constexpr uint32_t site_memo_version{2};
+constexpr char memo_magic[] = "GRAMMEMO";
+constexpr uint64_t inputs_seed{0x2545f4914f6cdd1d},
+    inputs_check_seed{0x9e3779b97f4a7c15};
+
+uint64_t hash_inputs(ModelData const& data, uint64_t const seed) {
+  StableHash hash;
+  hash.add(seed);
+  data.input_alleles.add_content(hash);
+  hash.add<uint64_t>(data.gp_counts.size());
+  for (auto const& [group, count] : data.gp_counts) {
+    hash.add<uint64_t>(group.size());
+    for (auto const allele_id : group) hash.add(allele_id);
+    hash.add<StoredCovCount>(count);
+  }
+  return hash.get();
+}
+
+void write_alleles(LittleEndianWriter& writer, allele_vector const& alleles) {
+  writer.write<uint64_t>(alleles.size());
+  for (auto const& allele : alleles) {
+    writer.write_string(allele.sequence);
+    writer.write_all(stored_cov_counts(allele.pbCov));
+    writer.write<AlleleId>(allele.haplogroup);
+    writer.write<uint8_t>(allele.callable);
+  }
+}
+
+allele_vector read_alleles(LittleEndianReader& reader) {
+  allele_vector alleles(reader.read<uint64_t>());
+  for (auto& allele : alleles) {
+    allele.sequence = reader.read_string();
+    for (auto const& count : reader.read_all<StoredCovCount>())
+      allele.pbCov.push_back(saturate_cov_count(count));
+    allele.haplogroup = reader.read<AlleleId>();
+    allele.callable = reader.read<uint8_t>();
+  }
+  return alleles;
+}
+
+void write_site(LittleEndianWriter& writer, LevelGenotypedSite const& site) {
+  auto const gtype_info = site.get_all_gtype_info();
+  write_alleles(writer, gtype_info.alleles);
+  writer.write_all(gtype_info.genotype);
+  writer.write<uint64_t>(gtype_info.allele_covs.size());
+  for (auto const& cov : gtype_info.allele_covs) writer.write_double(cov);
+  writer.write<uint64_t>(gtype_info.total_coverage);
+  writer.write_all(gtype_info.haplogroups);
+  writer.write<uint64_t>(gtype_info.filters.size());
+  for (auto const& filter : gtype_info.filters) writer.write_string(filter);
+
+  writer.write<uint64_t>(site.get_num_haplogroups());
+  auto const& extra_alleles = site.extra_alleles();
+  writer.write<uint8_t>(extra_alleles.has_value());
+  if (extra_alleles.has_value()) write_alleles(writer, extra_alleles.value());
+  writer.write_string(site.get_debug_info());
+  writer.write_double(site.get_gt_conf());
+}
+
+std::shared_ptr<LevelGenotypedSite> read_site(LittleEndianReader& reader) {
+  gtype_information gtype_info;
+  gtype_info.alleles = read_alleles(reader);
+  gtype_info.genotype = reader.read_all<GtypedIndex>();
+  gtype_info.allele_covs.resize(reader.read<uint64_t>());
+  for (auto& cov : gtype_info.allele_covs) cov = reader.read_double();
+  gtype_info.total_coverage = reader.read<uint64_t>();
+  gtype_info.haplogroups = reader.read_all<AlleleId>();
+
+  auto site = std::make_shared<LevelGenotypedSite>();
+  site->populate_site(gtype_info);
+  auto const num_filters = reader.read<uint64_t>();
+  for (std::size_t i = 0; i < num_filters; ++i)
+    site->set_filter(reader.read_string());
+  site->set_num_haplogroups(reader.read<uint64_t>());
+  if (reader.read<uint8_t>()) site->set_extra_alleles(read_alleles(reader));
+  site->set_debug_info(reader.read_string());
+  site->set_gt_conf(reader.read_double());
+  return site;
+}
+}  // namespace
+
+SiteMemo::Key SiteMemo::make_key(std::size_t const site_index,
+                                 ModelData const& data,
+                                 uint64_t const params_hash) {
+  bool has_coverage = false;
+  for (auto const& entry : data.gp_counts) {
+    if (entry.second > 0) has_coverage = true;
+  }
+  return Key{site_index, has_coverage ? params_hash : 0,
+             hash_inputs(data, inputs_seed),
+             hash_inputs(data, inputs_check_seed)};
+}
+
+uint64_t SiteMemo::make_params_hash(likelihood_related_stats const& l_stats,
+                                    Ploidy const ploidy, bool const debug) {
+  std::stringstream params;
+  params << "ploidy=" << (ploidy == Ploidy::Haploid ? 1 : 2)
+         << " debug=" << debug << " " << l_stats.data_params.key();
+  StableHash params_hash;
+  params_hash.add(params.str());
+  uint64_t const hash = params_hash.get();
+  // 0 is kept for sites with no coverage
+  return hash == 0 ? 1 : hash;
+}
+
+void SiteMemo::use_params(uint64_t const params_hash) {
+  std::unique_lock lock(mutex);
+  params_in_use.insert(params_hash);
+  load_params(params_hash);
+}
+
+void SiteMemo::reuse_params(uint64_t const params_hash) {
+  std::unique_lock lock(mutex);
+  reused_params = params_hash;
+  load_params(params_hash);
+}
+
+void SiteMemo::load_params(uint64_t const params_hash) {
+  if (!loaded_dirpath.has_value() || !loaded_params.insert(params_hash).second)
+    return;
+  auto loaded =
+      read_saved(params_memo_fpath(loaded_dirpath.value(), params_hash));
+  entries.merge(loaded);
+}
+
+std::shared_ptr<LevelGenotypedSite> SiteMemo::find(Key const& key) {
+  ++num_lookups;
+  std::shared_ptr<LevelGenotypedSite> reused;
+  {
+    std::shared_lock lock(mutex);
+    auto found = entries.find(key);
+    if (found != entries.end()) {
+      ++num_hits;
+      return std::make_shared<LevelGenotypedSite>(*found->second);
+    }
+    if (key.params_hash == 0 || !reused_params.has_value()) return nullptr;
+    auto reused_key = key;
+    reused_key.params_hash = reused_params.value();
+    found = entries.find(reused_key);
+    if (found == entries.end()) return nullptr;
+    reused = found->second;
+  }
+  ++num_hits;
+  ++num_reused;
+  {
+    std::unique_lock lock(mutex);
+    entries.emplace(key, reused);
+  }
+  return std::make_shared<LevelGenotypedSite>(*reused);
+}
+
+void SiteMemo::insert(Key const& key, LevelGenotypedSite const& site) {
+  auto stored = std::make_shared<LevelGenotypedSite>(site);
+  std::unique_lock lock(mutex);
+  entries.emplace(key, std::move(stored));
+}
+
+std::size_t SiteMemo::size() const {
+  std::shared_lock lock(mutex);
+  return entries.size();
+}
+
+std::string SiteMemo::memo_fpath(std::string const& dirpath) {
+  return (fs::path(dirpath) / "site_memo.bin").string();
+}
+
+std::string SiteMemo::params_memo_fpath(std::string const& dirpath,
+                                        uint64_t const params_hash) {
+  std::stringstream fname;
+  fname << "site_memo_" << std::hex << std::setw(16) << std::setfill('0')
+        << params_hash << ".bin";
+  return (fs::path(dirpath) / fname.str()).string();
+}
+
+SiteMemo::Entries SiteMemo::read_entries(std::string const& fpath) {
+  Entries result;
+  std::ifstream in(fpath, std::ios::binary);
+  if (!in.is_open()) return result;
+  char magic[sizeof(memo_magic) - 1];
+  in.read(magic, sizeof(magic));
+  if (static_cast<std::size_t>(in.gcount()) != sizeof(magic) ||
+      !std::equal(magic, magic + sizeof(magic), memo_magic))
+    return result;
+
+  LittleEndianReader reader(in, "site memo file");
+  if (reader.read<uint32_t>() != site_memo_version) return result;
+  auto const num_entries = reader.read<uint64_t>();
+  for (std::size_t i = 0; i < num_entries; ++i) {
+    Key key{reader.read<uint64_t>(), reader.read<uint64_t>(),
+            reader.read<uint64_t>(), reader.read<uint64_t>()};
+    result.emplace(key, read_site(reader));
+  }
+  return result;
+}
+
+SiteMemo::Entries SiteMemo::read_saved(std::string const& fpath) {
+  try {
+    return read_entries(fpath);
+  } catch (std::exception const& e) {
+    std::cerr << "Warning: ignoring site memo file " << fpath << ": "
+              << e.what() << std::endl;
+    return {};
+  }
+}
+
+void SiteMemo::write_entries(std::string const& fpath, Entries const& saved) {
+  // Written to a temporary file first, so that concurrent runs never read a
+  // partly written memo
+  auto const tmp_fpath = fpath + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(tmp_fpath, std::ios::binary);
+    LittleEndianWriter writer(out);
+    out.write(memo_magic, sizeof(memo_magic) - 1);
+    writer.write<uint32_t>(site_memo_version);
+    writer.write<uint64_t>(saved.size());
+    for (auto const& [key, site] : saved) {
+      writer.write<uint64_t>(key.site_index);
+      writer.write<uint64_t>(key.params_hash);
+      writer.write<uint64_t>(key.inputs_hash);
+      writer.write<uint64_t>(key.inputs_check);
+      write_site(writer, *site);
+    }
+  }
+  fs::rename(tmp_fpath, fpath);
+}
+
+void SiteMemo::load(std::string const& dirpath) {
+  auto loaded = read_saved(memo_fpath(dirpath));
+  std::unique_lock lock(mutex);
+  entries.merge(loaded);
+  loaded_dirpath = dirpath;
+  loaded_params.clear();
+  for (auto const params_hash : params_in_use) load_params(params_hash);
+  if (reused_params.has_value()) load_params(reused_params.value());
+}
+
+void SiteMemo::save(std::string const& dirpath,
+                    std::size_t const max_saved_params) const {
+  fs::create_directories(dirpath);
+  std::shared_lock lock(mutex);
+  auto const save_params = [&](uint64_t const params_hash,
+                               std::string const& fpath) {
+    auto saved = read_saved(fpath);
+    for (auto const& entry : entries) {
+      if (entry.first.params_hash == params_hash) saved.insert(entry);
+    }
+    write_entries(fpath, saved);
+  };
+  save_params(0, memo_fpath(dirpath));
+  for (auto const params_hash : params_in_use)
+    save_params(params_hash, params_memo_fpath(dirpath, params_hash));
+
+  // Evicts the files of the least recently saved other parameters
+  std::set<fs::path> saved_now;
+  for (auto const params_hash : params_in_use)
+    saved_now.insert(
+        fs::path(params_memo_fpath(dirpath, params_hash)).filename());
+  std::vector<std::pair<fs::file_time_type, fs::path>> other_files;
+  for (auto const& file : fs::directory_iterator(dirpath)) {
+    if (file.path().filename().string().rfind("site_memo_", 0) == 0 &&
+        file.path().extension() == ".bin" &&
+        saved_now.find(file.path().filename()) == saved_now.end())
+      other_files.emplace_back(file.last_write_time(), file.path());
+  }
+  auto const num_kept =
+      max_saved_params - std::min(max_saved_params, saved_now.size());
+  if (other_files.size() <= num_kept) return;
+  std::sort(other_files.begin(), other_files.end(),
+            [](auto const& a, auto const& b) { return a.first > b.first; });
+  for (auto it = other_files.begin() + num_kept; it != other_files.end();
+       ++it) {
+    std::error_code removal_error;  // Possibly removed by a concurrent run
+    fs::remove(it->second, removal_error);
+  }
+}
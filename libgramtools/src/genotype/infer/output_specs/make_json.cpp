@@ -28,8 +28,7 @@ void populate_json_prg(Json_Prg& json_prg, gtyper_ptr const& gtyper) {
     cur_json.at("Lvl1_Sites").push_back("all");
   else {
     for (int i{0}; i < genotyped_records.size(); ++i)
-      if (cov_graph->par_map.find(index_to_siteID(i)) ==
-          cov_graph->par_map.end())
+      if (not cov_graph->site_hierarchy.has_parent(index_to_siteID(i)))
         cur_json.at("Lvl1_Sites").push_back(i);
 
     for (const auto& child_entry : child_m) {
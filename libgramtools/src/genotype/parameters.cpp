@@ -42,6 +42,31 @@ void validate(boost::any& v, const std::vector<std::string>& values,
   v = boost::any(ploidy_argument(s));
 }
 
+struct search_limit_policy_argument {
+  SearchLimitPolicy policy;
+
+ public:
+  search_limit_policy_argument() = default;
+  search_limit_policy_argument(const std::string& in) {
+    if (in == "drop")
+      policy = SearchLimitPolicy::drop;
+    else if (in == "skip_per_base")
+      policy = SearchLimitPolicy::skip_per_base;
+    else
+      throw std::invalid_argument("Invalid search limit policy");
+  }
+
+  SearchLimitPolicy get() { return policy; }
+};
+
+void validate(boost::any& v, const std::vector<std::string>& values,
+              search_limit_policy_argument* target_type, int) {
+  using namespace boost::program_options;
+  validators::check_first_occurrence(v);
+  std::string const& s = validators::get_single_string(values);
+  v = boost::any(search_limit_policy_argument(s));
+}
+
 GenotypeParams commands::genotype::parse_parameters(
     po::variables_map& vm, const po::parsed_options& parsed) {
   GenotypeParams parameters = {};
@@ -49,15 +74,15 @@ GenotypeParams commands::genotype::parse_parameters(
   std::string run_dirpath;
   ploidy_argument ploidy;
   Seed::value_type seed;
+  search_limit_policy_argument search_limit_policy{"drop"};
 
   po::options_description genotype_description("genotype options");
   genotype_description.add_options()(
       "gram_dir", po::value<std::string>(&parameters.gram_dirpath)->required(),
-      "gramtools directory")("reads",
-                             po::value<std::vector<std::string>>(&reads_fpaths)
-                                 ->multitoken()
-                                 ->required(),
-                             "file containing reads (FASTA or FASTQ)")(
+      "gramtools directory")(
+      "reads", po::value<std::vector<std::string>>(&reads_fpaths)->multitoken(),
+      "file containing reads (FASTA or FASTQ). Required unless --from_coverage "
+      "is used.")(
       "sample_id", po::value<std::string>(&parameters.sample_id)->required())(
       "ploidy", po::value<ploidy_argument>(&ploidy)->required(),
       "expected ploidy of the sample. Choices: {haploid, diploid}")(
@@ -69,7 +94,44 @@ GenotypeParams commands::genotype::parse_parameters(
                           "maximum number of threads used")(
       "seed", po::value<SeedSize>(&seed),
       "seed for pseudo-random selection of multi-mapping reads. "
-      "a random seed is generated if this option is not used.");
+      "a random seed is generated if this option is not used.")(
+      "read_cache_size",
+      po::value<uint64_t>(&parameters.read_cache_size)->default_value(0),
+      "number of distinct reads whose mapping gets cached, so that repeated "
+      "reads skip the search. 0 disables the cache.")(
+      "max_search_states",
+      po::value<uint64_t>(&parameters.search_limits.max_search_states)
+          ->default_value(0),
+      "maximum number of search states a read can have during mapping. "
+      "0 means no limit.")(
+      "max_sa_interval_width",
+      po::value<uint64_t>(&parameters.search_limits.max_sa_interval_width)
+          ->default_value(0),
+      "maximum number of positions, summed over all search states, a read can "
+      "map to during mapping. 0 means no limit.")(
+      "search_limit_policy",
+      po::value<search_limit_policy_argument>(&search_limit_policy),
+      "what to do with reads exceeding the search limits, which stop being "
+      "extended: drop them, or record the allele coverage of the search "
+      "states reached, without per base coverage. Choices: {drop, "
+      "skip_per_base}. Default: drop")(
+      "gcp_cache_dir", po::value<std::string>(&parameters.gcp_cache_dirpath),
+      "directory caching the genotype confidences simulated for genotype "
+      "confidence percentiles, reused by samples with the same depth model.")(
+      "site_memo_dir", po::value<std::string>(&parameters.site_memo_dirpath),
+      "directory holding the memo of site genotyping results, reused by "
+      "samples and runs seeing the same site inputs. Covered sites are kept "
+      "for the 32 most recently saved depth models.")(
+      "from_coverage", po::value<std::string>(&parameters.from_coverage_fpath),
+      "coverage snapshot written by a previous run "
+      "(coverage/coverage_snapshot.bin): genotypes its coverage, without "
+      "mapping reads.")(
+      "top_up_coverage",
+      po::value<std::string>(&parameters.top_up_coverage_fpath),
+      "coverage snapshot written by a previous run of the sample: the coverage "
+      "of the reads, new reads of the sample, is added to it before "
+      "genotyping. With --site_memo_dir, the results of sites whose inputs did "
+      "not change are reused.");
 
   std::vector<std::string> opts =
       po::collect_unrecognized(parsed.options, po::include_positional);
@@ -79,6 +141,11 @@ GenotypeParams commands::genotype::parse_parameters(
     po::store(po::command_line_parser(opts).options(genotype_description).run(),
               vm);
     po::notify(vm);
+    if (reads_fpaths.empty() and not vm.count("from_coverage"))
+      throw po::error("one of --reads and --from_coverage is required");
+    if (vm.count("top_up_coverage") and vm.count("from_coverage"))
+      throw po::error("--top_up_coverage maps reads: use --reads, not "
+                      "--from_coverage");
   } catch (const std::exception& e) {
     std::cout << e.what() << std::endl;
     std::cout << genotype_description << std::endl;
@@ -103,6 +170,8 @@ GenotypeParams commands::genotype::parse_parameters(
       full_path(cov_dirpath, "allele_base_coverage.json");
   parameters.grouped_allele_counts_fpath =
       full_path(cov_dirpath, "grouped_allele_counts_coverage.json");
+  parameters.coverage_snapshot_fpath =
+      full_path(cov_dirpath, "coverage_snapshot.bin");
 
   parameters.genotyped_json_fpath = full_path(geno_dirpath, "genotyped.json");
   parameters.genotyped_vcf_fpath = full_path(geno_dirpath, "genotyped.vcf.gz");
@@ -113,5 +182,18 @@ GenotypeParams commands::genotype::parse_parameters(
   omp_set_num_threads(parameters.maximum_threads);
 
   if (vm.count("seed")) parameters.seed = seed;
+  if (not parameters.gcp_cache_dirpath.empty())
+    parameters.gcp_cache_dirpath =
+        fs::absolute(fs::path(parameters.gcp_cache_dirpath)).string();
+  if (not parameters.site_memo_dirpath.empty())
+    parameters.site_memo_dirpath =
+        fs::absolute(fs::path(parameters.site_memo_dirpath)).string();
+  if (not parameters.from_coverage_fpath.empty())
+    parameters.from_coverage_fpath =
+        fs::absolute(fs::path(parameters.from_coverage_fpath)).string();
+  if (not parameters.top_up_coverage_fpath.empty())
+    parameters.top_up_coverage_fpath =
+        fs::absolute(fs::path(parameters.top_up_coverage_fpath)).string();
+  parameters.search_limits.policy = search_limit_policy.get();
   return parameters;
 }
\ No newline at end of file
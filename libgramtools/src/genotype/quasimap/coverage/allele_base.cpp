@@ -1,5 +1,8 @@
+#include <omp.h>
+
 #include <cassert>
 #include <fstream>
+#include <sstream>
 #include <vector>
 
 #include "genotype/quasimap/coverage/allele_base.hpp"
@@ -37,73 +40,117 @@ SitesAlleleBaseCoverage gram::coverage::generate::allele_base_non_nested(
   return allele_base_coverage;
 }
 
-void coverage::record::allele_base(PRG_Info const &prg_info,
+void coverage::record::allele_base(Coverage &coverage,
+                                   PRG_Info const &prg_info,
                                    const SearchStates &search_states,
                                    const uint64_t &read_length) {
-  PbCovRecorder record_it{prg_info, search_states, read_length};
-}
+  auto const &layout = prg_info.pb_cov_layout;
+  if (layout.empty()) {  // Walks the graph node by node instead
+    PbCovRecorder record_it{prg_info, search_states, read_length};
+    return;
+  }
 
-/**
- * String serialise the base coverages for one allele.
- */
-std::string dump_allele(const PerBaseCoverage &allele) {
-  std::stringstream stream;
-  stream << "[";
-  auto i = 0;
-  for (const auto &base_coverage : allele) {
-    stream << (int)base_coverage;
-    if (i++ < allele.size() - 1) stream << ",";
+  auto const &random_access = prg_info.coverage_graph.random_access;
+  CovRanges ranges;
+  for (auto const &search_state : search_states) {
+    // Only the first mapping instance is traversed in full; see
+    // `PbCovRecorder::process_SearchState`
+    bool first{true};
+    for (auto occurrence = search_state.sa_interval.first;
+         occurrence <= search_state.sa_interval.second; occurrence++) {
+      auto const prg_pos = prg_info.fm_index[occurrence];
+      auto const node = random_access.node_number(prg_pos);
+      auto const offset = random_access.offset(prg_pos);
+      if (first)
+        layout.add_traversal(node, offset, search_state.traversed_path,
+                             read_length, ranges);
+      else
+        layout.add_traversal_start(node, offset, search_state.traversed_path,
+                                   read_length, ranges);
+      first = false;
+    }
   }
-  stream << "]";
-  return stream.str();
+  // Each base gets at most one unit of coverage per read
+  PbCovLayout::merge(ranges);
+  if (coverage.pb_cov_accumulator.empty())
+    layout.increment(ranges);
+  else
+    coverage.pb_cov_accumulator.add(ranges, omp_get_thread_num());
+}
+
+void coverage::record::accumulated_allele_base(Coverage &coverage,
+                                               PRG_Info const &prg_info) {
+  if (coverage.pb_cov_accumulator.empty()) return;
+  prg_info.pb_cov_layout.add_accumulated(coverage.pb_cov_accumulator);
 }
 
 /**
- * String serialise the alleles of a site.
- * @see dump_allele()
+ * String serialise the base coverages for one allele. Works on both
+ * `PerBaseCoverage` and `SparsePbCoverage`, the latter read in place.
  */
-std::string dump_site(const SitePbCoverage &site) {
-  std::stringstream stream;
-  auto i = 0;
-  for (const auto &allele : site) {
-    stream << dump_allele(allele);
-    if (i++ < site.size() - 1) stream << ",";
+template <typename AllelePbCoverage>
+void dump_allele(std::ostream &stream, AllelePbCoverage const &allele) {
+  stream << "[";
+  for (std::size_t base = 0; base < allele.size(); ++base) {
+    if (base > 0) stream << ",";
+    stream << static_cast<CovTotal>(allele[base]);
   }
-  return stream.str();
+  stream << "]";
 }
 
-/**
- * String serialise all base-level coverages for all sites of the prg.
- * @see dump_site()
- */
-std::string dump_sites(const SitesAlleleBaseCoverage &sites) {
+std::string gram::dump_allele_base_coverage(
+    const SitesAlleleBaseCoverage &sites) {
   std::stringstream stream;
-  auto i = 0;
-  for (const auto &site : sites) {
+  stream << "{\"allele_base_counts\":[";
+  for (std::size_t site = 0; site < sites.size(); ++site) {
+    if (site > 0) stream << ",";
     stream << "[";
-    stream << dump_site(site);
+    for (std::size_t allele = 0; allele < sites[site].size(); ++allele) {
+      if (allele > 0) stream << ",";
+      dump_allele(stream, sites[site][allele]);
+    }
     stream << "]";
-    if (i++ < sites.size() - 1) stream << ",";
   }
+  stream << "]}";
   return stream.str();
 }
 
-std::string gram::dump_allele_base_coverage(
-    const SitesAlleleBaseCoverage &sites) {
-  std::stringstream stream;
+void gram::dump_allele_base_coverage(std::ostream &stream,
+                                     PRG_Info const &prg_info) {
+  auto const &cov_graph = prg_info.coverage_graph;
+  // Site entries, in site index order
+  std::vector<covG_ptr> site_entries;
+  if (!cov_graph.is_nested) {
+    site_entries.resize(prg_info.num_variant_sites);
+    for (auto const &bubble_entry : cov_graph.bubble_map) {
+      auto site_index = siteID_to_index(bubble_entry.first->get_site_ID());
+      site_entries.at(site_index) = bubble_entry.first;
+    }
+  }
+
   stream << "{\"allele_base_counts\":[";
-  stream << dump_sites(sites);
+  for (std::size_t site = 0; site < site_entries.size(); ++site) {
+    if (site > 0) stream << ",";
+    stream << "[";
+    if (site_entries[site] != nullptr) {
+      auto const &allele_nodes = site_entries[site]->get_edges();
+      for (std::size_t allele = 0; allele < allele_nodes.size(); ++allele) {
+        if (allele > 0) stream << ",";
+        // A direct deletion allele's node is the site exit, without coverage
+        dump_allele(stream, allele_nodes[allele]->get_sparse_coverage());
+      }
+    }
+    stream << "]";
+  }
   stream << "]}";
-  return stream.str();
 }
 
-void coverage::dump::allele_base(const Coverage &coverage,
+void coverage::dump::allele_base(const PRG_Info &prg_info,
                                  const GenotypeParams &parameters) {
-  std::string json_string =
-      dump_allele_base_coverage(coverage.allele_base_coverage);
   std::ofstream file;
   file.open(parameters.allele_base_coverage_fpath);
-  file << json_string << std::endl;
+  dump_allele_base_coverage(file, prg_info);
+  file << std::endl;
 }
 
 DummyCovNode::DummyCovNode(node_coordinate start_pos, node_coordinate end_pos,
@@ -233,13 +280,9 @@ void PbCovRecorder::write_coverage_from_dummy_nodes() {
   for (auto const &element : cov_mapping) {  // Go through each dummy node
     cov_node = element.first;
     to_increment = element.second.get_coordinates();
-    PerBaseCoverage &cur_coverage =
-        cov_node->get_ref_to_coverage();  // Modifiable in place
-    for (auto i = to_increment.first; i <= to_increment.second; i++) {
-      if (cur_coverage[i] == UINT16_MAX) continue;
-#pragma omp atomic
-      cur_coverage[i]++;
-    }
+    auto &cur_coverage = cov_node->get_ref_to_coverage();
+    for (auto i = to_increment.first; i <= to_increment.second; i++)
+      cur_coverage.increment(i);
   }
 }
 
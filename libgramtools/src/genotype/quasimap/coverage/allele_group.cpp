@@ -0,0 +1,96 @@
+#include "genotype/quasimap/coverage/allele_group.hpp"
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <cassert>
+#include <stdexcept>
+
+using namespace gram;
+
+AlleleGroup::AlleleGroup(std::initializer_list<AlleleId> allele_ids) {
+  for (auto const& allele_id : allele_ids) insert(allele_id);
+}
+
+AlleleGroup::AlleleGroup(AlleleIds const& allele_ids) {
+  for (auto const& allele_id : allele_ids) insert(allele_id);
+}
+
+void AlleleGroup::insert(AlleleId const allele_id) {
+  assert(allele_id >= 0);
+  std::size_t const index = allele_id / word_bits;
+  Word const bit = Word{1} << (allele_id % word_bits);
+  if (index == 0) {
+    first_word |= bit;
+    return;
+  }
+  if (index > more_words.size()) more_words.resize(index, 0);
+  more_words[index - 1] |= bit;
+}
+
+bool AlleleGroup::contains(AlleleId const allele_id) const {
+  if (allele_id < 0 || allele_id >= end_allele()) return false;
+  return (word(allele_id / word_bits) >> (allele_id % word_bits)) & 1;
+}
+
+std::size_t AlleleGroup::size() const {
+  std::size_t result = __builtin_popcountll(first_word);
+  for (auto const& more_word : more_words)
+    result += __builtin_popcountll(more_word);
+  return result;
+}
+
+bool AlleleGroup::operator<(AlleleGroup const& other) const {
+  if (first_word != other.first_word) return first_word < other.first_word;
+  return more_words < other.more_words;
+}
+
+std::size_t AlleleGroup::hash() const {
+  std::size_t result = std::hash<Word>{}(first_word);
+  boost::hash_range(result, more_words.begin(), more_words.end());
+  return result;
+}
+
+AlleleId AlleleGroup::next_allele(AlleleId const from) const {
+  for (std::size_t index = from / word_bits; index < num_words(); ++index) {
+    Word remaining = word(index);
+    if (index == from / word_bits) remaining &= ~Word{0} << (from % word_bits);
+    if (remaining != 0)
+      return index * word_bits + __builtin_ctzll(remaining);
+  }
+  return end_allele();
+}
+
+GroupedAlleleCounts::GroupedAlleleCounts(
+    std::initializer_list<value_type> group_counts) {
+  for (auto const& group_count : group_counts)
+    (*this)[group_count.first] = group_count.second;
+}
+
+GroupedAlleleCounts::const_iterator GroupedAlleleCounts::find(
+    AlleleGroup const& group) const {
+  auto found = std::lower_bound(
+      counts.begin(), counts.end(), group,
+      [](value_type const& entry, AlleleGroup const& group) {
+        return entry.first < group;
+      });
+  if (found != counts.end() && found->first == group) return found;
+  return counts.end();
+}
+
+CovCount GroupedAlleleCounts::at(AlleleGroup const& group) const {
+  auto found = find(group);
+  if (found == counts.end())
+    throw std::out_of_range("No count for this allele group");
+  return found->second;
+}
+
+CovCount& GroupedAlleleCounts::operator[](AlleleGroup const& group) {
+  auto found = std::lower_bound(
+      counts.begin(), counts.end(), group,
+      [](value_type const& entry, AlleleGroup const& group) {
+        return entry.first < group;
+      });
+  if (found == counts.end() || found->first != group)
+    found = counts.insert(found, value_type{group, 0});
+  return found->second;
+}
@@ -37,8 +37,7 @@ void gram::coverage::record::allele_sum(Coverage &coverage,
     auto allele_id = locus.second;
     auto site_index = siteID_to_index(marker);
 
-#pragma omp atomic
-    allele_sum_coverage[site_index][allele_id] += 1;
+    saturating_increment(allele_sum_coverage[site_index][allele_id]);
   }
 }
 
@@ -48,7 +47,7 @@ void gram::coverage::dump::allele_sum(const Coverage &coverage,
   for (const auto &variant_site_coverage : coverage.allele_sum_coverage) {
     auto allele_count = 0;
     for (const auto &sum_coverage : variant_site_coverage) {
-      file_handle << sum_coverage;
+      file_handle << static_cast<CovTotal>(sum_coverage);
       auto not_last_coverage =
           allele_count++ < variant_site_coverage.size() - 1;
       if (not_last_coverage) file_handle << " ";
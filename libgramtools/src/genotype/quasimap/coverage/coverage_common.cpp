@@ -7,13 +7,20 @@
 
 using namespace gram;
 
-LocusFinder::LocusFinder(SearchState const search_state, info_ptr prg_info)
+template <Nesting nesting>
+LocusFinder::LocusFinder(SearchState const search_state, info_ptr prg_info,
+                         NestingTag<nesting>)
     : search_state(search_state), prg_info(prg_info) {
   check_site_uniqueness();
-  assign_traversing_loci();
-  assign_traversed_loci();
+  assign_traversing_loci<nesting>(search_state, prg_info);
+  assign_traversed_loci<nesting>(search_state, prg_info);
 }
 
+template LocusFinder::LocusFinder(SearchState const, info_ptr,
+                                  NestingTag<Nesting::flat>);
+template LocusFinder::LocusFinder(SearchState const, info_ptr,
+                                  NestingTag<Nesting::nested>);
+
 void LocusFinder::check_site_uniqueness(SearchState const &search_state) {
   auto all_loci = search_state.traversed_path;
   all_loci.insert(all_loci.end(), search_state.traversing_path.begin(),
@@ -33,7 +40,7 @@ void LocusFinder::check_site_uniqueness(SearchState const &search_state) {
 
 void LocusFinder::assign_nested_locus(VariantLocus const &var_loc,
                                       info_ptr info_ptr) {
-  auto &par_map = info_ptr->coverage_graph.par_map;
+  auto const &site_hierarchy = info_ptr->coverage_graph.site_hierarchy;
   VariantLocus cur_locus = var_loc;
   Marker &cur_marker = cur_locus.first;
   while (true) {
@@ -41,15 +48,26 @@ void LocusFinder::assign_nested_locus(VariantLocus const &var_loc,
     used_sites.insert(cur_marker);
     unique_loci.insert(cur_locus);
 
-    if (par_map.find(cur_marker) == par_map.end()) {
+    if (not site_hierarchy.has_parent(cur_marker)) {
       base_sites.insert(cur_marker);  // Add non-nested site marker
       break;
     }
-    cur_locus = par_map.at(cur_marker);
+    cur_locus = site_hierarchy.parent_locus(cur_marker);
   }
   return;
 }
 
+template <Nesting nesting>
+void LocusFinder::assign_locus(VariantLocus const &var_loc, info_ptr info_ptr) {
+  if constexpr (nesting == Nesting::nested)
+    assign_nested_locus(var_loc, info_ptr);
+  else {
+    unique_loci.insert(var_loc);
+    base_sites.insert(var_loc.first);
+  }
+}
+
+template <Nesting nesting>
 void LocusFinder::assign_traversing_loci(SearchState const &search_state,
                                          info_ptr prg_info) {
   if (search_state.traversing_path.empty()) return;
@@ -62,34 +80,45 @@ void LocusFinder::assign_traversing_loci(SearchState const &search_state,
   for (int i = search_state.sa_interval.first;
        i <= search_state.sa_interval.second; ++i) {
     auto prg_pos = prg_info->fm_index[i];
-    auto &node_access = prg_info->coverage_graph.random_access[prg_pos];
-    auto allele_id = node_access.node->get_allele_ID();
+    auto const &cov_node = prg_info->coverage_graph.random_access.node(prg_pos);
+    auto allele_id = cov_node->get_allele_ID();
 
     new_locus = VariantLocus{parent_seed, allele_id};
     unique_loci.insert(new_locus);
   }
 
-  assign_nested_locus(new_locus, prg_info);
+  assign_locus<nesting>(new_locus, prg_info);
 
   // TODO: add a check that entries in parent map correspond to entrie in
   // traversin_locus vector auto r = search_state.traversing_path.rbegin();
 }
 
+template <Nesting nesting>
 void LocusFinder::assign_traversed_loci(SearchState const &search_state,
                                         info_ptr prg_info) {
   for (auto const &var_locus : search_state.traversed_path) {
-    assign_nested_locus(var_locus, prg_info);
+    assign_locus<nesting>(var_locus, prg_info);
   }
 }
 
+template void LocusFinder::assign_traversing_loci<Nesting::flat>(
+    SearchState const &, info_ptr);
+template void LocusFinder::assign_traversing_loci<Nesting::nested>(
+    SearchState const &, info_ptr);
+template void LocusFinder::assign_traversed_loci<Nesting::flat>(
+    SearchState const &, info_ptr);
+template void LocusFinder::assign_traversed_loci<Nesting::nested>(
+    SearchState const &, info_ptr);
+
+template <Nesting nesting>
 MappingInstanceSelector::MappingInstanceSelector(
     SearchStates const search_states, info_ptr prg_info,
-    rand_ptr rand_generator)
+    rand_ptr rand_generator, NestingTag<nesting>)
     : input_search_states(search_states),
       usps(),
       prg_info(prg_info),
       rand_generator(rand_generator) {
-  process_searchstates(input_search_states);
+  process_searchstates<nesting>(input_search_states);
   int32_t selected_index = random_select_entry();
   if (selected_index >= 0) apply_selection(selected_index);
 }
@@ -113,8 +142,14 @@ void MappingInstanceSelector::apply_selection(int32_t selected_index) {
   selected = SelectedMapping{chosen_traversal.first, chosen_traversal.second};
 }
 
+template MappingInstanceSelector::MappingInstanceSelector(
+    SearchStates const, info_ptr, rand_ptr, NestingTag<Nesting::flat>);
+template MappingInstanceSelector::MappingInstanceSelector(
+    SearchStates const, info_ptr, rand_ptr, NestingTag<Nesting::nested>);
+
+template <Nesting nesting>
 void MappingInstanceSelector::add_searchstate(SearchState const &ss) {
-  LocusFinder l{ss, prg_info};
+  LocusFinder l{ss, prg_info, NestingTag<nesting>{}};
   // Create or retrieve the coverage information
   auto &cov_info = usps[l.base_sites];
 
@@ -126,12 +161,22 @@ void MappingInstanceSelector::add_searchstate(SearchState const &ss) {
   cov_info.first.push_back(ss);
 }
 
+template <Nesting nesting>
 void MappingInstanceSelector::process_searchstates(SearchStates const &all_ss) {
   for (auto const &ss : all_ss) {
-    if (ss.has_path()) add_searchstate(ss);
+    if (ss.has_path()) add_searchstate<nesting>(ss);
   }
 }
 
+template void MappingInstanceSelector::add_searchstate<Nesting::flat>(
+    SearchState const &);
+template void MappingInstanceSelector::add_searchstate<Nesting::nested>(
+    SearchState const &);
+template void MappingInstanceSelector::process_searchstates<Nesting::flat>(
+    SearchStates const &);
+template void MappingInstanceSelector::process_searchstates<Nesting::nested>(
+    SearchStates const &);
+
 uint32_t MappingInstanceSelector::count_nonvar_search_states(
     SearchStates const &search_states) {
   uint32_t count = 0;
@@ -163,11 +208,13 @@ uint32_t MappingInstanceSelector::count_nonvar_search_states(
  * site/allele combination twice. Probably need to randomly select only one
  * mapping instance from those subcases.
  */
+template <Nesting nesting>
 SelectedMapping selection(const SearchStates &search_states,
                           const uint64_t &read_length, const PRG_Info &prg_info,
                           SeedSize const &selection_seed) {
   RandomInclusiveInt selector{Seed{selection_seed}};
-  MappingInstanceSelector m{search_states, &prg_info, &selector};
+  MappingInstanceSelector m{search_states, &prg_info, &selector,
+                            NestingTag<nesting>{}};
 
   // This contains empty containers if we selected a mapping instance in an
   // invariant part of the PRG
@@ -176,30 +223,41 @@ SelectedMapping selection(const SearchStates &search_states,
   return selected;
 }
 
+template <Nesting nesting>
 void coverage::record::search_states(Coverage &coverage,
                                      const SearchStates &search_states,
                                      const uint64_t &read_length,
                                      const PRG_Info &prg_info,
-                                     SeedSize const &selection_seed) {
-  SelectedMapping selected_search_states =
-      selection(search_states, read_length, prg_info, selection_seed);
+                                     SeedSize const &selection_seed,
+                                     bool const record_per_base) {
+  SelectedMapping selected_search_states = selection<nesting>(
+      search_states, read_length, prg_info, selection_seed);
 
   // If we selected a mapping instance that does not overlap any variant site,
   // there is no coverage to record.
   if (selected_search_states.navigational_search_states.empty()) return;
 
-  coverage::record::allele_base(
-      prg_info, selected_search_states.navigational_search_states, read_length);
+  if (record_per_base)
+    coverage::record::allele_base(
+        coverage, prg_info, selected_search_states.navigational_search_states,
+        read_length);
   coverage::record::allele_sum(coverage,
                                selected_search_states.equivalence_class_loci);
   coverage::record::grouped_allele_counts(
       coverage, selected_search_states.equivalence_class_loci);
 }
 
-void coverage::dump::all(const Coverage &coverage,
+template void coverage::record::search_states<Nesting::flat>(
+    Coverage &, const SearchStates &, const uint64_t &, const PRG_Info &,
+    SeedSize const &, bool const);
+template void coverage::record::search_states<Nesting::nested>(
+    Coverage &, const SearchStates &, const uint64_t &, const PRG_Info &,
+    SeedSize const &, bool const);
+
+void coverage::dump::all(const Coverage &coverage, const PRG_Info &prg_info,
                          const GenotypeParams &parameters) {
   coverage::dump::allele_sum(coverage, parameters);
-  coverage::dump::allele_base(coverage, parameters);
+  coverage::dump::allele_base(prg_info, parameters);
   coverage::dump::grouped_allele_counts(coverage, parameters);
 }
 
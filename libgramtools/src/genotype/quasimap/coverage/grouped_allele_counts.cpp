@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <vector>
 
 #include "genotype/quasimap/coverage/grouped_allele_counts.hpp"
@@ -16,35 +18,28 @@ SitesGroupedAlleleCounts coverage::generate::grouped_allele_counts(
 
 void coverage::record::grouped_allele_counts(
     Coverage &coverage, uniqueLoci const &compatible_loci) {
-  // We will store, for each variant site `Marker`, which alleles are traversed
-  // across
-  // **all** (selected, ie site-equivalent) mapping instances of the processed
-  // read.
-  std::unordered_map<Marker, AlleleIdSet> site_allele_group;
-
-  // Loop through all loci and record the alleles compatible with each site
-  for (const auto &locus : compatible_loci) {
-    auto site_marker = locus.first;
-    auto allele_id = locus.second;
-    site_allele_group[site_marker].insert(allele_id);
-  }
-
-  // Loop through the variant site markers traversed at least once by the read.
-  for (const auto &entry : site_allele_group) {
-    auto site_marker = entry.first;
-    auto allele_ids_set = entry.second;
-    AlleleIds allele_ids;
-    std::copy(allele_ids_set.begin(), allele_ids_set.end(),
-              std::back_inserter(allele_ids));
+  // `compatible_loci` is ordered by site, so each variant site traversed by
+  // the read has its alleles (across **all** selected, ie site-equivalent,
+  // mapping instances) next to each other.
+  auto locus = compatible_loci.begin();
+  while (locus != compatible_loci.end()) {
+    auto const site_marker = locus->first;
+    AlleleGroup allele_group;
+    for (; locus != compatible_loci.end() && locus->first == site_marker;
+         ++locus)
+      allele_group.insert(locus->second);
 
     auto site_index = siteID_to_index(site_marker);
 
-    // Get the map between allele Ids and counts.
+    // Get the map between allele groups and counts.
     auto &site_coverage = coverage.grouped_allele_counts[site_index];
 #pragma omp critical
-    // Note: if the key does not already exists, creates a key value pair
-    // **and** initialises the value to 0.
-    site_coverage[allele_ids] += 1;
+    {
+      // Note: if the key does not already exists, creates a key value pair
+      // **and** initialises the value to 0.
+      auto &group_coverage = site_coverage[allele_group];
+      if (group_coverage < max_cov_count) group_coverage += 1;
+    }
   }
 }
 
@@ -55,30 +50,34 @@ AlleleGroupHash gram::hash_allele_groups(
   // Loop through all allele id groups across all variant sites.
   for (const auto &site : sites) {
     for (const auto &allele_group : site) {
-      auto allele_ids_group = allele_group.first;
-      auto group_seen = allele_ids_groups_hash.find(allele_ids_group) !=
-                        allele_ids_groups_hash.end();
-      // Group already has an ID, continue.
-      if (group_seen) continue;
-      allele_ids_groups_hash[allele_ids_group] = group_ID++;
+      // Only inserted if the group does not already have an ID
+      if (allele_ids_groups_hash.emplace(allele_group.first, group_ID).second)
+        ++group_ID;
     }
   }
   return allele_ids_groups_hash;
 }
 
+/**
+ * Fills `site_groups` with the (group ID, count) pairs of `site`, ordered by
+ * group ID. Reuses `site_groups`' storage.
+ */
+static void fill_site_groups(GroupedAlleleCounts const &site,
+                             AlleleGroupHash const &allele_ids_groups_hash,
+                             GroupIDToCounts &site_groups) {
+  site_groups.clear();
+  for (auto const &equiv_class_count : site)
+    site_groups.emplace_back(allele_ids_groups_hash.at(equiv_class_count.first),
+                             equiv_class_count.second);
+  std::sort(site_groups.begin(), site_groups.end());
+}
+
 SitesGroupIDToCounts gram::get_group_id_counts(
     SitesGroupedAlleleCounts const &sites,
     AlleleGroupHash const &allele_ids_groups_hash) {
   SitesGroupIDToCounts result(sites.size());
-  std::size_t num_processed{0};
-  for (auto const &site : sites) {
-    GroupIDToCounts site_groups;
-    for (auto const &equiv_class_count : site) {
-      auto group_id = allele_ids_groups_hash.at(equiv_class_count.first);
-      site_groups[std::to_string(group_id)] = equiv_class_count.second;
-    }
-    result.at(num_processed++) = site_groups;
-  }
+  for (std::size_t site = 0; site < sites.size(); ++site)
+    fill_site_groups(sites[site], allele_ids_groups_hash, result[site]);
   return result;
 }
 
@@ -86,26 +85,56 @@ GroupIDToAlleles gram::get_group_id_alleles(
     AlleleGroupHash const &allele_ids_group_hash) {
   GroupIDToAlleles result;
   for (auto const &entry : allele_ids_group_hash)
-    result[std::to_string(entry.second)] = entry.first;
+    result[entry.second] = entry.first.to_ids();
   return result;
 }
 
+void gram::write_json(std::ostream &stream,
+                      const SitesGroupedAlleleCounts &sites,
+                      AlleleGroupHash const &allele_ids_groups_hash) {
+  // Keys are in the order a `JSON` object sorts them
+  stream << "{\"grouped_allele_counts\":{\"allele_groups\":{";
+  bool first{true};
+  for (auto const &entry : get_group_id_alleles(allele_ids_groups_hash)) {
+    if (!first) stream << ",";
+    first = false;
+    stream << "\"" << entry.first << "\":[";
+    for (std::size_t i = 0; i < entry.second.size(); ++i) {
+      if (i > 0) stream << ",";
+      stream << entry.second[i];
+    }
+    stream << "]";
+  }
+
+  stream << "},\"site_counts\":[";
+  GroupIDToCounts site_groups;
+  for (std::size_t site = 0; site < sites.size(); ++site) {
+    if (site > 0) stream << ",";
+    fill_site_groups(sites[site], allele_ids_groups_hash, site_groups);
+    stream << "{";
+    for (std::size_t i = 0; i < site_groups.size(); ++i) {
+      if (i > 0) stream << ",";
+      stream << "\"" << site_groups[i].first
+             << "\":" << static_cast<CovTotal>(site_groups[i].second);
+    }
+    stream << "}";
+  }
+  stream << "]}}";
+}
+
 JSON gram::get_json(const SitesGroupedAlleleCounts &sites,
                     AlleleGroupHash const &allele_ids_groups_hash) {
-  auto group_id_alleles = get_group_id_alleles(allele_ids_groups_hash);
-  auto group_id_counts = get_group_id_counts(sites, allele_ids_groups_hash);
-  JSON result;
-  result["grouped_allele_counts"]["site_counts"] = group_id_counts;
-  result["grouped_allele_counts"]["allele_groups"] = group_id_alleles;
-  return result;
+  std::stringstream stream;
+  write_json(stream, sites, allele_ids_groups_hash);
+  return JSON::parse(stream.str());
 }
 
 void coverage::dump::grouped_allele_counts(const Coverage &coverage,
                                            const GenotypeParams &parameters) {
   auto allele_ids_groups_hash =
       hash_allele_groups(coverage.grouped_allele_counts);
-  auto json = get_json(coverage.grouped_allele_counts, allele_ids_groups_hash);
   std::ofstream file;
   file.open(parameters.grouped_allele_counts_fpath);
-  file << json << std::endl;
-}
\ No newline at end of file
+  write_json(file, coverage.grouped_allele_counts, allele_ids_groups_hash);
+  file << std::endl;
+}
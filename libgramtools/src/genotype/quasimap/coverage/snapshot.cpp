@@ -0,0 +1,182 @@
+#include "genotype/quasimap/coverage/snapshot.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "common/little_endian.hpp"
+#include "common/stable_hash.hpp"
+#include "genotype/parameters.hpp"
+
+using namespace gram;
+
+namespace {
+constexpr char snapshot_magic[] = "GRAMCOVS";
+constexpr uint32_t snapshot_version{2};
+
+CovCount add_counts(CovCount const count, StoredCovCount const added) {
+  return saturate_cov_count(static_cast<CovTotal>(count) + added);
+}
+
+/**
+ * The prg dimensions a snapshot must be loaded against, and a hash of the
+ * prg's layout: the sequence, site and allele markers and number of edges of
+ * each node of the `PbCovLayout`. Prgs of the same dimensions differing in
+ * sequence or structure are then told apart.
+ */
+std::vector<uint64_t> prg_dimensions(PRG_Info const &prg_info) {
+  auto const &layout = prg_info.pb_cov_layout;
+  StableHash layout_hash;
+  for (uint32_t node = 0; node < layout.num_nodes(); ++node) {
+    auto const &cov_node = layout.get_node(node);
+    if (cov_node == nullptr) continue;
+    layout_hash.add<uint64_t>(cov_node->get_sequence().size());
+    layout_hash.add(cov_node->get_sequence());
+    layout_hash.add(cov_node->get_site_ID());
+    layout_hash.add(cov_node->get_allele_ID());
+    layout_hash.add<uint64_t>(cov_node->get_num_edges());
+  }
+  return {prg_info.num_variant_sites, layout.num_nodes(),
+          layout.coverage_space(), layout_hash.get()};
+}
+
+std::runtime_error not_from_this_prg() {
+  return std::runtime_error(
+      "Coverage snapshot file was not made from this prg");
+}
+}  // namespace
+
+void coverage::dump::snapshot(std::ostream &out, Coverage const &coverage,
+                              PRG_Info const &prg_info,
+                              ReadStats const &read_stats) {
+  LittleEndianWriter writer(out);
+  out.write(snapshot_magic, sizeof(snapshot_magic) - 1);
+  writer.write<uint32_t>(snapshot_version);
+  writer.write_all(prg_dimensions(prg_info));
+
+  writer.write<uint64_t>(coverage.allele_sum_coverage.size());
+  for (auto const &site : coverage.allele_sum_coverage)
+    writer.write_all(stored_cov_counts(site));
+
+  writer.write<uint64_t>(coverage.grouped_allele_counts.size());
+  for (auto const &site : coverage.grouped_allele_counts) {
+    writer.write<uint64_t>(site.size());
+    for (auto const &[group, count] : site) {
+      writer.write_all(group.to_ids());
+      writer.write<StoredCovCount>(count);
+    }
+  }
+
+  auto const &layout = prg_info.pb_cov_layout;
+  std::vector<uint32_t> covered_nodes;
+  for (uint32_t node = 0; node < layout.num_nodes(); ++node) {
+    if (layout.coverage_offset(node).has_value() &&
+        !layout.get_node(node)->get_sparse_coverage().is_zero())
+      covered_nodes.push_back(node);
+  }
+  writer.write<uint64_t>(covered_nodes.size());
+  for (auto const node : covered_nodes) {
+    auto const node_coverage = layout.get_node(node)->get_coverage();
+    writer.write<uint32_t>(node);
+    writer.write_all(stored_cov_counts(node_coverage));
+  }
+
+  read_stats.write(writer);
+}
+
+void coverage::dump::snapshot(Coverage const &coverage,
+                              PRG_Info const &prg_info,
+                              ReadStats const &read_stats,
+                              GenotypeParams const &parameters) {
+  std::ofstream out(parameters.coverage_snapshot_fpath, std::ios::binary);
+  snapshot(out, coverage, prg_info, read_stats);
+}
+
+ReadStats coverage::load::snapshot(std::istream &in, Coverage &coverage,
+                                   PRG_Info const &prg_info) {
+  char magic[sizeof(snapshot_magic) - 1];
+  in.read(magic, sizeof(magic));
+  if (static_cast<std::size_t>(in.gcount()) != sizeof(magic) ||
+      !std::equal(magic, magic + sizeof(magic), snapshot_magic))
+    throw std::runtime_error("Not a gramtools coverage snapshot file");
+  LittleEndianReader reader(in, "coverage snapshot file");
+  auto const version = reader.read<uint32_t>();
+  if (version != snapshot_version)
+    throw std::runtime_error(
+        "Coverage snapshot file has format version " + std::to_string(version) +
+        ", expected " + std::to_string(snapshot_version) +
+        ". Please re-run gramtools genotype from reads.");
+  if (reader.read_all<uint64_t>() != prg_dimensions(prg_info))
+    throw not_from_this_prg();
+
+  auto const num_sum_sites = reader.read<uint64_t>();
+  if (num_sum_sites != coverage.allele_sum_coverage.size())
+    throw std::runtime_error("Coverage snapshot file has " +
+                             std::to_string(num_sum_sites) +
+                             " sites of allele sum coverage, expected " +
+                             std::to_string(
+                                 coverage.allele_sum_coverage.size()));
+  for (auto &site : coverage.allele_sum_coverage) {
+    auto const counts = reader.read_all<StoredCovCount>();
+    if (counts.size() != site.size())
+      throw std::runtime_error(
+          "Coverage snapshot file has allele sum coverage of the wrong size");
+    for (std::size_t allele = 0; allele < site.size(); ++allele)
+      site[allele] = add_counts(site[allele], counts[allele]);
+  }
+
+  auto const num_grouped_sites = reader.read<uint64_t>();
+  if (num_grouped_sites != coverage.grouped_allele_counts.size())
+    throw std::runtime_error(
+        "Coverage snapshot file has " + std::to_string(num_grouped_sites) +
+        " sites of grouped allele counts, expected " +
+        std::to_string(coverage.grouped_allele_counts.size()));
+  for (std::size_t site_index = 0; site_index < num_grouped_sites;
+       ++site_index) {
+    if (site_index >= coverage.allele_sum_coverage.size())
+      throw not_from_this_prg();
+    auto &site = coverage.grouped_allele_counts[site_index];
+    auto const num_alleles =
+        static_cast<AlleleId>(coverage.allele_sum_coverage[site_index].size());
+    auto const num_groups = reader.read<uint64_t>();
+    for (std::size_t i = 0; i < num_groups; ++i) {
+      auto const ids = reader.read_all<AlleleId>();
+      for (auto const id : ids) {
+        if (id < 0 || id >= num_alleles) throw not_from_this_prg();
+      }
+      auto &count = site[AlleleGroup(ids)];
+      count = add_counts(count, reader.read<StoredCovCount>());
+    }
+  }
+
+  auto const &layout = prg_info.pb_cov_layout;
+  auto const num_covered_nodes = reader.read<uint64_t>();
+  for (std::size_t i = 0; i < num_covered_nodes; ++i) {
+    auto const node = reader.read<uint32_t>();
+    auto const counts = reader.read_all<StoredCovCount>();
+    bool const records_coverage =
+        node < layout.num_nodes() && layout.coverage_offset(node).has_value();
+    if (!records_coverage ||
+        counts.size() != layout.get_node(node)->get_sparse_coverage().size())
+      throw std::runtime_error(
+          "Coverage snapshot file has per base coverage for node " +
+          std::to_string(node) + ", which does not record it in this prg");
+    auto &node_coverage = layout.get_node(node)->get_ref_to_coverage();
+    for (std::size_t base = 0; base < counts.size(); ++base) {
+      if (counts[base] > 0)
+        node_coverage.set(base, add_counts(node_coverage[base], counts[base]));
+    }
+  }
+
+  ReadStats read_stats;
+  read_stats.read(reader);
+  return read_stats;
+}
+
+ReadStats coverage::load::snapshot(std::string const &fpath,
+                                   Coverage &coverage,
+                                   PRG_Info const &prg_info) {
+  std::ifstream in(fpath, std::ios::binary);
+  if (!in.is_open())
+    throw std::runtime_error("Could not open coverage snapshot file " + fpath);
+  return snapshot(in, coverage, prg_info);
+}
@@ -2,7 +2,9 @@
 
 #include <omp.h>
 
+#include <algorithm>
 #include <exception>
+#include <memory>
 #include <stdexcept>
 
 #include "common/random.hpp"
@@ -16,7 +18,8 @@ using namespace gram;
 QuasimapReadsStats gram::quasimap_reads(const GenotypeParams &parameters,
                                         const KmerIndex &kmer_index,
                                         const PRG_Info &prg_info,
-                                        ReadStats &readstats) {
+                                        ReadStats &readstats,
+                                        KmerFilter const *const kmer_filter) {
   QuasimapReadsStats quasimap_stats{};
   std::cout << "Generating allele quasimap data structure" << std::endl;
   // The coverage structure records mapped allele counts (per site), aggregated
@@ -34,25 +37,48 @@ QuasimapReadsStats gram::quasimap_reads(const GenotypeParams &parameters,
   std::cout << "Maximum thread count: " << parameters.maximum_threads
             << std::endl;
 
+  // Optionally skips searching reads identical to recently mapped ones
+  std::unique_ptr<ReadCache> read_cache;
+  if (parameters.read_cache_size > 0) {
+    read_cache = std::make_unique<ReadCache>(parameters.read_cache_size);
+    std::cout << "Read cache size: " << parameters.read_cache_size
+              << std::endl;
+  }
+
+  // Per base coverage is accumulated per thread, and added to the coverage
+  // graph once all reads are mapped
+  auto &coverage = quasimap_stats.coverage;
+  if (!prg_info.pb_cov_layout.empty())
+    coverage.pb_cov_accumulator =
+        PbCovAccumulator(prg_info.pb_cov_layout.coverage_space(),
+                         static_cast<uint32_t>(omp_get_max_threads()));
+
   std::cout << "Processing reads:" << std::endl;
 
   // Execute quasimap for each read file provided
+  bool const nested = prg_info.coverage_graph.is_nested;
+  if (not nested)
+    std::cout << "The prg has no nested sites: using flat prg mapping"
+              << std::endl;
   for (const auto &reads_fpath : parameters.reads_fpaths) {
-    handle_read_file(quasimap_stats, reads_fpath, parameters, kmer_index,
-                     prg_info, &master_seed_generator);
+    if (nested)
+      handle_read_file<Nesting::nested>(
+          quasimap_stats, reads_fpath, parameters, kmer_index, prg_info,
+          &master_seed_generator, read_cache.get(), kmer_filter);
+    else
+      handle_read_file<Nesting::flat>(
+          quasimap_stats, reads_fpath, parameters, kmer_index, prg_info,
+          &master_seed_generator, read_cache.get(), kmer_filter);
   }
 
-  auto &coverage = quasimap_stats.coverage;
+  coverage::record::accumulated_allele_base(coverage, prg_info);
+
   // Compute read mapping statistics (used in `infer` command). Can only be done
   // after mapping!
   readstats.compute_coverage_depth(coverage, prg_info.coverage_graph);
 
-  // Extract non-nested per base coverage
-  coverage.allele_base_coverage =
-      coverage::generate::allele_base_non_nested(prg_info);
-
   // Write coverage results to disk
-  coverage::dump::all(coverage, parameters);
+  coverage::dump::all(coverage, prg_info, parameters);
   return quasimap_stats;
 }
 
@@ -78,16 +104,22 @@ std::vector<Sequence> get_reads_buffer(SeqRead::SeqIterator &reads_it,
 /**
  * Calls the (forward_reverse) mapping routine for each read in the read buffer,
  * in parallel (if the CL option has been specified).
+ * Reads are handed out to threads dynamically, `chunk_size` at a time, as
+ * their mapping cost is very uneven.
  */
+template <Nesting nesting>
 void handle_reads_buffer(QuasimapReadsStats &quasimap_stats,
                          const std::vector<Sequence> &reads_buffer,
                          Seeds const &selection_seeds,
+                         uint64_t const chunk_size,
                          const GenotypeParams &parameters,
                          const KmerIndex &kmer_index,
-                         const PRG_Info &prg_info) {
+                         const PRG_Info &prg_info,
+                         ReadCache *const read_cache,
+                         KmerFilter const *const kmer_filter) {
   uint64_t last_count_reported = 0;
 
-#pragma omp parallel for
+#pragma omp parallel for schedule(dynamic, chunk_size)
   for (std::size_t i = 0; i < reads_buffer.size(); ++i) {
     auto thread_id = omp_get_thread_num();
     //  Report total number of mapped reads everytime at least `diff` such have
@@ -105,92 +137,327 @@ void handle_reads_buffer(QuasimapReadsStats &quasimap_stats,
     quasimap_stats.all_reads_count +=
         2;  //  Increment by 2: mapping forward and reverse of read
 
-    auto const read = reads_buffer.at(i);
+    auto const &read = reads_buffer.at(i);
     if (read.empty()) {
 #pragma omp atomic
       quasimap_stats.skipped_reads_count += 2;
       continue;
     }
     auto const selection_seed = selection_seeds.at(i);
-    quasimap_forward_reverse(quasimap_stats, read, parameters, kmer_index,
-                             prg_info, selection_seed);
+    quasimap_forward_reverse<nesting>(quasimap_stats, read, parameters,
+                                      kmer_index, prg_info, selection_seed,
+                                      read_cache, kmer_filter);
   }
 }
 
+template <Nesting nesting>
 void gram::handle_read_file(QuasimapReadsStats &quasimap_stats,
                             const std::string &reads_fpath,
                             const GenotypeParams &parameters,
                             const KmerIndex &kmer_index,
                             const PRG_Info &prg_info,
-                            RandomGenerator *const seed_generator) {
-  //  Number of reads to load in memory; is upper limit of number of reads that
-  //  can be mapped in parallel
-  uint64_t max_num_reads = 5000;
+                            RandomGenerator *const seed_generator,
+                            ReadCache *const read_cache,
+                            KmerFilter const *const kmer_filter) {
+  auto const num_threads = static_cast<uint32_t>(omp_get_max_threads());
+  //  Sets the number of reads to load in memory, which is the upper limit of
+  //  number of reads that can be mapped in parallel
+  ReadBatchSizer batch_sizer(num_threads);
   // Used for random selection of multi-mapping reads
-  Seeds selection_seeds(max_num_reads);
+  Seeds selection_seeds;
 
   SeqRead reads(reads_fpath.c_str());
   auto reads_it = reads.begin();
   while (reads_it != reads.end()) {
-    auto reads_buffer = get_reads_buffer(reads_it, reads, max_num_reads);
-    for (int i = 0; i < max_num_reads; i++)
-      selection_seeds.at(i) = (*seed_generator)();
-    handle_reads_buffer(quasimap_stats, reads_buffer, selection_seeds,
-                        parameters, kmer_index, prg_info);
+    auto reads_buffer =
+        get_reads_buffer(reads_it, reads, batch_sizer.batch_size());
+    // Exactly one seed per read, so that each read gets the same seed whatever
+    // the buffer sizes
+    selection_seeds.resize(reads_buffer.size());
+    for (auto &selection_seed : selection_seeds)
+      selection_seed = (*seed_generator)();
+
+    auto const start_time = omp_get_wtime();
+    handle_reads_buffer<nesting>(
+        quasimap_stats, reads_buffer, selection_seeds,
+        ReadBatchSizer::chunk_size(reads_buffer.size(), num_threads),
+        parameters, kmer_index, prg_info, read_cache, kmer_filter);
+    batch_sizer.record(reads_buffer.size(), omp_get_wtime() - start_time);
+  }
+}
+
+template void gram::handle_read_file<Nesting::flat>(
+    QuasimapReadsStats &, const std::string &, const GenotypeParams &,
+    const KmerIndex &, const PRG_Info &, RandomGenerator *const,
+    ReadCache *const, KmerFilter const *const);
+template void gram::handle_read_file<Nesting::nested>(
+    QuasimapReadsStats &, const std::string &, const GenotypeParams &,
+    const KmerIndex &, const PRG_Info &, RandomGenerator *const,
+    ReadCache *const, KmerFilter const *const);
+
+ReadBatchSizer::ReadBatchSizer(uint32_t const num_threads)
+    : num_threads(std::max(num_threads, uint32_t{1})) {}
+
+void ReadBatchSizer::record(uint64_t const num_reads,
+                            double const elapsed_seconds) {
+  if (num_reads == 0) return;
+  double const measured = std::max(elapsed_seconds, 0.0) * num_threads /
+                          static_cast<double>(num_reads);
+  if (thread_seconds_per_read == 0)
+    thread_seconds_per_read = measured;
+  else  // Smooths out buffer-to-buffer variation
+    thread_seconds_per_read = (thread_seconds_per_read + measured) / 2;
+
+  if (thread_seconds_per_read == 0) {
+    size = max_batch_size;
+    return;
+  }
+  double const target_size =
+      target_seconds * num_threads / thread_seconds_per_read;
+  size = static_cast<uint64_t>(
+      std::clamp(target_size, static_cast<double>(min_batch_size),
+                 static_cast<double>(max_batch_size)));
+}
+
+uint64_t ReadBatchSizer::chunk_size(uint64_t const num_reads,
+                                    uint32_t const num_threads) {
+  uint64_t const chunks_per_thread = 32;
+  uint64_t const max_chunk_size = 64;
+  auto const chunk_size =
+      num_reads / (std::max(num_threads, uint32_t{1}) * chunks_per_thread);
+  return std::clamp(chunk_size, uint64_t{1}, max_chunk_size);
+}
+
+/**
+ * @return the cached mapping of `read`, if a cache is used and holds it.
+ */
+std::optional<ReadMapping> find_in_read_cache(Sequence const &read,
+                                              ReadCache *const read_cache,
+                                              QuasimapReadsStats &stats) {
+  if (read_cache == nullptr) return std::nullopt;
+  auto cached_mapping = read_cache->find(read);
+#pragma omp atomic
+  stats.read_cache_lookups_count += 1;
+  if (cached_mapping.has_value()) {
+#pragma omp atomic
+    stats.read_cache_hits_count += 1;
+  }
+  return cached_mapping;
+}
+
+/**
+ * Updates the mapping statistics with the outcome of mapping a read, and
+ * records coverage if it mapped.
+ */
+template <Nesting nesting>
+void record_read_mapping(ReadMapping const &mapping,
+                         uint64_t const &read_length, Coverage &coverage,
+                         const PRG_Info &prg_info, QuasimapReadsStats &stats,
+                         SeedSize const &selection_seed) {
+  switch (mapping.outcome) {
+    case MappingOutcome::rejected_by_filter:
+#pragma omp atomic
+      stats.kmer_filter_rejected_reads_count += 1;
+      [[fallthrough]];
+    case MappingOutcome::missing_kmer:
+#pragma omp atomic
+      stats.missing_kmer_reads_count += 1;
+      return;
+    case MappingOutcome::no_extension:
+#pragma omp atomic
+      stats.no_extension_reads_count += 1;
+      return;
+    case MappingOutcome::exceeded_search_limits:
+#pragma omp atomic
+      stats.search_limit_dropped_reads_count += 1;
+      return;
+    case MappingOutcome::mapped_without_per_base:
+#pragma omp atomic
+      stats.search_limit_no_per_base_reads_count += 1;
+      break;
+    case MappingOutcome::mapped:
+      break;
   }
+
+  bool const record_per_base =
+      mapping.outcome != MappingOutcome::mapped_without_per_base;
+  coverage::record::search_states<nesting>(coverage, mapping.search_states,
+                                           read_length, prg_info,
+                                           selection_seed, record_per_base);
+#pragma omp atomic
+  stats.exact_mapped_reads_count += 1;
 }
 
+template <Nesting nesting>
 void gram::quasimap_forward_reverse(QuasimapReadsStats &quasimap_stats,
                                     const Sequence &read,
                                     const GenotypeParams &parameters,
                                     const KmerIndex &kmer_index,
                                     const PRG_Info &prg_info,
-                                    SeedSize const &selection_seed) {
-  // Forward mapping
-  quasimap_read(read, quasimap_stats.coverage, kmer_index, prg_info, parameters,
-                quasimap_stats, selection_seed);
+                                    SeedSize const &selection_seed,
+                                    ReadCache *const read_cache,
+                                    KmerFilter const *const kmer_filter) {
+  auto const &kmer_size = parameters.kmers_size;
+  // Only materialised if needed: as a cache key, or for backward search
+  Sequence reverse_read;
+  if (read_cache != nullptr) reverse_read = reverse_complement_read(read);
+
+  auto forward_mapping = find_in_read_cache(read, read_cache, quasimap_stats);
+  auto reverse_mapping =
+      find_in_read_cache(reverse_read, read_cache, quasimap_stats);
+
+  // Checks the kmers of both strands in one pass over the read, so that
+  // unmappable reads are rejected without searching either strand.
+  auto const kmers_check =
+      check_strands_kmers(kmer_size, read, kmer_index, kmer_filter,
+                          not forward_mapping.has_value(),
+                          not reverse_mapping.has_value());
+
+  if (not forward_mapping.has_value()) {
+    if (kmers_check.forward_rejection.has_value())
+      forward_mapping = ReadMapping{kmers_check.forward_rejection.value()};
+    else
+      forward_mapping =
+          search_checked_read<nesting>(read, kmer_index, prg_info, parameters);
+    if (read_cache != nullptr) read_cache->insert(read, *forward_mapping);
+  }
 
-  auto reverse_read = reverse_complement_read(read);
+  if (not reverse_mapping.has_value()) {
+    if (kmers_check.reverse_rejection.has_value())
+      reverse_mapping = ReadMapping{kmers_check.reverse_rejection.value()};
+    else {
+      if (reverse_read.empty()) reverse_read = reverse_complement_read(read);
+      reverse_mapping = search_checked_read<nesting>(reverse_read, kmer_index,
+                                                     prg_info, parameters);
+    }
+    if (read_cache != nullptr)
+      read_cache->insert(reverse_read, *reverse_mapping);
+  }
+
+  // Forward mapping
+  record_read_mapping<nesting>(*forward_mapping, read.size(),
+                               quasimap_stats.coverage, prg_info,
+                               quasimap_stats, selection_seed);
   // Reverse mapping
-  quasimap_read(reverse_read, quasimap_stats.coverage, kmer_index, prg_info,
-                parameters, quasimap_stats, selection_seed);
+  record_read_mapping<nesting>(*reverse_mapping, read.size(),
+                               quasimap_stats.coverage, prg_info,
+                               quasimap_stats, selection_seed);
 }
 
+template void gram::quasimap_forward_reverse<Nesting::flat>(
+    QuasimapReadsStats &, const Sequence &, const GenotypeParams &,
+    const KmerIndex &, const PRG_Info &, SeedSize const &, ReadCache *const,
+    KmerFilter const *const);
+template void gram::quasimap_forward_reverse<Nesting::nested>(
+    QuasimapReadsStats &, const Sequence &, const GenotypeParams &,
+    const KmerIndex &, const PRG_Info &, SeedSize const &, ReadCache *const,
+    KmerFilter const *const);
+
+template <Nesting nesting>
 void gram::quasimap_read(const Sequence &read, Coverage &coverage,
                          const KmerIndex &kmer_index, const PRG_Info &prg_info,
                          const GenotypeParams &parameters,
                          QuasimapReadsStats &stats,
-                         SeedSize const &selection_seed) {
+                         SeedSize const &selection_seed,
+                         ReadCache *const read_cache,
+                         KmerFilter const *const kmer_filter) {
+  auto mapping = find_in_read_cache(read, read_cache, stats);
+  if (not mapping.has_value()) {
+    mapping = search_read<nesting>(read, kmer_index, prg_info, parameters,
+                                   kmer_filter);
+    if (read_cache != nullptr) read_cache->insert(read, *mapping);
+  }
+  record_read_mapping<nesting>(*mapping, read.size(), coverage, prg_info,
+                               stats, selection_seed);
+}
+
+template void gram::quasimap_read<Nesting::flat>(
+    const Sequence &, Coverage &, const KmerIndex &, const PRG_Info &,
+    const GenotypeParams &, QuasimapReadsStats &, SeedSize const &,
+    ReadCache *const, KmerFilter const *const);
+template void gram::quasimap_read<Nesting::nested>(
+    const Sequence &, Coverage &, const KmerIndex &, const PRG_Info &,
+    const GenotypeParams &, QuasimapReadsStats &, SeedSize const &,
+    ReadCache *const, KmerFilter const *const);
+
+template <Nesting nesting>
+ReadMapping gram::search_read(const Sequence &read, const KmerIndex &kmer_index,
+                              const PRG_Info &prg_info,
+                              const GenotypeParams &parameters,
+                              KmerFilter const *const kmer_filter) {
+  auto const &kmer_size = parameters.kmers_size;
   /*
    * We can discard reads containing 1 or more kmers not present in the index.
    * This is based on the following assumptions:
    *   - All kmers of size `kmers_size` in the PRG are in the index
    *   - Reads must be mapped exactly
+   * The kmer filter, if any, rejects most such reads without touching the
+   * index.
    */
+  if (kmer_filter != nullptr and
+      not kmer_filter->all_read_kmers_may_occur(kmer_size, read))
+    return ReadMapping{MappingOutcome::rejected_by_filter, SearchStates{}};
+
   bool read_can_map_exactly =
-      all_read_kmers_occur_in_index(parameters.kmers_size, read, kmer_index);
-  if (not read_can_map_exactly) {
-#pragma omp atomic
-    stats.missing_kmer_reads_count += 1;
-    return;
-  }
+      all_read_kmers_occur_in_index(kmer_size, read, kmer_index);
+  if (not read_can_map_exactly) return ReadMapping{};
+
+  return search_checked_read<nesting>(read, kmer_index, prg_info, parameters);
+}
 
+template ReadMapping gram::search_read<Nesting::flat>(
+    const Sequence &, const KmerIndex &, const PRG_Info &,
+    const GenotypeParams &, KmerFilter const *const);
+template ReadMapping gram::search_read<Nesting::nested>(
+    const Sequence &, const KmerIndex &, const PRG_Info &,
+    const GenotypeParams &, KmerFilter const *const);
+
+template <Nesting nesting>
+ReadMapping gram::search_checked_read(const Sequence &read,
+                                      const KmerIndex &kmer_index,
+                                      const PRG_Info &prg_info,
+                                      const GenotypeParams &parameters) {
+  auto const &limits = parameters.search_limits;
   auto seeding_kmer = get_last_kmer_in_read(parameters.kmers_size, read);
-  auto search_states =
-      search_read_backwards(read, seeding_kmer, kmer_index, prg_info);
+  bool exceeded_limits = false;
+  auto search_states = search_read_backwards<nesting>(
+      read, seeding_kmer, kmer_index, prg_info, limits, &exceeded_limits);
   // Test read did not map
-  if (search_states.empty()) {
-#pragma omp atomic
-    stats.no_extension_reads_count += 1;
-    return;
+  if (search_states.empty())
+    return ReadMapping{MappingOutcome::no_extension, SearchStates{}};
+
+  if (exceeded_limits) {
+    if (limits.policy == SearchLimitPolicy::drop)
+      return ReadMapping{MappingOutcome::exceeded_search_limits,
+                         SearchStates{}};
+    return ReadMapping{MappingOutcome::mapped_without_per_base, search_states};
   }
 
-  auto read_length = read.size();
-  coverage::record::search_states(coverage, search_states, read_length,
-                                  prg_info, selection_seed);
-#pragma omp atomic
-  stats.exact_mapped_reads_count += 1;
-  return;
+  return ReadMapping{MappingOutcome::mapped, search_states};
+}
+
+template ReadMapping gram::search_checked_read<Nesting::flat>(
+    const Sequence &, const KmerIndex &, const PRG_Info &,
+    const GenotypeParams &);
+template ReadMapping gram::search_checked_read<Nesting::nested>(
+    const Sequence &, const KmerIndex &, const PRG_Info &,
+    const GenotypeParams &);
+
+bool gram::exceeds_search_limits(SearchStates const &search_states,
+                                 SearchLimits const &limits) {
+  if (not limits.bounded()) return false;
+  if (limits.max_search_states > 0 and
+      search_states.size() > limits.max_search_states)
+    return true;
+  if (limits.max_sa_interval_width == 0) return false;
+
+  uint64_t sa_interval_width = 0;
+  for (auto const &search_state : search_states) {
+    auto const &sa_interval = search_state.sa_interval;
+    sa_interval_width += sa_interval.second - sa_interval.first + 1;
+    if (sa_interval_width > limits.max_sa_interval_width) return true;
+  }
+  return false;
 }
 
 Sequence gram::get_kmer_in_read(const uint32_t &kmer_size,
@@ -224,10 +491,112 @@ bool gram::all_read_kmers_occur_in_index(uint32_t const &kmer_size,
   return true;
 }
 
+/**
+ * Produce integer-encoded Watson-Crick base complement.
+ */
+int_Base complement_encoded_base(const int_Base &encoded_base) {
+  switch (encoded_base) {
+    case 1:
+      return 4;
+    case 2:
+      return 3;
+    case 3:
+      return 2;
+    case 4:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Two-bit code of an encoded base (1-4), and of its complement.
+ */
+inline uint64_t base_bits(int_Base const &base) { return (base - 1) & 3; }
+inline uint64_t complement_base_bits(int_Base const &base) {
+  return 3 - base_bits(base);
+}
+
+StrandsKmerCheck gram::check_strands_kmers(uint32_t const &kmer_size,
+                                           Sequence const &read,
+                                           KmerIndex const &kmer_index,
+                                           KmerFilter const *const kmer_filter,
+                                           bool const check_forward,
+                                           bool const check_reverse) {
+  StrandsKmerCheck result;
+  bool forward_alive = check_forward, reverse_alive = check_reverse;
+  // A read shorter than a kmer has no kmer to check
+  if (read.size() < kmer_size or kmer_size == 0) return result;
+
+  if (kmer_filter != nullptr and kmer_size <= max_packed_kmer_size) {
+    // Rolling two-bit words of the forward kmer and of its reverse complement
+    uint64_t const mask =
+        kmer_size == 32 ? ~uint64_t(0) : (uint64_t(1) << (2 * kmer_size)) - 1;
+    uint64_t const front_shift = 2 * (kmer_size - 1);
+    uint64_t forward_word = 0, reverse_word = 0;
+    for (std::size_t i = 0; i < read.size(); ++i) {
+      forward_word = ((forward_word << 2) | base_bits(read[i])) & mask;
+      reverse_word =
+          (reverse_word >> 2) | (complement_base_bits(read[i]) << front_shift);
+      if (i + 1 < kmer_size) continue;
+
+      if (forward_alive and
+          not kmer_filter->may_contain_packed(forward_word, kmer_size)) {
+        result.forward_rejection = MappingOutcome::rejected_by_filter;
+        forward_alive = false;
+      }
+      if (reverse_alive and
+          not kmer_filter->may_contain_packed(reverse_word, kmer_size)) {
+        result.reverse_rejection = MappingOutcome::rejected_by_filter;
+        reverse_alive = false;
+      }
+      if (not forward_alive and not reverse_alive) return result;
+    }
+  } else if (kmer_filter != nullptr) {
+    if (forward_alive and
+        not kmer_filter->all_read_kmers_may_occur(kmer_size, read)) {
+      result.forward_rejection = MappingOutcome::rejected_by_filter;
+      forward_alive = false;
+    }
+    if (reverse_alive and not kmer_filter->all_read_kmers_may_occur(
+                              kmer_size, reverse_complement_read(read))) {
+      result.reverse_rejection = MappingOutcome::rejected_by_filter;
+      reverse_alive = false;
+    }
+  }
+
+  // Exact lookups, for the strands that got through the filter
+  Sequence forward_kmer(kmer_size), reverse_kmer(kmer_size);
+  for (std::size_t offset = 0; offset + kmer_size <= read.size(); ++offset) {
+    if (not forward_alive and not reverse_alive) break;
+    auto const kmer_begin = read.begin() + offset;
+    if (forward_alive) {
+      std::copy(kmer_begin, kmer_begin + kmer_size, forward_kmer.begin());
+      if (kmer_index.find(forward_kmer) == kmer_index.end()) {
+        result.forward_rejection = MappingOutcome::missing_kmer;
+        forward_alive = false;
+      }
+    }
+    if (reverse_alive) {
+      for (std::size_t i = 0; i < kmer_size; ++i)
+        reverse_kmer[kmer_size - 1 - i] =
+            complement_encoded_base(*(kmer_begin + i));
+      if (kmer_index.find(reverse_kmer) == kmer_index.end()) {
+        result.reverse_rejection = MappingOutcome::missing_kmer;
+        reverse_alive = false;
+      }
+    }
+  }
+  return result;
+}
+
+template <Nesting nesting>
 SearchStates gram::search_read_backwards(const Sequence &read,
                                          const Sequence &kmer,
                                          const KmerIndex &kmer_index,
-                                         const PRG_Info &prg_info) {
+                                         const PRG_Info &prg_info,
+                                         SearchLimits const &limits,
+                                         bool *const exceeded_limits) {
   // Test if kmer has been indexed
   bool kmer_in_index = kmer_index.find(kmer) != kmer_index.end();
   if (not kmer_in_index) return SearchStates{};
@@ -239,51 +608,52 @@ SearchStates gram::search_read_backwards(const Sequence &read,
   std::advance(read_begin, kmer.size());
 
   SearchStates new_search_states = kmer_index_search_states;
+  bool exceeded = exceeds_search_limits(new_search_states, limits);
 
-  for (auto it = read_begin; it != read.rend();
+  for (auto it = read_begin; not exceeded and it != read.rend();
        ++it) {  /// Iterates end to start of read
     const int_Base &pattern_char = *it;
-    new_search_states = process_read_char_search_states(
+    new_search_states = process_read_char_search_states<nesting>(
         pattern_char, new_search_states, prg_info);
     // Test if no mapping found upon character extension
     auto read_not_mapped = new_search_states.empty();
     if (read_not_mapped) break;
+    exceeded = exceeds_search_limits(new_search_states, limits);
   }
+  if (exceeded_limits != nullptr) *exceeded_limits = exceeded;
+  // Dropped reads record no coverage, so need no allele paths
+  if (exceeded and limits.policy == SearchLimitPolicy::drop)
+    return new_search_states;
 
   new_search_states =
       handle_allele_encapsulated_states(new_search_states, prg_info);
   return new_search_states;
 }
 
+template SearchStates gram::search_read_backwards<Nesting::flat>(
+    const Sequence &, const Sequence &, const KmerIndex &, const PRG_Info &,
+    SearchLimits const &, bool *const);
+template SearchStates gram::search_read_backwards<Nesting::nested>(
+    const Sequence &, const Sequence &, const KmerIndex &, const PRG_Info &,
+    SearchLimits const &, bool *const);
+
+template <Nesting nesting>
 SearchStates gram::process_read_char_search_states(const int_Base &pattern_char,
                                                    SearchStates &search_states,
                                                    const PRG_Info &prg_info) {
   //  Check for variant  markers in the current SA intervals;
   //  This is the v part of vBWT. Modifies search states in-place.
-  process_markers_search_states(search_states, prg_info);
+  process_markers_search_states<nesting>(search_states, prg_info);
   //  Regular backward searching
   auto const new_search_states =
       search_base_backwards(pattern_char, search_states, prg_info);
   return new_search_states;
 }
 
-/**
- * Produce integer-encoded Watson-Crick base complement.
- */
-int_Base complement_encoded_base(const int_Base &encoded_base) {
-  switch (encoded_base) {
-    case 1:
-      return 4;
-    case 2:
-      return 3;
-    case 3:
-      return 2;
-    case 4:
-      return 1;
-    default:
-      return 0;
-  }
-}
+template SearchStates gram::process_read_char_search_states<Nesting::flat>(
+    const int_Base &, SearchStates &, const PRG_Info &);
+template SearchStates gram::process_read_char_search_states<Nesting::nested>(
+    const int_Base &, SearchStates &, const PRG_Info &);
 
 Sequence gram::reverse_complement_read(const Sequence &read) {
   Sequence reverse_read;
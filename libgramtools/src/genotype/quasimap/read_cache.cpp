@@ -0,0 +1,52 @@
+#include "genotype/quasimap/read_cache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace gram;
+
+ReadCache::ReadCache(std::size_t const max_entries,
+                     std::size_t const num_shards)
+    : max_entries(max_entries),
+      shards(std::max<std::size_t>(1, std::min(num_shards, max_entries))) {
+  if (max_entries == 0)
+    throw std::invalid_argument("A read cache must hold at least one read");
+  // Rounding up means the cache can hold slightly more than `max_entries`
+  max_shard_entries = (max_entries + shards.size() - 1) / shards.size();
+}
+
+ReadCache::Shard &ReadCache::get_shard(Sequence const &read) {
+  auto const hash = sequence_hash<Sequence>()(read);
+  return shards[hash % shards.size()];
+}
+
+std::optional<ReadMapping> ReadCache::find(Sequence const &read) {
+  auto &shard = get_shard(read);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto found = shard.entries.find(read);
+  if (found == shard.entries.end()) return std::nullopt;
+  return found->second;
+}
+
+void ReadCache::insert(Sequence const &read, ReadMapping const &mapping) {
+  auto &shard = get_shard(read);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // Another thread may have mapped the same read concurrently
+  if (shard.entries.find(read) != shard.entries.end()) return;
+
+  if (shard.entries.size() >= max_shard_entries) {
+    shard.entries.erase(shard.insertion_order.front());
+    shard.insertion_order.pop_front();
+  }
+  shard.entries.emplace(read, mapping);
+  shard.insertion_order.push_back(read);
+}
+
+std::size_t ReadCache::size() {
+  std::size_t result = 0;
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    result += shard.entries.size();
+  }
+  return result;
+}
@@ -38,7 +38,8 @@ SearchStates gram::handle_allele_encapsulated_state(
        sa_index <= search_state.sa_interval.second; ++sa_index) {
     // Retrieve site and allele IDs
     auto prg_index = prg_info.fm_index[sa_index];
-    auto cov_node = prg_info.coverage_graph.random_access[prg_index].node;
+    auto const &cov_node =
+        prg_info.coverage_graph.random_access.node(prg_index);
     auto site_marker = cov_node->get_site_ID();
     auto allele_id = cov_node->get_allele_ID();
 
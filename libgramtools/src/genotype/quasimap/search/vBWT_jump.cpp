@@ -102,7 +102,7 @@ MarkersSearchResults gram::left_markers_search(const SearchState &search_state,
 
     auto prg_index = prg_info.fm_index[index];
     VariantLocus target_locus =
-        prg_info.coverage_graph.random_access[prg_index].target;
+        prg_info.coverage_graph.random_access.target(prg_index);
     // Convert the target to a site ID if it is an allele ID that points to the
     // beginning of the site (ie, it is not the last allele)
     if (is_allele_marker(target_locus.first)) {
@@ -116,12 +116,13 @@ MarkersSearchResults gram::left_markers_search(const SearchState &search_state,
   return markers_search_results;
 }
 
+template <Nesting nesting>
 void gram::process_markers_search_states(SearchStates &current_search_states,
                                          const PRG_Info &prg_info) {
   SearchStates all_markers_search_states;
   for (auto const &search_state : current_search_states) {
     auto markers_search_states =
-        search_state_vBWT_jumps(search_state, prg_info);
+        search_state_vBWT_jumps<nesting>(search_state, prg_info);
     if (!markers_search_states.empty()) {
       all_markers_search_states.splice(all_markers_search_states.end(),
                                        markers_search_states);
@@ -131,6 +132,12 @@ void gram::process_markers_search_states(SearchStates &current_search_states,
                                all_markers_search_states);
 }
 
+template void gram::process_markers_search_states<Nesting::flat>(
+    SearchStates &, const PRG_Info &);
+template void gram::process_markers_search_states<Nesting::nested>(
+    SearchStates &, const PRG_Info &);
+
+template <Nesting nesting>
 SearchStates gram::search_state_vBWT_jumps(
     const SearchState &current_search_state, const PRG_Info &prg_info) {
   // A vector of the `VariantLocus`s that need to be processed
@@ -159,8 +166,8 @@ SearchStates gram::search_state_vBWT_jumps(
 
     // Get the new targets
     if (is_site_marker(target_locus.first)) {
-      auto new_target =
-          extend_targets_site_exit(target_locus, search_state, prg_info);
+      auto new_target = extend_targets_site_exit<nesting>(
+          target_locus, search_state, prg_info);
       extension_targets = Locus_and_SearchStates{new_target};
     } else {
       extension_targets =
@@ -182,6 +189,12 @@ SearchStates gram::search_state_vBWT_jumps(
   return markers_search_states;
 }
 
+template SearchStates gram::search_state_vBWT_jumps<Nesting::flat>(
+    const SearchState &, const PRG_Info &);
+template SearchStates gram::search_state_vBWT_jumps<Nesting::nested>(
+    const SearchState &, const PRG_Info &);
+
+template <Nesting nesting>
 Locus_and_SearchState gram::extend_targets_site_exit(
     VariantLocus const &target_locus, SearchState const &search_state,
     PRG_Info const &prg_info) {
@@ -210,10 +223,12 @@ Locus_and_SearchState gram::extend_targets_site_exit(
                           // will not extend this SearchState
       break;  // The site entry will get processed separately by the calling
               // function
-    } else {  // A double exit
+    } else if constexpr (nesting == Nesting::nested) {  // A double exit
       // Sanity check: the targeted double exit should be correspondingly well
       // recorded in the parental map
-      auto parent_site = prg_info.coverage_graph.par_map.at(site_marker);
+      auto const &site_hierarchy = prg_info.coverage_graph.site_hierarchy;
+      assert(site_hierarchy.has_parent(site_marker));
+      auto parent_site = site_hierarchy.parent_locus(site_marker);
       assert(parent_site.first == next_site_marker);
 
       // update the SearchState.
@@ -222,11 +237,19 @@ Locus_and_SearchState gram::extend_targets_site_exit(
           exiting_site_search_state(VariantLocus{next_site_marker, allele_id},
                                     new_search_state, prg_info);
       site_marker = next_site_marker;
+    } else {
+      assert(false);  // A flat prg has no double exits
+      break;
     }
   }
   return Locus_and_SearchState{next_target, new_search_state, commit_me};
 }
 
+template Locus_and_SearchState gram::extend_targets_site_exit<Nesting::flat>(
+    VariantLocus const &, SearchState const &, PRG_Info const &);
+template Locus_and_SearchState gram::extend_targets_site_exit<Nesting::nested>(
+    VariantLocus const &, SearchState const &, PRG_Info const &);
+
 Locus_and_SearchStates gram::extend_targets_site_entry(
     VariantLocus const &target_locus, SearchState const &search_state,
     PRG_Info const &prg_info) {
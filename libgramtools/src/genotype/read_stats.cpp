@@ -2,6 +2,9 @@
 
 #include <math.h>
 
+#include <algorithm>
+
+#include "common/little_endian.hpp"
 #include "genotype/infer/types.hpp"
 #include "prg/coverage_graph.hpp"
 
@@ -69,9 +72,27 @@ void gram::ReadStats::process_read_perbase_error_rates(
   this->mean_pb_error = mean_error;
 }
 
+void gram::ReadStats::add_base_error_rate(ReadStats const& other) {
+  // Statistics not computed are at -1
+  auto const num_bases = std::max<int64_t>(num_bases_processed, 0),
+             other_num_bases = std::max<int64_t>(other.num_bases_processed, 0);
+  // The error rate is that of the mean base quality
+  double total_qual = 0.;
+  if (num_bases > 0) total_qual -= num_bases * 10 * log10(mean_pb_error);
+  if (other_num_bases > 0)
+    total_qual -= other_num_bases * 10 * log10(other.mean_pb_error);
+  if (num_bases + other_num_bases > 0)
+    mean_pb_error = pow(10, -total_qual / (num_bases + other_num_bases) / 10);
+
+  num_bases_processed = num_bases + other_num_bases;
+  no_qual_reads = std::max<int64_t>(no_qual_reads, 0) +
+                  std::max<int64_t>(other.no_qual_reads, 0);
+  max_read_length = std::max(max_read_length, other.max_read_length);
+}
+
 ReadStats::haplogroup_cov ReadStats::get_max_cov_haplogroup(
     GroupedAlleleCounts const& gped_cov) {
-  std::map<AlleleId, CovCount> counts;
+  std::map<AlleleId, CovTotal> counts;
   for (auto const& entry : gped_cov) {
     for (auto const& allele_id : entry.first) {
       if (counts.find(allele_id) == counts.end())
@@ -108,8 +129,8 @@ ReadStats::allele_and_cov ReadStats::extract_max_coverage_allele(
       continue;
     }
     if (cur_Node->has_sequence()) {
-      result =
-          result + Allele{cur_Node->get_sequence(), cur_Node->get_coverage()};
+      result.sequence += cur_Node->get_sequence();
+      cur_Node->get_sparse_coverage().append_to(result.pbCov);
     }
     cur_Node = cur_Node->get_edges().at(0);
   }
@@ -129,7 +150,7 @@ void gram::AbstractReadStats::compute_coverage_depth(
     auto site_ID = node_pair.first->get_site_ID();
 
     // If the site is nested within another, we do not process its coverage
-    if (cov_graph.par_map.find(site_ID) != cov_graph.par_map.end()) continue;
+    if (cov_graph.site_hierarchy.has_parent(site_ID)) continue;
     site_extraction = extract_max_coverage_allele(
         coverage.grouped_allele_counts, node_pair.first, node_pair.second);
 
@@ -207,3 +228,25 @@ void gram::ReadStats::serialise(const std::string& json_output_fpath) {
 
   outf.close();
 }
+
+void gram::ReadStats::write(LittleEndianWriter& writer) const {
+  writer.write_double(mean_cov_depth);
+  writer.write_double(variance_cov_depth);
+  writer.write<uint64_t>(num_sites_noCov);
+  writer.write<uint64_t>(num_sites_total);
+  writer.write_double(mean_pb_error);
+  writer.write<int64_t>(no_qual_reads);
+  writer.write<uint64_t>(max_read_length);
+  writer.write<int64_t>(num_bases_processed);
+}
+
+void gram::ReadStats::read(LittleEndianReader& reader) {
+  mean_cov_depth = reader.read_double();
+  variance_cov_depth = reader.read_double();
+  num_sites_noCov = reader.read<uint64_t>();
+  num_sites_total = reader.read<uint64_t>();
+  mean_pb_error = reader.read_double();
+  no_qual_reads = reader.read<int64_t>();
+  max_read_length = reader.read<uint64_t>();
+  num_bases_processed = reader.read<int64_t>();
+}
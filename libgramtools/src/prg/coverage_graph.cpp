@@ -1,4 +1,7 @@
 #include "prg/coverage_graph.hpp"
+
+#include <bitset>
+
 #include "common/utils.hpp"
 
 coverage_Node::coverage_Node()
@@ -26,14 +29,59 @@ coverage_Node::coverage_Node(std::string const seq, int const pos,
       is_site_boundary(false) {
   // No need to allocate coverage if outside a variant site, as only variant
   // site coverage is used for genotyping
-  if (is_in_bubble()) this->coverage = PerBaseCoverage(seq.size(), 0);
+  if (is_in_bubble()) this->coverage = SparsePbCoverage(seq.size());
 }
 
 void coverage_Node::add_sequence(std::string const& new_seq) {
   sequence += new_seq;
-  if (is_in_bubble()) {
-    for (std::size_t i = 0; i < new_seq.size(); ++i) coverage.emplace_back(0);
+  if (is_in_bubble()) coverage.resize(sequence.size());
+}
+
+node_access_table::node_access_table(std::size_t const num_positions)
+    : node_IDs(num_positions, 0), target_bits(num_positions / 64 + 1, 0),
+      target_ranks(num_positions / 64 + 1, 0) {}
+
+VariantLocus node_access_table::target(std::size_t const pos) const {
+  auto const word = pos / 64;
+  uint64_t const bit = uint64_t(1) << (pos % 64);
+  if ((target_bits[word] & bit) == 0) return VariantLocus{0, ALLELE_UNKNOWN};
+  auto const rank_in_word = std::bitset<64>(target_bits[word] & (bit - 1));
+  return targets[target_ranks[word] + rank_in_word.count()];
+}
+
+node_access node_access_table::operator[](std::size_t const pos) const {
+  return node_access{node(pos), offset(pos), target(pos)};
+}
+
+void node_access_table::set_node(std::size_t const pos, covG_ptr const& node,
+                                 std::size_t const offset) {
+  auto found = node_numbers.find(node.get());
+  if (found == node_numbers.end()) {
+    found = node_numbers.insert({node.get(), nodes.size()}).first;
+    nodes.push_back(node);
+    // All positions of a sequence node are consecutive in the PRG string,
+    // while nodes without sequence always have offset 0.
+    node_starts.push_back(node != nullptr && node->has_sequence()
+                              ? pos - offset
+                              : no_sequence);
   }
+  node_IDs[pos] = found->second;
+}
+
+void node_access_table::done_setting_nodes() {
+  // Swapped, as clearing keeps the buckets allocated
+  std::unordered_map<coverage_Node const*, uint32_t>().swap(node_numbers);
+}
+
+void node_access_table::set_target(std::size_t const pos,
+                                   VariantLocus const& target) {
+  auto const word = pos / 64;
+  assert(num_ranked_words <= word + 1);
+  for (; num_ranked_words <= word; ++num_ranked_words)
+    target_ranks[num_ranked_words] = targets.size();
+  assert((target_bits[word] >> (pos % 64)) == 0);
+  target_bits[word] |= uint64_t(1) << (pos % 64);
+  targets.push_back(target);
 }
 
 /**
@@ -58,6 +106,7 @@ coverage_Graph::coverage_Graph(PRG_String const& vec_in) {
   par_map = std::move(built_graph.par_map);
   random_access = std::move(built_graph.random_access);
   target_map = std::move(built_graph.target_map);
+  site_hierarchy = SiteHierarchy(par_map, bubble_map.size());
 
   par_map.empty() ? is_nested = false : is_nested = true;
 }
@@ -81,7 +130,7 @@ bool operator==(coverage_Graph const& f, coverage_Graph const& s) {
 
 cov_Graph_Builder::cov_Graph_Builder(PRG_String const& prg_string) {
   linear_prg = prg_string.get_PRG_string();
-  random_access = access_vec(linear_prg.size(), node_access());
+  random_access = access_vec(linear_prg.size());
   end_positions = prg_string.get_end_positions();
   make_root();
   cur_Locus = std::make_pair(0, ALLELE_UNKNOWN);  // Meaning: no current Locus.
@@ -90,6 +139,7 @@ cov_Graph_Builder::cov_Graph_Builder(PRG_String const& prg_string) {
     process_marker(i);
     setup_random_access(i);
   }
+  random_access.done_setting_nodes();
   make_sink();
   map_targets();
 }
@@ -136,11 +186,9 @@ void cov_Graph_Builder::setup_random_access(uint32_t const& pos) {
   auto seq_size = target->get_sequence_size();
   if (seq_size <= 1)  // Will include all site entry and exit nodes, and
                       // sequence nodes with a single character
-    random_access[pos] =
-        node_access{target, 0, VariantLocus{0, ALLELE_UNKNOWN}};
+    random_access.set_node(pos, target, 0);
   else
-    random_access[pos] =
-        node_access{target, seq_size - 1, VariantLocus{0, ALLELE_UNKNOWN}};
+    random_access.set_node(pos, target, seq_size - 1);
 }
 
 marker_type cov_Graph_Builder::find_marker_type(uint32_t const& pos) {
@@ -279,10 +327,9 @@ void cov_Graph_Builder::map_targets() {
 
     switch (cur_t) {
       case marker_type::sequence:
+        // Adds a target for the sequence character
         if (prev_t != marker_type::sequence)
-          random_access[pos].target = VariantLocus{
-              prev_m,
-              cur_allele_ID};  // Adds a target for the sequence character
+          random_access.set_target(pos, VariantLocus{prev_m, cur_allele_ID});
         break;
       case marker_type::site_entry:
         cur_allele_ID = FIRST_ALLELE;
@@ -411,7 +458,8 @@ std::ostream& operator<<(std::ostream& out, coverage_Node const& node) {
   out << "Site ID: " << node.site_ID << std::endl;
   out << "Allele ID: " << node.allele_ID << std::endl;
   out << "Cov: ";
-  for (auto& s : node.coverage) std::cout << s << " ";
+  for (auto& s : node.coverage.to_dense())
+    std::cout << static_cast<CovTotal>(s) << " ";
   std::cout << std::endl;
   out << "Is a site boundary: " << node.is_site_boundary << std::endl;
   return out;
@@ -0,0 +1,417 @@
+#include "prg/flat_coverage_graph.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <stack>
+
+#include "common/little_endian.hpp"
+
+using namespace gram;
+
+namespace {
+using node_numbering = std::unordered_map<coverage_Node const*, NodeId>;
+
+/**
+ * Numbers the nodes reachable from `root` in topological order (Kahn's
+ * algorithm). Iterative, so that large graphs cannot overflow the stack.
+ */
+std::vector<covG_ptr> topological_order(covG_ptr const& root) {
+  std::unordered_map<coverage_Node const*, std::size_t> in_degrees;
+  std::stack<covG_ptr> to_visit;
+  to_visit.push(root);
+  in_degrees[root.get()] = 0;
+  while (!to_visit.empty()) {
+    auto node = to_visit.top();
+    to_visit.pop();
+    for (auto const& next : node->get_edges()) {
+      auto found = in_degrees.find(next.get());
+      if (found == in_degrees.end()) {
+        in_degrees[next.get()] = 1;
+        to_visit.push(next);
+      } else
+        ++found->second;
+    }
+  }
+
+  std::vector<covG_ptr> ordered;
+  ordered.reserve(in_degrees.size());
+  std::queue<covG_ptr> ready;
+  ready.push(root);
+  while (!ready.empty()) {
+    auto node = ready.front();
+    ready.pop();
+    ordered.push_back(node);
+    for (auto const& next : node->get_edges()) {
+      if (--in_degrees.at(next.get()) == 0) ready.push(next);
+    }
+  }
+  return ordered;
+}
+
+NodeId get_node_ID(node_numbering const& numbering, covG_ptr const& node) {
+  auto found = numbering.find(node.get());
+  if (found == numbering.end())
+    throw std::runtime_error(
+        "Coverage graph node not reachable from the graph's root");
+  return found->second;
+}
+
+/** On disk, per base coverage has 16 bits whatever the width of `CovCount` */
+using StoredCovCount = uint16_t;
+CovTotal const stored_cov_count_max{std::numeric_limits<StoredCovCount>::max()};
+
+/**
+ * @throws std::runtime_error unless `offsets` start at 0, never decrease and
+ * end at `total`, so that they delimit `total` elements node by node
+ */
+void check_offsets(std::vector<uint64_t> const& offsets, uint64_t const total,
+                   std::string const& what) {
+  bool const valid = !offsets.empty() && offsets.front() == 0 &&
+                     offsets.back() == total &&
+                     std::is_sorted(offsets.begin(), offsets.end());
+  if (!valid)
+    throw std::runtime_error("Invalid " + what +
+                             " offsets in coverage graph file");
+}
+
+void check_node(uint64_t const node, std::size_t const num_nodes) {
+  if (node >= num_nodes)
+    throw std::runtime_error("Invalid node number in coverage graph file");
+}
+
+VariantLocus const no_target{0, ALLELE_UNKNOWN};
+uint64_t const no_node_start{std::numeric_limits<uint64_t>::max()};
+}  // namespace
+
+FlatCoverageGraph::FlatCoverageGraph(coverage_Graph const& cov_graph)
+    : par_map(cov_graph.par_map),
+      target_map(cov_graph.target_map),
+      nested(cov_graph.is_nested) {
+  if (cov_graph.root == nullptr) return;
+  auto const ordered_nodes = topological_order(cov_graph.root);
+  auto const num_nodes = ordered_nodes.size();
+
+  node_numbering numbering;
+  numbering.reserve(num_nodes);
+  for (NodeId i = 0; i < num_nodes; ++i) numbering[ordered_nodes[i].get()] = i;
+
+  positions.reserve(num_nodes);
+  site_IDs.reserve(num_nodes);
+  allele_IDs.reserve(num_nodes);
+  site_boundaries.reserve(num_nodes);
+  sequence_offsets.reserve(num_nodes + 1);
+  coverage_offsets.reserve(num_nodes + 1);
+  edge_offsets.reserve(num_nodes + 1);
+  sequence_offsets.push_back(0);
+  coverage_offsets.push_back(0);
+  edge_offsets.push_back(0);
+
+  for (auto const& node : ordered_nodes) {
+    positions.push_back(node->get_pos());
+    site_IDs.push_back(node->get_site_ID());
+    allele_IDs.push_back(node->get_allele_ID());
+    site_boundaries.push_back(node->is_boundary());
+
+    sequences += node->get_sequence();
+    sequence_offsets.push_back(sequences.size());
+    auto const& node_coverage = node->get_coverage();
+    coverage.insert(coverage.end(), node_coverage.begin(), node_coverage.end());
+    coverage_offsets.push_back(coverage.size());
+    for (auto const& next : node->get_edges())
+      edge_targets.push_back(numbering.at(next.get()));
+    edge_offsets.push_back(edge_targets.size());
+  }
+
+  bubbles.reserve(cov_graph.bubble_map.size());
+  for (auto const& bubble : cov_graph.bubble_map)
+    bubbles.emplace_back(get_node_ID(numbering, bubble.first),
+                         get_node_ID(numbering, bubble.second));
+
+  auto const& node_accesses = cov_graph.random_access;
+  random_access.reserve(node_accesses.size());
+  for (std::size_t pos = 0; pos < node_accesses.size(); ++pos)
+    random_access.push_back(
+        flat_node_access{get_node_ID(numbering, node_accesses.node(pos)),
+                         node_accesses.offset(pos), node_accesses.target(pos)});
+}
+
+coverage_Graph FlatCoverageGraph::to_coverage_Graph() const {
+  std::vector<covG_ptr> nodes;
+  nodes.reserve(num_nodes());
+  for (NodeId i = 0; i < num_nodes(); ++i) {
+    auto node = boost::make_shared<coverage_Node>(coverage_Node(
+        std::string(get_sequence(i)), 0, get_site_ID(i), get_allele_ID(i)));
+    node->set_pos(get_pos(i));
+    if (is_site_boundary(i)) node->mark_as_boundary();
+    if (get_coverage_space(i) > 0) {
+      auto const node_coverage = get_coverage(i);
+      node->set_coverage(PerBaseCoverage(
+          node_coverage, node_coverage + get_coverage_space(i)));
+    }
+    nodes.push_back(node);
+  }
+  for (NodeId i = 0; i < num_nodes(); ++i) {
+    for (auto edge = edges_begin(i); edge != edges_end(i); ++edge)
+      nodes[i]->add_edge(nodes[*edge]);
+  }
+
+  coverage_Graph cov_graph;
+  if (nodes.empty()) return cov_graph;
+  cov_graph.root = nodes[root()];
+  for (auto const& bubble : bubbles)
+    cov_graph.bubble_map.insert({nodes[bubble.first], nodes[bubble.second]});
+  cov_graph.random_access = access_vec(random_access.size());
+  for (std::size_t pos = 0; pos < random_access.size(); ++pos) {
+    auto const& access = random_access[pos];
+    cov_graph.random_access.set_node(pos, nodes[access.node], access.offset);
+    if (access.target != no_target)
+      cov_graph.random_access.set_target(pos, access.target);
+  }
+  cov_graph.random_access.done_setting_nodes();
+  cov_graph.par_map = par_map;
+  cov_graph.site_hierarchy = SiteHierarchy(par_map, bubbles.size());
+  cov_graph.target_map = target_map;
+  cov_graph.is_nested = nested;
+  return cov_graph;
+}
+
+bool FlatCoverageGraph::operator==(FlatCoverageGraph const& other) const {
+  return positions == other.positions && site_IDs == other.site_IDs &&
+         allele_IDs == other.allele_IDs &&
+         site_boundaries == other.site_boundaries &&
+         sequences == other.sequences &&
+         sequence_offsets == other.sequence_offsets &&
+         coverage == other.coverage &&
+         coverage_offsets == other.coverage_offsets &&
+         edge_targets == other.edge_targets &&
+         edge_offsets == other.edge_offsets && bubbles == other.bubbles &&
+         random_access == other.random_access && par_map == other.par_map &&
+         target_map == other.target_map && nested == other.nested;
+}
+
+/*
+ * The format's sections, in order: header; nodes; edges; bubbles; random
+ * access; parental map; target map. Maps are written sorted by key, so that a
+ * given graph always gives the same bytes.
+ * Random access offsets are not stored, as they follow from node sequences.
+ */
+void FlatCoverageGraph::serialise(std::ostream& out) const {
+  LittleEndianWriter writer(out);
+  out.write(format_magic, sizeof(format_magic) - 1);
+  writer.write<uint32_t>(format_version);
+
+  writer.write_all(std::vector<uint64_t>(positions.begin(), positions.end()));
+  writer.write_all(site_IDs);
+  writer.write_all(allele_IDs);
+  writer.write_all(
+      std::vector<uint8_t>(site_boundaries.begin(), site_boundaries.end()));
+  writer.write_all(std::vector<char>(sequences.begin(), sequences.end()));
+  writer.write_all(sequence_offsets);
+  std::vector<StoredCovCount> stored_coverage(coverage.size());
+  for (std::size_t i = 0; i < coverage.size(); ++i)
+    stored_coverage[i] = static_cast<StoredCovCount>(
+        std::min<CovTotal>(coverage[i], stored_cov_count_max));
+  writer.write_all(stored_coverage);
+  writer.write_all(coverage_offsets);
+  writer.write_all(edge_targets);
+  writer.write_all(edge_offsets);
+
+  std::vector<NodeId> bubble_nodes;
+  bubble_nodes.reserve(2 * bubbles.size());
+  for (auto const& bubble : bubbles) {
+    bubble_nodes.push_back(bubble.first);
+    bubble_nodes.push_back(bubble.second);
+  }
+  writer.write_all(bubble_nodes);
+
+  std::vector<NodeId> position_nodes;
+  position_nodes.reserve(random_access.size());
+  std::vector<uint64_t> target_positions;
+  std::vector<Marker> target_markers;
+  std::vector<AlleleId> target_alleles;
+  for (std::size_t pos = 0; pos < random_access.size(); ++pos) {
+    auto const& access = random_access[pos];
+    position_nodes.push_back(access.node);
+    if (access.target == no_target) continue;
+    target_positions.push_back(pos);
+    target_markers.push_back(access.target.first);
+    target_alleles.push_back(access.target.second);
+  }
+  writer.write_all(position_nodes);
+  writer.write_all(target_positions);
+  writer.write_all(target_markers);
+  writer.write_all(target_alleles);
+
+  std::map<Marker, VariantLocus> sorted_par_map(par_map.begin(),
+                                                par_map.end());
+  std::vector<Marker> par_map_keys, parent_markers;
+  std::vector<AlleleId> parent_alleles;
+  for (auto const& entry : sorted_par_map) {
+    par_map_keys.push_back(entry.first);
+    parent_markers.push_back(entry.second.first);
+    parent_alleles.push_back(entry.second.second);
+  }
+  writer.write_all(par_map_keys);
+  writer.write_all(parent_markers);
+  writer.write_all(parent_alleles);
+
+  std::map<Marker, std::vector<targeted_marker>> sorted_target_map(
+      target_map.begin(), target_map.end());
+  std::vector<Marker> target_map_keys, targeted_IDs;
+  std::vector<uint64_t> num_targets;
+  std::vector<AlleleId> direct_deletion_alleles;
+  for (auto const& entry : sorted_target_map) {
+    target_map_keys.push_back(entry.first);
+    num_targets.push_back(entry.second.size());
+    for (auto const& targeted : entry.second) {
+      targeted_IDs.push_back(targeted.ID);
+      direct_deletion_alleles.push_back(targeted.direct_deletion_allele);
+    }
+  }
+  writer.write_all(target_map_keys);
+  writer.write_all(num_targets);
+  writer.write_all(targeted_IDs);
+  writer.write_all(direct_deletion_alleles);
+
+  writer.write<uint8_t>(nested);
+}
+
+bool FlatCoverageGraph::has_format_magic(std::istream& in) {
+  auto const start = in.tellg();
+  char magic[sizeof(format_magic) - 1];
+  in.read(magic, sizeof(magic));
+  bool const found = static_cast<std::size_t>(in.gcount()) == sizeof(magic) &&
+                     std::equal(magic, magic + sizeof(magic), format_magic);
+  in.clear();
+  in.seekg(start);
+  return found;
+}
+
+FlatCoverageGraph FlatCoverageGraph::deserialise(std::istream& in) {
+  if (!has_format_magic(in))
+    throw std::runtime_error("Not a gramtools coverage graph file");
+  in.ignore(sizeof(format_magic) - 1);
+  LittleEndianReader reader(in, "coverage graph file");
+  auto const version = reader.read<uint32_t>();
+  if (version != format_version)
+    throw std::runtime_error(
+        "Coverage graph file has format version " + std::to_string(version) +
+        ", expected " + std::to_string(format_version) +
+        ". Please re-run gramtools build.");
+
+  FlatCoverageGraph graph;
+  auto const node_positions = reader.read_all<uint64_t>();
+  graph.positions.assign(node_positions.begin(), node_positions.end());
+  graph.site_IDs = reader.read_all<Marker>();
+  graph.allele_IDs = reader.read_all<AlleleId>();
+  auto const boundaries = reader.read_all<uint8_t>();
+  graph.site_boundaries.assign(boundaries.begin(), boundaries.end());
+  auto const sequences = reader.read_all<char>();
+  graph.sequences.assign(sequences.begin(), sequences.end());
+  graph.sequence_offsets = reader.read_all<uint64_t>();
+  auto const stored_coverage = reader.read_all<StoredCovCount>();
+  graph.coverage.resize(stored_coverage.size());
+  for (std::size_t i = 0; i < stored_coverage.size(); ++i)
+    graph.coverage[i] = saturate_cov_count(stored_coverage[i]);
+  graph.coverage_offsets = reader.read_all<uint64_t>();
+  graph.edge_targets = reader.read_all<NodeId>();
+  graph.edge_offsets = reader.read_all<uint64_t>();
+
+  auto const num_nodes = graph.positions.size();
+  bool const consistent_nodes =
+      graph.site_IDs.size() == num_nodes &&
+      graph.allele_IDs.size() == num_nodes &&
+      graph.site_boundaries.size() == num_nodes &&
+      graph.sequence_offsets.size() == num_nodes + 1 &&
+      graph.coverage_offsets.size() == num_nodes + 1 &&
+      graph.edge_offsets.size() == num_nodes + 1;
+  if (!consistent_nodes)
+    throw std::runtime_error("Inconsistent node arrays in coverage graph file");
+  check_offsets(graph.sequence_offsets, graph.sequences.size(), "sequence");
+  check_offsets(graph.coverage_offsets, graph.coverage.size(), "coverage");
+  check_offsets(graph.edge_offsets, graph.edge_targets.size(), "edge");
+  // Nodes are in topological order, so edges only lead to later nodes; this
+  // also rules out cycles
+  for (NodeId node = 0; node < num_nodes; ++node) {
+    for (auto edge = graph.edges_begin(node); edge != graph.edges_end(node);
+         ++edge) {
+      check_node(*edge, num_nodes);
+      if (*edge <= node)
+        throw std::runtime_error(
+            "Edge against the topological order in coverage graph file");
+    }
+  }
+
+  auto const bubble_nodes = reader.read_all<NodeId>();
+  if (bubble_nodes.size() % 2 != 0)
+    throw std::runtime_error("Unpaired bubble node in coverage graph file");
+  for (std::size_t i = 0; i < bubble_nodes.size(); i += 2) {
+    check_node(bubble_nodes[i], num_nodes);
+    check_node(bubble_nodes[i + 1], num_nodes);
+    graph.bubbles.emplace_back(bubble_nodes[i], bubble_nodes[i + 1]);
+  }
+
+  // Offsets are counted from the first position of each node with sequence
+  auto const position_nodes = reader.read_all<NodeId>();
+  std::vector<uint64_t> node_starts(num_nodes, no_node_start);
+  graph.random_access.reserve(position_nodes.size());
+  for (std::size_t pos = 0; pos < position_nodes.size(); ++pos) {
+    auto const node = position_nodes[pos];
+    check_node(node, num_nodes);
+    std::size_t offset = 0;
+    if (graph.has_sequence(node)) {
+      if (node_starts[node] == no_node_start) node_starts[node] = pos;
+      offset = pos - node_starts[node];
+    }
+    graph.random_access.push_back(flat_node_access{node, offset, no_target});
+  }
+  auto const target_positions = reader.read_all<uint64_t>();
+  auto const target_markers = reader.read_all<Marker>();
+  auto const target_alleles = reader.read_all<AlleleId>();
+  if (target_markers.size() != target_positions.size() ||
+      target_alleles.size() != target_positions.size())
+    throw std::runtime_error(
+        "Inconsistent target arrays in coverage graph file");
+  for (std::size_t i = 0; i < target_positions.size(); ++i) {
+    if (target_positions[i] >= graph.random_access.size())
+      throw std::runtime_error(
+          "Invalid target position in coverage graph file");
+    graph.random_access[target_positions[i]].target =
+        VariantLocus{target_markers[i], target_alleles[i]};
+  }
+
+  auto const par_map_keys = reader.read_all<Marker>();
+  auto const parent_markers = reader.read_all<Marker>();
+  auto const parent_alleles = reader.read_all<AlleleId>();
+  if (parent_markers.size() != par_map_keys.size() ||
+      parent_alleles.size() != par_map_keys.size())
+    throw std::runtime_error(
+        "Inconsistent parental map arrays in coverage graph file");
+  for (std::size_t i = 0; i < par_map_keys.size(); ++i)
+    graph.par_map[par_map_keys[i]] =
+        VariantLocus{parent_markers[i], parent_alleles[i]};
+
+  auto const target_map_keys = reader.read_all<Marker>();
+  auto const num_targets = reader.read_all<uint64_t>();
+  auto const targeted_IDs = reader.read_all<Marker>();
+  auto const direct_deletion_alleles = reader.read_all<AlleleId>();
+  std::runtime_error const inconsistent_target_map(
+      "Inconsistent target map arrays in coverage graph file");
+  if (num_targets.size() != target_map_keys.size() ||
+      direct_deletion_alleles.size() != targeted_IDs.size())
+    throw inconsistent_target_map;
+  std::size_t targeted_index = 0;
+  for (std::size_t i = 0; i < target_map_keys.size(); ++i) {
+    if (num_targets[i] > targeted_IDs.size() - targeted_index)
+      throw inconsistent_target_map;
+    auto& targets = graph.target_map[target_map_keys[i]];
+    for (uint64_t j = 0; j < num_targets[i]; ++j, ++targeted_index)
+      targets.push_back(
+          targeted_marker{targeted_IDs[targeted_index],
+                          direct_deletion_alleles[targeted_index]});
+  }
+  if (targeted_index != targeted_IDs.size()) throw inconsistent_target_map;
+
+  graph.nested = reader.read<uint8_t>() != 0;
+  return graph;
+}
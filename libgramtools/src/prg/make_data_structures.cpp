@@ -1,6 +1,7 @@
 #include "prg/make_data_structures.hpp"
 #include <filesystem>
 #include "prg/coverage_graph.hpp"
+#include "prg/flat_coverage_graph.hpp"
 
 namespace fs = std::filesystem;
 
@@ -43,13 +44,24 @@ coverage_Graph gram::generate_cov_graph(CommonParameters const &parameters,
   coverage_Graph c_g{prg_string};
 
   // Serialise the cov graph
-  std::ofstream ofs{parameters.cov_graph_fpath};
-  boost::archive::binary_oarchive oa{ofs};
-  oa << c_g;
+  std::ofstream ofs{parameters.cov_graph_fpath, std::ios::binary};
+  FlatCoverageGraph{c_g}.serialise(ofs);
 
   return c_g;
 }
 
+coverage_Graph gram::load_cov_graph(CommonParameters const &parameters) {
+  std::ifstream ifs{parameters.cov_graph_fpath, std::ios::binary};
+  if (!ifs.is_open())
+    throw std::ios_base::failure("Could not open: " +
+                                 parameters.cov_graph_fpath);
+  if (!FlatCoverageGraph::has_format_magic(ifs))
+    throw std::runtime_error(
+        "Coverage graph file " + parameters.cov_graph_fpath +
+        " is in an outdated format. Please re-run gramtools build.");
+  return FlatCoverageGraph::deserialise(ifs).to_coverage_Graph();
+}
+
 child_map gram::build_child_map(parental_map const &par_map) {
   child_map result;
 
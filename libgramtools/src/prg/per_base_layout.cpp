@@ -0,0 +1,280 @@
+#include "prg/per_base_layout.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+using namespace gram;
+
+PbCovLayout::PbCovLayout(coverage_Graph const &cov_graph) {
+  auto const &random_access = cov_graph.random_access;
+  std::unordered_map<coverage_Node const *, uint32_t> numbers;
+  for (uint32_t number = 0; number < random_access.num_numbered_nodes();
+       ++number) {
+    auto const &node = random_access.numbered_node(number);
+    nodes.push_back(node);
+    if (node != nullptr) numbers.emplace(node.get(), number);
+  }
+  if (nodes.empty()) nodes.push_back(covG_ptr{});  // Number 0 is no node
+
+  auto number_of = [&](covG_ptr const &node) {
+    auto const found = numbers.find(node.get());
+    if (found != numbers.end()) return found->second;
+    auto const number = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(node);
+    numbers.emplace(node.get(), number);
+    return number;
+  };
+
+  // Numbers the nodes not referred to by any position, and records all edges
+  std::vector<std::vector<uint32_t>> edges;
+  if (cov_graph.root != nullptr) {
+    std::vector<bool> visited;
+    std::vector<uint32_t> to_visit{number_of(cov_graph.root)};
+    while (!to_visit.empty()) {
+      auto const number = to_visit.back();
+      to_visit.pop_back();
+      if (number >= visited.size()) visited.resize(nodes.size(), false);
+      if (visited[number]) continue;
+      visited[number] = true;
+
+      if (number >= edges.size()) edges.resize(nodes.size());
+      for (auto const &target : nodes[number]->get_edges())
+        edges[number].push_back(number_of(target));
+      // Pushed in reverse, so that alleles are visited in order
+      for (auto target = edges[number].rbegin();
+           target != edges[number].rend(); ++target)
+        to_visit.push_back(*target);
+    }
+  }
+  edges.resize(nodes.size());
+
+  sizes.resize(nodes.size(), 0);
+  in_bubble.resize(nodes.size(), false);
+  coverage_offsets.resize(nodes.size(), no_coverage);
+  edge_offsets.push_back(0);
+  for (uint32_t number = 0; number < nodes.size(); ++number) {
+    auto const &node = nodes[number];
+    if (node != nullptr) {
+      sizes[number] = node->get_sequence_size();
+      in_bubble[number] = node->is_in_bubble();
+      if (node->get_coverage_space() > 0) {
+        coverage_offsets[number] = space;
+        space += node->get_coverage_space();
+      }
+    }
+    edge_targets.insert(edge_targets.end(), edges[number].begin(),
+                        edges[number].end());
+    edge_offsets.push_back(edge_targets.size());
+  }
+
+  // Invariant gaps. A gap ends at the first node which is in a bubble, or does
+  // not have a single outgoing edge; these are the nodes at which traversals
+  // record coverage or choose an allele.
+  auto num_edges = [&](uint32_t const number) {
+    return edge_offsets[number + 1] - edge_offsets[number];
+  };
+  auto ends_gap = [&](uint32_t const number) {
+    return in_bubble[number] || num_edges(number) != 1;
+  };
+  gap_targets.resize(nodes.size(), 0);
+  gap_lengths.resize(nodes.size(), 0);
+  std::vector<bool> gap_known(nodes.size(), false);
+  std::vector<uint32_t> chain;
+  for (uint32_t number = 0; number < nodes.size(); ++number) {
+    if (num_edges(number) != 1 || gap_known[number]) continue;
+    chain.push_back(number);
+    while (true) {
+      auto const next = edge_targets[edge_offsets[chain.back()]];
+      if (ends_gap(next) || gap_known[next]) break;
+      chain.push_back(next);
+    }
+    // Resolved from the end of the chain, whose gap is then known
+    for (auto node = chain.rbegin(); node != chain.rend(); ++node) {
+      auto const next = edge_targets[edge_offsets[*node]];
+      if (ends_gap(next)) {
+        gap_targets[*node] = next;
+      } else {
+        gap_targets[*node] = gap_targets[next];
+        gap_lengths[*node] = sizes[next] + gap_lengths[next];
+      }
+      gap_known[*node] = true;
+    }
+    chain.clear();
+  }
+}
+
+std::optional<uint64_t> PbCovLayout::coverage_offset(
+    uint32_t const node) const {
+  if (coverage_offsets[node] == no_coverage) return std::nullopt;
+  return coverage_offsets[node];
+}
+
+void PbCovLayout::add_traversal(uint32_t const node, std::size_t const offset,
+                                VariantSitePath const &traversed_loci,
+                                std::size_t const read_size,
+                                CovRanges &ranges) const {
+  add_ranges(node, offset, traversed_loci, read_size, ranges, false);
+}
+
+void PbCovLayout::add_traversal_start(uint32_t const node,
+                                      std::size_t const offset,
+                                      VariantSitePath const &traversed_loci,
+                                      std::size_t const read_size,
+                                      CovRanges &ranges) const {
+  add_ranges(node, offset, traversed_loci, read_size, ranges, true);
+}
+
+void PbCovLayout::add_ranges(uint32_t node, std::size_t const offset,
+                             VariantSitePath const &traversed_loci,
+                             std::size_t const read_size, CovRanges &ranges,
+                             bool const first_node_only) const {
+  if (node == 0 || read_size == 0) return;
+  std::size_t bases_remaining = read_size;
+  // Loci are chosen from the back, as the last traversed comes first
+  auto next_locus = traversed_loci.size();
+
+  // Consumes the bases of `node` from `start`, recording them if it has
+  // coverage
+  auto consume = [&](std::size_t const start) {
+    if (sizes[node] == 0) return;
+    auto const length =
+        std::min(static_cast<std::size_t>(sizes[node]) - start,
+                 bases_remaining);
+    bases_remaining -= length;
+    if (coverage_offsets[node] != no_coverage)
+      ranges.push_back(CovRange{node, coverage_offsets[node] + start,
+                                static_cast<uint32_t>(length)});
+  };
+
+  consume(offset);
+  bool reached_bubble = in_bubble[node];
+  while (bases_remaining > 0 && !(first_node_only && reached_bubble)) {
+    auto const num_edges = edge_offsets[node + 1] - edge_offsets[node];
+    if (num_edges == 1) {
+      // The read ends before the gap does
+      if (bases_remaining <= gap_lengths[node]) return;
+      bases_remaining -= gap_lengths[node];
+      node = gap_targets[node];
+      reached_bubble = in_bubble[node];
+    } else if (num_edges > 1 && next_locus > 0) {
+      auto const allele_ID = traversed_loci[--next_locus].second;
+      assert(allele_ID >= 0 && allele_ID < num_edges);
+      node = edge_targets[edge_offsets[node] + allele_ID];
+      reached_bubble = true;
+    } else
+      return;
+    consume(0);
+  }
+}
+
+void PbCovLayout::merge(CovRanges &ranges) {
+  if (ranges.empty()) return;
+  std::sort(ranges.begin(), ranges.end(),
+            [](CovRange const &first, CovRange const &second) {
+              return first.offset < second.offset;
+            });
+  std::size_t last{0};
+  for (std::size_t i = 1; i < ranges.size(); ++i) {
+    auto const &range = ranges[i];
+    auto &merged = ranges[last];
+    if (range.node == merged.node) {
+      auto const end = std::max(merged.offset + merged.length,
+                                range.offset + range.length);
+      merged.length = static_cast<uint32_t>(end - merged.offset);
+    } else
+      ranges[++last] = range;
+  }
+  ranges.resize(last + 1);
+}
+
+void PbCovLayout::increment(CovRanges const &ranges) const {
+  for (auto const &range : ranges) {
+    auto &coverage = nodes[range.node]->get_ref_to_coverage();
+    auto const start = range.offset - coverage_offsets[range.node];
+    for (auto i = start; i < start + range.length; ++i) coverage.increment(i);
+  }
+}
+
+void PbCovLayout::add_accumulated(PbCovAccumulator &accumulator) const {
+  assert(accumulator.coverage_space() == space);
+  auto const blocks = accumulator.take_differences();
+  if (blocks.empty()) return;
+
+  int64_t running_coverage{0};
+  uint32_t node{0};
+  // Adds the running coverage to the bases from `start` to `end`, updating it
+  // with `differences` (starting at `start`) if given. Without differences,
+  // the running coverage is constant, so bases are only visited if it is not
+  // zero: bases which no read covered stay unallocated.
+  auto add_coverage = [&](uint64_t const start, uint64_t const end,
+                          int64_t const *const differences) {
+    if (differences == nullptr && running_coverage == 0) return;
+    for (auto offset = start; offset < end; ++offset) {
+      if (differences != nullptr)
+        running_coverage += differences[offset - start];
+      if (running_coverage == 0) continue;
+      // Nodes are placed in the coverage space in number order
+      while (coverage_offsets[node] == no_coverage ||
+             coverage_offsets[node] + nodes[node]->get_coverage_space() <=
+                 offset)
+        ++node;
+      auto &coverage = nodes[node]->get_ref_to_coverage();
+      auto const base = offset - coverage_offsets[node];
+      coverage.set(base, saturate_cov_count(
+                             static_cast<int64_t>(coverage[base]) +
+                             running_coverage));
+    }
+  };
+
+  uint64_t offset{0};
+  for (auto const &[block, differences] : blocks) {
+    auto const block_start = block * accumulator.get_block_size();
+    auto const block_end =
+        std::min<uint64_t>(block_start + differences.size(), space);
+    add_coverage(offset, block_start, nullptr);
+    add_coverage(block_start, block_end, differences.data());
+    offset = std::max(offset, block_end);
+  }
+  add_coverage(offset, space, nullptr);
+}
+
+PbCovAccumulator::PbCovAccumulator(std::size_t const coverage_space,
+                                   uint32_t const num_threads,
+                                   std::size_t const block_size)
+    : differences(std::max(num_threads, uint32_t{1})),
+      space(coverage_space),
+      block_size(block_size) {}
+
+void PbCovAccumulator::add(CovRanges const &ranges, uint32_t const thread) {
+  assert(thread < differences.size());
+  auto &thread_blocks = differences[thread];
+  // One entry past the coverage space, for ranges ending at its end
+  if (thread_blocks.empty()) thread_blocks.resize(space / block_size + 1);
+  auto const add_at = [&](uint64_t const offset, Difference const difference) {
+    auto &block = thread_blocks[offset / block_size];
+    if (block.empty()) block.resize(block_size, 0);
+    block[offset % block_size] += difference;
+  };
+  for (auto const &range : ranges) {
+    add_at(range.offset, 1);
+    add_at(range.offset + range.length, -1);
+  }
+}
+
+PbCovAccumulator::BlockDifferences PbCovAccumulator::take_differences() {
+  BlockDifferences summed;
+  for (auto &thread_blocks : differences) {
+    for (std::size_t block = 0; block < thread_blocks.size(); ++block) {
+      auto const &thread_block = thread_blocks[block];
+      if (thread_block.empty()) continue;
+      auto &summed_block = summed[block];
+      if (summed_block.empty()) summed_block.resize(block_size, 0);
+      for (std::size_t i = 0; i < block_size; ++i)
+        summed_block[i] += thread_block[i];
+    }
+    thread_blocks.clear();  // Freed as they are summed
+  }
+  differences.clear();
+  return summed;
+}
@@ -10,10 +10,9 @@ PRG_Info gram::load_prg_info(CommonParameters const &parameters) {
   prg_info.last_allele_positions = ps.get_end_positions();
 
   // Load coverage graph
-  std::ifstream ifs{parameters.cov_graph_fpath};
-  boost::archive::binary_iarchive ia{ifs};
-  ia >> prg_info.coverage_graph;
+  prg_info.coverage_graph = load_cov_graph(parameters);
   prg_info.num_variant_sites = prg_info.coverage_graph.bubble_map.size();
+  prg_info.pb_cov_layout = PbCovLayout{prg_info.coverage_graph};
 
   prg_info.fm_index = load_fm_index(parameters);
 
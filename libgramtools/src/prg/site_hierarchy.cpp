@@ -0,0 +1,108 @@
+#include "prg/site_hierarchy.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace gram;
+
+SiteHierarchy::SiteHierarchy(parental_map const& par_map,
+                             std::size_t const num_sites) {
+  std::size_t size = num_sites;
+  // Ordered by parent site, then parent allele, then child site
+  std::vector<std::tuple<std::size_t, AlleleId, Marker>> nestings;
+  nestings.reserve(par_map.size());
+  for (auto const& entry : par_map) {
+    auto const parent_index = siteID_to_index(entry.second.first);
+    size = std::max({size, parent_index + 1, siteID_to_index(entry.first) + 1});
+    nestings.emplace_back(parent_index, entry.second.second, entry.first);
+  }
+  std::sort(nestings.begin(), nestings.end());
+
+  parent_sites.resize(size, 0);
+  parent_alleles.resize(size, 0);
+  child_offsets.resize(size + 1, 0);
+  child_sites.reserve(nestings.size());
+  for (auto const& [parent_index, allele_ID, site_ID] : nestings) {
+    auto const index = siteID_to_index(site_ID);
+    parent_sites[index] = index_to_siteID(parent_index);
+    parent_alleles[index] = allele_ID;
+    ++child_offsets[parent_index + 1];
+    child_sites.push_back(site_ID);
+  }
+  for (std::size_t index = 0; index < size; ++index)
+    child_offsets[index + 1] += child_offsets[index];
+
+  // Preorder walk from each level 1 site, without recursion as nesting can be
+  // deep
+  depths.resize(size, 0);
+  preorder_starts.resize(size, 0);
+  preorder_ends.resize(size, 0);
+  uint32_t visited{0};
+  std::vector<std::pair<std::size_t, uint64_t>> to_visit;  // Site, next child
+  for (std::size_t root = 0; root < size; ++root) {
+    if (parent_sites[root] != 0) continue;
+    preorder_starts[root] = visited++;
+    to_visit.emplace_back(root, child_offsets[root]);
+    while (!to_visit.empty()) {
+      auto& [index, next_child] = to_visit.back();
+      if (next_child == child_offsets[index + 1]) {
+        preorder_ends[index] = visited;
+        to_visit.pop_back();
+        continue;
+      }
+      auto const child = siteID_to_index(child_sites[next_child++]);
+      depths[child] = depths[index] + 1;
+      preorder_starts[child] = visited++;
+      to_visit.emplace_back(child, child_offsets[child]);
+    }
+  }
+}
+
+SiteHierarchy::SiteHierarchy(parental_map const& par_map)
+    : SiteHierarchy(par_map, 0) {}
+
+namespace {
+parental_map to_parental_map(child_map const& child_m) {
+  parental_map par_map;
+  for (auto const& site_entry : child_m) {
+    for (auto const& allele_entry : site_entry.second) {
+      for (auto const& child_marker : allele_entry.second)
+        par_map[child_marker] =
+            VariantLocus{site_entry.first, allele_entry.first};
+    }
+  }
+  return par_map;
+}
+}  // namespace
+
+SiteHierarchy::SiteHierarchy(child_map const& child_m)
+    : SiteHierarchy(to_parental_map(child_m)) {}
+
+SiteRange SiteHierarchy::children(Marker const site_ID) const {
+  auto const index = siteID_to_index(site_ID);
+  if (index >= num_sites()) return {child_sites.end(), child_sites.end()};
+  return {child_sites.begin() + child_offsets[index],
+          child_sites.begin() + child_offsets[index + 1]};
+}
+
+SiteRange SiteHierarchy::children(Marker const site_ID,
+                                  AlleleId const allele_ID) const {
+  auto const all_children = children(site_ID);
+  auto const allele_of = [this](Marker const child_ID) {
+    return parent_alleles[siteID_to_index(child_ID)];
+  };
+  auto const first = std::partition_point(
+      all_children.begin(), all_children.end(),
+      [&](Marker const child_ID) { return allele_of(child_ID) < allele_ID; });
+  auto const last = std::partition_point(
+      first, all_children.end(),
+      [&](Marker const child_ID) { return allele_of(child_ID) == allele_ID; });
+  return {first, last};
+}
+
+bool SiteHierarchy::operator==(SiteHierarchy const& other) const {
+  return parent_sites == other.parent_sites &&
+         parent_alleles == other.parent_alleles &&
+         child_offsets == other.child_offsets &&
+         child_sites == other.child_sites;
+}
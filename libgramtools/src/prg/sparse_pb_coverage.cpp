@@ -0,0 +1,132 @@
+#include "prg/sparse_pb_coverage.hpp"
+
+#include <cassert>
+
+using namespace gram;
+
+SparsePbCoverage::SparsePbCoverage(std::size_t const num_bases)
+    : num_bases(num_bases) {
+  if (num_blocks() > 1)
+    other_blocks = std::make_unique<Block[]>(num_blocks() - 1);
+}
+
+SparsePbCoverage::SparsePbCoverage(PerBaseCoverage const& dense)
+    : SparsePbCoverage(dense.size()) {
+  for (std::size_t base = 0; base < dense.size(); ++base)
+    if (dense[base] != 0) set(base, dense[base]);
+}
+
+SparsePbCoverage::SparsePbCoverage(SparsePbCoverage const& other)
+    : SparsePbCoverage(other.num_bases) {
+  for (std::size_t block = 0; block < num_blocks(); ++block) {
+    auto const bases = other.get_block(block).load(std::memory_order_acquire);
+    if (bases == nullptr) continue;
+    std::copy(bases, bases + block_length(block), touch_block(block));
+  }
+}
+
+SparsePbCoverage::SparsePbCoverage(SparsePbCoverage&& other) noexcept
+    : num_bases(other.num_bases),
+      first_block(other.first_block.exchange(nullptr)),
+      other_blocks(std::move(other.other_blocks)) {
+  other.num_bases = 0;
+}
+
+SparsePbCoverage& SparsePbCoverage::operator=(SparsePbCoverage const& other) {
+  if (this != &other) *this = SparsePbCoverage(other);
+  return *this;
+}
+
+SparsePbCoverage& SparsePbCoverage::operator=(
+    SparsePbCoverage&& other) noexcept {
+  if (this == &other) return *this;
+  release();
+  num_bases = other.num_bases;
+  first_block = other.first_block.exchange(nullptr);
+  other_blocks = std::move(other.other_blocks);
+  other.num_bases = 0;
+  return *this;
+}
+
+SparsePbCoverage::~SparsePbCoverage() { release(); }
+
+void SparsePbCoverage::release() {
+  for (std::size_t block = 0; block < num_blocks(); ++block)
+    delete[] get_block(block).exchange(nullptr);
+  other_blocks.reset();
+  num_bases = 0;
+}
+
+std::size_t SparsePbCoverage::num_allocated_blocks() const {
+  std::size_t result{0};
+  for (std::size_t block = 0; block < num_blocks(); ++block)
+    if (get_block(block).load(std::memory_order_acquire) != nullptr) ++result;
+  return result;
+}
+
+CovCount* SparsePbCoverage::touch_block(std::size_t const block) {
+  auto& pointer = get_block(block);
+  auto bases = pointer.load(std::memory_order_acquire);
+  if (bases != nullptr) return bases;
+  // Another thread may allocate the block at the same time; only one wins
+  auto allocated = new CovCount[block_length(block)]();
+  if (pointer.compare_exchange_strong(bases, allocated,
+                                      std::memory_order_acq_rel))
+    return allocated;
+  delete[] allocated;
+  return bases;
+}
+
+CovCount SparsePbCoverage::operator[](std::size_t const base) const {
+  assert(base < num_bases);
+  auto const bases =
+      get_block(base / block_size).load(std::memory_order_acquire);
+  return bases == nullptr ? 0 : bases[base % block_size];
+}
+
+void SparsePbCoverage::set(std::size_t const base, CovCount const value) {
+  assert(base < num_bases);
+  auto const block = base / block_size;
+  if (value == 0 && get_block(block).load() == nullptr) return;
+  touch_block(block)[base % block_size] = value;
+}
+
+void SparsePbCoverage::increment(std::size_t const base) {
+  assert(base < num_bases);
+  saturating_increment(touch_block(base / block_size)[base % block_size]);
+}
+
+void SparsePbCoverage::resize(std::size_t const new_size) {
+  if (new_size == num_bases) return;
+  if (is_zero()) {
+    *this = SparsePbCoverage(new_size);
+    return;
+  }
+  auto dense = to_dense();
+  dense.resize(new_size, 0);
+  *this = SparsePbCoverage(dense);
+}
+
+PerBaseCoverage SparsePbCoverage::to_dense() const {
+  PerBaseCoverage result;
+  append_to(result);
+  return result;
+}
+
+void SparsePbCoverage::append_to(PerBaseCoverage& dense) const {
+  auto const start = dense.size();
+  dense.resize(start + num_bases, 0);
+  for (std::size_t block = 0; block < num_blocks(); ++block) {
+    auto const bases = get_block(block).load(std::memory_order_acquire);
+    if (bases == nullptr) continue;
+    std::copy(bases, bases + block_length(block),
+              dense.begin() + start + block * block_size);
+  }
+}
+
+bool SparsePbCoverage::operator==(SparsePbCoverage const& other) const {
+  if (num_bases != other.num_bases) return false;
+  for (std::size_t base = 0; base < num_bases; ++base)
+    if ((*this)[base] != other[base]) return false;
+  return true;
+}
@@ -13,6 +13,7 @@
 
 #include "genotype/infer/output_specs/segment_tracker.hpp"
 #include "prg/coverage_graph.hpp"
+#include "prg/flat_coverage_graph.hpp"
 #include "submod_resources.hpp"
 
 using gram::genotype::SegmentTracker;
@@ -147,14 +148,19 @@ int main(int argc, const char* argv[]) {
     tracker = SegmentTracker(ifs);
   }
 
-  std::ifstream ifs{argv[1]};
+  std::ifstream ifs{argv[1], std::ios::binary};
   if (!ifs.good()) {
     std::cout << "Error: could not open " << argv[1] << std::endl;
     usage(argv);
   }
-  boost::archive::binary_iarchive ia{ifs};
   coverage_Graph graph;
-  ia >> graph;
+  try {
+    graph = gram::FlatCoverageGraph::deserialise(ifs).to_coverage_Graph();
+  } catch (std::runtime_error const& e) {
+    std::cout << "Error: could not load " << argv[1] << ": " << e.what()
+              << std::endl;
+    exit(1);
+  }
 
   covG_ptrPair node_pair;
   if (matched_region->chrom.size() != 0) {
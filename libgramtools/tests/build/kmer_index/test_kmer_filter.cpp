@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+
+#include "build/kmer_index/kmer_filter.hpp"
+#include "build/kmer_index/kmers.hpp"
+#include "genotype/quasimap/quasimap.hpp"
+#include "test_resources.hpp"
+
+using namespace gram;
+
+TEST(HashKmer, GivenSameKmerInDifferentReads_SameHash) {
+  auto read1 = encode_dna_bases("ttacgtt");
+  auto read2 = encode_dna_bases("acgt");
+  EXPECT_EQ(hash_kmer(read1.begin() + 2, read1.begin() + 6),
+            hash_kmer(read2.begin(), read2.end()));
+}
+
+TEST(HashKmer, GivenKmersLongerThan32Bases_DifferentKmersDifferentHashes) {
+  auto kmer1 = encode_dna_bases(std::string(40, 'a'));
+  auto kmer2 = kmer1;
+  kmer2.front() = 2;
+  EXPECT_NE(hash_kmer(kmer1.begin(), kmer1.end()),
+            hash_kmer(kmer2.begin(), kmer2.end()));
+}
+
+TEST(KmerFilter, GivenEmptyFilter_EverythingMayBePresent) {
+  KmerFilter filter;
+  EXPECT_TRUE(filter.empty());
+  EXPECT_TRUE(filter.may_contain(encode_dna_bases("acgt")));
+}
+
+TEST(KmerFilter, GivenInsertedKmers_AllInsertedKmersFoundAndFewOthers) {
+  auto all_kmers = generate_all_kmers(7);
+  std::vector<Sequence> inserted, not_inserted;
+  for (auto const& kmer : all_kmers) {
+    // Insert one kmer in four
+    if (kmer.back() == 1)
+      inserted.push_back(kmer);
+    else
+      not_inserted.push_back(kmer);
+  }
+
+  KmerFilter filter(inserted.size());
+  for (auto const& kmer : inserted) filter.insert(kmer);
+
+  for (auto const& kmer : inserted) EXPECT_TRUE(filter.may_contain(kmer));
+
+  std::size_t false_positives = 0;
+  for (auto const& kmer : not_inserted)
+    false_positives += filter.may_contain(kmer);
+  EXPECT_LT(false_positives, not_inserted.size() / 50);
+}
+
+TEST(KmerFilter, GivenReadWithOneAbsentKmer_ReadRejected) {
+  uint32_t kmer_size = 3;
+  KmerIndex index{{encode_dna_bases("acg"), SearchStates{}},
+                  {encode_dna_bases("cgt"), SearchStates{}}};
+  auto filter = kmer_filter::build(index);
+
+  EXPECT_TRUE(
+      filter.all_read_kmers_may_occur(kmer_size, encode_dna_bases("acgt")));
+  EXPECT_FALSE(
+      filter.all_read_kmers_may_occur(kmer_size, encode_dna_bases("acgtt")));
+}
+
+TEST(KmerFilter, GivenDumpedFilter_LoadedFilterIdentical) {
+  KmerIndex index{{encode_dna_bases("acg"), SearchStates{}},
+                  {encode_dna_bases("cgt"), SearchStates{}}};
+  CommonParameters parameters = {};
+  parameters.kmer_filter_fpath = "@kmer_filter_fpath";
+
+  auto filter = kmer_filter::build(index);
+  kmer_filter::dump(filter, parameters);
+  auto loaded = kmer_filter::load(parameters);
+  EXPECT_EQ(loaded.get_blocks(), filter.get_blocks());
+}
+
+TEST(KmerFilter, GivenNoFilterFile_LoadsEmptyFilter) {
+  CommonParameters parameters = {};
+  parameters.kmer_filter_fpath = "@no_such_kmer_filter";
+  EXPECT_TRUE(kmer_filter::load(parameters).empty());
+}
+
+TEST(KmerFilter, GivenOffTargetRead_RejectedAndCountedAsMissingKmer) {
+  prg_setup setup;
+  setup.setup_numbered_prg("gct5c6g6t6ag7t8c8cta", 3);
+
+  // All possible 3-mers are indexed; removing the seeding kmer of the read
+  // makes it off-target.
+  auto read = encode_dna_bases("gcttaa");
+  setup.kmer_index.erase(encode_dna_bases("taa"));
+  auto kmer_filter = kmer_filter::build(setup.kmer_index);
+
+  quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
+                setup.parameters, setup.quasimap_stats, 42, nullptr,
+                &kmer_filter);
+  EXPECT_EQ(setup.quasimap_stats.missing_kmer_reads_count, 1);
+  EXPECT_EQ(setup.quasimap_stats.kmer_filter_rejected_reads_count, 1);
+}
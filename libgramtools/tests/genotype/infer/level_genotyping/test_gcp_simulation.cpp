@@ -0,0 +1,92 @@
+#include <omp.h>
+
+#include <filesystem>
+
+#include "genotype/infer/level_genotyping/gcp_simulation.hpp"
+#include "genotype/infer/level_genotyping/runner.hpp"
+#include "gtest/gtest.h"
+
+namespace fs = std::filesystem;
+
+class GCPSimulation_Seeded : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    cache_dir = fs::temp_directory_path() / "gram_test_gcp_cache";
+    fs::remove_all(cache_dir);
+  }
+  void TearDown() override { fs::remove_all(cache_dir); }
+
+  likelihood_related_stats l_stats = LevelGenotyper::make_l_stats(20, 30, 0.01);
+  fs::path cache_dir;
+};
+
+TEST_F(GCPSimulation_Seeded, SameConfidencesAnyNumThreads) {
+  auto const previous_num_threads = omp_get_max_threads();
+  omp_set_num_threads(1);
+  auto single_thread =
+      simulate_gt_confs(l_stats, Ploidy::Haploid, 1000, GcpSimulationParams{});
+  omp_set_num_threads(4);
+  auto multi_thread =
+      simulate_gt_confs(l_stats, Ploidy::Haploid, 1000, GcpSimulationParams{});
+  omp_set_num_threads(previous_num_threads);
+
+  EXPECT_EQ(single_thread.size(), 1000);
+  EXPECT_EQ(single_thread, multi_thread);
+}
+
+TEST_F(GCPSimulation_Seeded, FewerConfidences_PrefixOfMoreConfidences) {
+  auto fewer =
+      simulate_gt_confs(l_stats, Ploidy::Diploid, 300, GcpSimulationParams{});
+  auto more =
+      simulate_gt_confs(l_stats, Ploidy::Diploid, 700, GcpSimulationParams{});
+  EXPECT_EQ(fewer, decltype(more)(more.begin(), more.begin() + 300));
+}
+
+TEST_F(GCPSimulation_Seeded, DifferentSeeds_DifferentConfidences) {
+  auto first = simulate_gt_confs(l_stats, Ploidy::Haploid, 300,
+                                 GcpSimulationParams{1, ""});
+  auto second = simulate_gt_confs(l_stats, Ploidy::Haploid, 300,
+                                  GcpSimulationParams{2, ""});
+  EXPECT_NE(first, second);
+}
+
+TEST_F(GCPSimulation_Seeded, CachedConfidences_SameAsSimulated) {
+  GcpSimulationParams cached_params{42, cache_dir.string()};
+  auto simulated =
+      simulate_gt_confs(l_stats, Ploidy::Haploid, 600, GcpSimulationParams{});
+
+  auto first_run = simulate_gt_confs(l_stats, Ploidy::Haploid, 600,
+                                     cached_params);
+  GcpCache cache(cache_dir.string(), l_stats, Ploidy::Haploid, 42);
+  EXPECT_TRUE(fs::exists(cache.get_fpath()));
+  // Whole chunks are cached
+  EXPECT_EQ(cache.load().size(), 3 * gcp_chunk_size);
+
+  auto second_run = simulate_gt_confs(l_stats, Ploidy::Haploid, 600,
+                                      cached_params);
+  EXPECT_EQ(first_run, simulated);
+  EXPECT_EQ(second_run, simulated);
+
+  // Extended with the missing chunks
+  auto more = simulate_gt_confs(l_stats, Ploidy::Haploid, 1000, cached_params);
+  EXPECT_EQ(more, simulate_gt_confs(l_stats, Ploidy::Haploid, 1000,
+                                    GcpSimulationParams{}));
+  EXPECT_EQ(cache.load().size(), 4 * gcp_chunk_size);
+}
+
+TEST_F(GCPSimulation_Seeded, DifferentDepthModelOrPloidy_DifferentCacheKey) {
+  GcpCache cache(cache_dir.string(), l_stats, Ploidy::Haploid, 42);
+  GcpCache other_ploidy(cache_dir.string(), l_stats, Ploidy::Diploid, 42);
+  GcpCache other_depth(cache_dir.string(),
+                       LevelGenotyper::make_l_stats(21, 30, 0.01),
+                       Ploidy::Haploid, 42);
+  EXPECT_NE(cache.get_key(), other_ploidy.get_key());
+  EXPECT_NE(cache.get_key(), other_depth.get_key());
+  EXPECT_NE(cache.get_key().find("cov_count_bits=" +
+                                 std::to_string(GRAM_COV_COUNT_BITS)),
+            std::string::npos);
+
+  cache.save(std::vector<double>(gcp_chunk_size, 1.5));
+  EXPECT_EQ(cache.load(), std::vector<double>(gcp_chunk_size, 1.5));
+  EXPECT_TRUE(other_ploidy.load().empty());
+}
@@ -0,0 +1,125 @@
+#include "genotype/infer/level_genotyping/likelihood_batch.hpp"
+#include "genotype/infer/level_genotyping/runner.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram::genotype::infer;
+
+namespace {
+likelihood_map first_two(likelihood_map const& likelihoods) {
+  return likelihood_map(likelihoods.begin(), std::next(likelihoods.begin(), 2));
+}
+
+template <Ploidy P>
+likelihood_map best_two(LikelihoodBatch<P> const& batch, std::size_t site) {
+  likelihood_map result;
+  for (auto const genotype : batch.best_two(site)) {
+    if (genotype == LikelihoodBatch<P>::no_genotype) continue;
+    auto const alleles = batch.genotype(genotype);
+    result.insert({batch.log_likelihood(genotype),
+                   GtypedIndices(alleles.begin(), alleles.end())});
+  }
+  return result;
+}
+}  // namespace
+
+class LikelihoodBatch_ThreeSites : public ::testing::TestWithParam<Ploidy> {
+ protected:
+  void SetUp() override {
+    // Nested alleles share a haplogroup in the second site; the third has
+    // equal coverage on two alleles
+    sites.push_back(ModelData(
+        allele_vector{{"AC", {10, 12}, 0}, {"GC", {5, 1}, 1}, {"", {}, 2}},
+        GroupedAlleleCounts{{{0}, 10}, {{1}, 3}, {{0, 1}, 2}, {{2}, 1}},
+        GetParam(), &l_stats));
+    sites.push_back(ModelData(
+        allele_vector{{"TTA", {8, 9, 9}, 0},
+                      {"TTC", {4, 4, 3}, 0},
+                      {"GGG", {6, 7, 6}, 1},
+                      {"GCG", {0, 1, 0}, 2}},
+        GroupedAlleleCounts{
+            {{0}, 9}, {{1}, 6}, {{0, 1}, 3}, {{1, 2}, 1}, {{2}, 1}},
+        GetParam(), &l_stats));
+    sites.push_back(ModelData(allele_vector{{"A", {9}, 0}, {"C", {9}, 1}},
+                              GroupedAlleleCounts{{{0}, 9}, {{1}, 9}},
+                              GetParam(), &l_stats));
+  }
+
+  template <Ploidy P>
+  void expect_same_as_model() {
+    LikelihoodBatch<P> batch(l_stats.log_mean_pb_error);
+    std::vector<LevelGenotyperModel> batched;
+    batched.reserve(sites.size());
+    for (auto& site : sites) batched.emplace_back(site, true);
+    for (auto const& model : batched) {
+      ASSERT_TRUE(model.awaits_batch());
+      batch.add_site();
+      model.add_genotypes<P>(batch);
+    }
+    batch.evaluate();
+    EXPECT_EQ(batch.num_sites(), 3);
+
+    for (std::size_t i = 0; i < sites.size(); ++i) {
+      LevelGenotyperModel model(sites[i]);
+      EXPECT_EQ(best_two(batch, i), first_two(model.get_likelihoods()));
+
+      batched[i].call_genotype<P>(batch, i);
+      EXPECT_FALSE(batched[i].awaits_batch());
+      auto const batched_call = batched[i].get_site_gtype_info(),
+                 call = model.get_site_gtype_info();
+      EXPECT_EQ(batched_call.genotype, call.genotype);
+      EXPECT_EQ(batched_call.alleles, call.alleles);
+      EXPECT_EQ(batched[i].get_genotype_confidence(),
+                model.get_genotype_confidence());
+    }
+  }
+
+  likelihood_related_stats l_stats =
+      LevelGenotyper::make_l_stats(15, 30, 0.01);
+  std::vector<ModelData> sites;
+};
+
+TEST_P(LikelihoodBatch_ThreeSites, BestTwoLikelihoods_SameAsModel) {
+  if (GetParam() == Ploidy::Haploid)
+    expect_same_as_model<Ploidy::Haploid>();
+  else
+    expect_same_as_model<Ploidy::Diploid>();
+}
+
+INSTANTIATE_TEST_SUITE_P(Ploidies, LikelihoodBatch_ThreeSites,
+                         ::testing::Values(Ploidy::Haploid, Ploidy::Diploid));
+
+TEST(LikelihoodBatch, TiedLikelihoods_RankedInOrderOfAddition) {
+  LikelihoodBatch<Ploidy::Haploid> batch(-4);
+  batch.add_site();
+  batch.add_haploid(0, 10, 5, -1);
+  batch.add_haploid(1, 10, 5, -1);
+  batch.add_haploid(2, 10, 5, -1);
+  batch.evaluate();
+
+  std::array<std::size_t, 2> expected{0, 1};
+  EXPECT_EQ(batch.best_two(0), expected);
+  EXPECT_EQ(batch.log_likelihood(0), -21);
+}
+
+TEST(LikelihoodBatch, SiteWithOneGenotype_NoSecondBest) {
+  using Batch = LikelihoodBatch<Ploidy::Diploid>;
+  Batch batch(-4);
+  batch.add_site();
+  batch.add_diploid({1, 1}, 10, true, {10, 10}, 0, {false, false}, {-1, -1});
+  batch.evaluate();
+
+  std::array<std::size_t, 2> expected{0, Batch::no_genotype};
+  EXPECT_EQ(batch.best_two(0), expected);
+  EXPECT_EQ(batch.genotype(0), (Genotype<Ploidy::Diploid>{1, 1}));
+}
+
+TEST(LikelihoodBatch, UncallableAllele_NotBatched) {
+  auto l_stats = LevelGenotyper::make_l_stats(10, 20, 0.01);
+  ModelData data(
+      allele_vector{{"A", {1}, 0, false}, {"C", {9}, 1}, {"G", {8}, 2}},
+      GroupedAlleleCounts{{{0}, 1}, {{1}, 9}, {{2}, 8}}, Ploidy::Haploid,
+      &l_stats);
+  LevelGenotyperModel model(data, true);
+  EXPECT_FALSE(model.awaits_batch());
+  EXPECT_EQ(model.get_site()->get_genotype(), GtypedIndices{1});
+}
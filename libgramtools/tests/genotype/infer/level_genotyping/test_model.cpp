@@ -17,7 +17,7 @@ TEST(HaploidCoverages,
 
   LevelGenotyperModel gtyper;
   gtyper.set_haploid_coverages(gp_covs, 4);
-  PerAlleleCoverage expected_haploid_cov{5, 10, 0, 1};
+  AlleleCovTotals expected_haploid_cov{5, 10, 0, 1};
   EXPECT_EQ(gtyper.get_haploid_covs(), expected_haploid_cov);
   EXPECT_EQ(gtyper.get_singleton_covs(), expected_haploid_cov);
 }
@@ -29,8 +29,8 @@ TEST(HaploidCoverages,
   LevelGenotyperModel gtyper;
   gtyper.set_haploid_coverages(gp_covs, 4);
 
-  PerAlleleCoverage expected_haploid_cov{9, 14, 1, 1};
-  PerAlleleCoverage expected_singleton_cov{5, 10, 0, 0};
+  AlleleCovTotals expected_haploid_cov{9, 14, 1, 1};
+  AlleleCovTotals expected_singleton_cov{5, 10, 0, 0};
 
   EXPECT_EQ(gtyper.get_haploid_covs(), expected_haploid_cov);
   EXPECT_EQ(gtyper.get_singleton_covs(), expected_singleton_cov);
@@ -48,9 +48,10 @@ TEST(DiploidCoverages, GivenMultiAllelicClasses_CorrectDiploidCovs) {
 
   LevelGenotyperModel gtyper;
   gtyper.set_haploid_coverages(gp_covs, 4);
+  gtyper.set_shared_coverages(gp_covs, 4);
   multiplicities haplogroup_multiplicities(4, false);
   auto diploid_covs =
-      gtyper.compute_diploid_coverage(gp_covs, ids, haplogroup_multiplicities);
+      gtyper.compute_diploid_coverage(ids, haplogroup_multiplicities);
   EXPECT_FLOAT_EQ(diploid_covs.first, 10 + 4 / 3.);
   EXPECT_FLOAT_EQ(diploid_covs.second, 20 + 8 / 3.);
 }
@@ -65,13 +66,41 @@ TEST(DiploidCoverages, GivenOnlyMultiAllelicClasses_CorrectDiploidCovs) {
 
   LevelGenotyperModel gtyper;
   gtyper.set_haploid_coverages(gp_covs, 4);
+  gtyper.set_shared_coverages(gp_covs, 4);
   multiplicities haplogroup_multiplicities(4, false);
   auto diploid_covs =
-      gtyper.compute_diploid_coverage(gp_covs, ids, haplogroup_multiplicities);
+      gtyper.compute_diploid_coverage(ids, haplogroup_multiplicities);
   EXPECT_FLOAT_EQ(diploid_covs.first, 1.5);
   EXPECT_FLOAT_EQ(diploid_covs.second, 1.5);
 }
 
+TEST(SharedCoverages, GivenMultiAllelicClasses_CorrectCoveragePerPair) {
+  GroupedAlleleCounts gp_covs{
+      {{0}, 7}, {{0, 1}, 4}, {{1}, 20}, {{0, 1, 3}, 3}, {{2, 3}, 1}};
+  SharedCoverages shared(gp_covs, 4);
+  EXPECT_FALSE(shared.is_sparse());
+  EXPECT_EQ(shared(0, 1), 7);
+  EXPECT_EQ(shared(1, 0), 7);
+  EXPECT_EQ(shared(0, 3), 3);
+  EXPECT_EQ(shared(1, 3), 3);
+  EXPECT_EQ(shared(2, 3), 1);
+  EXPECT_EQ(shared(0, 2), 0);
+  EXPECT_EQ(shared(1, 2), 0);
+}
+
+TEST(SharedCoverages, GivenManyHaplogroups_OnlyPairsSharingCoverageStored) {
+  AlleleId const num_haplogroups{SharedCoverages::max_dense_haplogroups + 100};
+  AlleleId const last{num_haplogroups - 1};
+  GroupedAlleleCounts gp_covs{{{0, 1}, 4}, {{0, 1, last}, 3}, {{2}, 1}};
+  SharedCoverages shared(gp_covs, num_haplogroups);
+  EXPECT_TRUE(shared.is_sparse());
+  EXPECT_EQ(shared(0, 1), 7);
+  EXPECT_EQ(shared(last, 0), 3);
+  EXPECT_EQ(shared(1, last), 3);
+  EXPECT_EQ(shared(0, 2), 0);
+  EXPECT_EQ(shared(2, last), 0);
+}
+
 TEST(LevelGenotyperModelDirectDeletion, GivenEmptyAllele_AssignsCoverage) {
   allele_vector alleles{
       Allele{"C", {8}, 0},
@@ -84,18 +113,24 @@ TEST(LevelGenotyperModelDirectDeletion, GivenEmptyAllele_AssignsCoverage) {
       {{1}, 8},
       {{0, 1}, 1},
   };
-  auto expected = alleles;
-  expected.at(2).pbCov = PerBaseCoverage{9};
-
-  LevelGenotyperModel m;
+  auto l_stats = LevelGenotyper::make_l_stats(10, 20, 0.01);
+  LevelGenotyperModel m{l_stats, {}, {}};
   m.set_haploid_coverages(gp_counts, 2);
-  m.assign_coverage_to_empty_alleles(alleles);
-  EXPECT_EQ(alleles, expected);
+  m.set_allele_log_likelihoods(alleles);
+
+  // The empty allele is given its haplogroup's coverage, on a single base
+  auto const& log_likelihoods = m.get_allele_log_likelihoods();
+  EXPECT_DOUBLE_EQ(log_likelihoods.at(2),
+                   m.allele_log_likelihood(Allele{"", {9}, 1}));
+  EXPECT_DOUBLE_EQ(log_likelihoods.at(0), m.allele_log_likelihood(alleles[0]));
 }
 
 class DiploidCoveragesOneDominatingClass : public ::testing::Test {
  protected:
-  void SetUp() { gtyper.set_haploid_coverages(gp_covs, 2); }
+  void SetUp() {
+    gtyper.set_haploid_coverages(gp_covs, 2);
+    gtyper.set_shared_coverages(gp_covs, 2);
+  }
 
   GroupedAlleleCounts gp_covs{
       {{0}, 8},
@@ -112,7 +147,7 @@ TEST_F(DiploidCoveragesOneDominatingClass,
 
   multiplicities haplogroup_multiplicities(2, false);
   auto diploid_covs =
-      gtyper.compute_diploid_coverage(gp_covs, ids, haplogroup_multiplicities);
+      gtyper.compute_diploid_coverage(ids, haplogroup_multiplicities);
   EXPECT_FLOAT_EQ(diploid_covs.first, 12);
   EXPECT_FLOAT_EQ(diploid_covs.second, 0);
 }
@@ -126,7 +161,7 @@ TEST_F(DiploidCoveragesOneDominatingClass,
   multiplicities haplogroup_multiplicities(
       {true});  // The two alleles have the same haplogroup
   auto diploid_covs =
-      gtyper.compute_diploid_coverage(gp_covs, ids, haplogroup_multiplicities);
+      gtyper.compute_diploid_coverage(ids, haplogroup_multiplicities);
   EXPECT_FLOAT_EQ(diploid_covs.first, 6);
   EXPECT_FLOAT_EQ(diploid_covs.second, 6);
 }
@@ -182,8 +217,7 @@ TEST(MakePermutations, GivenVariousParameters_CorrectPermutations) {
   expected = {{1, 4}, {1, 5}, {4, 5}};
   EXPECT_EQ(two_from_three, expected);
 
-  // Make sure result is internally sorted (at the genotype index level); needed
-  // for diploid coverage memoization
+  // Make sure result is internally sorted (at the genotype index level)
   auto from_unsorted = g.get_permutations(GtypedIndices{4, 3, 2}, 2);
   std::sort(from_unsorted.begin(), from_unsorted.end());
   expected = {{2, 3}, {2, 4}, {3, 4}};
@@ -495,9 +529,63 @@ TEST(TestLevelGenotyperModel_FourAlleles,
 
   data.ploidy = Ploidy::Diploid;
   auto diploid_genotyped = LevelGenotyperModel(data);
-  // Expected number of genotypes: 4 diploid homozygous + (4 choose 2) diploid
-  // heterozygous
-  EXPECT_EQ(diploid_genotyped.get_likelihoods().size(), 10);
+  // At most 4 diploid homozygous + (4 choose 2) diploid heterozygous: the
+  // heterozygous genotypes that cannot be called, or be next best, are skipped
+  EXPECT_GT(diploid_genotyped.get_likelihoods().size(), 4);
+  EXPECT_LE(diploid_genotyped.get_likelihoods().size(), 10);
+}
+
+TEST(TestLevelGenotyperModel_ManyAlleles,
+     GivenSkippedHeterozygousGenotypes_SameCallAsAllGenotypes) {
+  // Alleles 1 and 3 share a haplogroup; the others have their own
+  allele_vector alleles;
+  std::vector<CovCount> covs{3, 25, 1, 18, 0, 7, 2, 22, 1};
+  std::vector<AlleleId> hapgs{0, 1, 2, 1, 3, 4, 5, 6, 7};
+  for (std::size_t i = 0; i < covs.size(); ++i)
+    alleles.push_back(Allele{std::string(3, "ACGT"[i % 4]) + std::to_string(i),
+                             PerBaseCoverage(4, covs[i]), hapgs[i]});
+  GroupedAlleleCounts gp_counts{
+      {{0}, 3},  {{1}, 30},    {{2}, 1},       {{3}, 1},    {{4}, 6},
+      {{5}, 20}, {{6}, 1},     {{1, 6}, 9},    {{6, 7}, 4}, {{0, 2, 5}, 5},
+      {{7}, 1},  {{1, 5}, 12}, {{0, 1, 2}, 2},
+  };
+  auto l_stats = LevelGenotyper::make_l_stats(25, 40, 0.01);
+  ModelData data(alleles, gp_counts, Ploidy::Diploid, &l_stats, false);
+  LevelGenotyperModel genotyped(data);
+
+  // All diploid genotypes, ranked as the model ranks them
+  likelihood_map all_likelihoods;
+  multiplicities hap_mults(8, false);
+  hap_mults.at(1) = true;
+  auto const total_cov = genotyped.count_total_coverage(gp_counts);
+  for (GtypedIndex i = 0; i < alleles.size(); ++i) {
+    for (GtypedIndex j = i; j < alleles.size(); ++j) {
+      if (i != j &&
+          genotyped.get_singleton_covs().at(alleles.at(i).haplogroup) == 0)
+        continue;
+      if (i != j &&
+          genotyped.get_singleton_covs().at(alleles.at(j).haplogroup) == 0)
+        continue;
+      auto const covs = genotyped.compute_diploid_coverage(
+          AlleleIds{alleles.at(i).haplogroup, alleles.at(j).haplogroup},
+          hap_mults);
+      all_likelihoods.insert(
+          {(total_cov - covs.first - covs.second) * l_stats.log_mean_pb_error +
+               genotyped.allele_log_likelihood(alleles.at(i)) +
+               genotyped.allele_log_likelihood(alleles.at(j)),
+           GtypedIndices{i, j}});
+    }
+  }
+  EXPECT_LT(genotyped.get_likelihoods().size(), all_likelihoods.size());
+
+  auto const best = all_likelihoods.begin();
+  auto const next_best = std::next(best);
+  auto const likelihoods = genotyped.get_likelihoods();
+  auto const called = likelihoods.begin();
+  EXPECT_EQ(called->second, best->second);
+  EXPECT_EQ(std::next(called)->second, next_best->second);
+  EXPECT_NEAR(genotyped.get_genotype_confidence(),
+              best->first - next_best->first, 1e-9);
 }
 
 class TestMaxLikelihoodCall : public ::testing::Test {
@@ -514,6 +602,14 @@ class TestMaxLikelihoodCall : public ::testing::Test {
       Allele{"C", {}},
       Allele{"D", {}},
   };
+  likelihood_related_stats l_stats = LevelGenotyper::make_l_stats(20, 5, 0.01);
+
+  using indices = std::pair<std::size_t, std::size_t>;
+  /** Indices of the chosen and next best genotypes, as ranked in `input` */
+  indices choose(likelihood_map const& input) {
+    LevelGenotyperModel model(l_stats, {20, 15, 12, 8}, input);
+    return model.choose_max_likelihood<Ploidy::Haploid>(alleles);
+  }
 };
 
 TEST_F(TestMaxLikelihoodCall, LikelihoodsOrderedDescending) {
@@ -527,37 +623,45 @@ TEST_F(TestMaxLikelihoodCall, LikelihoodsOrderedDescending) {
 
 TEST_F(TestMaxLikelihoodCall, GivenOneLikelihood_Throws) {
   likelihood_map input{*likelihoods.begin()};
-  EXPECT_THROW(LevelGenotyperModel::ChooseMaxLikelihood(input, allele_vector{}),
-               IncorrectGenotyping);
+  EXPECT_THROW(choose(input), IncorrectGenotyping);
 }
 
 TEST_F(TestMaxLikelihoodCall,
        GivenSeveralLikelihoods_ReturnsHighestLikelihood) {
-  EXPECT_EQ(LevelGenotyperModel::ChooseMaxLikelihood(likelihoods, alleles),
-            likelihoods.begin());
+  EXPECT_EQ(choose(likelihoods), indices(0, 1));
 }
 
 TEST_F(TestMaxLikelihoodCall, GivenInconsistentBestLikelihood_ItGetsSkipped) {
   alleles.at(0).callable = false;
-  auto expected = likelihoods.begin();
-  ++expected;
-  EXPECT_EQ(LevelGenotyperModel::ChooseMaxLikelihood(likelihoods, alleles),
-            expected);
+  EXPECT_EQ(choose(likelihoods), indices(1, 2));
 }
 
 TEST_F(TestMaxLikelihoodCall,
        GivenInconsistentSecondBestLikelihood_NoSkipping) {
   alleles.at(1).callable = false;
-  EXPECT_EQ(LevelGenotyperModel::ChooseMaxLikelihood(likelihoods, alleles),
-            likelihoods.begin());
+  EXPECT_EQ(choose(likelihoods), indices(0, 1));
 }
 
-TEST_F(TestMaxLikelihoodCall, GivenFewerThanTwoConsistentAlleles_Throws) {
+TEST_F(TestMaxLikelihoodCall, GivenOnlyWorstAlleleConsistent_Throws) {
   alleles.at(0).callable = false;
   alleles.at(1).callable = false;
   alleles.at(2).callable = false;
-  EXPECT_THROW(LevelGenotyperModel::ChooseMaxLikelihood(likelihoods, alleles),
-               IncorrectGenotyping);
+  EXPECT_THROW(choose(likelihoods), IncorrectGenotyping);
+}
+
+TEST_F(TestMaxLikelihoodCall, GivenNoConsistentAllele_Throws) {
+  for (auto& allele : alleles) allele.callable = false;
+  EXPECT_THROW(choose(likelihoods), IncorrectGenotyping);
+}
+
+TEST_F(TestMaxLikelihoodCall, GivenTiedLikelihoods_FirstComputedChosen) {
+  // Stored as computed in ranked order: {2}, {1}, {3}, {0}
+  likelihood_map tied{{-2, {3}}, {-1, {2}}, {-2, {0}}, {-1, {1}}};
+  EXPECT_EQ(choose(tied), indices(0, 1));
+
+  // The uncallable tied genotype is not the next best
+  alleles.at(2).callable = false;
+  EXPECT_EQ(choose(tied), indices(1, 2));
 }
 
 TEST_F(TestMaxLikelihoodCall, GivenNestingInconsistentBestAllele_NotCalled) {
@@ -579,3 +683,16 @@ TEST_F(TestMaxLikelihoodCall, GivenNestingInconsistentBestAllele_NotCalled) {
   EXPECT_EQ(result.alleles, expected_alleles);
   EXPECT_EQ(result.genotype, GtypedIndices{1});
 }
+
+TEST_F(TestMaxLikelihoodCall, GivenTiedLikelihoods_RankedInOrderOfComputation) {
+  auto l_stats = LevelGenotyper::make_l_stats(20, 5, 0.01);
+  multiplicities hap_muts{false, false, false, false};
+  likelihood_map tied{{-2, {3}}, {-1, {2}}, {-2, {0}}, {-1, {1}}};
+  alleles.at(2).callable = false;
+
+  LevelGenotyperModel model(l_stats, {20, 15, 12, 8}, tied);
+  EXPECT_EQ(model.get_likelihoods(), tied);
+  model.CallGenotype(alleles, hap_muts, Ploidy::Haploid);
+  EXPECT_EQ(model.get_site_gtype_info().genotype, GtypedIndices{1});
+  EXPECT_EQ(model.get_genotype_confidence(), 1);
+}
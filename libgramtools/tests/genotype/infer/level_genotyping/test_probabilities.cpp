@@ -9,7 +9,7 @@ TEST(ProbabilityMemoisation,
      GivenSameQueryParamsTwice_ProbabilityOnlyComputedOnce) {
   MockPmf pmf;
 
-  EXPECT_CALL(pmf, compute_prob(params{1.5})).Times(1).WillOnce(Return(0.5));
+  EXPECT_CALL(pmf, compute_prob(1.5)).Times(1).WillOnce(Return(0.5));
 
   double prob1 = pmf(params{1.5});
   EXPECT_DOUBLE_EQ(prob1, 0.5);
@@ -57,6 +57,13 @@ TEST(LikelihoodStats, DynamicDataParams) {
   EXPECT_EQ(int(num_successes * (1 - prob_success) / pow(prob_success, 2)), 20);
 }
 
+TEST(LikelihoodStats, DataParamsKey_HoldsExactParams) {
+  DataParams const params(10., 0.01);
+  EXPECT_EQ(params.key(), DataParams(10., 0.01).key());
+  EXPECT_NE(params.key(), DataParams(std::nextafter(10., 11.), 0.01).key());
+  EXPECT_NE(params.key(), DataParams(10., 0.02).key());
+}
+
 TEST(LogPmfs, GivenConstructedObject_PmfAt0IsAlreadyMemoised) {
   pmf_ptr pmf;
   pmf = std::make_shared<PoissonLogPmf>(params{2});
@@ -95,6 +102,57 @@ TEST(LogPmfs, GivenTruthProbabilities_LogPmfValuesCorrect) {
   EXPECT_DOUBLE_EQ(res2, known2);
 }
 
+TEST(LogPmfTable, TabulatedIntegerCoverages_NotComputedAgain) {
+  MockPmf pmf;
+  for (double coverage : {0., 1., 2.})
+    EXPECT_CALL(pmf, compute_prob(coverage))
+        .Times(1)
+        .WillOnce(Return(-coverage));
+  pmf.tabulate(3);
+  EXPECT_EQ(pmf.table_size(), 3);
+
+  EXPECT_DOUBLE_EQ(pmf.log_prob(2), -2);
+  EXPECT_DOUBLE_EQ(pmf.log_prob(0), 0);
+  EXPECT_TRUE(pmf.get_probs().empty());
+}
+
+TEST(LogPmfTable, UntabulatedCoverages_ComputedEachTimeWithoutMemo) {
+  MockPmf pmf;
+  EXPECT_CALL(pmf, compute_prob(0.)).WillOnce(Return(0));
+  EXPECT_CALL(pmf, compute_prob(0.5)).Times(2).WillRepeatedly(Return(-0.5));
+  EXPECT_CALL(pmf, compute_prob(3.)).Times(2).WillRepeatedly(Return(-3));
+  pmf.tabulate(1);
+
+  // Not an integer, then past the table
+  for (int repeat = 0; repeat < 2; ++repeat) {
+    EXPECT_DOUBLE_EQ(pmf.log_prob(0.5), -0.5);
+    EXPECT_DOUBLE_EQ(pmf.log_prob(3), -3);
+  }
+  EXPECT_TRUE(pmf.get_probs().empty());
+}
+
+TEST(LogPmfTable, GivenLikelihoodStats_TablesSameAsComputedProbabilities) {
+  for (double var_cov : {5., 30.}) {
+    auto l_stats = LevelGenotyper::make_l_stats(10, var_cov, 0.01);
+    auto const& pmf = l_stats.pmf_full_depth;
+    EXPECT_EQ(pmf->table_size(), pmf_table_size(10, var_cov));
+    EXPECT_GT(pmf->table_size(), 40);
+    for (double coverage : {0., 7., 40.}) {
+      auto const tabulated = pmf->log_prob(coverage);
+      EXPECT_DOUBLE_EQ(tabulated, (*pmf)(params{coverage}));
+    }
+    EXPECT_EQ(l_stats.pmf_half_depth->table_size(), 0);
+  }
+}
+
+TEST(LogPmfTable, TableSize_BoundedByCoverageCounter) {
+  EXPECT_EQ(pmf_table_size(0, 0), 1);
+  EXPECT_EQ(pmf_table_size(std::nan(""), 1), 1);
+  double const beyond_max = 2.0 * max_cov_count;
+  EXPECT_EQ(pmf_table_size(beyond_max, beyond_max),
+            std::size_t{max_cov_count} + 1);
+}
+
 TEST(MinCovMoreLikelyThanError,
      GivenMeanDepthAndErrorRate_CorrectMinCovThreshold) {
   LevelGenotyper g;
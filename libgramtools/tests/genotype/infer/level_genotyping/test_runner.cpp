@@ -10,6 +10,7 @@
 #include "genotype/infer/level_genotyping/runner.hpp"
 #include "genotype/infer/output_specs/make_json.hpp"
 #include "gtest/gtest.h"
+#include <omp.h>
 
 TEST(LevelGenotyping, Given2SiteNonNestedPRG_CorrectGenotypes) {
   std::string prg{"AATAA5C6G6AA7C8G8AA"};
@@ -150,6 +151,23 @@ TEST_F(LG_SnpsNestedInTwoHaplotypes, MapReads_CorrectlyInvalidatedSites) {
   EXPECT_FLOAT_EQ(json_result.at("GT_CONF").at(0), 0.);
 }
 
+TEST_F(LG_SnpsNestedInTwoHaplotypes, MapReads_SameGenotypesAnyNumThreads) {
+  setup.quasimap_reads(reads);
+  auto genotype_with_threads = [&](int const num_threads) {
+    auto const previous_num_threads = omp_get_max_threads();
+    omp_set_num_threads(num_threads);
+    LevelGenotyper genotyper(setup.prg_info.coverage_graph,
+                             setup.coverage.grouped_allele_counts,
+                             setup.read_stats, Ploidy::Diploid);
+    omp_set_num_threads(previous_num_threads);
+    std::vector<JSON> result;
+    for (auto const& gt_rec : genotyper.get_genotyped_records())
+      result.push_back(make_json_site(gt_rec)->get_site());
+    return result;
+  };
+  EXPECT_EQ(genotype_with_threads(1), genotype_with_threads(4));
+}
+
 TEST(GCPSimulation, GivenDifferentNumGenotypedSites_ConsistentNumConfidences) {
   auto l_stats = LevelGenotyper::make_l_stats(20, 10, 0.1);
   Ploidy ploidy{Ploidy::Haploid};
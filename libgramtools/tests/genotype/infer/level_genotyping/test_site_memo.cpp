@@ -0,0 +1,308 @@
+#include "genotype/infer/level_genotyping/site_memo.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+#include "../../../test_resources/test_resources.hpp"
+#include "genotype/infer/level_genotyping/runner.hpp"
+#include "genotype/infer/output_specs/make_json.hpp"
+#include "gtest/gtest.h"
+
+namespace fs = std::filesystem;
+
+class SiteMemo_OneSite : public ::testing::Test {
+ protected:
+  ModelData make_data(GroupedAlleleCounts const& counts,
+                      likelihood_related_stats const* stats) {
+    return ModelData(allele_vector{{"A", {5}, 0}, {"C", {1}, 1}}, counts,
+                     Ploidy::Haploid, stats);
+  }
+
+  likelihood_related_stats l_stats = LevelGenotyper::make_l_stats(5, 5, 0.01),
+                           other_l_stats =
+                               LevelGenotyper::make_l_stats(30, 40, 0.01);
+  uint64_t params_hash =
+      SiteMemo::make_params_hash(l_stats, Ploidy::Haploid, false);
+  uint64_t other_params_hash =
+      SiteMemo::make_params_hash(other_l_stats, Ploidy::Haploid, false);
+  GroupedAlleleCounts counts{{{0}, 5}, {{1}, 1}};
+};
+
+TEST_F(SiteMemo_OneSite, SameInputs_SameKey) {
+  auto const data = make_data(counts, &l_stats);
+  EXPECT_EQ(SiteMemo::make_key(0, data, params_hash),
+            SiteMemo::make_key(0, make_data(counts, &l_stats), params_hash));
+  EXPECT_FALSE(SiteMemo::make_key(0, data, params_hash) ==
+               SiteMemo::make_key(1, data, params_hash));
+  EXPECT_FALSE(
+      SiteMemo::make_key(0, data, params_hash) ==
+      SiteMemo::make_key(0, make_data({{{0}, 6}}, &l_stats), params_hash));
+}
+
+TEST_F(SiteMemo_OneSite, DifferentParams_DifferentKeyUnlessNoCoverage) {
+  EXPECT_NE(params_hash, other_params_hash);
+  EXPECT_NE(params_hash,
+            SiteMemo::make_params_hash(l_stats, Ploidy::Diploid, false));
+
+  auto const data = make_data(counts, &l_stats);
+  EXPECT_FALSE(SiteMemo::make_key(0, data, params_hash) ==
+               SiteMemo::make_key(0, data, other_params_hash));
+
+  auto const uncovered = make_data({}, &l_stats);
+  EXPECT_EQ(SiteMemo::make_key(0, uncovered, params_hash),
+            SiteMemo::make_key(0, uncovered, other_params_hash));
+}
+
+TEST(SiteMemoHash, StableHash_IsLittleEndianFnv1a) {
+  StableHash hash;
+  hash.add(std::string{"a"});
+  EXPECT_EQ(hash.get(), 0xaf63dc4c8601ec8c);
+
+  StableHash string_hash, int_hash;
+  string_hash.add(std::string{"ab"});
+  int_hash.add<uint16_t>(0x6261);
+  EXPECT_EQ(string_hash.get(), int_hash.get());
+}
+
+TEST_F(SiteMemo_OneSite, InsertThenFind_CopyOfSite) {
+  SiteMemo memo;
+  auto data = make_data(counts, &l_stats);
+  auto const key = SiteMemo::make_key(0, data, params_hash);
+  EXPECT_EQ(memo.find(key), nullptr);
+
+  auto const genotyped = std::static_pointer_cast<LevelGenotypedSite>(
+      LevelGenotyperModel(data).get_site());
+  memo.insert(key, *genotyped);
+  auto const found = memo.find(key);
+  ASSERT_NE(found, nullptr);
+  EXPECT_NE(found, genotyped);
+  EXPECT_EQ(found->get_genotype(), genotyped->get_genotype());
+  EXPECT_EQ(found->get_alleles(), genotyped->get_alleles());
+  EXPECT_EQ(found->get_gt_conf(), genotyped->get_gt_conf());
+
+  found->make_null();
+  EXPECT_FALSE(memo.find(key)->is_null());
+  EXPECT_EQ(memo.get_num_lookups(), 3);
+  EXPECT_EQ(memo.get_num_hits(), 2);
+}
+
+TEST_F(SiteMemo_OneSite, ReuseParams_FoundUnderPreviousParamsAndStoredAgain) {
+  SiteMemo memo;
+  auto data = make_data(counts, &l_stats);
+  memo.insert(SiteMemo::make_key(0, data, params_hash),
+              *std::static_pointer_cast<LevelGenotypedSite>(
+                  LevelGenotyperModel(data).get_site()));
+  auto const key = SiteMemo::make_key(0, data, other_params_hash);
+  EXPECT_EQ(memo.find(key), nullptr);
+
+  memo.reuse_params(params_hash);
+  EXPECT_NE(memo.find(key), nullptr);
+  EXPECT_EQ(memo.get_num_reused(), 1);
+  EXPECT_EQ(memo.size(), 2);
+  EXPECT_NE(memo.find(key), nullptr);
+  EXPECT_EQ(memo.get_num_reused(), 1);
+  EXPECT_EQ(memo.get_num_hits(), 2);
+}
+
+class SiteMemo_Saved : public SiteMemo_OneSite {
+ protected:
+  void SetUp() override {
+    memo_dir = fs::temp_directory_path() / "gram_test_site_memo";
+    fs::remove_all(memo_dir);
+  }
+  void TearDown() override { fs::remove_all(memo_dir); }
+
+  void insert_genotyped(SiteMemo& memo, SiteMemo::Key const& key,
+                        ModelData& data) {
+    memo.insert(key, *std::static_pointer_cast<LevelGenotypedSite>(
+                         LevelGenotyperModel(data).get_site()));
+  }
+
+  fs::path memo_dir;
+};
+
+TEST_F(SiteMemo_Saved, SaveThenLoad_SameSites) {
+  auto data = make_data(counts, &l_stats);
+  data.debug = true;
+  auto const key = SiteMemo::make_key(0, data, params_hash);
+  auto genotyped = std::static_pointer_cast<LevelGenotypedSite>(
+      LevelGenotyperModel(data).get_site());
+  genotyped->set_filter("AMBIG");
+  SiteMemo memo;
+  memo.use_params(params_hash);
+  memo.insert(key, *genotyped);
+  memo.save(memo_dir);
+
+  SiteMemo loaded;
+  loaded.load(memo_dir);
+  loaded.use_params(params_hash);
+  ASSERT_EQ(loaded.size(), 1);
+  auto const expected = memo.find(key), result = loaded.find(key);
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(result->get_genotype(), expected->get_genotype());
+  EXPECT_EQ(result->get_alleles(), expected->get_alleles());
+  EXPECT_EQ(result->get_all_gtype_info().allele_covs,
+            expected->get_all_gtype_info().allele_covs);
+  EXPECT_EQ(result->get_all_gtype_info().filters,
+            expected->get_all_gtype_info().filters);
+  EXPECT_EQ(result->get_num_haplogroups(), expected->get_num_haplogroups());
+  EXPECT_EQ(result->get_debug_info(), expected->get_debug_info());
+  EXPECT_EQ(result->get_gt_conf(), expected->get_gt_conf());
+}
+
+TEST_F(SiteMemo_Saved, SaveWithOtherParams_KeepsSitesOfPreviousParams) {
+  auto covered = make_data(counts, &l_stats);
+  auto uncovered = make_data({}, &l_stats);
+  auto const covered_key = SiteMemo::make_key(0, covered, params_hash);
+  SiteMemo first;
+  first.use_params(params_hash);
+  insert_genotyped(first, covered_key, covered);
+  insert_genotyped(first, SiteMemo::make_key(1, uncovered, params_hash),
+                   uncovered);
+  first.save(memo_dir);
+
+  SiteMemo second;
+  second.load(memo_dir);
+  EXPECT_EQ(second.size(), 1);
+  second.use_params(other_params_hash);
+  EXPECT_EQ(second.find(covered_key), nullptr);
+  second.save(memo_dir);
+
+  SiteMemo third;
+  third.load(memo_dir);
+  EXPECT_NE(third.find(SiteMemo::make_key(1, uncovered, other_params_hash)),
+            nullptr);
+  third.use_params(params_hash);
+  EXPECT_EQ(third.size(), 2);
+  EXPECT_NE(third.find(covered_key), nullptr);
+}
+
+TEST_F(SiteMemo_Saved, SaveMoreParamsThanKept_LeastRecentlySavedEvicted) {
+  auto covered = make_data(counts, &l_stats);
+  auto const save_with = [&](uint64_t const hash) {
+    SiteMemo memo;
+    memo.use_params(hash);
+    insert_genotyped(memo, SiteMemo::make_key(0, covered, hash), covered);
+    memo.save(memo_dir, 2);
+  };
+  save_with(1);
+  save_with(2);
+  auto const now = fs::file_time_type::clock::now();
+  fs::last_write_time(SiteMemo::params_memo_fpath(memo_dir, 1),
+                      now - std::chrono::hours(1));
+  fs::last_write_time(SiteMemo::params_memo_fpath(memo_dir, 2),
+                      now - std::chrono::hours(2));
+  save_with(3);
+
+  EXPECT_TRUE(fs::exists(SiteMemo::params_memo_fpath(memo_dir, 1)));
+  EXPECT_FALSE(fs::exists(SiteMemo::params_memo_fpath(memo_dir, 2)));
+  EXPECT_TRUE(fs::exists(SiteMemo::params_memo_fpath(memo_dir, 3)));
+}
+
+TEST_F(SiteMemo_Saved, CorruptFile_Ignored) {
+  fs::create_directories(memo_dir);
+  std::ofstream(SiteMemo::memo_fpath(memo_dir)) << "GRAMMEMO\x01";
+  SiteMemo memo;
+  memo.load(memo_dir);
+  EXPECT_EQ(memo.size(), 0);
+}
+
+class SiteMemo_Runner : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memo_dir = fs::temp_directory_path() / "gram_test_site_memo_runs";
+    fs::remove_all(memo_dir);
+    setup.setup_bracketed_prg("ATCGGC[TC[A,G]TC,GG[T,G]GG]AT");
+    GenomicRead_vector reads;
+    for (int num_mapped{0}; num_mapped < 7; num_mapped++)
+      reads.push_back(GenomicRead("Read1", "ATCGGCTCGTCAT", "............."));
+    reads.push_back(GenomicRead("Read2", "ATCGGCGGG", "........."));
+    setup.quasimap_reads(reads);
+  }
+  void TearDown() override { fs::remove_all(memo_dir); }
+
+  void map_more_reads() {
+    GenomicRead_vector reads;
+    for (int num_mapped{0}; num_mapped < 5; num_mapped++)
+      reads.push_back(GenomicRead("Read1", "ATCGGCTCGTCAT", "............."));
+    setup.quasimap_reads(reads);
+  }
+
+  uint64_t params_hash() {
+    auto const l_stats = LevelGenotyper::make_l_stats(
+        setup.read_stats.get_mean_cov(), setup.read_stats.get_var_cov(),
+        setup.read_stats.get_mean_pb_error());
+    return SiteMemo::make_params_hash(l_stats, Ploidy::Diploid, false);
+  }
+
+  std::vector<JSON> genotype(SiteMemo* memo) { return genotype(setup, memo); }
+
+  std::vector<JSON> genotype(prg_setup& sample, SiteMemo* memo) {
+    LevelGenotyper genotyper(sample.prg_info.coverage_graph,
+                             sample.coverage.grouped_allele_counts,
+                             sample.read_stats, Ploidy::Diploid, false, "", {},
+                             memo);
+    std::vector<JSON> result;
+    for (auto const& gt_rec : genotyper.get_genotyped_records())
+      result.push_back(make_json_site(gt_rec)->get_site());
+    return result;
+  }
+
+  prg_setup setup;
+  fs::path memo_dir;
+};
+
+TEST_F(SiteMemo_Runner, GenotypeTwiceWithMemo_SameGenotypesAsWithout) {
+  auto const expected = genotype(nullptr);
+  SiteMemo memo;
+  EXPECT_EQ(genotype(&memo), expected);
+  EXPECT_EQ(memo.get_num_hits(), 0);
+  EXPECT_EQ(memo.size(), expected.size());
+
+  EXPECT_EQ(genotype(&memo), expected);
+  EXPECT_EQ(memo.get_num_hits(), expected.size());
+}
+
+TEST_F(SiteMemo_Runner, TopUpReads_SitesWithUnchangedInputsReused) {
+  SiteMemo memo;
+  auto const previous = genotype(&memo);
+  auto const previous_params_hash = params_hash();
+  map_more_reads();
+  ASSERT_NE(params_hash(), previous_params_hash);
+
+  memo.reuse_params(previous_params_hash);
+  auto const topped_up = genotype(&memo);
+  // Only site 9, in the haplogroup the new reads do not go through, is
+  // unchanged
+  EXPECT_EQ(memo.get_num_reused(), 1);
+  EXPECT_EQ(topped_up.at(siteID_to_index(9)), previous.at(siteID_to_index(9)));
+  EXPECT_EQ(topped_up.at(siteID_to_index(5)),
+            genotype(nullptr).at(siteID_to_index(5)));
+}
+
+TEST_F(SiteMemo_Runner, TopUpAfterOtherSample_SitesWithUnchangedInputsReused) {
+  SiteMemo memo;
+  memo.load(memo_dir);
+  auto const previous = genotype(&memo);
+  auto const previous_params_hash = params_hash();
+  memo.save(memo_dir);
+
+  prg_setup other_sample;
+  other_sample.setup_bracketed_prg("ATCGGC[TC[A,G]TC,GG[T,G]GG]AT");
+  GenomicRead_vector reads;
+  for (int num_mapped{0}; num_mapped < 4; num_mapped++)
+    reads.push_back(GenomicRead("Read1", "ATCGGCGGTGGAT", "............."));
+  other_sample.quasimap_reads(reads);
+  SiteMemo other_memo;
+  other_memo.load(memo_dir);
+  genotype(other_sample, &other_memo);
+  other_memo.save(memo_dir);
+
+  map_more_reads();
+  SiteMemo topped_up_memo;
+  topped_up_memo.load(memo_dir);
+  topped_up_memo.reuse_params(previous_params_hash);
+  auto const topped_up = genotype(&topped_up_memo);
+  EXPECT_EQ(topped_up_memo.get_num_reused(), 1);
+  EXPECT_EQ(topped_up.at(siteID_to_index(9)), previous.at(siteID_to_index(9)));
+}
@@ -15,6 +15,6 @@ class MockGenotypedSite : public GenotypedSite {
 namespace gram::genotype::infer::probabilities {
 class MockPmf : public AbstractPmf {
  public:
-  MOCK_METHOD(double, compute_prob, (params const& query), (const, override));
+  MOCK_METHOD(double, compute_prob, (double const coverage), (const, override));
 };
 }  // namespace gram::genotype::infer::probabilities
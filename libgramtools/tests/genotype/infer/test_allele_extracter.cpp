@@ -10,6 +10,25 @@
 using namespace ::testing;
 using namespace gram::submods;
 
+namespace {
+using path_vector = AlleleExtracter::path_vector;
+
+path_vector to_paths(AlleleExtracter& extracter, allele_vector const& alleles) {
+  path_vector result;
+  for (auto const& allele : alleles)
+    result.push_back(extracter.make_path(allele));
+  return result;
+}
+
+allele_vector to_alleles(AlleleExtracter const& extracter,
+                         path_vector const& paths) {
+  allele_vector result;
+  for (auto const& path : paths)
+    result.push_back(extracter.get_paths().materialise(path));
+  return result;
+}
+}  // namespace
+
 TEST(ExtractRefAllele, GivenSiteNodesInGraph_CorrectRefAllele) {
   marker_vec v = prg_string_to_ints("AT[[C,A,G]T[G[,C]C,T],TTA]T");
   PRG_String prg_string{v};
@@ -41,10 +60,10 @@ TEST_F(AlleleCombineTest,
   site.set_alleles(allele_vector{Allele{"CCC", {1, 1, 1}, 2}});
   site.set_genotype(GtypedIndices{0});
 
-  allele_vector one_allele{existing_alleles.at(0)};
+  auto one_allele = to_paths(test_extracter, {existing_alleles.at(0)});
   auto result = test_extracter.allele_combine(one_allele, 0);
   allele_vector expected{{"ATTGCCC", {0, 1, 2, 3, 1, 1, 1}, 0}};
-  EXPECT_EQ(result, expected);
+  EXPECT_EQ(to_alleles(test_extracter, result), expected);
 }
 
 TEST_F(AlleleCombineTest,
@@ -58,7 +77,7 @@ TEST_F(AlleleCombineTest,
   site.set_extra_alleles(allele_vector{Allele{"AAA", {2, 1, 0}, 2, false}});
   site.set_genotype(GtypedIndices{1});
 
-  allele_vector one_allele{existing_alleles.at(0)};
+  auto one_allele = to_paths(test_extracter, {existing_alleles.at(0)});
   EXPECT_TRUE(one_allele.at(0).callable);
 
   auto result = test_extracter.allele_combine(one_allele, 0);
@@ -66,7 +85,7 @@ TEST_F(AlleleCombineTest,
       {"ATTGGGG", {0, 1, 2, 3, 2, 2, 2}, 0},
       {"ATTGAAA", {0, 1, 2, 3, 2, 1, 0}, 0},
   };
-  EXPECT_EQ(result, expected);
+  EXPECT_EQ(to_alleles(test_extracter, result), expected);
   EXPECT_TRUE(result.at(0).callable);
   EXPECT_FALSE(result.at(1).callable);
 }
@@ -76,12 +95,11 @@ TEST_F(AlleleCombineTest, TwoAllelesNullGenotype_oneCorrectCombinationAllele) {
   site.set_alleles(
       allele_vector{Allele{"TTT", {1, 1, 1}}, Allele{"CCC", {0, 1, 1}}});
 
-  allele_vector one_allele(existing_alleles.begin(),
-                           existing_alleles.begin() + 1);
+  auto one_allele = to_paths(test_extracter, {existing_alleles.at(0)});
   auto result = test_extracter.allele_combine(one_allele, 0);
   allele_vector expected{{"ATTGTTT", {0, 1, 2, 3, 1, 1, 1}, 0}};
 
-  EXPECT_EQ(result, expected);
+  EXPECT_EQ(to_alleles(test_extracter, result), expected);
   EXPECT_TRUE(result.at(0).callable);
 };
 
@@ -97,7 +115,8 @@ TEST_F(AlleleCombineTest,
           1  // Note the pasted allele's haplogroup should get ignored
       }});
 
-  auto result = test_extracter.allele_combine(existing_alleles, 0);
+  auto result = test_extracter.allele_combine(
+      to_paths(test_extracter, existing_alleles), 0);
   allele_vector expected{
       {"ATTGCCC", {0, 1, 2, 3, 1, 1, 1}, 0},
       {"ATTGTTT", {0, 1, 2, 3, 5, 5, 5}, 0},
@@ -105,7 +124,7 @@ TEST_F(AlleleCombineTest,
       {"ATCGTTT", {0, 0, 1, 1, 5, 5, 5}, 0},
   };
 
-  EXPECT_EQ(result, expected);
+  EXPECT_EQ(to_alleles(test_extracter, result), expected);
   for (auto const& allele : result) EXPECT_TRUE(allele.callable);
 }
 
@@ -119,12 +138,13 @@ TEST(AllelePasteTest,
   covG_ptr cov_Node = boost::make_shared<coverage_Node>("ATTCGC", 120, 1, 1);
 
   AlleleExtracter extracter;
-  extracter.allele_paste(existing_alleles, cov_Node);
+  auto existing_paths = to_paths(extracter, existing_alleles);
+  extracter.allele_paste(existing_paths, cov_Node);
 
   allele_vector expected{{"ATTGATTCGC", {0, 1, 2, 3, 0, 0, 0, 0, 0, 0}, 0},
                          {"ATCGATTCGC", {0, 0, 1, 1, 0, 0, 0, 0, 0, 0}, 0}};
 
-  EXPECT_EQ(existing_alleles, expected);
+  EXPECT_EQ(to_alleles(extracter, existing_paths), expected);
 }
 
 class AlleleExtracter_NestedPRG : public ::testing::Test {
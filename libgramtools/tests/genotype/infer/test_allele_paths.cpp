@@ -0,0 +1,57 @@
+#include "genotype/infer/allele_paths.hpp"
+#include "gtest/gtest.h"
+
+using namespace gram;
+using namespace gram::genotype::infer;
+
+class AllelePaths_SharedPieces : public ::testing::Test {
+ protected:
+  void SetUp() {
+    auto const at = paths.add_piece(Allele{"AT", {1, 2}});
+    auto const g = paths.add_piece(Allele{"G", {4}, 3});
+    auto const c = paths.add_piece(Allele{"C", {0}});
+    auto const atg = paths.add_piece(Allele{"ATG", {7, 7, 7}});
+    paths.add_path({{at, g, c}, 0});
+    paths.add_path({{at, c}, 1, false});
+    paths.add_path({{atg, c}, 2});
+  }
+  AllelePaths paths;
+};
+
+TEST_F(AllelePaths_SharedPieces, StatisticsFromPieces) {
+  EXPECT_EQ(paths.size(), 3);
+  EXPECT_EQ(paths.length(paths[0]), 4);
+  EXPECT_EQ(paths.total_coverage(paths[0]), 7);
+  EXPECT_DOUBLE_EQ(paths.average_cov(paths[1]), 1);
+  EXPECT_EQ(paths.count_positions_below(paths[0], 2), 2);
+  EXPECT_EQ(paths.sequence(paths[0]), "ATGC");
+}
+
+TEST_F(AllelePaths_SharedPieces, MaterialisedAlleles) {
+  allele_vector expected{
+      Allele{"ATGC", {1, 2, 4, 0}, 0},
+      Allele{"ATC", {1, 2, 0}, 1, false},
+      Allele{"ATGC", {7, 7, 7, 0}, 2},
+  };
+  auto result = paths.materialise_all();
+  EXPECT_EQ(result, expected);
+  EXPECT_FALSE(result.at(1).callable);
+}
+
+TEST_F(AllelePaths_SharedPieces, SameSequenceFromDifferentPieces_SameHash) {
+  EXPECT_EQ(paths.sequence_hash(paths[0]), paths.sequence_hash(paths[2]));
+  EXPECT_NE(paths.sequence_hash(paths[0]), paths.sequence_hash(paths[1]));
+  EXPECT_TRUE(paths.has_duplicate_sequences());
+
+  AllelePaths distinct(allele_vector{{"ATGC", {}}, {"ATC", {}}, {"", {}}});
+  EXPECT_FALSE(distinct.has_duplicate_sequences());
+}
+
+TEST_F(AllelePaths_SharedPieces, FindAllele_ComparesCoverageAndHaplogroup) {
+  EXPECT_EQ(paths.find(Allele{"ATGC", {7, 7, 7, 0}, 2}), 2);
+  EXPECT_EQ(paths.find(Allele{"ATGC", {1, 2, 4, 0}, 0}), 0);
+  EXPECT_EQ(paths.find(Allele{"ATGC", {1, 2, 4, 0}, 2}), paths.size());
+
+  paths.swap_paths(0, 2);
+  EXPECT_EQ(paths.find(Allele{"ATGC", {7, 7, 7, 0}, 2}), 0);
+}
@@ -44,6 +44,28 @@ TEST(AlleleBaseCoverageDump, GivenEmptyAlleleBaseCoverage_CorrectJsonDump) {
   EXPECT_EQ(result, expected);
 }
 
+TEST(AlleleBaseCoverageDump, GivenCovGraph_SameJsonAsCopiedStructure) {
+  auto prg_info =
+      generate_prg_info(prg_string_to_ints("ac[a,c,tt]atg[gggg,,a]cc"));
+  // Second allele of the first site
+  auto const& allele_node = prg_info.coverage_graph.random_access[5].node;
+  allele_node->get_ref_to_coverage().set(0, 7);
+
+  std::stringstream stream;
+  dump_allele_base_coverage(stream, prg_info);
+  auto copied = coverage::generate::allele_base_non_nested(prg_info);
+  EXPECT_EQ(stream.str(), dump_allele_base_coverage(copied));
+  EXPECT_EQ(stream.str(),
+            "{\"allele_base_counts\":[[[0],[7],[0,0]],[[0,0,0,0],[],[0]]]}");
+}
+
+TEST(AlleleBaseCoverageDump, GivenNestedCovGraph_EmptyJsonDump) {
+  auto prg_info = generate_prg_info(prg_string_to_ints("[AC[TG,CC]T,T]A"));
+  std::stringstream stream;
+  dump_allele_base_coverage(stream, prg_info);
+  EXPECT_EQ(stream.str(), "{\"allele_base_counts\":[]}");
+}
+
 TEST(AlleleBaseCoverageStructure, GivenNestedCovGraph_EmptyStructure) {
   auto prg_raw = prg_string_to_ints("[AC[TG,CC]T,T]A");
   auto prg_info = generate_prg_info(prg_raw);
@@ -0,0 +1,36 @@
+#include "gtest/gtest.h"
+
+#include "genotype/quasimap/coverage/allele_group.hpp"
+
+using namespace gram;
+
+TEST(AlleleGroup, GivenAlleles_IteratedInIncreasingOrder) {
+  AlleleGroup group{3, 0, 70};
+  EXPECT_EQ(group.size(), 3);
+  EXPECT_EQ(group.front(), 0);
+  EXPECT_EQ(group.to_ids(), (AlleleIds{0, 3, 70}));
+  EXPECT_TRUE(group.contains(70));
+  EXPECT_FALSE(group.contains(4));
+  EXPECT_FALSE(group.contains(200));
+}
+
+TEST(AlleleGroup, GivenSameAllelesInsertedDifferently_EqualGroups) {
+  AlleleGroup group;
+  group.insert(65);
+  group.insert(1);
+  group.insert(1);
+  EXPECT_EQ(group, (AlleleGroup{1, 65}));
+  EXPECT_EQ(group.hash(), (AlleleGroup{1, 65}).hash());
+  EXPECT_NE(group, (AlleleGroup{1}));
+}
+
+TEST(GroupedAlleleCounts, GivenGroupsInAnyOrder_EqualCounts) {
+  GroupedAlleleCounts counts{{{0, 1}, 4}, {{2}, 1}};
+  EXPECT_EQ(counts, (GroupedAlleleCounts{{{2}, 1}, {{0, 1}, 4}}));
+  EXPECT_EQ(counts.at({0, 1}), 4);
+  EXPECT_THROW(counts.at({1}), std::out_of_range);
+
+  counts[{1}] += 2;
+  EXPECT_EQ(counts.size(), 3);
+  EXPECT_EQ(counts.at({1}), 2);
+}
@@ -42,3 +42,29 @@ TEST(AlleleSumCoverage_Nested,
   AlleleSumCoverage expected = {{0, 0, 0}, {0, 0}, {0, 0}, {0, 0, 0, 0}};
   EXPECT_EQ(result, expected);
 }
+
+TEST(AlleleSumCoverage, GivenCoverageAtMaximum_Saturates) {
+  Coverage coverage;
+  coverage.allele_sum_coverage = AlleleSumCoverage{{max_cov_count, 0}};
+  uniqueLoci compatible_loci{VariantLocus{5, 0}, VariantLocus{5, 1}};
+  coverage::record::allele_sum(coverage, compatible_loci);
+
+  AlleleSumCoverage expected{{max_cov_count, 1}};
+  EXPECT_EQ(coverage.allele_sum_coverage, expected);
+}
+
+TEST(AlleleSumCoverage, GivenConcurrentRecordingPastMaximum_Saturates) {
+  Coverage coverage;
+  // Started close to the maximum, so that wide counters get there quickly
+  CovCount const start = max_cov_count > 10000 ? max_cov_count - 10000 : 0;
+  coverage.allele_sum_coverage = AlleleSumCoverage{{start, 0}};
+  uniqueLoci compatible_loci{VariantLocus{5, 0}};
+  CovTotal const num_records{static_cast<CovTotal>(max_cov_count - start) +
+                             100};
+#pragma omp parallel for num_threads(4)
+  for (CovTotal i = 0; i < num_records; ++i)
+    coverage::record::allele_sum(coverage, compatible_loci);
+
+  AlleleSumCoverage expected{{max_cov_count, 0}};
+  EXPECT_EQ(coverage.allele_sum_coverage, expected);
+}
@@ -105,6 +105,7 @@ class LocusFinder_minimal : public ::testing::Test {
                    {7, VariantLocus{5, FIRST_ALLELE + 2}}};
     coverage_Graph c;
     c.par_map = p;
+    c.site_hierarchy = SiteHierarchy(p);
     prg_info.coverage_graph = c;
   }
   LocusFinder l{};
@@ -250,6 +251,24 @@ TEST_F(LocusFinder_full,
   EXPECT_EQ(l2.unique_loci, expected_unique_loci);
 }
 
+TEST(LocusFinder_flat, constructForFlatPrg_SameAsNestedConstruction) {
+  auto prg_info = generate_prg_info(prg_string_to_ints("A[C,G]T[A,CC,G]T"));
+  // Pretense is we've mapped the read "GTCCT"
+  SearchState test{SA_Interval{7, 7},
+                   VariantSitePath{VariantLocus{7, FIRST_ALLELE + 1},
+                                   VariantLocus{5, FIRST_ALLELE + 1}}};
+  LocusFinder flat{test, &prg_info, NestingTag<Nesting::flat>{}};
+  LocusFinder nested{test, &prg_info, NestingTag<Nesting::nested>{}};
+
+  uniqueLoci expected_unique_loci{
+      VariantLocus{5, FIRST_ALLELE + 1},
+      VariantLocus{7, FIRST_ALLELE + 1},
+  };
+  EXPECT_EQ(flat.unique_loci, expected_unique_loci);
+  EXPECT_EQ(flat.unique_loci, nested.unique_loci);
+  EXPECT_EQ(flat.base_sites, nested.base_sites);
+}
+
 /**
  * Test random selection of multi-mapping reads
  */
@@ -307,6 +326,7 @@ class MappingInstanceSelector_addSearchStates : public ::testing::Test {
     coverage_Graph c;
     parental_map par_map{{7, VariantLocus{5, FIRST_ALLELE}}};
     c.par_map = par_map;
+    c.site_hierarchy = SiteHierarchy(par_map);
     prg_info.coverage_graph = c;
   };
   PRG_Info prg_info;
@@ -86,7 +86,7 @@ TEST(GroupedAlleleCount, GivenSitesGroupedAlleleCounts_CorrectHashing) {
 
   // Test allele IDs in the gped allele counts are all registered and hashed
   HashSet<AlleleIds> allele_ids;
-  for (auto const& entry : result) allele_ids.insert(entry.first);
+  for (auto const& entry : result) allele_ids.insert(entry.first.to_ids());
   HashSet<AlleleIds> expected_allele_ids = {
       AlleleIds{1, 3},
       AlleleIds{2},
@@ -113,7 +113,7 @@ TEST(GroupedAlleleCount_IDToCount, OneSite_CorrectGroupIDToCounts) {
   };
 
   SitesGroupIDToCounts expected{// Ordered by the key
-                                {{"0", 2}, {"1", 19}}};
+                                {{0, 2}, {1, 19}}};
   auto result = get_group_id_counts(sites, allele_ids_groups_hash);
   EXPECT_EQ(result, expected);
 }
@@ -135,11 +135,11 @@ TEST(GroupedAlleleCount_IDToCount, TwoSites_CorrectGroupIDToCounts) {
   };
 
   SitesGroupIDToCounts expected{
-      {{"0", 1}, {"1", 2}},
+      {{0, 1}, {1, 2}},
       {
-          {"0", 20},
-          {"2", 10},
-          {"3", 2},
+          {0, 20},
+          {2, 10},
+          {3, 2},
       },
   };
   auto result = get_group_id_counts(sites, allele_ids_groups_hash);
@@ -151,20 +151,20 @@ TEST(ReverseAlleleGroupHash, Succeeds) {
                                             {AlleleIds{1, 4}, 43}};
   GroupIDToAlleles reversed = get_group_id_alleles(allele_ids_groups_hash);
   GroupIDToAlleles expected{
-      {"42", AlleleIds{1, 3}},
-      {"43", AlleleIds{1, 4}},
+      {42, AlleleIds{1, 3}},
+      {43, AlleleIds{1, 4}},
   };
   EXPECT_EQ(reversed, expected);
 }
 
 TEST(ReverseAlleleGroupHash, IsOrderedByNumericValue) {
-  // Lexicographically, "30" < "9", but gets ordered by numeric value
+  // As strings, "30" < "9", but gets ordered by numeric value
   AlleleGroupHash allele_ids_groups_hash = {{AlleleIds{1, 3}, 30},
                                             {AlleleIds{1, 4}, 9}};
   GroupIDToAlleles reversed = get_group_id_alleles(allele_ids_groups_hash);
   GroupIDToAlleles expected{
-      {"9", AlleleIds{1, 4}},
-      {"30", AlleleIds{1, 3}},
+      {9, AlleleIds{1, 4}},
+      {30, AlleleIds{1, 3}},
   };
   EXPECT_EQ(reversed, expected);
 }
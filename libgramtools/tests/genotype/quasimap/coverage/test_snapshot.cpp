@@ -0,0 +1,121 @@
+#include "genotype/quasimap/coverage/snapshot.hpp"
+
+#include <sstream>
+
+#include "../../../test_resources/test_resources.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+std::vector<PerBaseCoverage> all_pb_coverage(PRG_Info const& prg_info) {
+  std::vector<PerBaseCoverage> result;
+  auto const& layout = prg_info.pb_cov_layout;
+  for (uint32_t node = 0; node < layout.num_nodes(); ++node) {
+    if (layout.coverage_offset(node).has_value())
+      result.push_back(layout.get_node(node)->get_coverage());
+  }
+  return result;
+}
+}  // namespace
+
+class CoverageSnapshot : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mapped.setup_bracketed_prg(prg);
+    GenomicRead_vector reads;
+    for (int num_mapped{0}; num_mapped < 3; num_mapped++)
+      reads.push_back(GenomicRead("Read1", "ATCGGCTCGTCAT", "+++++++++++++"));
+    reads.push_back(GenomicRead("Read2", "ATCGGCGGG", "........."));
+    mapped.quasimap_reads(reads);
+    coverage::dump::snapshot(snapshot, mapped.coverage, mapped.prg_info,
+                             mapped.read_stats);
+
+    loaded.setup_bracketed_prg(prg);
+  }
+
+  ReadStats load(std::string const& contents) {
+    std::stringstream in(contents);
+    return coverage::load::snapshot(in, loaded.coverage, loaded.prg_info);
+  }
+
+  std::string const prg{"ATCGGC[TC[A,G]TC,GG[T,G]GG]AT"};
+  prg_setup mapped, loaded;
+  std::stringstream snapshot;
+};
+
+TEST_F(CoverageSnapshot, DumpThenLoad_SameCoverage) {
+  load(snapshot.str());
+  EXPECT_EQ(loaded.coverage.allele_sum_coverage,
+            mapped.coverage.allele_sum_coverage);
+  EXPECT_EQ(loaded.coverage.grouped_allele_counts,
+            mapped.coverage.grouped_allele_counts);
+  EXPECT_EQ(all_pb_coverage(loaded.prg_info), all_pb_coverage(mapped.prg_info));
+}
+
+TEST_F(CoverageSnapshot, DumpThenLoad_SameReadStats) {
+  auto const result = load(snapshot.str());
+  auto const& expected = mapped.read_stats;
+  EXPECT_EQ(result.get_mean_cov(), expected.get_mean_cov());
+  EXPECT_EQ(result.get_var_cov(), expected.get_var_cov());
+  EXPECT_EQ(result.get_num_sites_noCov(), expected.get_num_sites_noCov());
+  EXPECT_EQ(result.get_num_sites_total(), expected.get_num_sites_total());
+  EXPECT_EQ(result.get_mean_pb_error(), expected.get_mean_pb_error());
+  EXPECT_EQ(result.get_num_bases_processed(),
+            expected.get_num_bases_processed());
+  EXPECT_EQ(result.get_max_read_len(), expected.get_max_read_len());
+  EXPECT_EQ(result.get_num_no_qual_reads(), expected.get_num_no_qual_reads());
+}
+
+TEST_F(CoverageSnapshot, LoadTwice_CoverageAdded) {
+  load(snapshot.str());
+  load(snapshot.str());
+  AlleleSumCoverage expected = mapped.coverage.allele_sum_coverage;
+  for (auto& site : expected) {
+    for (auto& count : site) count *= 2;
+  }
+  EXPECT_EQ(loaded.coverage.allele_sum_coverage, expected);
+
+  auto const mapped_pb_cov = all_pb_coverage(mapped.prg_info);
+  auto const loaded_pb_cov = all_pb_coverage(loaded.prg_info);
+  ASSERT_EQ(loaded_pb_cov.size(), mapped_pb_cov.size());
+  for (std::size_t node = 0; node < mapped_pb_cov.size(); ++node) {
+    for (std::size_t base = 0; base < mapped_pb_cov[node].size(); ++base)
+      EXPECT_EQ(loaded_pb_cov[node][base], 2 * mapped_pb_cov[node][base]);
+  }
+}
+
+TEST_F(CoverageSnapshot, LoadIntoOtherPrg_Throws) {
+  prg_setup other;
+  other.setup_bracketed_prg("ATCGGC[TC,GG]AT");
+  std::stringstream in(snapshot.str());
+  EXPECT_THROW(coverage::load::snapshot(in, other.coverage, other.prg_info),
+               std::runtime_error);
+}
+
+TEST_F(CoverageSnapshot, LoadIntoPrgOfSameDimensions_Throws) {
+  prg_setup other;
+  other.setup_bracketed_prg("ATCGGC[TC[A,C]TC,GG[T,G]GG]AT");
+  ASSERT_EQ(other.prg_info.pb_cov_layout.coverage_space(),
+            mapped.prg_info.pb_cov_layout.coverage_space());
+  std::stringstream in(snapshot.str());
+  EXPECT_THROW(coverage::load::snapshot(in, other.coverage, other.prg_info),
+               std::runtime_error);
+}
+
+TEST_F(CoverageSnapshot, GroupedCountsOfAlleleNotInSite_Throws) {
+  auto bad_coverage = mapped.coverage;
+  auto const num_alleles = static_cast<AlleleId>(
+      bad_coverage.allele_sum_coverage.at(0).size());
+  bad_coverage.grouped_allele_counts.at(0)[AlleleGroup{{0, num_alleles}}] = 1;
+  std::stringstream bad_snapshot;
+  coverage::dump::snapshot(bad_snapshot, bad_coverage, mapped.prg_info,
+                           mapped.read_stats);
+  EXPECT_THROW(load(bad_snapshot.str()), std::runtime_error);
+}
+
+TEST_F(CoverageSnapshot, TruncatedOrNotSnapshot_Throws) {
+  auto const contents = snapshot.str();
+  EXPECT_THROW(load(contents.substr(0, contents.size() - 1)),
+               std::runtime_error);
+  EXPECT_THROW(load("GRAMCOV"), std::runtime_error);
+  EXPECT_THROW(load("not a snapshot"), std::runtime_error);
+}
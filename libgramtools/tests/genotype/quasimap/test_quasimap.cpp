@@ -64,6 +64,109 @@ TEST(KmersAllInRead, GivenKmerIndex_AllKmersInReadMustBeIndexed) {
   EXPECT_FALSE(all_read_kmers_occur_in_index(kmer_size, read2, index));
 }
 
+TEST(StrandsKmerCheck, GivenKmerIndex_EachStrandCheckedIndependently) {
+  uint32_t kmer_size = 3;
+  // Holds the kmers of "acgg", but not of its reverse complement "ccgt"
+  KmerIndex index{{encode_dna_bases("acg"), SearchStates{}},
+                  {encode_dna_bases("cgg"), SearchStates{}}};
+  auto result =
+      check_strands_kmers(kmer_size, encode_dna_bases("acgg"), index, nullptr);
+  EXPECT_FALSE(result.forward_rejection.has_value());
+  EXPECT_EQ(result.reverse_rejection, MappingOutcome::missing_kmer);
+
+  // Now with the reverse complement's kmers too
+  index.insert({encode_dna_bases("ccg"), SearchStates{}});
+  index.insert({encode_dna_bases("cgt"), SearchStates{}});
+  result =
+      check_strands_kmers(kmer_size, encode_dna_bases("acgg"), index, nullptr);
+  EXPECT_FALSE(result.forward_rejection.has_value());
+  EXPECT_FALSE(result.reverse_rejection.has_value());
+}
+
+TEST(StrandsKmerCheck, GivenKmerFilter_SameAsUnfilteredCheckOfEachStrand) {
+  uint32_t kmer_size = 4;
+  KmerIndex index;
+  for (auto const &kmer : {"acgt", "cgtt", "gtta", "aacg", "taac"})
+    index.insert({encode_dna_bases(kmer), SearchStates{}});
+  auto filter = kmer_filter::build(index);
+
+  for (auto const &read_str : {"acgtta", "taacgt", "acgtac", "gggg", "aac"}) {
+    auto read = encode_dna_bases(read_str);
+    auto result = check_strands_kmers(kmer_size, read, index, &filter);
+    EXPECT_EQ(not result.forward_rejection.has_value(),
+              all_read_kmers_occur_in_index(kmer_size, read, index));
+    EXPECT_EQ(not result.reverse_rejection.has_value(),
+              all_read_kmers_occur_in_index(
+                  kmer_size, reverse_complement_read(read), index));
+  }
+}
+
+TEST(StrandsKmerCheck, GivenStrandNotToCheck_NoRejection) {
+  KmerIndex index{};
+  auto result = check_strands_kmers(2, encode_dna_bases("acgt"), index,
+                                    nullptr, false, true);
+  EXPECT_FALSE(result.forward_rejection.has_value());
+  EXPECT_EQ(result.reverse_rejection, MappingOutcome::missing_kmer);
+}
+
+TEST(Coverage, ForwardReverseQuasimap_SameAsMappingEachStrand) {
+  prg_setup strands_together, strands_apart;
+  for (auto *setup : {&strands_together, &strands_apart}) {
+    setup->setup_numbered_prg("gct5c6g6T6AG7T8c8cta", 3);
+    setup->quasimap_stats.coverage = setup->coverage;
+  }
+
+  for (auto const &read : {encode_dna_bases("tagt"), encode_dna_bases("acta"),
+                           encode_dna_bases("cccc")}) {
+    quasimap_forward_reverse(strands_together.quasimap_stats, read,
+                             strands_together.parameters,
+                             strands_together.kmer_index,
+                             strands_together.prg_info, 42);
+    for (auto const &strand : {read, reverse_complement_read(read)})
+      quasimap_read(strand, strands_apart.quasimap_stats.coverage,
+                    strands_apart.kmer_index, strands_apart.prg_info,
+                    strands_apart.parameters, strands_apart.quasimap_stats,
+                    42);
+  }
+  auto const &together = strands_together.quasimap_stats;
+  auto const &apart = strands_apart.quasimap_stats;
+  EXPECT_EQ(together.coverage.allele_sum_coverage,
+            apart.coverage.allele_sum_coverage);
+  EXPECT_EQ(together.missing_kmer_reads_count, apart.missing_kmer_reads_count);
+  EXPECT_EQ(together.no_extension_reads_count, apart.no_extension_reads_count);
+  EXPECT_EQ(together.exact_mapped_reads_count, apart.exact_mapped_reads_count);
+}
+
+TEST(Coverage, FlatPrgMapping_SameAsNestedMapping) {
+  prg_setup flat, nested;
+  for (auto *setup : {&flat, &nested})
+    setup->setup_numbered_prg("gct5c6g6T6AG7T8c8cta", 3);
+
+  for (auto const &read :
+       {encode_dna_bases("tagt"), encode_dna_bases("ctgagtcta"),
+        encode_dna_bases("gct"), encode_dna_bases("cccc")}) {
+    auto const flat_mapping = search_read<Nesting::flat>(
+        read, flat.kmer_index, flat.prg_info, flat.parameters);
+    auto const nested_mapping = search_read<Nesting::nested>(
+        read, nested.kmer_index, nested.prg_info, nested.parameters);
+    EXPECT_EQ(flat_mapping.outcome, nested_mapping.outcome);
+    EXPECT_EQ(flat_mapping.search_states, nested_mapping.search_states);
+
+    quasimap_read<Nesting::flat>(read, flat.coverage, flat.kmer_index,
+                                 flat.prg_info, flat.parameters,
+                                 flat.quasimap_stats);
+    quasimap_read<Nesting::nested>(read, nested.coverage, nested.kmer_index,
+                                   nested.prg_info, nested.parameters,
+                                   nested.quasimap_stats);
+  }
+  EXPECT_EQ(flat.coverage.allele_sum_coverage,
+            nested.coverage.allele_sum_coverage);
+  EXPECT_EQ(flat.coverage.grouped_allele_counts,
+            nested.coverage.grouped_allele_counts);
+  EXPECT_EQ(flat.quasimap_stats.exact_mapped_reads_count,
+            nested.quasimap_stats.exact_mapped_reads_count);
+}
+
 TEST(Coverage, ReadCrossingSecondVariantSecondAllele_CorrectAlleleCoverage) {
   prg_setup setup;
   setup.setup_numbered_prg("gct5c6g6t6aG7t8C8CTA");
@@ -830,3 +933,110 @@ TEST_F(Coverage_Nested_SingleNestingPlusSNP,
       PerBaseCoverage{0},    PerBaseCoverage{1}};
   EXPECT_EQ(PbCov, expectedPbCov);
 }
+
+TEST_F(Coverage_Nested_SingleNestingPlusSNP,
+       ReadExceedingSearchLimitsWithDropPolicy_NoCoverage) {
+  setup.parameters.search_limits.max_search_states = 1;
+  setup.parameters.search_limits.policy = SearchLimitPolicy::drop;
+  quasimap_read(read2, setup.coverage, setup.kmer_index, setup.prg_info,
+                setup.parameters, setup.quasimap_stats);
+
+  EXPECT_EQ(setup.quasimap_stats.search_limit_dropped_reads_count, 1);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 0);
+  SitesGroupedAlleleCounts expectedGpAlCounts(4);
+  EXPECT_EQ(setup.coverage.grouped_allele_counts, expectedGpAlCounts);
+}
+
+TEST_F(Coverage_Nested_SingleNestingPlusSNP,
+       ReadExceedingSearchLimitsWithSkipPerBasePolicy_NoPerBaseCoverage) {
+  setup.parameters.search_limits.max_search_states = 1;
+  setup.parameters.search_limits.policy = SearchLimitPolicy::skip_per_base;
+  quasimap_read(read2, setup.coverage, setup.kmer_index, setup.prg_info,
+                setup.parameters, setup.quasimap_stats);
+
+  EXPECT_EQ(setup.quasimap_stats.search_limit_no_per_base_reads_count, 1);
+  EXPECT_EQ(setup.quasimap_stats.exact_mapped_reads_count, 1);
+  SitesGroupedAlleleCounts expectedGpAlCounts = {
+      GroupedAlleleCounts{{AlleleIds{0}, 1}},
+      GroupedAlleleCounts{{AlleleIds{0, 1}, 1}},
+      GroupedAlleleCounts{},
+      GroupedAlleleCounts{},
+  };
+  EXPECT_EQ(setup.coverage.grouped_allele_counts, expectedGpAlCounts);
+
+  auto PbCov = collect_coverage(setup.prg_info.coverage_graph, positions);
+  SitePbCoverage expectedPbCov{
+      PerBaseCoverage{},     PerBaseCoverage{0}, PerBaseCoverage{0, 0},
+      PerBaseCoverage{0},    PerBaseCoverage{0}, PerBaseCoverage{0},
+      PerBaseCoverage{0, 0}, PerBaseCoverage{0}, PerBaseCoverage{},
+      PerBaseCoverage{0},    PerBaseCoverage{0}};
+  EXPECT_EQ(PbCov, expectedPbCov);
+}
+
+TEST_F(Coverage_Nested_SingleNestingPlusSNP,
+       ReadExceedingSearchLimitsPartway_StopsExtendingUnderBothPolicies) {
+  // Read1 has two search states partway through its search, one at its end
+  setup.parameters.search_limits.max_search_states = 1;
+  auto const kmer = get_last_kmer_in_read(setup.parameters.kmers_size, read1);
+  for (auto const policy :
+       {SearchLimitPolicy::drop, SearchLimitPolicy::skip_per_base}) {
+    setup.parameters.search_limits.policy = policy;
+    bool exceeded_limits = false;
+    search_read_backwards(read1, kmer, setup.kmer_index, setup.prg_info,
+                          setup.parameters.search_limits, &exceeded_limits);
+    EXPECT_TRUE(exceeded_limits);
+  }
+
+  quasimap_read(read1, setup.coverage, setup.kmer_index, setup.prg_info,
+                setup.parameters, setup.quasimap_stats);
+  EXPECT_EQ(setup.quasimap_stats.search_limit_no_per_base_reads_count, 1);
+  auto PbCov = collect_coverage(setup.prg_info.coverage_graph, positions);
+  for (auto const &node_coverage : PbCov) {
+    for (auto const count : node_coverage) EXPECT_EQ(count, 0);
+  }
+}
+
+TEST(SearchLimits, GivenSearchStates_LimitsOnCountAndTotalSAIntervalWidth) {
+  SearchStates search_states{SearchState{SA_Interval{1, 4}},
+                             SearchState{SA_Interval{8, 8}}};
+  SearchLimits limits;
+  EXPECT_FALSE(exceeds_search_limits(search_states, limits));
+
+  limits.max_search_states = 2;
+  EXPECT_FALSE(exceeds_search_limits(search_states, limits));
+  limits.max_search_states = 1;
+  EXPECT_TRUE(exceeds_search_limits(search_states, limits));
+
+  limits.max_search_states = 0;
+  limits.max_sa_interval_width = 5;
+  EXPECT_FALSE(exceeds_search_limits(search_states, limits));
+  limits.max_sa_interval_width = 4;
+  EXPECT_TRUE(exceeds_search_limits(search_states, limits));
+}
+
+TEST(ReadBatchSizer, GivenCostPerRead_BatchHoldsTargetWorkWithinBounds) {
+  uint32_t num_threads = 4;
+  ReadBatchSizer sizer(num_threads);
+  EXPECT_EQ(sizer.batch_size(), ReadBatchSizer::initial_batch_size);
+
+  // 1000 reads in 0.05s on 4 threads: 0.2ms of thread time per read
+  sizer.record(1000, 0.05);
+  uint64_t expected = ReadBatchSizer::target_seconds * num_threads / 0.0002;
+  EXPECT_NEAR(sizer.batch_size(), expected, 1);
+
+  // Very slow reads: batch size floored
+  ReadBatchSizer slow_sizer(num_threads);
+  slow_sizer.record(1000, 1000);
+  EXPECT_EQ(slow_sizer.batch_size(), ReadBatchSizer::min_batch_size);
+
+  // Very fast reads: batch size capped
+  ReadBatchSizer fast_sizer(num_threads);
+  fast_sizer.record(1000, 0);
+  EXPECT_EQ(fast_sizer.batch_size(), ReadBatchSizer::max_batch_size);
+}
+
+TEST(ReadBatchSizer, GivenBufferSize_ChunksSpreadOverThreads) {
+  EXPECT_EQ(ReadBatchSizer::chunk_size(10, 4), 1);
+  EXPECT_EQ(ReadBatchSizer::chunk_size(4 * 32 * 8, 4), 8);
+  EXPECT_EQ(ReadBatchSizer::chunk_size(1000000, 4), 64);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file
+ * Test the cache of read mappings, and that quasimapping with it records the
+ * same coverage as quasimapping without it.
+ */
+
+#include "genotype/quasimap/coverage/allele_base.hpp"
+#include "genotype/quasimap/quasimap.hpp"
+#include "genotype/quasimap/read_cache.hpp"
+#include "gtest/gtest.h"
+#include "test_resources.hpp"
+
+using namespace gram;
+
+TEST(ReadCache, GivenZeroEntries_Throws) {
+  EXPECT_THROW(ReadCache(0), std::invalid_argument);
+}
+
+TEST(ReadCache, GivenInsertedRead_ReadFoundWithSameMapping) {
+  ReadCache cache(10);
+  auto read = encode_dna_bases("acgt");
+  ReadMapping mapping{MappingOutcome::mapped,
+                      SearchStates{SearchState{SA_Interval{1, 3}}}};
+  cache.insert(read, mapping);
+
+  auto result = cache.find(read);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->outcome, MappingOutcome::mapped);
+  EXPECT_EQ(result->search_states, mapping.search_states);
+  EXPECT_FALSE(cache.find(encode_dna_bases("acga")).has_value());
+}
+
+TEST(ReadCache, GivenMoreReadsThanCapacity_OldestReadEvicted) {
+  ReadCache cache(2, 1);
+  auto read1 = encode_dna_bases("aaa");
+  auto read2 = encode_dna_bases("ccc");
+  auto read3 = encode_dna_bases("ggg");
+  for (auto const& read : {read1, read2, read3})
+    cache.insert(read, ReadMapping{});
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_FALSE(cache.find(read1).has_value());
+  EXPECT_TRUE(cache.find(read2).has_value());
+  EXPECT_TRUE(cache.find(read3).has_value());
+}
+
+TEST(ReadCache, GivenReadInsertedTwice_StoredOnce) {
+  ReadCache cache(4, 1);
+  auto read = encode_dna_bases("acgt");
+  cache.insert(read, ReadMapping{MappingOutcome::no_extension});
+  cache.insert(read, ReadMapping{MappingOutcome::mapped});
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.find(read)->outcome, MappingOutcome::no_extension);
+}
+
+class QuasimapWithReadCache : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (auto* setup : {&uncached, &cached}) {
+      setup->setup_bracketed_prg("a[c,g[ct,t]a]tt[a,c]c", 2);
+    }
+  }
+
+  void map_all(prg_setup& setup, ReadCache* const read_cache) {
+    SeedSize seed = 7;
+    for (auto const& read : reads) {
+      quasimap_read(read, setup.coverage, setup.kmer_index, setup.prg_info,
+                    setup.parameters, setup.quasimap_stats, seed++,
+                    read_cache);
+    }
+  }
+
+  Sequences reads{encode_dna_bases("gctatt"), encode_dna_bases("gctatt"),
+                  encode_dna_bases("ttac"),   encode_dna_bases("gggg"),
+                  encode_dna_bases("gctatt"), encode_dna_bases("ttac")};
+  prg_setup uncached;
+  prg_setup cached;
+};
+
+TEST_F(QuasimapWithReadCache, RepeatedReads_SameCoverageAndCountsAsNoCache) {
+  ReadCache cache(100);
+  map_all(uncached, nullptr);
+  map_all(cached, &cache);
+
+  EXPECT_EQ(cached.coverage.allele_sum_coverage,
+            uncached.coverage.allele_sum_coverage);
+  EXPECT_EQ(cached.coverage.grouped_allele_counts,
+            uncached.coverage.grouped_allele_counts);
+  prg_positions positions{2, 4, 6, 7, 9, 11};
+  EXPECT_EQ(collect_coverage(cached.prg_info.coverage_graph, positions),
+            collect_coverage(uncached.prg_info.coverage_graph, positions));
+
+  auto const& stats = cached.quasimap_stats;
+  EXPECT_EQ(stats.missing_kmer_reads_count,
+            uncached.quasimap_stats.missing_kmer_reads_count);
+  EXPECT_EQ(stats.exact_mapped_reads_count,
+            uncached.quasimap_stats.exact_mapped_reads_count);
+  EXPECT_EQ(stats.read_cache_lookups_count, 6);
+  EXPECT_EQ(stats.read_cache_hits_count, 3);
+  EXPECT_EQ(uncached.quasimap_stats.read_cache_lookups_count, 0);
+}
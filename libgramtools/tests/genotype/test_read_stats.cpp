@@ -38,6 +38,24 @@ TEST(ReadProcessingStats, GivenOneOKAndOneEmptyGenomicRead_CorrectStats) {
   EXPECT_FLOAT_EQ(r.get_mean_pb_error(), 0.001);
 }
 
+TEST(ReadProcessingStats, AddBaseErrorRate_SameAsProcessedTogether) {
+  GenomicRead_vector first{GenomicRead{"Read1", "AAAA", "5555"}},
+      second{GenomicRead{"Read2", "AA", "??"}, GenomicRead{"Read3", "", ""}};
+  GenomicRead_vector both{first};
+  both.insert(both.end(), second.begin(), second.end());
+
+  ReadStats r, other, expected;
+  r.compute_base_error_rate(first);
+  other.compute_base_error_rate(second);
+  expected.compute_base_error_rate(both);
+  r.add_base_error_rate(other);
+
+  EXPECT_EQ(r.get_num_bases_processed(), expected.get_num_bases_processed());
+  EXPECT_EQ(r.get_num_no_qual_reads(), expected.get_num_no_qual_reads());
+  EXPECT_EQ(r.get_max_read_len(), expected.get_max_read_len());
+  EXPECT_FLOAT_EQ(r.get_mean_pb_error(), expected.get_mean_pb_error());
+}
+
 /**
  * Coverage mean and variance
  * Notes:
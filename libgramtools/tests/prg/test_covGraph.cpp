@@ -490,3 +490,39 @@ TEST(Target_map, EvenIsEntry_OddIsExit) {
 
   EXPECT_EQ(c.target_map, expected_map);
 }
+
+TEST(NodeAccessTable, GivenNodesSetAtPositions_OffsetsFromNodeStarts) {
+  auto site_entry = boost::make_shared<coverage_Node>(coverage_Node("", 0, 5));
+  auto allele = boost::make_shared<coverage_Node>(
+      coverage_Node("ACG", 0, 5, FIRST_ALLELE));
+  // Positions of "[ACG,"
+  node_access_table table(5);
+  table.set_node(0, site_entry, 0);
+  for (std::size_t offset = 0; offset < 3; ++offset)
+    table.set_node(offset + 1, allele, offset);
+  table.set_node(4, site_entry, 0);
+
+  std::vector<covG_ptr> expected_nodes{site_entry, allele, allele, allele,
+                                       site_entry};
+  std::vector<std::size_t> expected_offsets{0, 0, 1, 2, 0};
+  for (std::size_t pos = 0; pos < table.size(); ++pos) {
+    EXPECT_EQ(table.node(pos), expected_nodes[pos]);
+    EXPECT_EQ(table.offset(pos), expected_offsets[pos]);
+    EXPECT_EQ(table[pos].node, expected_nodes[pos]);
+  }
+}
+
+TEST(NodeAccessTable, GivenSparseTargets_TargetsFoundAcrossWords) {
+  node_access_table table(200);
+  std::map<std::size_t, VariantLocus> targets{
+      {1, {5, unkn}}, {3, {6, 1}}, {64, {7, first}}, {199, {9, 2}}};
+  for (auto const &target : targets)
+    table.set_target(target.first, target.second);
+
+  for (std::size_t pos = 0; pos < table.size(); ++pos) {
+    auto found = targets.find(pos);
+    auto expected = found == targets.end() ? VariantLocus{0, unkn}
+                                           : found->second;
+    EXPECT_EQ(table.target(pos), expected);
+  }
+}
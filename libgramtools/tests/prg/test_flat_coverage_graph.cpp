@@ -0,0 +1,184 @@
+#include <filesystem>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "common/little_endian.hpp"
+#include "prg/flat_coverage_graph.hpp"
+#include "prg/make_data_structures.hpp"
+#include "submod_resources.hpp"
+
+using namespace gram::submods;
+
+namespace {
+coverage_Graph make_cov_graph(std::string const& prg) {
+  PRG_String p{prg_string_to_ints(prg)};
+  return coverage_Graph{p};
+}
+
+/** The bytes `values` are serialised to */
+std::string serialised(std::vector<NodeId> const& values) {
+  std::stringstream stream;
+  LittleEndianWriter(stream).write_all(values);
+  return stream.str();
+}
+
+/** Replaces the serialised `node_ids`, found in `bytes`, by `corrupt_ids` */
+std::string corrupt(std::string bytes, std::vector<NodeId> const& node_ids,
+                    std::vector<NodeId> const& corrupt_ids) {
+  auto const found = bytes.find(serialised(node_ids));
+  if (found == std::string::npos) return "";
+  return bytes.replace(found, serialised(node_ids).size(),
+                       serialised(corrupt_ids));
+}
+}  // namespace
+
+TEST(FlatCoverageGraph, GivenNestedGraph_NodesInTopologicalOrder) {
+  auto cov_graph = make_cov_graph("ATCG[G[A,CCC]C,G]A[AT,T]A");
+  FlatCoverageGraph flat{cov_graph};
+
+  EXPECT_EQ(flat.get_pos(flat.root()), cov_graph.root->get_pos());
+  for (NodeId node = 0; node < flat.num_nodes(); ++node) {
+    for (auto edge = flat.edges_begin(node); edge != flat.edges_end(node);
+         ++edge)
+      EXPECT_GT(*edge, node);
+  }
+  // The sink is the only node without outgoing edges
+  EXPECT_EQ(flat.get_num_edges(flat.num_nodes() - 1), 0);
+}
+
+TEST(FlatCoverageGraph, GivenGraph_BubblesAndRandomAccessMatchNodeGraph) {
+  auto cov_graph = make_cov_graph("ATCG[G[A,CCC]C,G]A[AT,T]A");
+  FlatCoverageGraph flat{cov_graph};
+
+  ASSERT_EQ(flat.get_bubbles().size(), cov_graph.bubble_map.size());
+  auto flat_bubble = flat.get_bubbles().begin();
+  for (auto const& bubble : cov_graph.bubble_map) {
+    EXPECT_EQ(flat.get_site_ID(flat_bubble->first),
+              bubble.first->get_site_ID());
+    EXPECT_TRUE(flat.is_bubble_start(flat_bubble->first));
+    EXPECT_TRUE(flat.is_bubble_end(flat_bubble->second));
+    EXPECT_EQ(flat.get_pos(flat_bubble->second), bubble.second->get_pos());
+    ++flat_bubble;
+  }
+
+  ASSERT_EQ(flat.get_random_access().size(), cov_graph.random_access.size());
+  for (std::size_t i = 0; i < cov_graph.random_access.size(); ++i) {
+    auto const& access = cov_graph.random_access[i];
+    auto const& flat_access = flat.get_random_access()[i];
+    EXPECT_EQ(flat.get_sequence(flat_access.node),
+              access.node->get_sequence());
+    EXPECT_EQ(flat_access.offset, access.offset);
+    EXPECT_EQ(flat_access.target, access.target);
+  }
+}
+
+TEST(FlatCoverageGraph, GivenRecordedCoverage_CoverageStoredPerNode) {
+  auto cov_graph = make_cov_graph("AT[GC,G]A");
+  auto allele_node = cov_graph.bubble_map.begin()->first->get_edges()[0];
+  allele_node->set_coverage(PerBaseCoverage{3, 4});
+
+  FlatCoverageGraph flat{cov_graph};
+  auto flat_allele_node = flat.get_edge(flat.get_bubbles().front().first, 0);
+  ASSERT_EQ(flat.get_coverage_space(flat_allele_node), 2);
+  EXPECT_EQ(flat.get_coverage(flat_allele_node)[0], 3);
+  EXPECT_EQ(flat.get_coverage(flat_allele_node)[1], 4);
+  // Only nodes inside bubbles hold coverage
+  EXPECT_EQ(flat.get_all_coverage(), (PerBaseCoverage{3, 4, 0}));
+}
+
+TEST(FlatCoverageGraph, GivenFlatGraph_RebuiltNodeGraphIsIdentical) {
+  auto cov_graph = make_cov_graph("[AC[CG,C]TTT[C[A,G],G]T,GG]CA[A,G[A,C]]C");
+  cov_graph.random_access[1].node->get_ref_to_coverage().set(0, 5);
+  FlatCoverageGraph flat{cov_graph};
+
+  auto rebuilt = flat.to_coverage_Graph();
+  EXPECT_EQ(rebuilt, cov_graph);
+  EXPECT_EQ(rebuilt.is_nested, cov_graph.is_nested);
+  EXPECT_EQ(FlatCoverageGraph{rebuilt}, flat);
+}
+
+TEST(FlatCoverageGraphSerialisation, GivenSerialisedGraph_SameGraphBack) {
+  auto cov_graph = make_cov_graph("[AC[CG,C]TTT[C[A,G],G]T,GG]CA[A,G[A,C]]C");
+  cov_graph.random_access[1].node->get_ref_to_coverage().set(0, 5);
+  FlatCoverageGraph flat{cov_graph};
+
+  std::stringstream stream;
+  flat.serialise(stream);
+  auto deserialised = FlatCoverageGraph::deserialise(stream);
+  EXPECT_EQ(deserialised, flat);
+  EXPECT_EQ(deserialised.to_coverage_Graph(), cov_graph);
+}
+
+TEST(FlatCoverageGraphSerialisation, GivenSerialisedGraph_LittleEndianHeader) {
+  FlatCoverageGraph flat{make_cov_graph("A[C,G]T")};
+  std::stringstream stream;
+  flat.serialise(stream);
+  auto const bytes = stream.str();
+
+  EXPECT_EQ(bytes.substr(0, 8), "GRAMCOVG");
+  EXPECT_EQ(bytes.substr(8, 4), std::string("\x01\x00\x00\x00", 4));
+  EXPECT_TRUE(FlatCoverageGraph::has_format_magic(stream));
+}
+
+TEST(FlatCoverageGraphSerialisation, GivenOtherVersionOrTruncatedFile_Throws) {
+  FlatCoverageGraph flat{make_cov_graph("A[C,G]T")};
+  std::stringstream stream;
+  flat.serialise(stream);
+  auto const bytes = stream.str();
+
+  std::stringstream not_a_graph("not a coverage graph");
+  EXPECT_FALSE(FlatCoverageGraph::has_format_magic(not_a_graph));
+  EXPECT_THROW(FlatCoverageGraph::deserialise(not_a_graph), std::runtime_error);
+
+  auto other_version = bytes;
+  other_version[8] = 2;
+  std::stringstream other_version_stream(other_version);
+  EXPECT_THROW(FlatCoverageGraph::deserialise(other_version_stream),
+               std::runtime_error);
+
+  std::stringstream truncated(bytes.substr(0, bytes.size() / 2));
+  EXPECT_THROW(FlatCoverageGraph::deserialise(truncated), std::runtime_error);
+}
+
+TEST(FlatCoverageGraphSerialisation, GivenInvalidNodeNumbers_Throws) {
+  FlatCoverageGraph flat{make_cov_graph("AA[CC,GG]TT")};
+  std::stringstream stream;
+  flat.serialise(stream);
+  auto const bytes = stream.str();
+  std::vector<NodeId> edge_targets(flat.edges_begin(0),
+                                   flat.edges_end(flat.num_nodes() - 1));
+  std::vector<NodeId> bubble_nodes{flat.get_bubbles().at(0).first,
+                                   flat.get_bubbles().at(0).second};
+
+  auto edge_out_of_range = edge_targets;
+  edge_out_of_range.back() = 1000;
+  auto edge_backwards = edge_targets;
+  edge_backwards.back() = 0;
+  auto bubble_out_of_range = bubble_nodes;
+  bubble_out_of_range.back() = 1000;
+  for (auto const& corrupt_bytes :
+       {corrupt(bytes, edge_targets, edge_out_of_range),
+        corrupt(bytes, edge_targets, edge_backwards),
+        corrupt(bytes, bubble_nodes, bubble_out_of_range)}) {
+    ASSERT_FALSE(corrupt_bytes.empty());
+    std::stringstream corrupt_stream(corrupt_bytes);
+    EXPECT_THROW(FlatCoverageGraph::deserialise(corrupt_stream),
+                 std::runtime_error);
+  }
+}
+
+TEST(CovGraphFile, GivenGeneratedCovGraph_LoadedGraphIdentical) {
+  PRG_String prg_string{prg_string_to_ints("[A,]A[[G,A]A,C,T]")};
+  CommonParameters parameters;
+  parameters.cov_graph_fpath =
+      (std::filesystem::temp_directory_path() / "gram_test_cov_graph")
+          .string();
+
+  auto generated = generate_cov_graph(parameters, prg_string);
+  auto loaded = load_cov_graph(parameters);
+  std::filesystem::remove(parameters.cov_graph_fpath);
+  EXPECT_EQ(loaded, generated);
+  EXPECT_EQ(loaded.bubble_map.size(), generated.bubble_map.size());
+  EXPECT_EQ(loaded.is_nested, generated.is_nested);
+}
@@ -0,0 +1,178 @@
+#include "gtest/gtest.h"
+
+#include "genotype/quasimap/coverage/allele_base.hpp"
+#include "prg/per_base_layout.hpp"
+#include "submod_resources.hpp"
+#include "test_resources.hpp"
+
+using namespace gram::submods;
+using namespace gram::coverage::per_base;
+
+TEST(PbCovLayout, GivenGraph_CoverageSpaceHoldsAllBubbleNodes) {
+  auto prg_info =
+      generate_prg_info(prg_string_to_ints("AT[GC[GCC,CCGC],T]TTTT"));
+  auto const& layout = prg_info.pb_cov_layout;
+  EXPECT_EQ(layout.coverage_space(), 2 + 3 + 4 + 1);
+
+  auto const& random_access = prg_info.coverage_graph.random_access;
+  // "AT" is not in a bubble; "GC" is
+  EXPECT_FALSE(layout.coverage_offset(random_access.node_number(0)));
+  auto gc_node = random_access.node_number(3);
+  ASSERT_TRUE(layout.coverage_offset(gc_node));
+  EXPECT_EQ(layout.get_node(gc_node), random_access.node(3));
+}
+
+TEST(PbCovLayout, GivenReadThroughTwoSites_OneRangePerRecordedNode) {
+  // PRG: "GCT5C6G6T6AG7T8CC8CT"; Read: "CTGAGC" from position 1
+  auto prg_info = generate_prg_info(encode_prg("GCT5C6G6T6AG7T8CC8CT"));
+  auto const& layout = prg_info.pb_cov_layout;
+  auto const& random_access = prg_info.coverage_graph.random_access;
+  VariantSitePath path{VariantLocus{7, FIRST_ALLELE + 1},
+                       VariantLocus{5, FIRST_ALLELE + 1}};
+
+  CovRanges ranges;
+  layout.add_traversal(random_access.node_number(1), random_access.offset(1),
+                       path, 6, ranges);
+  auto g_node = random_access.node_number(6);
+  auto cc_node = random_access.node_number(15);
+  CovRanges expected{
+      CovRange{g_node, layout.coverage_offset(g_node).value(), 1},
+      CovRange{cc_node, layout.coverage_offset(cc_node).value(), 1}};
+  EXPECT_EQ(ranges, expected);
+
+  // Only the first node in a bubble
+  ranges.clear();
+  layout.add_traversal_start(random_access.node_number(1),
+                             random_access.offset(1), path, 6, ranges);
+  EXPECT_EQ(ranges, CovRanges{expected.front()});
+}
+
+TEST(PbCovLayout, GivenRangesInSameNode_MergedToTheirHull) {
+  CovRanges ranges{CovRange{3, 12, 1}, CovRange{1, 0, 2}, CovRange{3, 10, 1},
+                   CovRange{1, 1, 1}};
+  PbCovLayout::merge(ranges);
+  CovRanges expected{CovRange{1, 0, 2}, CovRange{3, 10, 3}};
+  EXPECT_EQ(ranges, expected);
+}
+
+/*
+ * Recording with the layout must give the same coverage as walking the graph
+ * with a `PbCovRecorder`.
+ */
+class PbCovLayout_SameAsRecorder : public ::testing::Test {
+ protected:
+  void SetUp() {
+    marker_vec v = prg_string_to_ints("AT[GC[GCC,CCGC],T]TTTT");
+    layout_prg_info = generate_prg_info(v);
+    walk_prg_info = generate_prg_info(v);
+  }
+
+  void record(SearchStates const& search_states, std::size_t read_size) {
+    coverage::record::allele_base(coverage, layout_prg_info, search_states,
+                                  read_size);
+    PbCovRecorder{walk_prg_info, search_states, read_size};
+  }
+
+  void expect_same_coverage() {
+    EXPECT_EQ(collect_coverage(layout_prg_info.coverage_graph, positions),
+              collect_coverage(walk_prg_info.coverage_graph, positions));
+  }
+
+  Coverage coverage;
+  PRG_Info layout_prg_info;
+  PRG_Info walk_prg_info;
+  prg_positions positions{0, 3, 6, 10, 16, 18};
+};
+
+TEST_F(PbCovLayout_SameAsRecorder, ReadsIntoAndOutOfNestedSite) {
+  // Read: CGCCTT
+  record(SearchStates{SearchState{
+             SA_Interval{5, 5},
+             VariantSitePath{VariantLocus{7, FIRST_ALLELE}}}},
+         6);
+  // Read: ATTTT
+  record(SearchStates{SearchState{
+             SA_Interval{1, 1},
+             VariantSitePath{VariantLocus{5, FIRST_ALLELE + 1}}}},
+         5);
+  expect_same_coverage();
+}
+
+TEST_F(PbCovLayout_SameAsRecorder, MultiMappedReads) {
+  // Read: GCC
+  record(SearchStates{SearchState{SA_Interval{9, 9},
+                                  VariantSitePath{
+                                      VariantLocus{7, FIRST_ALLELE + 1}}},
+                      SearchState{SA_Interval{8, 8}, VariantSitePath{}}},
+         3);
+  // Read: CTTT
+  record(SearchStates{SearchState{SA_Interval{6, 7}, VariantSitePath{}}}, 4);
+  expect_same_coverage();
+}
+
+TEST_F(PbCovLayout_SameAsRecorder, AccumulatedCoverage_AddedOnceMerged) {
+  coverage.pb_cov_accumulator = PbCovAccumulator(
+      layout_prg_info.pb_cov_layout.coverage_space(), 2);
+  // Read: CTTT, recorded twice
+  SearchStates search_states{SearchState{SA_Interval{6, 7}, VariantSitePath{}}};
+  record(search_states, 4);
+  record(search_states, 4);
+  auto const& gcc_node = layout_prg_info.coverage_graph.random_access[6].node;
+  EXPECT_EQ(gcc_node->get_coverage(), (PerBaseCoverage{0, 0, 0}));
+
+  coverage::record::accumulated_allele_base(coverage, layout_prg_info);
+  EXPECT_TRUE(coverage.pb_cov_accumulator.empty());
+  expect_same_coverage();
+}
+
+TEST_F(PbCovLayout_SameAsRecorder,
+       AccumulatedInSingleBaseBlocks_SameCoverage) {
+  // Ranges then span untouched blocks, whose bases are covered all the same
+  coverage.pb_cov_accumulator = PbCovAccumulator(
+      layout_prg_info.pb_cov_layout.coverage_space(), 2, 1);
+  // Read: GCC
+  record(SearchStates{SearchState{SA_Interval{9, 9},
+                                  VariantSitePath{
+                                      VariantLocus{7, FIRST_ALLELE + 1}}},
+                      SearchState{SA_Interval{8, 8}, VariantSitePath{}}},
+         3);
+  // Read: CTTT
+  record(SearchStates{SearchState{SA_Interval{6, 7}, VariantSitePath{}}}, 4);
+  coverage::record::accumulated_allele_base(coverage, layout_prg_info);
+  expect_same_coverage();
+}
+
+TEST(PbCovAccumulator, GivenRangesFromSeveralThreads_SummedDifferences) {
+  PbCovAccumulator accumulator(4, 2, 2);
+  accumulator.add(CovRanges{CovRange{1, 0, 2}}, 0);
+  accumulator.add(CovRanges{CovRange{1, 1, 1}, CovRange{2, 2, 2}}, 1);
+
+  PbCovAccumulator::BlockDifferences expected{
+      {0, {1, 1}}, {1, {-1, 0}}, {2, {-1, 0}}};
+  EXPECT_EQ(accumulator.take_differences(), expected);
+  EXPECT_TRUE(accumulator.empty());
+}
+
+TEST(PbCovAccumulator, GivenRangeOverManyBlocks_OnlyItsEndBlocksAllocated) {
+  PbCovAccumulator accumulator(100, 1, 10);
+  accumulator.add(CovRanges{CovRange{1, 15, 60}}, 0);
+
+  auto const differences = accumulator.take_differences();
+  ASSERT_EQ(differences.size(), 2);
+  EXPECT_EQ(differences.at(1).at(5), 1);
+  EXPECT_EQ(differences.at(7).at(5), -1);
+}
+
+TEST(PbCovAccumulator, GivenCoverageAboveMaximum_Saturates) {
+  auto prg_info = generate_prg_info(prg_string_to_ints("A[C,G]T"));
+  auto const& layout = prg_info.pb_cov_layout;
+  auto const node = prg_info.coverage_graph.random_access.node_number(2);
+  auto const range = CovRange{node, layout.coverage_offset(node).value(), 1};
+  auto const max_coverage = std::numeric_limits<CovCount>::max();
+  layout.get_node(node)->get_ref_to_coverage().set(0, max_coverage - 1);
+
+  PbCovAccumulator accumulator(layout.coverage_space(), 1);
+  for (int i = 0; i < 3; ++i) accumulator.add(CovRanges{range}, 0);
+  layout.add_accumulated(accumulator);
+  EXPECT_EQ(layout.get_node(node)->get_coverage()[0], max_coverage);
+}
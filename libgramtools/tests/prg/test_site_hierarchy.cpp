@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+
+#include "prg/make_data_structures.hpp"
+#include "prg/site_hierarchy.hpp"
+#include "submod_resources.hpp"
+
+using namespace gram::submods;
+
+namespace {
+marker_vec to_vec(SiteRange const& range) {
+  return marker_vec(range.begin(), range.end());
+}
+}  // namespace
+
+class SiteHierarchy_Nested : public ::testing::Test {
+ protected:
+  // Site 5 has sites 7 and 9 in its first allele and 11 in its second; site 9
+  // has site 13 in its third. Site 15 is not nested.
+  parental_map par_map{
+      {9, VariantLocus{5, FIRST_ALLELE}},
+      {7, VariantLocus{5, FIRST_ALLELE}},
+      {11, VariantLocus{5, FIRST_ALLELE + 1}},
+      {13, VariantLocus{9, FIRST_ALLELE + 2}},
+  };
+  SiteHierarchy hierarchy{par_map, 6};
+};
+
+TEST_F(SiteHierarchy_Nested, Parents) {
+  EXPECT_EQ(hierarchy.num_sites(), 6);
+  EXPECT_FALSE(hierarchy.has_parent(5));
+  EXPECT_FALSE(hierarchy.has_parent(15));
+  EXPECT_TRUE(hierarchy.has_parent(13));
+  EXPECT_EQ(hierarchy.parent_locus(11), VariantLocus(5, FIRST_ALLELE + 1));
+  EXPECT_EQ(hierarchy.parent_locus(13), VariantLocus(9, FIRST_ALLELE + 2));
+}
+
+TEST_F(SiteHierarchy_Nested, Depths) {
+  EXPECT_EQ(hierarchy.depth(5), 0);
+  EXPECT_EQ(hierarchy.depth(7), 1);
+  EXPECT_EQ(hierarchy.depth(13), 2);
+  EXPECT_EQ(hierarchy.depth(15), 0);
+}
+
+TEST_F(SiteHierarchy_Nested, Children_OrderedByAlleleThenSite) {
+  EXPECT_TRUE(hierarchy.has_children(5));
+  EXPECT_FALSE(hierarchy.has_children(7));
+  EXPECT_EQ(to_vec(hierarchy.children(5)), (marker_vec{7, 9, 11}));
+  EXPECT_EQ(to_vec(hierarchy.children(9)), marker_vec{13});
+  EXPECT_TRUE(hierarchy.children(15).empty());
+}
+
+TEST_F(SiteHierarchy_Nested, ChildrenOfAllele) {
+  EXPECT_EQ(to_vec(hierarchy.children(5, FIRST_ALLELE)), (marker_vec{7, 9}));
+  EXPECT_EQ(to_vec(hierarchy.children(5, FIRST_ALLELE + 1)), marker_vec{11});
+  EXPECT_TRUE(hierarchy.children(5, FIRST_ALLELE + 2).empty());
+  EXPECT_EQ(to_vec(hierarchy.children(9, FIRST_ALLELE + 2)), marker_vec{13});
+  EXPECT_TRUE(hierarchy.children(9, FIRST_ALLELE).empty());
+}
+
+TEST_F(SiteHierarchy_Nested, Ancestors) {
+  EXPECT_TRUE(hierarchy.is_ancestor(5, 13));
+  EXPECT_TRUE(hierarchy.is_ancestor(9, 13));
+  EXPECT_TRUE(hierarchy.is_ancestor(13, 13));
+  EXPECT_FALSE(hierarchy.is_ancestor(7, 13));
+  EXPECT_FALSE(hierarchy.is_ancestor(13, 9));
+  EXPECT_FALSE(hierarchy.is_ancestor(15, 13));
+  EXPECT_FALSE(hierarchy.is_ancestor(5, 15));
+}
+
+TEST_F(SiteHierarchy_Nested, FromChildMap_SameHierarchy) {
+  SiteHierarchy from_child_map{build_child_map(par_map)};
+  // Sites past the last nested site are not known from the child map alone
+  EXPECT_EQ(from_child_map.num_sites(), 5);
+  EXPECT_EQ(to_vec(from_child_map.children(5)), (marker_vec{7, 9, 11}));
+  EXPECT_EQ(from_child_map.parent_locus(13), VariantLocus(9, FIRST_ALLELE + 2));
+}
+
+TEST(SiteHierarchy, FromCoverageGraph_SameAsParentalMap) {
+  auto prg_info = generate_prg_info(prg_string_to_ints("[[A,C,G]A,T]T[,C]"));
+  auto const& cov_graph = prg_info.coverage_graph;
+  EXPECT_EQ(cov_graph.site_hierarchy,
+            SiteHierarchy(cov_graph.par_map, cov_graph.bubble_map.size()));
+  EXPECT_EQ(cov_graph.site_hierarchy.num_sites(), 3);
+  EXPECT_EQ(cov_graph.site_hierarchy.parent_locus(7),
+            VariantLocus(5, FIRST_ALLELE));
+  EXPECT_FALSE(cov_graph.site_hierarchy.has_parent(9));
+}
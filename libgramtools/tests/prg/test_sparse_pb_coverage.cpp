@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+
+#include "prg/sparse_pb_coverage.hpp"
+
+using namespace gram;
+
+TEST(SparsePbCoverage, GivenNoCoverage_NothingAllocated) {
+  SparsePbCoverage coverage(3 * SparsePbCoverage::block_size);
+  EXPECT_TRUE(coverage.is_zero());
+  EXPECT_EQ(coverage[5], 0);
+  EXPECT_EQ(coverage.to_dense(), PerBaseCoverage(coverage.size(), 0));
+
+  coverage.set(5, 0);
+  EXPECT_TRUE(coverage.is_zero());
+}
+
+TEST(SparsePbCoverage, GivenCoverageInOneBlock_OnlyThatBlockAllocated) {
+  auto const size = 3 * SparsePbCoverage::block_size;
+  SparsePbCoverage coverage(size);
+  auto const base = SparsePbCoverage::block_size + 2;
+  coverage.increment(base);
+  coverage.increment(base);
+
+  EXPECT_EQ(coverage.num_allocated_blocks(), 1);
+  PerBaseCoverage expected(size, 0);
+  expected[base] = 2;
+  EXPECT_EQ(coverage.to_dense(), expected);
+}
+
+TEST(SparsePbCoverage, GivenDenseCoverage_SameCoverageBack) {
+  PerBaseCoverage dense(SparsePbCoverage::block_size + 1, 0);
+  dense.back() = 4;
+  SparsePbCoverage coverage(dense);
+  EXPECT_EQ(coverage.num_allocated_blocks(), 1);
+  EXPECT_EQ(coverage.to_dense(), dense);
+
+  auto copy = coverage;
+  EXPECT_EQ(copy, coverage);
+  copy.increment(0);
+  EXPECT_NE(copy, coverage);
+}
+
+TEST(SparsePbCoverage, GivenResize_CoverageKeptAndNewBasesZero) {
+  SparsePbCoverage coverage(PerBaseCoverage{1, 0, 2});
+  coverage.resize(5);
+  EXPECT_EQ(coverage.to_dense(), (PerBaseCoverage{1, 0, 2, 0, 0}));
+}
+
+TEST(SparsePbCoverage, GivenCoverageAtMaximum_IncrementSaturates) {
+  SparsePbCoverage coverage(1);
+  coverage.set(0, max_cov_count);
+  coverage.increment(0);
+  EXPECT_EQ(coverage[0], max_cov_count);
+}
+
+TEST(SparsePbCoverage, GivenConcurrentIncrementsPastMaximum_Saturates) {
+  // Started close to the maximum, so that wide counters get there quickly
+  CovCount const start = max_cov_count > 10000 ? max_cov_count - 10000 : 0;
+  SparsePbCoverage coverage(PerBaseCoverage{start});
+  CovTotal const num_increments{static_cast<CovTotal>(max_cov_count - start) +
+                                100};
+#pragma omp parallel for num_threads(4)
+  for (CovTotal i = 0; i < num_increments; ++i) coverage.increment(0);
+  EXPECT_EQ(coverage[0], max_cov_count);
+}
+
+TEST(SparsePbCoverage, GivenAppendTo_CoverageAddedAfterExistingBases) {
+  SparsePbCoverage coverage(PerBaseCoverage{0, 3});
+  PerBaseCoverage dense{1};
+  coverage.append_to(dense);
+  SparsePbCoverage(2).append_to(dense);
+  EXPECT_EQ(dense, (PerBaseCoverage{1, 0, 3, 0, 0}));
+}
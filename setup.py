@@ -16,12 +16,15 @@ def _test_backend(root_dir):
     )
     test_dir = Path(root_dir) / "libgramtools" / "tests"
 
-    return_code = subprocess.run(
-        [str(test_dir / "test_main.bin")], cwd=test_dir
-    ).returncode
-    if return_code != 0:
-        print("ERROR: gramtools backend test runner returned: ", return_code)
-        exit(1)
+    # One test runner per coverage counter width the backend was built with
+    for test_runner in ("test_main", "test_main_narrow", "test_main_wide"):
+        test_fpath = test_dir / f"{test_runner}.bin"
+        if test_runner != "test_main" and not test_fpath.exists():
+            continue
+        return_code = subprocess.run([str(test_fpath)], cwd=test_dir).returncode
+        if return_code != 0:
+            print(f"ERROR: gramtools backend {test_runner} returned: ", return_code)
+            exit(1)
 
 
 ## Run the front end unit tests: operations making prg, `infer`, integration tests.